@@ -0,0 +1,471 @@
+/*
+ * bsl_bench.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Microbenchmarks of the protocol hot paths.
+ * Results are printed as a table and optionally written as JSON (--json <path>).
+ */
+
+#include "bsl_cli.h"
+#include "bsl_cli_options.h"
+#include "bsl_packet.h"
+#include "bsl_tool.h"
+#include "bsl_timing.h"
+#include "loopback_transport.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <set>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#if _HAVE_BOOST_PROGRAM_OPTIONS_
+#include <boost/program_options.hpp>
+#endif
+
+struct _result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double mb_per_s;    // 0 if not a throughput benchmark
+};
+
+static std::vector<_result> results;
+static uint64_t min_sample_us = 200000;
+static constexpr int samples = 5;
+
+// benchmarks whose command did not succeed, timing a failure measures nothing
+static std::set<std::string> failed;
+
+static void expect(bool ok, const std::string &name)
+{
+    if(!ok && failed.insert(name).second)
+        printf("%s: command failed\n", name.c_str());
+}
+
+// keeps the compiler from dropping benchmarked results
+static void do_not_optimize(const void* p)
+{
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+static void bench(const std::string &name, size_t bytes_per_op, const std::function<void()> &fn)
+{
+    // grow the batch until one sample takes long enough to time reliably
+    uint64_t batch = 1;
+    while(true) {
+        timespec start = BSLTiming::now();
+        for(uint64_t i = 0; i < batch; i++)
+            fn();
+        if(BSLTiming::elapsed_us(start) >= min_sample_us / samples || batch >= (1ULL << 30))
+            break;
+        batch *= 2;
+    }
+
+    std::vector<double> ns;
+    for(int s = 0; s < samples; s++) {
+        timespec start = BSLTiming::now();
+        for(uint64_t i = 0; i < batch; i++)
+            fn();
+        ns.push_back(BSLTiming::elapsed_us(start) * 1000.0 / batch);
+    }
+    std::sort(ns.begin(), ns.end());
+
+    _result r = {name, batch * samples, ns[samples / 2], 0};
+    if(bytes_per_op > 0 && r.ns_per_op > 0)
+        r.mb_per_s = bytes_per_op / r.ns_per_op * 1e9 / (1024 * 1024);
+    results.push_back(r);
+
+    printf("%-40s %14.1f ns/op", name.c_str(), r.ns_per_op);
+    if(r.mb_per_s > 0)
+        printf(" %10.2f MB/s", r.mb_per_s);
+    printf("\n");
+}
+
+static void bench_crc()
+{
+    const size_t sizes[] = {133, 1024, 32 * 1024, 128 * 1024, 512 * 1024};
+    std::vector<uint8_t> buf(512 * 1024);
+    for(size_t i = 0; i < buf.size(); i++)
+        buf[i] = (uint8_t) (i * 31 + 7);
+
+    for(size_t size : sizes) {
+        bench("crc32/" + std::to_string(size) + "B", size, [&]() {
+            uint32_t crc = BSL::softwareCRC(buf.data(), size);
+            do_not_optimize(&crc);
+        });
+    }
+}
+
+static void bench_build()
+{
+    struct _case {
+        BSL::CoreCmd cmd;
+        uint16_t data_len;
+    };
+    // data layout sizes as sent by BSL_UART
+    const _case cases[] = {
+        {BSL::CoreCmd::Connection, 0},
+        {BSL::CoreCmd::GetDeviceInfo, 0},
+        {BSL::CoreCmd::UnlockBootloader, 32},
+        {BSL::CoreCmd::MassErase, 0},
+        {BSL::CoreCmd::FlashRangeErase, 8},
+        {BSL::CoreCmd::ProgramData, 4 + 128},
+        {BSL::CoreCmd::ProgramDataFast, 4 + 128},
+        {BSL::CoreCmd::MemoryRead, 8},
+        {BSL::CoreCmd::FactoryReset, 32},
+        {BSL::CoreCmd::StandaloneVerification, 8},
+        {BSL::CoreCmd::StartApplication, 0},
+        {BSL::CoreCmd::ChangeBaudrate, 1},
+    };
+
+    uint8_t data[256];
+    uint8_t packet[BSL::packet_len(1 + sizeof(data))];
+    memset(data, 0x5A, sizeof(data));
+
+    for(const auto &c : cases) {
+        bench(std::string("build/") + BSL::CoreCmdToString(c.cmd), BSL::packet_len(1 + c.data_len), [&]() {
+            size_t len = BSL::build_packet(packet, c.cmd, data, c.data_len);
+            do_not_optimize(packet);
+            do_not_optimize(&len);
+        });
+    }
+}
+
+static std::vector<uint8_t> make_response(BSL::CoreResponse code, uint16_t data_len)
+{
+    std::vector<uint8_t> rsp(BSL::packet_len(1 + data_len));
+    const uint16_t core_len = 1 + data_len;
+    rsp[0] = BSL::RSP_HEADER;
+    memcpy(&rsp[1], &core_len, 2);
+    rsp[3] = static_cast<uint8_t>(code);
+    for(uint16_t i = 0; i < data_len; i++)
+        rsp[4 + i] = (uint8_t) i;
+    uint32_t crc = BSL::softwareCRC(&rsp[3], core_len);
+    memcpy(&rsp[3 + core_len], &crc, 4);
+    return rsp;
+}
+
+static void bench_parse()
+{
+    struct _case {
+        const char* name;
+        BSL::CoreResponse code;
+        uint16_t data_len;
+    };
+    const _case cases[] = {
+        {"Message", BSL::CoreResponse::Message, 1},
+        {"GetDeviceInfo", BSL::CoreResponse::GetDeviceInfo, 24},
+        {"StandaloneVerification", BSL::CoreResponse::StandaloneVerification, 4},
+        {"MemoryRead_128B", BSL::CoreResponse::MemoryRead, 128},
+        {"MemoryRead_1KB", BSL::CoreResponse::MemoryRead, 1024},
+    };
+
+    for(const auto &c : cases) {
+        auto rsp = make_response(c.code, c.data_len);
+        bench(std::string("parse/") + c.name, rsp.size(), [&]() {
+            BSL::_response_view view;
+            bool ok = BSL::parse_response(rsp.data(), rsp.size(), view);
+            do_not_optimize(&ok);
+            do_not_optimize(&view);
+        });
+    }
+
+    auto rsp = make_response(BSL::CoreResponse::GetDeviceInfo, 24);
+    bench("parse/device_info_fields", 0, [&]() {
+        BSL::_response_view view;
+        BSL::_device_info info;
+        BSL::parse_response(rsp.data(), rsp.size(), view);
+        bool ok = BSL::parse_device_info(view, info);
+        do_not_optimize(&ok);
+        do_not_optimize(&info);
+    });
+}
+
+static void bench_image()
+{
+    const size_t sizes_kb[] = {32, 64, 128, 256, 512};
+    char path[] = "/tmp/bsl_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        printf("Can not create temp image, skipping image benchmarks\n");
+        return;
+    }
+    close(fd);
+
+    for(size_t kb : sizes_kb) {
+        const size_t size = kb * 1024;
+        std::vector<uint8_t> content(size);
+        for(size_t i = 0; i < size; i++)
+            content[i] = (uint8_t) (i * 13 + 1);
+        FILE* f = fopen(path, "wb");
+        fwrite(content.data(), 1, size, f);
+        fclose(f);
+
+        // the flash path: open, read whole image, CRC over it (as verify does)
+        std::vector<uint8_t> data(size);
+        BSLTool tool((const char*) nullptr, BSL_Entry::Method::None);
+        bench("image/load_crc_" + std::to_string(kb) + "KB", size, [&]() {
+            uint32_t file_size = 0;
+            tool.open_file(path, file_size);
+            tool.read_file(data.data(), file_size);
+            uint32_t crc = BSL::softwareCRC(data.data() + 8, file_size - 8);
+            tool.close_file();
+            do_not_optimize(&crc);
+        });
+    }
+
+    unlink(path);
+}
+
+static void bench_loopback()
+{
+    // full command round trips through BSL_UART against the device model
+    BSLTarget target;
+    BSL_UART uart(new LoopbackTransport(target));
+    expect(uart.connect() == BSL::AckType::BSL_ACK, "loopback/setup");
+    expect(std::get<1>(uart.unlock_bootloader()) == BSL::CoreMessage::SUCCESS, "loopback/setup");
+
+    bench("loopback/Connection", 0, [&]() {
+        auto ack = uart.connect();
+        expect(ack == BSL::AckType::BSL_ACK, "loopback/Connection");
+    });
+    bench("loopback/GetDeviceInfo", 0, [&]() {
+        auto rsp = uart.get_device_info();
+        expect(std::get<0>(rsp) == BSL::AckType::BSL_ACK, "loopback/GetDeviceInfo");
+        do_not_optimize(&rsp);
+    });
+    bench("loopback/UnlockBootloader", 0, [&]() {
+        auto rsp = uart.unlock_bootloader();
+        expect(std::get<0>(rsp) == BSL::AckType::BSL_ACK && std::get<1>(rsp) == BSL::CoreMessage::SUCCESS, "loopback/UnlockBootloader");
+    });
+
+    const size_t sizes_kb[] = {1, 32, 128};
+    for(size_t kb : sizes_kb) {
+        const std::string name = "loopback/StandaloneVerification_" + std::to_string(kb) + "KB";
+        const uint32_t expected = BSL::softwareCRC(target.get_flash().data(), kb * 1024);
+        bench(name, kb * 1024, [&]() {
+            auto [ack, msg, crc] = uart.verify(0, kb * 1024);
+            expect(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS && crc == expected, name);
+        });
+    }
+
+    // host side cost of programming, the unpipelined path sleeps between frames and is left out
+    std::vector<uint8_t> image(32 * 1024, 0xA5);
+    const int windows[] = {1, 4};
+    for(int window : windows) {
+        const std::string name = "loopback/ProgramData_32KB_window" + std::to_string(window);
+        uart.set_pipeline(true, window);
+        bench(name, image.size(), [&]() {
+            auto [ack, msg] = uart.program_data(0, image.data(), image.size());
+            expect(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS, name);
+        });
+        expect(!memcmp(target.get_flash().data(), image.data(), image.size()), name);
+    }
+}
+
+static void bench_cli()
+{
+    // a per-unit flash call, parsed the way main() does it
+    const char* argv[] = {"MSPM0_bsl_flasher", "flash", "/dev/ttyACM0", "/home/foo/bar.bin", "--enter-bsl", "false",
+        "--verbose", "1", "--fixture", "station1", "--retries", "5", "--entry", "modem"};
+    const int argc = sizeof(argv) / sizeof(argv[0]);
+
+    static const BSLCli::_command commands[] = {
+        {"flash", "", {BSLCli::group(BSLCli::flash_options), BSLCli::group(BSLCli::entry_options)}, nullptr},
+    };
+
+    bench("cli/table_flash", 0, [&]() {
+        int cmd = BSLCli::find_command(commands, argv[1]);
+        BSLCli::Args args;
+        args.parse(commands[cmd], argc - 2, argv + 2);
+        int retries = args.get_int("retries");
+        do_not_optimize(&retries);
+    });
+
+#if _HAVE_BOOST_PROGRAM_OPTIONS_
+    // the former main(): main options with unregistered ones, then the flash reparse
+    namespace po = boost::program_options;
+    bench("cli/boost_flash", 0, [&]() {
+        po::options_description main_desc("Main options");
+        main_desc.add_options()
+            ("help,h", "produce help message")
+            ("version,v", "print version")
+            ("command", po::value<std::string>(), "command")
+            ("cmd-args", po::value<std::vector<std::string> >(), "arguments for command")
+        ;
+        po::positional_options_description main_p;
+        main_p.add("command", 1);
+        main_p.add("cmd-args", -1);
+
+        po::variables_map vm;
+        po::parsed_options parsed = po::command_line_parser(argc, argv).options(main_desc).positional(main_p).allow_unregistered().run();
+        po::store(parsed, vm);
+        po::notify(vm);
+
+        // the same options as the table, described the Boost way
+        po::options_description desc("flash options");
+        po::positional_options_description p;
+        for(const BSLCli::_group &g : commands[0].groups) {
+            for(size_t i = 0; i < g.count; i++) {
+                const BSLCli::_option &opt = g.options[i];
+                std::string name = opt.name;
+                if(opt.short_name != 0)
+                    name += std::string(",") + opt.short_name;
+                switch(opt.type) {
+                case BSLCli::Type::Flag:
+                    desc.add_options()(name.c_str(), opt.help);
+                    break;
+                case BSLCli::Type::Bool: {
+                    auto* v = po::value<bool>();
+                    if(opt.default_value != nullptr)
+                        v->default_value(!strcmp(opt.default_value, "true"));
+                    desc.add_options()(name.c_str(), v, opt.help);
+                    break;
+                }
+                case BSLCli::Type::Int: {
+                    auto* v = po::value<int>();
+                    if(opt.default_value != nullptr)
+                        v->default_value(atoi(opt.default_value));
+                    desc.add_options()(name.c_str(), v, opt.help);
+                    break;
+                }
+                case BSLCli::Type::String: {
+                    auto* v = po::value<std::string>();
+                    if(opt.default_value != nullptr)
+                        v->default_value(opt.default_value);
+                    desc.add_options()(name.c_str(), v, opt.help);
+                    break;
+                }
+                }
+                if(opt.position > 0)
+                    p.add(opt.name, 1);
+            }
+        }
+
+        std::vector<std::string> opts = po::collect_unrecognized(parsed.options, po::include_positional);
+        opts.erase(opts.begin());
+        po::store(po::command_line_parser(opts).options(desc).positional(p).run(), vm);
+        int retries = vm["retries"].as<int>();
+        do_not_optimize(&retries);
+    });
+#endif
+}
+
+// exec to exit of the flasher, what a script calling it once per unit pays
+static bool run_flasher(const char* path, const std::vector<const char*> &args)
+{
+    pid_t pid = fork();
+    if(pid < 0)
+        return false;
+    if(pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if(null >= 0) {
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        std::vector<char*> argv = {(char*) path};
+        for(const char* a : args)
+            argv.push_back((char*) a);
+        argv.push_back(nullptr);
+        execv(path, argv.data());
+        _exit(127);
+    }
+
+    int status;
+    while(waitpid(pid, &status, 0) < 0) {
+        if(errno != EINTR)
+            return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void bench_startup(const char* flasher)
+{
+    if(flasher == nullptr) {
+        printf("startup: skipped, no --flasher given\n");
+        return;
+    }
+
+    const std::vector<const char*> version = {"--version"};
+    const std::vector<const char*> flash_help = {"flash", "--help"};
+    bench("startup/version", 0, [&]() {
+        expect(run_flasher(flasher, version), "startup/version");
+    });
+    bench("startup/flash_help", 0, [&]() {
+        expect(run_flasher(flasher, flash_help), "startup/flash_help");
+    });
+}
+
+static bool write_json(const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if(f == nullptr) {
+        printf("Can not write %s\n", path);
+        return false;
+    }
+
+    fprintf(f, "{\"project\":\"%s\",\"version\":\"%s.%s.%s\",\"results\":[", _PROJECT_NAME_, _VERSION_MAJOR_, _VERSION_MINOR_, _VERSION_PATCH_);
+    for(size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        fprintf(f, "%s\n{\"name\":\"%s\",\"iterations\":%lu,\"ns_per_op\":%.1f,\"mb_per_s\":%.3f}",
+            i ? "," : "", r.name.c_str(), r.iterations, r.ns_per_op, r.mb_per_s);
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* json_path = nullptr;
+    const char* flasher = nullptr;
+    std::string filter;
+
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "--quick")) {
+            min_sample_us = 20000;
+        } else if(!strcmp(argv[i], "--json") && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if(!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if(!strcmp(argv[i], "--flasher") && i + 1 < argc) {
+            flasher = argv[++i];
+        } else {
+            printf("Usage: MSPM0_bsl_bench [--quick] [--json <path>] [--flasher <path>] [--filter crc|build|parse|image|loopback|cli|startup]\n");
+            return 1;
+        }
+    }
+
+    if(filter.empty() || filter == "crc")
+        bench_crc();
+    if(filter.empty() || filter == "build")
+        bench_build();
+    if(filter.empty() || filter == "parse")
+        bench_parse();
+    if(filter.empty() || filter == "image")
+        bench_image();
+    if(filter.empty() || filter == "loopback")
+        bench_loopback();
+    if(filter.empty() || filter == "cli")
+        bench_cli();
+    if(filter.empty() || filter == "startup")
+        bench_startup(flasher);
+
+    if(json_path != nullptr && !write_json(json_path))
+        return 1;
+
+    if(!failed.empty()) {
+        printf("%zu benchmarks failed\n", failed.size());
+        return 1;
+    }
+    return results.empty() ? 1 : 0;
+}
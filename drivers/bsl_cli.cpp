@@ -0,0 +1,341 @@
+/*
+ * bsl_cli.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_cli.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <stdexcept>
+#include <strings.h>
+
+namespace BSLCli {
+
+static constexpr size_t line_length = 80;
+static constexpr size_t min_column = 24;
+static constexpr size_t max_column = 40;
+
+bool parse_bool(const char* text, bool &value)
+{
+    static const char* const yes[] = {"true", "1", "yes", "on"};
+    static const char* const no[] = {"false", "0", "no", "off"};
+    for(const char* s : yes) {
+        if(strcasecmp(text, s) == 0) {
+            value = true;
+            return true;
+        }
+    }
+    for(const char* s : no) {
+        if(strcasecmp(text, s) == 0) {
+            value = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_int(const char* text, int &value)
+{
+    char* end = nullptr;
+    errno = 0;
+    long v = strtol(text, &end, 10);
+    if(*text == '\0' || *end != '\0' || errno != 0 || v < INT_MIN || v > INT_MAX)
+        return false;
+    value = v;
+    return true;
+}
+
+const _option &Args::option_at(int index) const
+{
+    const _group &first = command->groups[0];
+    if((size_t) index < first.count)
+        return first.options[index];
+    return command->groups[1].options[index - first.count];
+}
+
+int Args::find_long(const char* name, size_t len, bool exact) const
+{
+    std::vector<const char*> matches;
+    int found = -1;
+
+    for(size_t i = 0; i < values.size(); i++) {
+        const char* candidate = option_at(i).name;
+        if(strncmp(candidate, name, len) != 0)
+            continue;
+        if(candidate[len] == '\0')
+            return i;
+        if(exact)
+            continue;
+
+        found = i;
+        matches.push_back(candidate);
+    }
+
+    if(matches.size() > 1) {
+        // same wording as Boost
+        std::sort(matches.begin(), matches.end(), [](const char* a, const char* b) { return strcmp(a, b) < 0; });
+        std::string list;
+        for(size_t i = 0; i < matches.size(); i++) {
+            if(i > 0)
+                list += (i + 1 < matches.size()) ? ", " : (matches.size() > 2 ? ", and " : " and ");
+            list += std::string("'--") + matches[i] + "'";
+        }
+        throw std::invalid_argument("option '--" + std::string(name, len) + "' is ambiguous and matches " + list);
+    }
+    return found;
+}
+
+int Args::find_short(char name) const
+{
+    for(size_t i = 0; i < values.size(); i++) {
+        if(option_at(i).short_name == name)
+            return i;
+    }
+    return -1;
+}
+
+void Args::store(int index, const char* text, const char* spelled)
+{
+    const _option &opt = option_at(index);
+    const std::string quoted = std::string("'") + spelled + "'";
+
+    if(values[index] != nullptr && values[index] != opt.default_value)
+        throw std::invalid_argument("option " + quoted + " cannot be specified more than once");
+
+    bool b;
+    int i;
+    if(opt.type == Type::Bool && !parse_bool(text, b))
+        throw std::invalid_argument("the argument ('" + std::string(text) + "') for option " + quoted + " is invalid");
+    if(opt.type == Type::Int && !parse_int(text, i))
+        throw std::invalid_argument("the argument ('" + std::string(text) + "') for option " + quoted + " is invalid");
+
+    values[index] = text;
+}
+
+void Args::parse(const _command &_command, int argc, const char* const argv[])
+{
+    command = &_command;
+    values.clear();
+    rest_values.clear();
+    for(const _group &g : command->groups) {
+        for(size_t i = 0; i < g.count; i++)
+            values.push_back(g.options[i].default_value);
+    }
+
+    int position = 0;
+    bool options_end = false;
+    for(int a = 0; a < argc; a++) {
+        const char* arg = argv[a];
+        int index;
+        const char* inline_value = nullptr;
+        std::string spelled;
+
+        if(!options_end && strcmp(arg, "--") == 0) {
+            // as in Boost, everything after a bare -- is positional
+            options_end = true;
+            continue;
+        }
+
+        const bool named = !options_end && arg[0] == '-' && arg[1] != '\0';
+        if(named && arg[1] == '-') {
+            const char* name = arg + 2;
+            const char* eq = strchr(name, '=');
+            size_t len = eq != nullptr ? eq - name : strlen(name);
+            if(eq != nullptr)
+                inline_value = eq + 1;
+
+            index = find_long(name, len, false);
+            if(index < 0)
+                throw std::invalid_argument("unrecognised option '--" + std::string(name, len) + "'");
+            spelled = std::string("--") + option_at(index).name;
+        } else if(named) {
+            index = find_short(arg[1]);
+            if(index < 0)
+                throw std::invalid_argument("unrecognised option '-" + std::string(1, arg[1]) + "'");
+            if(arg[2] != '\0')
+                inline_value = arg + 2;
+            spelled = std::string("--") + option_at(index).name;
+        } else {
+            // positional, fills the options in the order of their position
+            position++;
+            index = -1;
+            for(size_t i = 0; i < values.size(); i++) {
+                if(option_at(i).position == position)
+                    index = i;
+            }
+            if(index < 0) {
+                // the rest option collects what no numbered one takes
+                for(size_t i = 0; i < values.size(); i++) {
+                    if(option_at(i).position == rest)
+                        index = i;
+                }
+                if(index >= 0 && values[index] != nullptr) {
+                    rest_values.push_back(arg);
+                    continue;
+                }
+            }
+            if(index < 0)
+                throw std::invalid_argument("too many positional options have been specified on the command line");
+            store(index, arg, (std::string("--") + option_at(index).name).c_str());
+            continue;
+        }
+
+        const _option &opt = option_at(index);
+        if(opt.type == Type::Flag) {
+            if(inline_value != nullptr)
+                throw std::invalid_argument("option '" + spelled + "' does not take any arguments");
+            values[index] = "";
+            continue;
+        }
+
+        if(inline_value == nullptr) {
+            if(a + 1 >= argc)
+                throw std::invalid_argument("the required argument for option '" + spelled + "' is missing");
+            inline_value = argv[++a];
+        }
+        store(index, inline_value, spelled.c_str());
+    }
+}
+
+const char* Args::value(const char* name) const
+{
+    int index = find_long(name, strlen(name), true);
+    if(index < 0)
+        throw std::logic_error("option '--" + std::string(name) + "' is not defined for " + command->name);
+    return values[index];
+}
+
+size_t Args::count(const char* name) const
+{
+    return value(name) != nullptr;
+}
+
+std::string Args::get_string(const char* name) const
+{
+    const char* v = value(name);
+    return v != nullptr ? v : "";
+}
+
+int Args::get_int(const char* name) const
+{
+    const char* v = value(name);
+    int i = 0;
+    if(v != nullptr)
+        parse_int(v, i);
+    return i;
+}
+
+bool Args::get_bool(const char* name) const
+{
+    const char* v = value(name);
+    bool b = false;
+    if(v != nullptr)
+        parse_bool(v, b);
+    return b;
+}
+
+std::vector<std::string> Args::get_list(const char* name) const
+{
+    std::vector<const char*> given;
+    const char* v = value(name);
+    if(v != nullptr)
+        given.push_back(v);
+    if(option_at(find_long(name, strlen(name), true)).position == rest)
+        given.insert(given.end(), rest_values.begin(), rest_values.end());
+
+    std::vector<std::string> list;
+    for(const char* text : given) {
+        std::string s(text);
+        size_t start = 0;
+        while(start <= s.size()) {
+            size_t comma = s.find(',', start);
+            if(comma == std::string::npos)
+                comma = s.size();
+            if(comma > start)
+                list.push_back(s.substr(start, comma - start));
+            start = comma + 1;
+        }
+    }
+    return list;
+}
+
+void Args::print_options(FILE* out) const
+{
+    print_group(out, (std::string(command->name) + " options").c_str(), command->groups, 2);
+}
+
+static std::string format_name(const _option &opt)
+{
+    std::string s;
+    if(opt.short_name != 0)
+        s = std::string("-") + opt.short_name + " [ --" + opt.name + " ]";
+    else
+        s = std::string("--") + opt.name;
+
+    if(opt.type != Type::Flag) {
+        s += " arg";
+        if(opt.default_value != nullptr) {
+            // bools show as Boost prints them
+            bool b;
+            if(opt.type == Type::Bool && parse_bool(opt.default_value, b))
+                s += b ? " (=1)" : " (=0)";
+            else
+                s += std::string(" (=") + opt.default_value + ")";
+        }
+    }
+    return s;
+}
+
+void print_group(FILE* out, const char* title, const _group* groups, size_t num_groups)
+{
+    size_t column = min_column;
+    for(size_t g = 0; g < num_groups; g++) {
+        for(size_t i = 0; i < groups[g].count; i++)
+            column = std::max(column, format_name(groups[g].options[i]).size() + 3);
+    }
+    column = std::min(column, max_column);
+    const size_t width = line_length - 1 - column;
+
+    fprintf(out, "%s:\n", title);
+    for(size_t g = 0; g < num_groups; g++) {
+        for(size_t i = 0; i < groups[g].count; i++) {
+            const _option &opt = groups[g].options[i];
+            std::string name = format_name(opt);
+            fprintf(out, "  %s", name.c_str());
+            if(name.size() + 2 >= column)
+                fprintf(out, "\n%*s", (int) column, "");
+            else
+                fprintf(out, "%*s", (int) (column - 2 - name.size()), "");
+
+            // wrap at spaces unless that wastes more than half a line
+            const char* text = opt.help;
+            size_t len = strlen(text);
+            while(len > width) {
+                size_t cut = width;
+                size_t next = width;
+                if(text[width] == ' ') {
+                    next = width + 1;
+                } else {
+                    size_t space = width;
+                    while(space > 0 && text[space - 1] != ' ')
+                        space--;
+                    if(space > 0 && width - space < width / 2) {
+                        cut = space;
+                        next = space;
+                    }
+                }
+                fprintf(out, "%.*s\n%*s", (int) cut, text, (int) column, "");
+                text += next;
+                len -= next;
+            }
+            fprintf(out, "%s\n", text);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+}
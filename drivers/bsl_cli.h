@@ -0,0 +1,108 @@
+/*
+ * bsl_cli.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * Table-driven command line parser of the flasher CLI.
+ *
+ * Subcommands and their options are constant tables, parsing is one pass over
+ * argv. Values point into argv, nothing but the value slots is allocated.
+ * Accepted syntax and error messages follow Boost program_options:
+ * --name value, --name=value, -n value, -nvalue, unique prefixes of long
+ * names, bool values true/false/1/0/yes/no/on/off, -- ends the options.
+ */
+namespace BSLCli {
+    enum class Type {
+        Flag,       // no value
+        Bool,
+        Int,
+        String
+    };
+
+    struct _option {
+        const char* name;
+        char short_name;            // 0: long name only
+        Type type;
+        const char* default_value;  // nullptr: unset unless given
+        const char* help;
+        int position = 0;           // n: filled by the n-th positional argument, 0: named only, rest: see below
+    };
+
+    // position of a String option that takes every positional argument no numbered option takes
+    static constexpr int rest = -1;
+
+    struct _group {
+        const _option* options;
+        size_t count;
+    };
+
+    template<size_t N>
+    constexpr _group group(const _option (&options)[N])
+    {
+        return {options, N};
+    }
+
+    class Args;
+
+    struct _command {
+        const char* name;
+        const char* summary;        // one line in the command list
+        _group groups[2];           // command options, shared options (may be empty)
+        int (*run)(const Args &args);
+    };
+
+    class Args {
+        public:
+            // throws std::invalid_argument on unknown options and invalid values
+            void parse(const _command &command, int argc, const char* const argv[]);
+
+            // 1 if given or defaulted
+            size_t count(const char* name) const;
+            std::string get_string(const char* name) const;
+            int get_int(const char* name) const;
+            bool get_bool(const char* name) const;
+            // comma separated values, the extra positional arguments of a rest option
+            std::vector<std::string> get_list(const char* name) const;
+
+            void print_options(FILE* out) const;
+
+        private:
+            const char* value(const char* name) const;
+            // index into values, exact match first, then a unique prefix
+            int find_long(const char* name, size_t len, bool exact) const;
+            int find_short(char name) const;
+            const _option &option_at(int index) const;
+            void store(int index, const char* text, const char* spelled);
+
+            const _command* command = nullptr;
+            std::vector<const char*> values;
+            std::vector<const char*> rest_values;
+    };
+
+    // index of the command called name, -1 if there is none
+    template<size_t N>
+    int find_command(const _command (&commands)[N], const char* name)
+    {
+        for(size_t i = 0; i < N; i++) {
+            if(strcmp(commands[i].name, name) == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    bool parse_bool(const char* text, bool &value);
+    bool parse_int(const char* text, int &value);
+
+    // option column as Boost prints it, e.g. "-p [ --serial-port ] arg"
+    void print_group(FILE* out, const char* title, const _group* groups, size_t num_groups);
+}
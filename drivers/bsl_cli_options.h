@@ -0,0 +1,150 @@
+/*
+ * bsl_cli_options.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "bsl_cli.h"
+
+/*
+ * Option tables of the flasher subcommands, shared by main() and the CLI
+ * benchmark so both parse the same command lines.
+ * name, short name, type, default, help, position
+ */
+namespace BSLCli {
+    static const _option main_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"version", 'v', Type::Flag, nullptr, "print version"},
+    };
+
+    static const _option entry_options[] = {
+        {"entry", 0, Type::String, "gpio", "BSL entry method: gpio, modem (DTR/RTS) or none (default: gpio)"},
+        {"modem-reset", 0, Type::String, "dtr", "modem line driving NRST, the other one drives BSL invoke: dtr or rts (default: dtr)"},
+        {"modem-invert-reset", 0, Type::Bool, "false", "reset is active while the line is deasserted (default: false)"},
+        {"modem-invert-bsl", 0, Type::Bool, "false", "BSL invoke is active while the line is deasserted (default: false)"},
+    };
+
+    static const _option flash_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"serial-port", 'p', Type::String, nullptr, "serial port (e.g. /dev/ttyACM0, tcp://host:port or rfc2217://host:port)", 1},
+        {"firmware-file", 'i', Type::String, nullptr, "firmware file at 0x0 or Intel HEX file, plain or gzip/zstd compressed", 2},
+        {"region", 0, Type::String, nullptr, "more images in the same session, comma separated file@addr or Intel HEX files (e.g. data.bin@0x41d00000)"},
+        {"enter-bsl", 0, Type::Bool, "true", "enter BSL mode before flashing (default: true)"},
+        {"verbose", 0, Type::Int, "0", "verbosity level 0-3 (default: 0)"},
+        {"force", 0, Type::Bool, "false", "Force the update (default: false)"},
+        {"fixture", 0, Type::String, "default", "fixture name of calibrated entry timing (default: default)"},
+        {"stats-file", 0, Type::String, nullptr, "write per-phase latency histograms to this file"},
+        {"stats-format", 0, Type::String, "json", "stats file format: json or csv (default: json)"},
+        {"trace", 0, Type::String, nullptr, "record a binary wire trace to this file (see decode_trace)"},
+        {"replay", 0, Type::String, nullptr, "play the device side of a recorded trace instead of using a serial port"},
+        {"replay-timing", 0, Type::String, "fast", "replay timing: fast or original (default: fast)"},
+        {"pipeline", 0, Type::Bool, "false", "prebuild program frames and send each one as soon as the previous answer is in (default: false)"},
+        {"window", 0, Type::Int, "0", "program frames in flight for targets that can buffer, 0: link default (default: 0)"},
+        {"retries", 0, Type::Int, "3", "resend a program frame up to this many times on checksum errors or timeouts (default: 3)"},
+        {"resume", 0, Type::Bool, "true", "continue an interrupted flash of the same image from the port's journal (default: true)"},
+        {"progress", 0, Type::String, "auto", "status line with rate and ETA on stderr: auto (if a terminal), on or off (default: auto)"},
+        {"progress-fd", 0, Type::Int, nullptr, "write progress as newline-delimited JSON to this file descriptor"},
+        {"progress-interval", 0, Type::Int, "250", "ms between progress updates (default: 250)"},
+        {"metrics-file", 0, Type::String, nullptr, "add the unit to this OpenMetrics textfile (e.g. for the node exporter)"},
+    };
+
+    static const _option gpio_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"serial-port", 'p', Type::String, nullptr, "serial port whose DTR/RTS lines --entry modem drives", 1},
+        {"verbose", 0, Type::Int, "0", "verbosity level 0-3 (default: 0)"},
+        {"fixture", 0, Type::String, "default", "fixture name of calibrated entry timing (default: default)"},
+    };
+
+    static const _option read_binary_version_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"firmware-file", 'i', Type::String, nullptr, "firmware file", 1},
+        {"verbose", 0, Type::Int, "0", "verbosity level 0-3 (default: 0)"},
+    };
+
+    static const _option calibrate_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"serial-port", 'p', Type::String, nullptr, "serial port (e.g. /dev/ttyACM0, tcp://host:port or rfc2217://host:port)", 1},
+        {"fixture", 0, Type::String, "default", "fixture name to store the timing for (default: default)"},
+        {"trials", 0, Type::Int, "5", "consecutive successful entries per timing (default: 5)"},
+        {"margin", 0, Type::Int, "50", "safety margin in percent added to the minimum (default: 50)"},
+        {"verbose", 0, Type::Int, "0", "verbosity level 0-3 (default: 0)"},
+    };
+
+    static const _option decode_trace_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"trace-file", 'i', Type::String, nullptr, "wire trace recorded with flash --trace", 1},
+        {"raw", 0, Type::Bool, "false", "also print the raw chunks (default: false)"},
+    };
+
+    static const _option daemon_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"socket", 0, Type::String, nullptr, "Unix socket to listen on (default: $XDG_RUNTIME_DIR/" _PROJECT_NAME_ ".sock)"},
+        {"verbose", 0, Type::Int, "0", "verbosity level 0-3 (default: 0)"},
+        {"fixture", 0, Type::String, "default", "fixture name of calibrated entry timing (default: default)"},
+        {"pipeline", 0, Type::Bool, "false", "prebuild program frames and send each one as soon as the previous answer is in (default: false)"},
+        {"window", 0, Type::Int, "0", "program frames in flight for targets that can buffer, 0: link default (default: 0)"},
+        {"retries", 0, Type::Int, "3", "resend a program frame up to this many times on checksum errors or timeouts (default: 3)"},
+        {"resume", 0, Type::Bool, "true", "continue an interrupted flash of the same image from the port's journal (default: true)"},
+        {"metrics-file", 0, Type::String, nullptr, "add every unit to this OpenMetrics textfile (e.g. for the node exporter)"},
+    };
+
+    static const _option submit_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"serial-port", 'p', Type::String, nullptr, "serial port as the daemon opens it", 1},
+        {"firmware-file", 'i', Type::String, nullptr, "firmware file, the daemon reads it", 2},
+        {"socket", 0, Type::String, nullptr, "Unix socket of the daemon (default: $XDG_RUNTIME_DIR/" _PROJECT_NAME_ ".sock)"},
+        {"enter-bsl", 0, Type::Bool, "true", "enter BSL mode before flashing (default: true)"},
+        {"force", 0, Type::Bool, "false", "Force the update (default: false)"},
+        {"stats-file", 0, Type::String, nullptr, "let the daemon write the job's latency histograms to this file"},
+    };
+
+    static const _option metrics_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"socket", 0, Type::String, nullptr, "Unix socket of the daemon (default: $XDG_RUNTIME_DIR/" _PROJECT_NAME_ ".sock)"},
+    };
+
+    static const _option inventory_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"serial-port", 'p', Type::String, nullptr, "serial ports, as further arguments or comma separated", BSLCli::rest},
+        {"image", 'i', Type::String, nullptr, "firmware images to match the boards against, comma separated"},
+        {"addr", 0, Type::String, "0x0", "start of the region to take the CRC of (default: 0x0)"},
+        {"length", 0, Type::String, nullptr, "length of the region, at least 1024 (default: size of the first image)"},
+        {"format", 0, Type::String, "table", "output format: table or json (default: table)"},
+        {"jobs", 'j', Type::Int, "0", "ports probed at a time, 0: all (default: 0)"},
+        {"start", 0, Type::Bool, "true", "start the application when done (default: true)"},
+        {"verbose", 0, Type::Int, "0", "verbosity level 0-3, prints each port's log (default: 0)"},
+        {"fixture", 0, Type::String, "default", "fixture name of calibrated entry timing (default: default)"},
+    };
+
+    static const _option watch_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"serial-port", 'p', Type::String, nullptr, "serial port (e.g. /dev/ttyACM0, tcp://host:port or rfc2217://host:port)", 1},
+        {"firmware-file", 'i', Type::String, nullptr, "firmware file the build writes", 2},
+        {"start", 0, Type::Bool, "true", "start the application after each update, re-entering the BSL for the next one (default: true)"},
+        {"quiet-ms", 0, Type::Int, "300", "ms the file has to be left alone before it is flashed (default: 300)"},
+        {"verbose", 0, Type::Int, "0", "verbosity level 0-3 (default: 0)"},
+        {"fixture", 0, Type::String, "default", "fixture name of calibrated entry timing (default: default)"},
+        {"pipeline", 0, Type::Bool, "false", "prebuild program frames and send each one as soon as the previous answer is in (default: false)"},
+        {"window", 0, Type::Int, "0", "program frames in flight for targets that can buffer, 0: link default (default: 0)"},
+        {"retries", 0, Type::Int, "3", "resend a program frame up to this many times on checksum errors or timeouts (default: 3)"},
+    };
+
+    static const _option station_options[] = {
+        {"help", 'h', Type::Flag, nullptr, "produce help message"},
+        {"firmware-file", 'i', Type::String, nullptr, "firmware file, read once at start", 1},
+        {"filter", 0, Type::String, "/dev/ttyUSB*,/dev/ttyACM*", "ports to flash, comma separated shell patterns (default: /dev/ttyUSB*,/dev/ttyACM*)"},
+        {"present", 0, Type::Bool, "true", "also flash the matching ports there at start (default: true)"},
+        {"settle-ms", 0, Type::Int, "500", "ms to wait after a port appeared before opening it (default: 500)"},
+        {"force", 0, Type::Bool, "false", "Force the update (default: false)"},
+        {"results-file", 0, Type::String, nullptr, "append one JSON line per unit to this file"},
+        {"metrics-file", 0, Type::String, nullptr, "add every unit to this OpenMetrics textfile (e.g. for the node exporter)"},
+        {"verbose", 0, Type::Int, "0", "verbosity level 0-3, prints each unit's log (default: 0)"},
+        {"fixture", 0, Type::String, "default", "fixture name of calibrated entry timing (default: default)"},
+        {"pipeline", 0, Type::Bool, "false", "prebuild program frames and send each one as soon as the previous answer is in (default: false)"},
+        {"window", 0, Type::Int, "0", "program frames in flight for targets that can buffer, 0: link default (default: 0)"},
+        {"retries", 0, Type::Int, "3", "resend a program frame up to this many times on checksum errors or timeouts (default: 3)"},
+        {"resume", 0, Type::Bool, "true", "continue an interrupted flash of the same image from the port's journal (default: true)"},
+    };
+}
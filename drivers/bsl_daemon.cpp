@@ -0,0 +1,511 @@
+/*
+ * bsl_daemon.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_daemon.h"
+#include "bsl_log.h"
+#include "bsl_tool.h"
+#include "bsl_timing.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int)
+{
+    stop = 1;
+}
+
+static bool write_all(int fd, const char* data, size_t len)
+{
+    while(len > 0) {
+        ssize_t n = write(fd, data, len);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool fill_address(const std::string &path, sockaddr_un &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(addr.sun_path)) {
+        BSLLog::printf("Socket path %s is too long\n", path.c_str());
+        return false;
+    }
+    strcpy(addr.sun_path, path.c_str());
+    return true;
+}
+
+BSLDaemon::BSLDaemon(const _config &_cfg) : cfg(_cfg)
+{
+    if(cfg.socket_path.empty())
+        cfg.socket_path = default_socket();
+}
+
+BSLDaemon::~BSLDaemon()
+{
+    for(auto &[port, jobs] : ports) {
+        if(jobs.worker.joinable())
+            jobs.worker.join();
+    }
+
+    // closes ports and releases entry lines, stores learned timeouts
+    for(auto &[port, tool] : tools)
+        delete tool;
+
+    if(listener >= 0) {
+        close(listener);
+        unlink(cfg.socket_path.c_str());
+    }
+}
+
+std::string BSLDaemon::default_socket()
+{
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+    if(runtime != nullptr && *runtime)
+        return std::string(runtime) + "/" _PROJECT_NAME_ ".sock";
+    return BSLTiming::state_file("daemon.sock");
+}
+
+bool BSLDaemon::listen_socket()
+{
+    sockaddr_un addr;
+    if(!fill_address(cfg.socket_path, addr))
+        return false;
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listener < 0) {
+        BSLLog::printf("Error %i creating socket: %s\n", errno, strerror(errno));
+        return false;
+    }
+
+    // a socket file nobody answers on is left over from a crashed daemon
+    if(connect(listener, (sockaddr*) &addr, sizeof(addr)) == 0) {
+        BSLLog::printf("A daemon is already listening on %s\n", cfg.socket_path.c_str());
+        close(listener);
+        listener = -1;
+        return false;
+    }
+    close(listener);
+    unlink(cfg.socket_path.c_str());
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listener < 0 || bind(listener, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(listener, 16) != 0) {
+        BSLLog::printf("Error %i listening on %s: %s\n", errno, cfg.socket_path.c_str(), strerror(errno));
+        if(listener >= 0)
+            close(listener);
+        listener = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool BSLDaemon::run()
+{
+    if(!listen_socket())
+        return false;
+
+    // no SA_RESTART, a signal has to wake up poll()
+    struct sigaction sa = {};
+    sa.sa_handler = on_signal;
+    stop = 0;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    // a client going away mid job must not take the daemon with it
+    signal(SIGPIPE, SIG_IGN);
+
+    BSLLog::printf("Listening on %s\n", cfg.socket_path.c_str());
+    fflush(stdout);
+
+    // clients still sending their job, polled next to the listener so a slow one holds up no other
+    std::vector<_reading> reading;
+    std::vector<pollfd> pfds;
+
+    while(!stop) {
+        pfds.assign(1, {.fd=listener, .events=POLLIN, .revents=0});
+        int timeout_ms = -1;
+        for(const _reading &r : reading) {
+            pfds.push_back({.fd=r.client, .events=POLLIN, .revents=0});
+            const int left_ms = std::max(0, job_timeout_ms - (int) (BSLTiming::elapsed_us(r.start) / 1000));
+            timeout_ms = timeout_ms < 0 ? left_ms : std::min(timeout_ms, left_ms);
+        }
+        if(poll(pfds.data(), pfds.size(), timeout_ms) < 0)
+            continue;
+
+        // back to front, finished clients are taken out as they go
+        for(size_t i = reading.size(); i-- > 0; ) {
+            _job job;
+            const int state = read_job(reading[i], pfds[i + 1].revents, job);
+            if(state == 0)
+                continue;
+            const int client = reading[i].client;
+            reading.erase(reading.begin() + i);
+            if(state > 0)
+                dispatch(client, job);
+            else
+                close(client);
+        }
+
+        if(pfds[0].revents & POLLIN) {
+            int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if(client >= 0)
+                reading.push_back({client, std::string(), BSLTiming::now()});
+        }
+    }
+
+    BSLLog::printf("Stopping\n");
+    for(const _reading &r : reading)
+        close(r.client);
+    // running jobs finish, queued ones are answered by their worker
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for(auto &[port, jobs] : ports) {
+            if(jobs.worker.joinable())
+                workers.push_back(std::move(jobs.worker));
+        }
+    }
+    for(std::thread &worker : workers)
+        worker.join();
+    return true;
+}
+
+void BSLDaemon::dispatch(int client, const _job &job)
+{
+    // jobs without a port are quick and touch no port, they run right here
+    auto port = job.find("port");
+    if(port == job.end()) {
+        serve({client, job});
+        return;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    // the entry GPIOs are wired to one target, the first port a job names is its
+    if(cfg.entry_method == BSL_Entry::Method::GPIO) {
+        if(gpio_port.empty())
+            gpio_port = port->second;
+        if(port->second != gpio_port) {
+            const std::string bound = gpio_port;
+            guard.unlock();
+            char refused[256];
+            int len = snprintf(refused, sizeof(refused), "gpio entry drives the target on %s only, start the daemon with --entry modem or none for several ports\n%cexit=2\n",
+                bound.c_str(), '\0');
+            write_all(client, refused, std::min<int>(len, sizeof(refused) - 1));
+            close(client);
+            return;
+        }
+    }
+
+    _port_jobs &jobs = ports[port->second];
+    jobs.queue.push_back({client, job});
+    if(jobs.running)
+        return;
+
+    // the last worker left the queue empty and is gone or about to be
+    if(jobs.worker.joinable())
+        jobs.worker.join();
+    jobs.running = true;
+
+    // SIGINT/SIGTERM have to reach the accept loop, the worker inherits the blocked mask
+    sigset_t block, previous;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &previous);
+    jobs.worker = std::thread(&BSLDaemon::serve_port, this, port->second);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+void BSLDaemon::serve_port(const std::string &port)
+{
+    while(true) {
+        _pending pending;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            _port_jobs &jobs = ports[port];
+            if(jobs.queue.empty()) {
+                jobs.running = false;
+                return;
+            }
+            pending = std::move(jobs.queue.front());
+            jobs.queue.pop_front();
+        }
+
+        if(stop) {
+            const char refused[] = "Daemon is stopping\n\0exit=1\n";
+            write_all(pending.client, refused, sizeof(refused) - 1);
+            close(pending.client);
+            continue;
+        }
+        serve(pending);
+    }
+}
+
+void BSLDaemon::serve(const _pending &pending)
+{
+    const _job &job = pending.job;
+    const int client = pending.client;
+
+    int code;
+    {
+        // the job prints to the client
+        BSLLog::Redirect redirect([client](const char* text) { write_all(client, text, strlen(text)); });
+
+        const timespec start = BSLTiming::now();
+        code = run_job(job);
+        if(cfg.verbose_level > 0)
+            BSLLog::printf("Job done in %.1fms\n", BSLTiming::elapsed_us(start) / 1000.0);
+    }
+
+    if(cfg.verbose_level > 0) {
+        auto cmd = job.find("cmd");
+        auto port = job.find("port");
+        BSLLog::printf("%s %s: exit %d\n", cmd != job.end() ? cmd->second.c_str() : "-", port != job.end() ? port->second.c_str() : "-", code);
+        fflush(stdout);
+    }
+
+    char trailer[32];
+    int len = snprintf(trailer, sizeof(trailer), "%cexit=%d\n", '\0', code);
+    write_all(client, trailer, len);
+    close(client);
+}
+
+int BSLDaemon::read_job(_reading &r, short revents, _job &job)
+{
+    // poll() reported data or a hangup, the read does not block
+    if(revents != 0) {
+        char buf[512];
+        ssize_t n = read(r.client, buf, sizeof(buf));
+        if(n == 0 || (n < 0 && errno != EINTR) || r.request.size() + std::max<ssize_t>(n, 0) > max_job_len)
+            return -1;
+        if(n > 0)
+            r.request.append(buf, n);
+    }
+
+    // the empty line ends the job, a client that does not send it in time is dropped
+    const std::string &request = r.request;
+    if(request.find("\n\n") == std::string::npos) {
+        if(BSLTiming::elapsed_us(r.start) / 1000 < (uint64_t) job_timeout_ms)
+            return 0;
+        if(cfg.verbose_level > 0)
+            BSLLog::printf("Dropped a client that sent no job within %dms\n", job_timeout_ms);
+        return -1;
+    }
+
+    size_t pos = 0;
+    while(true) {
+        size_t end = request.find('\n', pos);
+        if(end == pos)
+            break;
+        std::string line = request.substr(pos, end - pos);
+        size_t eq = line.find('=');
+        if(eq != std::string::npos)
+            job[line.substr(0, eq)] = line.substr(eq + 1);
+        pos = end + 1;
+    }
+
+    return 1;
+}
+
+int BSLDaemon::run_job(const _job &job)
+{
+    auto cmd = job.find("cmd");
+    if(cmd == job.end()) {
+        BSLLog::printf("Job without cmd\n");
+        return 2;
+    }
+
+    if(cmd->second == "flash")
+        return run_flash(job);
+    if(cmd->second == "metrics") {
+        std::string text;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            text = metrics.to_openmetrics();
+        }
+        BSLLog::printf("%s", text.c_str());
+        return 0;
+    }
+
+    BSLLog::printf("Unknown job %s\n", cmd->second.c_str());
+    return 2;
+}
+
+BSLTool* BSLDaemon::tool_for(const std::string &port)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = tools.find(port);
+        if(it != tools.end())
+            return it->second;
+    }
+
+    // opening the port may take a while, only this port's worker waits for it
+    BSLTool* tool = new BSLTool(port.c_str(), cfg.entry_method, cfg.verbose_level, cfg.modem_def);
+    tool->load_entry_timing(cfg.fixture);
+    tool->set_pipeline(cfg.pipeline, cfg.window);
+    tool->set_max_retries(cfg.max_retries);
+    tool->set_resume(cfg.resume);
+
+    std::lock_guard<std::mutex> guard(lock);
+    tools[port] = tool;
+    return tool;
+}
+
+void BSLDaemon::drop_tool(const std::string &port)
+{
+    BSLTool* tool;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = tools.find(port);
+        if(it == tools.end())
+            return;
+        tool = it->second;
+        tools.erase(it);
+    }
+    delete tool;
+}
+
+int BSLDaemon::run_flash(const _job &job)
+{
+    auto port = job.find("port");
+    auto path = job.find("image");
+    if(port == job.end() || path == job.end()) {
+        BSLLog::printf("flash needs port and image\n");
+        return 2;
+    }
+
+    auto flag = [&](const char* key, bool fallback) {
+        auto it = job.find(key);
+        return it == job.end() ? fallback : it->second == "1";
+    };
+
+    auto image = images.get(path->second);
+    if(image == nullptr)
+        return 1;
+
+    BSLTool* tool;
+    try {
+        tool = tool_for(port->second);
+    }
+    catch(std::exception &e) {
+        BSLLog::printf("error: %s\n", e.what());
+        return 1;
+    }
+
+    tool->reset_session();
+    BSLLog::printf("Using serial %s to flash %s\nFirmware version:%s\n\n", port->second.c_str(), path->second.c_str(), image->version.c_str());
+
+    if(flag("enter", true) && cfg.entry_method != BSL_Entry::Method::None) {
+        BSLLog::printf("Entering BSL mode\n");
+        if(!tool->enter_bsl()) {
+            BSLLog::printf("Could not enter BSL mode. Stopping...\n");
+            record_unit(*tool, port->second, false);
+            return 1;
+        }
+    }
+
+    bool status = tool->flash_image(image->data, image->size, image->crc, flag("force", false));
+
+    auto stats_file = job.find("stats-file");
+    if(stats_file != job.end())
+        tool->get_stats().export_file(stats_file->second.c_str(), "json");
+    record_unit(*tool, port->second, status);
+
+    // the port may be gone with the unit, open it again for the next job
+    if(!status)
+        drop_tool(port->second);
+
+    return !status;
+}
+
+void BSLDaemon::record_unit(BSLTool &tool, const std::string &port, bool ok)
+{
+    BSLMetrics unit;
+    unit.record_unit(tool, port, ok);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        metrics.merge(unit);
+    }
+    if(!cfg.metrics_file.empty())
+        unit.update_file(cfg.metrics_file);
+}
+
+int BSLDaemon::submit(const std::string &socket_path, const _job &job)
+{
+    sockaddr_un addr;
+    if(!fill_address(socket_path, addr))
+        return 1;
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sock < 0 || connect(sock, (sockaddr*) &addr, sizeof(addr)) != 0) {
+        BSLLog::printf("Error %i connecting to daemon at %s: %s\n", errno, socket_path.c_str(), strerror(errno));
+        if(sock >= 0)
+            close(sock);
+        return 1;
+    }
+
+    std::string request;
+    for(const auto &[key, value] : job)
+        request += key + "=" + value + "\n";
+    request += "\n";
+    if(!write_all(sock, request.data(), request.size())) {
+        BSLLog::printf("Error sending job: %s\n", strerror(errno));
+        close(sock);
+        return 1;
+    }
+
+    // output up to the NUL, the exit code after it
+    std::string trailer;
+    bool in_trailer = false;
+    char buf[4096];
+    while(true) {
+        ssize_t n = read(sock, buf, sizeof(buf));
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            break;
+
+        size_t out_len = n;
+        if(!in_trailer) {
+            const char* nul = (const char*) memchr(buf, '\0', n);
+            if(nul != nullptr) {
+                out_len = nul - buf;
+                trailer.append(nul + 1, n - out_len - 1);
+                in_trailer = true;
+            }
+            fwrite(buf, 1, out_len, stdout);
+            fflush(stdout);
+        } else {
+            trailer.append(buf, n);
+        }
+    }
+    close(sock);
+
+    int code;
+    if(!in_trailer || sscanf(trailer.c_str(), "exit=%d", &code) != 1) {
+        BSLLog::printf("Daemon closed the connection without a result\n");
+        return 1;
+    }
+    return code;
+}
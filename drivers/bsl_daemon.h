@@ -0,0 +1,107 @@
+/*
+ * bsl_daemon.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "bsl_modem.h"
+#include "bsl_image_cache.h"
+#include "bsl_metrics.h"
+#include <ctime>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class BSLTool;
+
+/*
+ * Long running flasher for stations: ports stay open and configured, entry
+ * lines stay requested and images stay in memory between jobs.
+ *
+ * Jobs arrive on a Unix stream socket as "key=value" lines ended by an empty
+ * line, a client has job_timeout_ms to send it while others are served. The
+ * job's output is streamed back as it is printed, followed by a NUL byte and
+ * "exit=<code>". Each port has a worker thread running its jobs one after
+ * another in arrival order, different ports flash at the same time. The entry
+ * GPIOs are wired to one target, with GPIO entry jobs for any port but the
+ * first one are refused.
+ *
+ *   cmd=flash port=<serial> image=<path> [force=0|1] [enter=0|1] [stats-file=<path>]
+ *   cmd=metrics                 OpenMetrics text of the units flashed since the daemon started
+ */
+class BSLDaemon {
+    public:
+        typedef std::map<std::string, std::string> _job;
+
+        struct _config {
+            std::string socket_path;
+            BSL_Entry::Method entry_method = BSL_Entry::Method::GPIO;
+            BSL_Modem::_modem_def modem_def = BSL_Modem::default_modem_def;
+            std::string fixture = "default";
+            bool pipeline = false;
+            int window = 0;
+            int max_retries = 3;
+            bool resume = true;
+            int verbose_level = 0;
+            std::string metrics_file;   // every unit is added to it, empty: none
+        };
+
+        BSLDaemon(const _config &_cfg);
+        ~BSLDaemon();
+
+        // serves jobs until SIGINT/SIGTERM, false if the socket can not be set up
+        bool run();
+
+        // $XDG_RUNTIME_DIR/MSPM0_bsl_flasher.sock, the state directory without it
+        static std::string default_socket();
+        // client side: sends the job, copies its output to stdout and returns its exit code
+        static int submit(const std::string &socket_path, const _job &job);
+
+    private:
+        struct _pending {
+            int client;
+            _job job;
+        };
+
+        struct _port_jobs {
+            std::deque<_pending> queue;
+            std::thread worker;
+            bool running = false;       // worker still takes jobs off the queue
+        };
+
+        // a client sending its job
+        struct _reading {
+            int client;
+            std::string request;
+            timespec start;
+        };
+
+        bool listen_socket();
+        // reads what poll() reported: 1 the job is complete, 0 more to come, -1 drop the client
+        int read_job(_reading &r, short revents, _job &job);
+        void dispatch(int client, const _job &job);
+        void serve_port(const std::string &port);
+        void serve(const _pending &pending);
+        int run_job(const _job &job);
+        int run_flash(const _job &job);
+        void record_unit(BSLTool &tool, const std::string &port, bool ok);
+        BSLTool* tool_for(const std::string &port);
+        void drop_tool(const std::string &port);
+
+        static constexpr size_t max_job_len = 4096;
+        static constexpr int job_timeout_ms = 5000;
+
+        _config cfg;
+        ImageCache images;
+        int listener = -1;
+
+        std::mutex lock;
+        std::map<std::string, _port_jobs> ports;    // under lock
+        std::string gpio_port;                      // under lock, the one port GPIO entry serves
+        std::map<std::string, BSLTool*> tools;      // under lock, each one used by its port's worker only
+        BSLMetrics metrics;                         // under lock
+};
@@ -0,0 +1,77 @@
+/*
+ * bsl_entry.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_entry.h"
+#include "bsl_log.h"
+#include <cstdio>
+
+void BSL_Entry::set_timing(BSLTiming::_entry_timing _timing)
+{
+    timing = _timing;
+}
+
+bool BSL_Entry::pulse_reset(timespec &deadline)
+{
+    bool status = set_reset(true);
+    if(!status) {
+        BSLLog::printf("Could set reset active\n");
+        return status;
+    }
+
+    BSLTiming::add_us(deadline, timing.us_reset);
+    BSLTiming::sleep_until(deadline);
+
+    status = set_reset(false);
+    if(!status) {
+        BSLLog::printf("Could set reset inactive\n");
+        return status;
+    }
+
+    return status;
+}
+
+bool BSL_Entry::hard_reset()
+{
+    timespec deadline = BSLTiming::now();
+    return pulse_reset(deadline);
+}
+
+bool BSL_Entry::enter_bsl()
+{
+    // all waits are relative to the first edge, time spent in set_bsl/set_reset is absorbed
+    const timespec start = BSLTiming::now();
+    timespec deadline = start;
+
+    bool status = set_bsl(true);
+    if(!status) {
+        BSLLog::printf("Could not set BSL pin high\n");
+        return status;
+    }
+
+    BSLTiming::add_us(deadline, timing.us_settle);
+    BSLTiming::sleep_until(deadline);
+    status = pulse_reset(deadline);
+    if(!status) {
+        BSLLog::printf("Could not reset\n");
+        return status;
+    }
+
+    BSLTiming::add_us(deadline, timing.us_settle);
+    BSLTiming::sleep_until(deadline);
+    status = set_bsl(false);
+    if(!status) {
+        BSLLog::printf("Could not set BSL pin low\n");
+        return status;
+    }
+
+    if(verbose_level > 1) {
+        BSLLog::printf("BSL entry sequence took %luus (reset %uus, settle %uus)\n",
+            BSLTiming::elapsed_us(start), timing.us_reset, timing.us_settle);
+    }
+
+    return status;
+}
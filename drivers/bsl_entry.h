@@ -0,0 +1,43 @@
+/*
+ * bsl_entry.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include "bsl_timing.h"
+
+/*
+ * Common BSL entry sequence (invoke pin + reset pulse).
+ * Backends only drive the two signals, the timing lives here.
+ */
+class BSL_Entry {
+    public:
+        enum class Method {
+            None,
+            GPIO,   // dedicated GPIOs of the host
+            Modem   // DTR/RTS of the serial adapter
+        };
+
+        BSL_Entry(int _verbose_level) : verbose_level(_verbose_level) {}
+        virtual ~BSL_Entry() {}
+
+        bool hard_reset();
+        bool enter_bsl();
+        void set_timing(BSLTiming::_entry_timing _timing);
+        BSLTiming::_entry_timing get_timing() const { return timing; }
+
+    protected:
+        // active = BSL invoked / target held in reset
+        virtual bool set_bsl(bool active) = 0;
+        virtual bool set_reset(bool active) = 0;
+
+        int verbose_level = 0;
+
+    private:
+        bool pulse_reset(timespec &deadline);
+
+        BSLTiming::_entry_timing timing = BSLTiming::default_entry_timing;
+};
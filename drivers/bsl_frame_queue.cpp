@@ -0,0 +1,96 @@
+/*
+ * bsl_frame_queue.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_frame_queue.h"
+
+FrameQueue::FrameQueue(size_t capacity, size_t frame_size) : slots(capacity)
+{
+    for(auto &slot : slots)
+        slot.buf.resize(frame_size);
+}
+
+FrameQueue::_frame* FrameQueue::acquire()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    cond.wait(guard, [&]() { return closed || write_idx - release_idx < slots.size(); });
+    if(closed)
+        return nullptr;
+    return &slots[write_idx % slots.size()];
+}
+
+void FrameQueue::publish()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        write_idx++;
+    }
+    cond.notify_all();
+}
+
+void FrameQueue::finish()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        finished = true;
+    }
+    cond.notify_all();
+}
+
+FrameQueue::_frame* FrameQueue::next_to_send()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    cond.wait(guard, [&]() { return send_idx < write_idx || finished || closed; });
+    if(send_idx == write_idx || closed)
+        return nullptr;
+    return &slots[send_idx % slots.size()];
+}
+
+void FrameQueue::sent()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    send_idx++;
+}
+
+FrameQueue::_frame* FrameQueue::oldest()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(release_idx == send_idx)
+        return nullptr;
+    return &slots[release_idx % slots.size()];
+}
+
+size_t FrameQueue::in_flight()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return send_idx - release_idx;
+}
+
+FrameQueue::_frame* FrameQueue::in_flight_at(size_t i)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(release_idx + i >= send_idx)
+        return nullptr;
+    return &slots[(release_idx + i) % slots.size()];
+}
+
+void FrameQueue::release()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        release_idx++;
+    }
+    cond.notify_all();
+}
+
+void FrameQueue::close()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+    }
+    cond.notify_all();
+}
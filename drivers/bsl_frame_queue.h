@@ -0,0 +1,64 @@
+/*
+ * bsl_frame_queue.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <condition_variable>
+#include <mutex>
+#include <time.h>
+#include <vector>
+
+/*
+ * Bounded ring of prebuilt command frames between a producer thread and the
+ * transmitter. Slots move through three stages in order:
+ *
+ *   acquire()/publish()     producer builds a frame
+ *   next_to_send()/sent()   transmitter puts it on the wire
+ *   oldest()/release()      its response arrived, the slot is free again
+ *
+ * Buffers are allocated once, a full ring blocks the producer.
+ */
+class FrameQueue {
+    public:
+        struct _frame {
+            std::vector<uint8_t> buf;
+            size_t len = 0;
+            uint32_t addr = 0;          // target address of the payload
+            uint16_t data_len = 0;      // payload bytes
+            timespec t_sent;
+            bool acked = false;         // read back as written after a lost answer, none is due
+            int retries = 0;
+        };
+
+        FrameQueue(size_t capacity, size_t frame_size);
+
+        // producer side, acquire() returns nullptr once the queue is closed
+        _frame* acquire();
+        void publish();
+        void finish();
+
+        // transmitter side, next_to_send() returns nullptr when finished and drained
+        _frame* next_to_send();
+        void sent();
+        _frame* oldest();
+        // frames sent but not released, 0 is oldest()
+        size_t in_flight();
+        _frame* in_flight_at(size_t i);
+        void release();
+        void close();
+
+    private:
+        std::vector<_frame> slots;
+        uint64_t write_idx = 0;
+        uint64_t send_idx = 0;
+        uint64_t release_idx = 0;
+        bool finished = false;
+        bool closed = false;
+
+        std::mutex lock;
+        std::condition_variable cond;
+};
@@ -6,59 +6,38 @@
  */
 
 #include "bsl_gpio.h"
-#include <chrono>
-#include <thread>
+#include "bsl_log.h"
 #include <iostream>
 
-BSL_GPIO::BSL_GPIO(int _verbose_level, _gpio_def _bsl, _gpio_def _reset) : verbose_level(_verbose_level), bsl_out(_bsl), reset_out(_reset)
+BSL_GPIO::BSL_GPIO(int _verbose_level, _gpio_def _bsl, _gpio_def _reset, Backend _backend) : BSL_Entry(_verbose_level),
+    bsl_out(_bsl), reset_out(_reset), backend(_backend),
+    bsl_line(_bsl.bank, _bsl.pin, _verbose_level), reset_line(_reset.bank, _reset.pin, _verbose_level)
 {
 
 }
 
-bool BSL_GPIO::hard_reset(uint16_t ms_reset_time)
+bool BSL_GPIO::set_pin(_gpio_def gpio, bool level)
 {
-    bool status = set_pin(reset_out, true);
-    if(!status) {
-        printf("Could set reset active\n");
-        return status;
+    if(backend == Backend::Shell) {
+        return set_pin_shell(gpio, level);
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(ms_reset_time));
-
-    status = set_pin(reset_out, false);
-    if(!status) {
-        printf("Could set reset inactive\n");
-        return status;
-    }
-
-    return status;
-}
-
-bool BSL_GPIO::enter_bsl()
-{
-    bool status = set_pin(bsl_out, true);
-    if(!status) {
-        printf("Could not set BSL pin high\n");
-        return status;
+    GPIOLine &line = (gpio.bank == bsl_out.bank && gpio.pin == bsl_out.pin) ? bsl_line : reset_line;
+    if(line.set(level)) {
+        return true;
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(ms_bsl_out_settle));
-    status = hard_reset();
-    if(!status) {
-        printf("Could not reset\n");
-        return status;
-    }
-    std::this_thread::sleep_for(std::chrono::milliseconds(ms_bsl_out_settle));
-    status = set_pin(bsl_out, false);
-    if(!status) {
-        printf("Could not set BSL pin low\n");
-        return status;
+    // chip not available (no permission, old kernel), stay usable via gpioset
+    if(!line.is_requested()) {
+        BSLLog::printf("GPIO chardev not available, falling back to gpioset\n");
+        backend = Backend::Shell;
+        return set_pin_shell(gpio, level);
     }
 
-    return status;
+    return false;
 }
 
-bool BSL_GPIO::set_pin(_gpio_def gpio, bool level)
+bool BSL_GPIO::set_pin_shell(_gpio_def gpio, bool level)
 {
     char* cmd;
     int size = asprintf(&cmd, "gpioset %d %d=%d", gpio.bank, gpio.pin, (level ? 1 : 0));
@@ -68,7 +47,7 @@ bool BSL_GPIO::set_pin(_gpio_def gpio, bool level)
 
     // debug printfs
     if(verbose_level > 2) {
-        printf("%s\n", cmd);
+        BSLLog::printf("%s\n", cmd);
     }
     
     int status = system(cmd);
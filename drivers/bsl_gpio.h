@@ -4,28 +4,41 @@
  *  Created on: Dec 19, 2023
  *      Author: Jonas Rockstroh
  */
+#pragma once
+
 #include "stdint.h"
+#include "gpio_chardev.h"
+#include "bsl_entry.h"
 
-class BSL_GPIO {
+class BSL_GPIO : public BSL_Entry {
     public:
         struct _gpio_def {
             uint8_t bank;
             uint8_t pin;
         };
 
-        BSL_GPIO(int _verbose_level, _gpio_def _bsl={.bank=_GPIO_BSL_BANK_, .pin=_GPIO_BSL_PIN_}, _gpio_def _reset={.bank=_GPIO_RESET_BANK_, .pin=_GPIO_RESET_PIN_});
-        bool hard_reset(uint16_t ms_reset_time=default_ms_reset_time);
-        bool enter_bsl();
+        enum class Backend {
+            Chardev,    // GPIO character device, lines held for the session
+            Shell       // one gpioset process per pin change
+        };
+
+        BSL_GPIO(int _verbose_level, _gpio_def _bsl={.bank=_GPIO_BSL_BANK_, .pin=_GPIO_BSL_PIN_}, _gpio_def _reset={.bank=_GPIO_RESET_BANK_, .pin=_GPIO_RESET_PIN_}, Backend _backend=default_backend);
+
+    protected:
+        bool set_bsl(bool active) override { return set_pin(bsl_out, active); }
+        bool set_reset(bool active) override { return set_pin(reset_out, active); }
 
     private:
         bool set_pin(_gpio_def gpio, bool level);
+        bool set_pin_shell(_gpio_def gpio, bool level);
 
-        static constexpr uint16_t default_ms_reset_time = 10;
-        static constexpr uint16_t ms_bsl_out_settle = 10;
+        static constexpr Backend default_backend = _GPIO_USE_CHARDEV_ ? Backend::Chardev : Backend::Shell;
 
         // at the moment done via cmake flags
         _gpio_def bsl_out;
         _gpio_def reset_out;
 
-        int verbose_level = 0;
-};
\ No newline at end of file
+        Backend backend;
+        GPIOLine bsl_line;
+        GPIOLine reset_line;
+};
@@ -0,0 +1,105 @@
+/*
+ * bsl_image_cache.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_image_cache.h"
+#include "bsl_image_source.h"
+#include "bsl_log.h"
+#include "bsl_protocol.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+static bool same_file(const struct stat &a, const struct stat &b)
+{
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size &&
+        a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+size_t ImageCache::count() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return images.size();
+}
+
+bool ImageCache::load(const std::string &path, const struct stat &st, _image &image)
+{
+    ImageSource source;
+    if(!source.open(path.c_str()))
+        return false;
+
+    if(source.format() != ImageSource::Format::Raw) {
+        // a compressed one is inflated once for all jobs
+        if(!source.scan())
+            return false;
+        image.buffer.resize(source.size());
+        return source.read(image.buffer.data(), image.buffer.size());
+    }
+
+    image.buffer.resize(st.st_size);
+    return source.read(image.buffer.data(), image.buffer.size());
+}
+
+std::shared_ptr<const ImageCache::_image> ImageCache::get(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) {
+        BSLLog::printf("Can not open image %s: %s\n", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    auto it = images.find(path);
+    if(it != images.end()) {
+        const _image &cached = *it->second;
+        if(cached.dev == st.st_dev && cached.ino == st.st_ino && cached.file_size == st.st_size &&
+           cached.mtime.tv_sec == st.st_mtim.tv_sec && cached.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+            return it->second;
+        }
+        // jobs still flashing the old one keep it
+        images.erase(it);
+    }
+
+    auto image = std::make_shared<_image>();
+    for(int attempt = 0; ; attempt++) {
+        if(st.st_size == 0) {
+            BSLLog::printf("Image %s is empty\n", path.c_str());
+            return nullptr;
+        }
+        const bool loaded = load(path, st, *image);
+
+        // a build writing the file meanwhile, the copy may hold parts of both or be cut short
+        struct stat after;
+        if(stat(path.c_str(), &after) != 0) {
+            BSLLog::printf("Can not open image %s: %s\n", path.c_str(), strerror(errno));
+            return nullptr;
+        }
+        if(same_file(st, after)) {
+            if(!loaded)
+                return nullptr;
+            break;
+        }
+        if(attempt + 1 >= max_reads) {
+            BSLLog::printf("Image %s keeps changing while it is read\n", path.c_str());
+            return nullptr;
+        }
+        st = after;
+    }
+
+    image->data = image->buffer.data();
+    image->size = image->buffer.size();
+    image->crc = BSL::softwareCRC(image->data, image->size);
+    image->dev = st.st_dev;
+    image->file_size = st.st_size;
+    image->ino = st.st_ino;
+    image->mtime = st.st_mtim;
+    if(image->size >= version_offset + version_len)
+        image->version.assign((const char*) image->data + version_offset, strnlen((const char*) image->data + version_offset, version_len));
+
+    images[path] = image;
+    return image;
+}
@@ -0,0 +1,56 @@
+/*
+ * bsl_image_cache.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+/*
+ * Firmware images kept in memory between jobs, with their CRC and version
+ * string computed once. An image is read again when the file on disk changed
+ * (inode, size or mtime).
+ *
+ * Images are copies, not mappings: a build rewriting the file can not change
+ * or truncate the bytes of a running job. A read the file changed under is
+ * repeated. Thread safe, a job keeps its image while another one reloads it.
+ */
+class ImageCache {
+    public:
+        struct _image {
+            const uint8_t* data = nullptr;  // into buffer
+            uint32_t size = 0;
+            uint32_t crc = 0;
+            std::string version;
+
+            std::vector<uint8_t> buffer;    // inflated if the file is compressed
+
+            dev_t dev = 0;
+            ino_t ino = 0;
+            off_t file_size = 0;
+            timespec mtime = {};
+        };
+
+        static constexpr uint32_t version_offset = 0x000000c0;
+        static constexpr uint32_t version_len = 51;
+
+        // nullptr if the file can not be read
+        std::shared_ptr<const _image> get(const std::string &path);
+        size_t count() const;
+
+    private:
+        static bool load(const std::string &path, const struct stat &st, _image &image);
+
+        static constexpr int max_reads = 3;
+
+        mutable std::mutex lock;
+        std::map<std::string, std::shared_ptr<const _image>> images;
+};
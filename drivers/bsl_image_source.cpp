@@ -0,0 +1,331 @@
+/*
+ * bsl_image_source.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_image_source.h"
+#include "bsl_log.h"
+#include "bsl_protocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#if _HAVE_ZLIB_
+#include <zlib.h>
+#endif
+#if _HAVE_ZSTD_
+#include <zstd.h>
+#endif
+
+struct ImageSource::_decoder {
+#if _HAVE_ZLIB_
+    z_stream zs = {};
+    bool zs_init = false;
+#endif
+#if _HAVE_ZSTD_
+    ZSTD_DStream* zds = nullptr;
+#endif
+
+    ~_decoder()
+    {
+#if _HAVE_ZLIB_
+        if(zs_init)
+            inflateEnd(&zs);
+#endif
+#if _HAVE_ZSTD_
+        if(zds != nullptr)
+            ZSTD_freeDStream(zds);
+#endif
+    }
+};
+
+ImageSource::ImageSource() : decoder(new _decoder()), in(chunk_size), out(chunk_size)
+{
+}
+
+ImageSource::~ImageSource()
+{
+    close();
+}
+
+const char* ImageSource::format_name(Format f)
+{
+    switch(f) {
+    case Format::Gzip:
+        return "gzip";
+    case Format::Zstd:
+        return "zstd";
+    default:
+        return "raw";
+    }
+}
+
+bool ImageSource::open(const char* _path)
+{
+    close();
+    path = _path;
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        BSLLog::printf("Read file: Can not open file %s\n", path.c_str());
+        return false;
+    }
+    if(!rewind()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ImageSource::close()
+{
+    if(fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+bool ImageSource::read_input()
+{
+    ssize_t n;
+    do {
+        n = ::read(fd, in.data(), in.size());
+    } while(n < 0 && errno == EINTR);
+
+    if(n < 0) {
+        BSLLog::printf("Image %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    in_pos = 0;
+    in_len = n;
+    in_eof = (n == 0);
+    return true;
+}
+
+bool ImageSource::rewind()
+{
+    if(lseek(fd, 0, SEEK_SET) != 0) {
+        BSLLog::printf("Image %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    in_pos = in_len = 0;
+    in_eof = false;
+    out_pos = out_len = 0;
+    stream_end = false;
+    if(!read_input())
+        return false;
+
+    // the magic bytes of the container
+    static const uint8_t gzip_magic[] = {0x1f, 0x8b};
+    static const uint8_t zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd};
+    fmt = Format::Raw;
+    if(in_len >= sizeof(gzip_magic) && !memcmp(in.data(), gzip_magic, sizeof(gzip_magic)))
+        fmt = Format::Gzip;
+    else if(in_len >= sizeof(zstd_magic) && !memcmp(in.data(), zstd_magic, sizeof(zstd_magic)))
+        fmt = Format::Zstd;
+
+    switch(fmt) {
+    case Format::Gzip:
+#if _HAVE_ZLIB_
+        if(decoder->zs_init) {
+            inflateReset(&decoder->zs);
+        } else {
+            // 15 + 32: largest window, gzip or zlib header detected
+            decoder->zs_init = (inflateInit2(&decoder->zs, 15 + 32) == Z_OK);
+            if(!decoder->zs_init) {
+                BSLLog::printf("Image %s: can not set up zlib\n", path.c_str());
+                return false;
+            }
+        }
+        return true;
+#else
+        BSLLog::printf("Image %s is gzip compressed, built without zlib\n", path.c_str());
+        return false;
+#endif
+    case Format::Zstd:
+#if _HAVE_ZSTD_
+        if(decoder->zds == nullptr)
+            decoder->zds = ZSTD_createDStream();
+        if(decoder->zds == nullptr || ZSTD_isError(ZSTD_initDStream(decoder->zds))) {
+            BSLLog::printf("Image %s: can not set up zstd\n", path.c_str());
+            return false;
+        }
+        return true;
+#else
+        BSLLog::printf("Image %s is zstd compressed, built without libzstd\n", path.c_str());
+        return false;
+#endif
+    default:
+        return true;
+    }
+}
+
+bool ImageSource::decode()
+{
+    out_pos = out_len = 0;
+
+    while(out_len == 0 && !stream_end) {
+        if(in_pos == in_len && !in_eof && !read_input())
+            return false;
+        const bool input_done = (in_pos == in_len && in_eof);
+
+        switch(fmt) {
+        case Format::Raw:
+            // a plain image is its own output
+            if(input_done) {
+                stream_end = true;
+            } else {
+                std::swap(in, out);
+                out_len = in_len;
+                in_pos = in_len = 0;
+            }
+            break;
+
+        case Format::Gzip: {
+#if _HAVE_ZLIB_
+            z_stream &zs = decoder->zs;
+            zs.next_in = in.data() + in_pos;
+            zs.avail_in = in_len - in_pos;
+            zs.next_out = out.data();
+            zs.avail_out = out.size();
+            int ret = inflate(&zs, Z_NO_FLUSH);
+            in_pos = in_len - zs.avail_in;
+            out_len = out.size() - zs.avail_out;
+
+            if(ret == Z_STREAM_END) {
+                // concatenated members continue the image
+                if(in_pos == in_len && !in_eof && !read_input())
+                    return false;
+                if(in_pos < in_len)
+                    inflateReset(&zs);
+                else
+                    stream_end = true;
+            } else if(ret == Z_BUF_ERROR && input_done) {
+                BSLLog::printf("Image %s: gzip stream is truncated\n", path.c_str());
+                return false;
+            } else if(ret != Z_OK && ret != Z_BUF_ERROR) {
+                BSLLog::printf("Image %s: %s\n", path.c_str(), zs.msg != nullptr ? zs.msg : "gzip stream is corrupt");
+                return false;
+            }
+#endif
+            break;
+        }
+
+        case Format::Zstd: {
+#if _HAVE_ZSTD_
+            ZSTD_inBuffer ib = {in.data() + in_pos, in_len - in_pos, 0};
+            ZSTD_outBuffer ob = {out.data(), out.size(), 0};
+            size_t ret = ZSTD_decompressStream(decoder->zds, &ob, &ib);
+            if(ZSTD_isError(ret)) {
+                BSLLog::printf("Image %s: %s\n", path.c_str(), ZSTD_getErrorName(ret));
+                return false;
+            }
+            in_pos += ib.pos;
+            out_len = ob.pos;
+
+            // 0: a frame is complete, further frames continue the image
+            if(ret == 0) {
+                if(in_pos == in_len && !in_eof && !read_input())
+                    return false;
+                if(in_pos == in_len && in_eof)
+                    stream_end = true;
+            } else if(input_done && out_len == 0) {
+                BSLLog::printf("Image %s: zstd stream is truncated\n", path.c_str());
+                return false;
+            }
+#endif
+            break;
+        }
+        }
+    }
+
+    return true;
+}
+
+bool ImageSource::read(uint8_t* dst, uint32_t len)
+{
+    while(len > 0) {
+        if(out_pos == out_len) {
+            if(!decode())
+                return false;
+            if(out_len == 0) {
+                BSLLog::printf("Image %s ends early\n", path.c_str());
+                return false;
+            }
+        }
+        const size_t n = std::min<size_t>(len, out_len - out_pos);
+        if(dst != nullptr) {
+            memcpy(dst, out.data() + out_pos, n);
+            dst += n;
+        }
+        out_pos += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool ImageSource::skip(uint32_t len)
+{
+    return read(nullptr, len);
+}
+
+bool ImageSource::scan()
+{
+    if(!rewind())
+        return false;
+
+    uint64_t size = 0;
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t vcrc = 0xFFFFFFFF;
+    std::string version_bytes;
+    prefix_crcs.clear();
+
+    while(true) {
+        if(!decode())
+            return false;
+        if(out_len == 0)
+            break;
+
+        const uint8_t* data = out.data();
+        const uint32_t n = out_len;
+        if(size + n > UINT32_MAX) {
+            BSLLog::printf("Image %s is too large\n", path.c_str());
+            return false;
+        }
+
+        // in steps that end on prefix_step boundaries, each one gets its CRC
+        for(uint32_t p = 0; p < n; ) {
+            const uint32_t step = std::min<uint32_t>(n - p, prefix_step - (size + p) % prefix_step);
+            crc = BSL::softwareCRC(data + p, step, crc);
+            p += step;
+            if((size + p) % prefix_step == 0)
+                prefix_crcs.push_back(crc);
+        }
+
+        const uint32_t vstart = size < verify_offset ? std::min<uint32_t>(n, verify_offset - size) : 0;
+        vcrc = BSL::softwareCRC(data + vstart, n - vstart, vcrc);
+
+        if(size < version_offset + version_len && size + n > version_offset) {
+            const uint32_t from = size < version_offset ? version_offset - size : 0;
+            const uint32_t to = std::min<uint64_t>(n, version_offset + version_len - size);
+            version_bytes.append((const char*) data + from, to - from);
+        }
+
+        size += n;
+    }
+
+    if(size == 0) {
+        BSLLog::printf("Image %s is empty\n", path.c_str());
+        return false;
+    }
+
+    image_size = size;
+    image_crc = crc;
+    image_verify_crc = vcrc;
+    image_version.clear();
+    if(version_bytes.size() == version_len)
+        image_version.assign(version_bytes.c_str(), strnlen(version_bytes.c_str(), version_len));
+
+    return rewind();
+}
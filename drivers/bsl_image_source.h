@@ -0,0 +1,88 @@
+/*
+ * bsl_image_source.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Sequential reader of a firmware image file that may be compressed: plain,
+ * gzip (zlib) or zstd, told apart by their magic bytes. Compressed images are
+ * inflated chunk by chunk as they are read, memory stays at the decoder state
+ * and two buffers whatever the image size.
+ *
+ * scan() reads the image once for its size, version string and CRCs, read()
+ * then streams it from the start again straight into the program frames.
+ * zstd needs the library at build time, without it such images are refused.
+ */
+class ImageSource {
+    public:
+        enum class Format { Raw, Gzip, Zstd };
+
+        ImageSource();
+        ~ImageSource();
+
+        bool open(const char* path);
+        void close();
+        bool is_open() const { return fd >= 0; }
+
+        // reads the whole image for the values below, false on read and decode errors
+        bool scan();
+        // back to the first byte
+        bool rewind();
+        // next len bytes of the image, false on read and decode errors and past its end
+        bool read(uint8_t* dst, uint32_t len);
+        bool skip(uint32_t len);
+
+        Format format() const { return fmt; }
+        static const char* format_name(Format f);
+
+        // valid after scan()
+        uint32_t size() const { return image_size; }
+        uint32_t crc() const { return image_crc; }
+        // of [verify_offset, size) as the standalone verification answers
+        uint32_t verify_crc() const { return image_verify_crc; }
+        // of the first len bytes, len a multiple of prefix_step up to size
+        uint32_t prefix_crc(uint32_t len) const { return len == 0 ? 0xFFFFFFFF : prefix_crcs[len / prefix_step - 1]; }
+        const std::string &version() const { return image_version; }
+
+        static constexpr uint32_t verify_offset = 0x8;
+        static constexpr uint32_t prefix_step = 1024;
+        static constexpr uint32_t version_offset = 0x000000c0;
+        static constexpr uint32_t version_len = 51;
+
+    private:
+        struct _decoder;
+
+        // refills out with the next inflated bytes, false on errors, out_len 0 at the end
+        bool decode();
+        bool read_input();
+
+        static constexpr size_t chunk_size = 16384;
+
+        std::string path;
+        int fd = -1;
+        Format fmt = Format::Raw;
+        std::unique_ptr<_decoder> decoder;
+
+        std::vector<uint8_t> in;
+        size_t in_pos = 0;
+        size_t in_len = 0;
+        bool in_eof = false;
+        std::vector<uint8_t> out;
+        size_t out_pos = 0;
+        size_t out_len = 0;
+        bool stream_end = false;
+
+        uint32_t image_size = 0;
+        uint32_t image_crc = 0;
+        uint32_t image_verify_crc = 0;
+        std::vector<uint32_t> prefix_crcs;
+        std::string image_version;
+};
@@ -0,0 +1,182 @@
+/*
+ * bsl_inventory.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_inventory.h"
+#include "bsl_image_cache.h"
+#include "bsl_log.h"
+#include "bsl_tool.h"
+#include "bsl_timing.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// version strings of unknown images are arbitrary bytes
+static std::string printable(const std::string &s)
+{
+    std::string out = s;
+    for(char &c : out) {
+        if((unsigned char) c < 0x20 || (unsigned char) c > 0x7e)
+            c = '.';
+    }
+    return out;
+}
+
+BSLInventory::BSLInventory(const _config &_cfg) : cfg(_cfg)
+{
+}
+
+bool BSLInventory::run(std::vector<_unit> &units)
+{
+    // the probes only need size, CRC and version
+    ImageCache cache;
+    images.clear();
+    for(const std::string &path : cfg.images) {
+        auto image = cache.get(path);
+        if(image == nullptr)
+            return false;
+        if(image->size < verify_offset + min_verify_len) {
+            BSLLog::printf("Image %s is too small to be verified\n", path.c_str());
+            return false;
+        }
+        images.push_back({path, printable(image->version), image->size, BSL::softwareCRC(image->data + verify_offset, image->size - verify_offset)});
+    }
+
+    if(cfg.length == 0 && !images.empty())
+        cfg.length = images.front().size;
+
+    units.assign(cfg.ports.size(), _unit());
+    for(size_t i = 0; i < units.size(); i++)
+        units[i].port = cfg.ports[i];
+
+    // workers take the next port until none are left
+    std::atomic<size_t> next(0);
+    const size_t num_workers = (cfg.jobs > 0) ? std::min<size_t>(cfg.jobs, units.size()) : units.size();
+    std::vector<std::thread> workers;
+    for(size_t w = 0; w < num_workers; w++) {
+        workers.emplace_back([&]() {
+            for(size_t i = next++; i < units.size(); i = next++)
+                probe(units[i]);
+        });
+    }
+    for(auto &worker : workers)
+        worker.join();
+
+    return true;
+}
+
+void BSLInventory::probe(_unit &unit) const
+{
+    const timespec start = BSLTiming::now();
+    BSLLog::Redirect redirect([&unit](const char* text) { unit.log += text; });
+
+    try {
+        BSLTool tool(unit.port.c_str(), cfg.entry_method, cfg.verbose_level, cfg.modem_def);
+        tool.load_entry_timing(cfg.fixture);
+
+        if(cfg.entry_method != BSL_Entry::Method::None && !tool.enter_bsl()) {
+            unit.error = "Could not enter BSL mode";
+        } else if(!tool.open_session()) {
+            unit.error = BSLLog::last_line(unit.log);
+        } else {
+            unit.has_device_info = true;
+            unit.device_info = tool.last_device_info();
+
+            if(cfg.length > 0) {
+                unit.has_crc = tool.read_crc(cfg.addr, cfg.length, unit.crc);
+                if(!unit.has_crc)
+                    unit.error = BSLLog::last_line(unit.log);
+            }
+
+            // as flash decides a unit is up to date
+            for(const _image &image : images) {
+                uint32_t crc;
+                if(!tool.read_crc(verify_offset, image.size - verify_offset, crc)) {
+                    unit.error = BSLLog::last_line(unit.log);
+                    break;
+                }
+                if(crc == image.crc) {
+                    unit.image = image.path;
+                    unit.version = image.version;
+                    break;
+                }
+            }
+
+            unit.ok = unit.error.empty();
+            if(cfg.start && !tool.start_application() && unit.ok) {
+                unit.ok = false;
+                unit.error = BSLLog::last_line(unit.log);
+            }
+        }
+    }
+    catch(std::exception &e) {
+        unit.error = e.what();
+    }
+
+    unit.elapsed_us = BSLTiming::elapsed_us(start);
+}
+
+std::string BSLInventory::to_table(const std::vector<_unit> &units) const
+{
+    size_t port_width = 4, image_width = 5, version_width = 7;
+    for(const _unit &u : units) {
+        port_width = std::max(port_width, u.port.size());
+        image_width = std::max(image_width, u.image.size());
+        version_width = std::max(version_width, u.version.size());
+    }
+
+    std::string out;
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%-*s  %-6s  %-10s  %-*s  %-*s  %7s  %s\n", (int) port_width, "PORT", "RESULT", "CRC",
+        (int) image_width, "IMAGE", (int) version_width, "VERSION", "TIME", "DEVICE");
+    out += buf;
+
+    for(const _unit &u : units) {
+        char crc[16] = "-";
+        if(u.has_crc)
+            snprintf(crc, sizeof(crc), "0x%08x", u.crc);
+        const std::string device = u.ok ? BSL::DeviceInfoToString(u.device_info) : u.error;
+        snprintf(buf, sizeof(buf), "%-*s  %-6s  %-10s  %-*s  %-*s  %6.1fs  ", (int) port_width, u.port.c_str(), u.ok ? "ok" : "failed", crc,
+            (int) image_width, u.image.empty() ? "-" : u.image.c_str(), (int) version_width, u.version.empty() ? "-" : u.version.c_str(),
+            u.elapsed_us / 1e6);
+        out += buf + device + "\n";
+    }
+    return out;
+}
+
+std::string BSLInventory::to_json(const std::vector<_unit> &units) const
+{
+    std::string out = "[\n";
+    char buf[512];
+    for(size_t i = 0; i < units.size(); i++) {
+        const _unit &u = units[i];
+        out += "{\"port\":" + BSLLog::json_string(u.port) + ",\"ok\":" + (u.ok ? "true" : "false") +
+            ",\"error\":" + (u.error.empty() ? "null" : BSLLog::json_string(u.error));
+
+        if(u.has_device_info) {
+            const BSL::_device_info &d = u.device_info;
+            snprintf(buf, sizeof(buf), ",\"device_info\":{\"cmd_interpreter_version\":%u,\"build_id\":%u,\"app_version\":%u,"
+                "\"plugin_if_version\":%u,\"bsl_max_buff_size\":%u,\"bsl_buff_start_addr\":%u,\"bcr_conf_id\":%u,\"bsl_conf_id\":%u}",
+                d.cmd_interpreter_version, d.build_id, d.app_version, d.plugin_if_version, d.bsl_max_buff_size,
+                d.bsl_buff_start_addr, d.bcr_conf_id, d.bsl_conf_id);
+            out += buf;
+        } else {
+            out += ",\"device_info\":null";
+        }
+
+        if(u.has_crc) {
+            snprintf(buf, sizeof(buf), ",\"region\":{\"addr\":%u,\"length\":%u,\"crc\":\"0x%08x\"}", cfg.addr, cfg.length, u.crc);
+            out += buf;
+        } else {
+            out += ",\"region\":null";
+        }
+
+        out += ",\"image\":" + (u.image.empty() ? std::string("null") : BSLLog::json_string(u.image)) +
+            ",\"version\":" + (u.image.empty() ? std::string("null") : BSLLog::json_string(u.version)) +
+            ",\"elapsed_ms\":" + std::to_string(u.elapsed_us / 1000) + "}" + (i + 1 < units.size() ? ",\n" : "\n");
+    }
+    return out + "]\n";
+}
@@ -0,0 +1,75 @@
+/*
+ * bsl_inventory.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "bsl_modem.h"
+#include "bsl_protocol.h"
+#include <string>
+#include <vector>
+
+/*
+ * Audit of a rack: every port is opened on its own thread, the BSL entered,
+ * the device info read and the CRC of the application region taken by
+ * standalone verification. Images given are matched the way flash decides a
+ * unit is up to date, so the table shows which firmware each board runs.
+ *
+ * Nothing is erased or programmed. The application is started again at the
+ * end unless told otherwise.
+ */
+class BSLInventory {
+    public:
+        struct _config {
+            std::vector<std::string> ports;
+            std::vector<std::string> images;
+            BSL_Entry::Method entry_method = BSL_Entry::Method::None;
+            BSL_Modem::_modem_def modem_def = BSL_Modem::default_modem_def;
+            std::string fixture = "default";
+            uint32_t addr = 0;
+            uint32_t length = 0;        // 0: size of the first image
+            int jobs = 0;               // ports probed at a time, 0: all
+            bool start = true;          // start the application when done
+            int verbose_level = 0;
+        };
+
+        struct _unit {
+            std::string port;
+            bool ok = false;
+            std::string error;          // why the port failed
+            bool has_device_info = false;
+            BSL::_device_info device_info = {};
+            bool has_crc = false;
+            uint32_t crc = 0;           // of [addr, addr+length)
+            std::string image;          // matching image, empty: none of them
+            std::string version;        // its version string
+            uint64_t elapsed_us = 0;
+            std::string log;            // the tool's output on this port
+        };
+
+        BSLInventory(const _config &_cfg);
+
+        // one unit per port in the order given, false if an image can not be read
+        bool run(std::vector<_unit> &units);
+
+        std::string to_table(const std::vector<_unit> &units) const;
+        std::string to_json(const std::vector<_unit> &units) const;
+
+    private:
+        struct _image {
+            std::string path;
+            std::string version;
+            uint32_t size;
+            uint32_t crc;               // from verify_offset on, as flash verifies
+        };
+
+        void probe(_unit &unit) const;
+
+        static constexpr uint32_t verify_offset = 0x8;
+        static constexpr uint32_t min_verify_len = 1024;    // StandaloneVerification lower limit
+
+        _config cfg;
+        std::vector<_image> images;
+};
@@ -0,0 +1,63 @@
+/*
+ * bsl_journal.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_journal.h"
+#include "bsl_log.h"
+#include "bsl_timing.h"
+#include <cstdio>
+
+namespace BSLJournal {
+
+    static std::string journal_file(const std::string &port)
+    {
+        return BSLTiming::state_file("journal_" + port);
+    }
+
+    bool load(const std::string &port, _checkpoint &cp)
+    {
+        std::string path = journal_file(port);
+        FILE* f = fopen(path.c_str(), "r");
+        if(f == nullptr) {
+            return false;
+        }
+
+        _checkpoint loaded;
+        int matched = fscanf(f, "image_crc=%x\nimage_size=%u\nload_addr=%x\nconfirmed=%u\n",
+            &loaded.image_crc, &loaded.image_size, &loaded.load_addr, &loaded.confirmed);
+        fclose(f);
+
+        if(matched != 4 || loaded.confirmed > loaded.image_size) {
+            BSLLog::printf("Ignoring malformed journal %s\n", path.c_str());
+            return false;
+        }
+
+        cp = loaded;
+        return true;
+    }
+
+    bool store(const std::string &port, const _checkpoint &cp)
+    {
+        std::string path = journal_file(port);
+        std::string tmp_path = path + ".tmp";
+        FILE* f = fopen(tmp_path.c_str(), "w");
+        if(f == nullptr) {
+            BSLLog::printf("Can not write journal %s\n", path.c_str());
+            return false;
+        }
+
+        fprintf(f, "image_crc=%08x\nimage_size=%u\nload_addr=%08x\nconfirmed=%u\n",
+            cp.image_crc, cp.image_size, cp.load_addr, cp.confirmed);
+        fclose(f);
+
+        return rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+
+    void clear(const std::string &port)
+    {
+        remove(journal_file(port).c_str());
+    }
+};
@@ -0,0 +1,25 @@
+/*
+ * bsl_journal.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <string>
+
+namespace BSLJournal {
+
+    /* progress of an interrupted flash, one journal per port */
+    struct _checkpoint {
+        uint32_t image_crc;     // CRC32 over the whole image
+        uint32_t image_size;
+        uint32_t load_addr;
+        uint32_t confirmed;     // bytes from load_addr the BSL acknowledged
+    };
+
+    bool load(const std::string &port, _checkpoint &cp);
+    bool store(const std::string &port, const _checkpoint &cp);
+    void clear(const std::string &port);
+};
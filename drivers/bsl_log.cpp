@@ -0,0 +1,75 @@
+/*
+ * bsl_log.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_log.h"
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
+
+namespace BSLLog {
+
+    static thread_local _sink current;
+
+    int printf(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        if(!current) {
+            int n = vprintf(format, args);
+            va_end(args);
+            return n;
+        }
+
+        char buf[256];
+        va_list copy;
+        va_copy(copy, args);
+        int n = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+
+        if(n >= (int) sizeof(buf)) {
+            std::vector<char> big(n + 1);
+            vsnprintf(big.data(), big.size(), format, copy);
+            current(big.data());
+        } else if(n > 0) {
+            current(buf);
+        }
+        va_end(copy);
+        return n;
+    }
+
+    Redirect::Redirect(_sink sink) : previous(current)
+    {
+        current = sink;
+    }
+
+    Redirect::~Redirect()
+    {
+        current = previous;
+    }
+
+    std::string last_line(const std::string &log)
+    {
+        size_t end = log.find_last_not_of("\n");
+        if(end == std::string::npos)
+            return "";
+        size_t start = log.rfind('\n', end);
+        start = (start == std::string::npos) ? 0 : start + 1;
+        return log.substr(start, end - start + 1);
+    }
+
+    std::string json_string(const std::string &s)
+    {
+        std::string out = "\"";
+        for(char c : s) {
+            if(c == '"' || c == '\\')
+                out += '\\';
+            if((unsigned char) c >= 0x20)
+                out += c;
+        }
+        return out + "\"";
+    }
+};
@@ -0,0 +1,37 @@
+/*
+ * bsl_log.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include <functional>
+#include <string>
+
+/*
+ * Text output of the drivers. Goes to stdout unless the calling thread
+ * installed a sink, the daemon and the library API hand it to their client.
+ * Progress, station and inventory records are JSON lines built with the
+ * helpers below.
+ */
+namespace BSLLog {
+
+    typedef std::function<void(const char* text)> _sink;
+
+    int printf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+    // installs sink for the current thread while in scope, restores the previous one
+    class Redirect {
+        public:
+            Redirect(_sink sink);
+            ~Redirect();
+        private:
+            _sink previous;
+    };
+
+    // last line of captured output, it says what went wrong
+    std::string last_line(const std::string &log);
+    // s quoted for JSON records, control characters dropped
+    std::string json_string(const std::string &s);
+};
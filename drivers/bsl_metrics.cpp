@@ -0,0 +1,401 @@
+/*
+ * bsl_metrics.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_metrics.h"
+#include "bsl_log.h"
+#include "bsl_tool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+const BSLMetrics::_family BSLMetrics::families[] = {
+    {"mspm0_bsl_units", Kind::Counter, "Units flashed by result."},
+    {"mspm0_bsl_programmed_bytes", Kind::Counter, "Payload bytes the BSL acknowledged."},
+    {"mspm0_bsl_program_seconds", Kind::Counter, "Time spent programming."},
+    {"mspm0_bsl_frame_retries", Kind::Counter, "Program frames sent again."},
+    {"mspm0_bsl_line_errors", Kind::Counter, "Resynchronizations after line errors while programming."},
+    {"mspm0_bsl_errors", Kind::Counter, "BSL errors by phase, acknowledgement and core message."},
+    {"mspm0_bsl_crc_mismatches", Kind::Counter, "Standalone verifications that answered with a different CRC."},
+    {"mspm0_bsl_phase_duration_seconds", Kind::Histogram, "Duration of the flash phases."},
+    {"mspm0_bsl_baud", Kind::Gauge, "Baudrate of the last unit."},
+    {"mspm0_bsl_throughput_bytes_per_second", Kind::Gauge, "Programming rate of the last unit."},
+    {"mspm0_bsl_last_unit_timestamp_seconds", Kind::Gauge, "Unix time the last unit was done."},
+};
+
+// the stats histograms of BSLTool that time a phase
+static const char* const phases[] = {
+    "bsl_entry", "connect", "change_baud", "device_info", "unlock", "mass_erase", "range_erase",
+    "resume_verify", "program", "verify", "start", "dump"
+};
+
+static const char* ack_label(BSL::AckType ack)
+{
+    switch(ack) {
+    case BSL::AckType::BSL_ACK: return "ack";
+    case BSL::AckType::BSL_ERROR_HEADER_INCORRECT: return "header_incorrect";
+    case BSL::AckType::BSL_ERROR_CHECKSUM_INCORRECT: return "checksum_incorrect";
+    case BSL::AckType::BSL_ERROR_PACKET_SIZE_ZERO: return "packet_size_zero";
+    case BSL::AckType::BSL_ERROR_PACKET_SIZE_TOO_BIG: return "packet_size_too_big";
+    case BSL::AckType::BSL_ERROR_UNKNOWN_ERROR: return "unknown_error";
+    case BSL::AckType::BSL_ERROR_UNKNOWN_BAUD_RATE: return "unknown_baud_rate";
+    case BSL::AckType::ERR_TIMEOUT: return "timeout";
+    case BSL::AckType::ERR_UNDEFINED: return "undefined";
+    case BSL::AckType::ERR_RX_CHECKSUM: return "rx_checksum";
+    default: return "other";
+    }
+}
+
+static const char* message_label(BSL::CoreMessage msg)
+{
+    switch(msg) {
+    case BSL::CoreMessage::SUCCESS: return "success";
+    case BSL::CoreMessage::BSL_LOCKED: return "bsl_locked";
+    case BSL::CoreMessage::BSL_PWD_ERR: return "bsl_pwd_err";
+    case BSL::CoreMessage::BSL_MULTIPLE_PWD_ERR: return "bsl_multiple_pwd_err";
+    case BSL::CoreMessage::UNKNOWN_CMD: return "unknown_cmd";
+    case BSL::CoreMessage::INVALID_MEM_RANGE: return "invalid_mem_range";
+    case BSL::CoreMessage::INVALID_CMD: return "invalid_cmd";
+    case BSL::CoreMessage::FACTORY_RESET_DISABLED: return "factory_reset_disabled";
+    case BSL::CoreMessage::FACTORY_RESET_PWD_ERR: return "factory_reset_pwd_err";
+    case BSL::CoreMessage::READOUT_ERR: return "readout_err";
+    case BSL::CoreMessage::INV_ADDR_OR_LEN: return "inv_addr_or_len";
+    case BSL::CoreMessage::INV_LEN_VERIFICATION: return "inv_len_verification";
+    case BSL::CoreMessage::BSL_UART_UNDEFINED: return "none";
+    default: return "other";
+    }
+}
+
+static std::string format_number(double v)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g", v);
+    return buf;
+}
+
+// le values as canonical floats, "1.0" rather than "1"
+static std::string format_bound(double v)
+{
+    std::string s = format_number(v);
+    if(s.find_first_of(".e") == std::string::npos)
+        s += ".0";
+    return s;
+}
+
+std::string BSLMetrics::label(const char* name, const std::string &value)
+{
+    std::string out = std::string(name) + "=\"";
+    for(char c : value) {
+        if(c == '\\' || c == '"')
+            out += '\\';
+        if(c == '\n')
+            out += "\\n";
+        else
+            out += c;
+    }
+    return out + "\"";
+}
+
+const BSLMetrics::_family* BSLMetrics::find_family(const std::string &name, std::string &suffix)
+{
+    static const char* const counter_suffixes[] = {"_total"};
+    static const char* const gauge_suffixes[] = {""};
+    static const char* const histogram_suffixes[] = {"_bucket", "_count", "_sum"};
+
+    for(const _family &f : families) {
+        const size_t len = strlen(f.name);
+        if(name.compare(0, len, f.name) != 0)
+            continue;
+
+        const char* const* suffixes = counter_suffixes;
+        size_t num_suffixes = 1;
+        if(f.kind == Kind::Gauge) {
+            suffixes = gauge_suffixes;
+        } else if(f.kind == Kind::Histogram) {
+            suffixes = histogram_suffixes;
+            num_suffixes = 3;
+        }
+        for(size_t i = 0; i < num_suffixes; i++) {
+            if(name.compare(len, std::string::npos, suffixes[i]) == 0) {
+                suffix = suffixes[i];
+                return &f;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void BSLMetrics::add(const char* family, const std::string &labels, double v)
+{
+    values[family][labels] += v;
+}
+
+void BSLMetrics::set(const char* family, const std::string &labels, double v)
+{
+    values[family][labels] = v;
+}
+
+void BSLMetrics::observe(const char* family, const std::string &labels, double v, uint64_t n)
+{
+    _histogram &h = histograms[family][labels];
+    for(size_t i = 0; i < num_bounds; i++) {
+        if(v <= bounds[i])
+            h.buckets[i] += n;
+    }
+    h.buckets[num_bounds] += n;
+    h.count += n;
+    h.sum += v * n;
+}
+
+void BSLMetrics::record_unit(BSLTool &tool, const std::string &port, bool ok)
+{
+    const std::string by_port = label("port", port);
+    const auto &report = tool.get_program_report();
+
+    add("mspm0_bsl_units", by_port + "," + label("result", ok ? "ok" : "failed"), 1);
+    add("mspm0_bsl_programmed_bytes", by_port, report.confirmed);
+    add("mspm0_bsl_program_seconds", by_port, report.elapsed_us / 1e6);
+    add("mspm0_bsl_frame_retries", by_port, report.retries);
+    add("mspm0_bsl_line_errors", by_port, report.resyncs);
+    add("mspm0_bsl_crc_mismatches", by_port, tool.get_crc_mismatches());
+
+    for(const auto &[key, n] : tool.get_errors()) {
+        const auto &[phase, ack, msg] = key;
+        add("mspm0_bsl_errors", by_port + "," + label("phase", phase) + "," + label("ack", ack_label(ack)) + "," +
+            label("message", message_label(msg)), n);
+    }
+
+    // a phase ran once per unit unless a step was repeated, then its log2 buckets have to do
+    const auto stats = tool.get_stats().histograms();
+    for(const char* phase : phases) {
+        auto it = stats.find(phase);
+        if(it == stats.end() || it->second.count == 0)
+            continue;
+
+        const auto &h = it->second;
+        const std::string labels = by_port + "," + label("phase", phase);
+        if(h.count == 1) {
+            observe("mspm0_bsl_phase_duration_seconds", labels, h.sum_us / 1e6);
+            continue;
+        }
+        double approx_s = 0;
+        for(int i = 0; i < BSLStats::num_buckets; i++) {
+            if(h.buckets[i] == 0)
+                continue;
+            const uint64_t upper = (i == 0) ? 0 : ((1ULL << i) - 1);
+            const double s = std::min(std::max(upper, h.min_us), h.max_us) / 1e6;
+            observe("mspm0_bsl_phase_duration_seconds", labels, s, h.buckets[i]);
+            approx_s += s * h.buckets[i];
+        }
+        // the sum is exact
+        histograms["mspm0_bsl_phase_duration_seconds"][labels].sum += h.sum_us / 1e6 - approx_s;
+    }
+
+    if(tool.get_link_baud() != 0)
+        set("mspm0_bsl_baud", by_port, tool.get_link_baud());
+    if(report.confirmed > 0 && report.elapsed_us > 0)
+        set("mspm0_bsl_throughput_bytes_per_second", by_port, report.confirmed * 1e6 / report.elapsed_us);
+    set("mspm0_bsl_last_unit_timestamp_seconds", by_port, time(nullptr));
+}
+
+void BSLMetrics::merge(const BSLMetrics &other)
+{
+    for(const auto &[name, series] : other.values) {
+        std::string suffix;
+        const _family* f = find_family(name, suffix);
+        for(const auto &[labels, v] : series) {
+            // gauges take the newer value, counters add up
+            if(f != nullptr && f->kind == Kind::Gauge)
+                values[name][labels] = v;
+            else
+                values[name][labels] += v;
+        }
+    }
+
+    for(const auto &[name, series] : other.histograms) {
+        for(const auto &[labels, o] : series) {
+            _histogram &h = histograms[name][labels];
+            for(size_t i = 0; i <= num_bounds; i++)
+                h.buckets[i] += o.buckets[i];
+            h.count += o.count;
+            h.sum += o.sum;
+        }
+    }
+}
+
+void BSLMetrics::clear()
+{
+    values.clear();
+    histograms.clear();
+}
+
+bool BSLMetrics::parse(const std::string &text)
+{
+    size_t pos = 0;
+    while(pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if(end == std::string::npos)
+            end = text.size();
+        const std::string line = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        // name{labels} value, label values may hold spaces and escaped quotes
+        size_t name_end = line.find_first_of("{ ");
+        if(name_end == std::string::npos)
+            return false;
+        const std::string name = line.substr(0, name_end);
+        std::string labels;
+        size_t value_at = name_end;
+        if(line[name_end] == '{') {
+            bool quoted = false;
+            size_t i = name_end + 1;
+            for(; i < line.size(); i++) {
+                if(quoted && line[i] == '\\')
+                    i++;
+                else if(line[i] == '"')
+                    quoted = !quoted;
+                else if(!quoted && line[i] == '}')
+                    break;
+            }
+            if(i >= line.size())
+                return false;
+            labels = line.substr(name_end + 1, i - name_end - 1);
+            value_at = i + 1;
+        }
+
+        const char* value_text = line.c_str() + value_at;
+        char* value_end = nullptr;
+        const double v = strtod(value_text, &value_end);
+        if(value_end == value_text)
+            return false;
+
+        std::string suffix;
+        const _family* f = find_family(name, suffix);
+        if(f == nullptr)
+            continue;
+
+        if(f->kind != Kind::Histogram) {
+            values[f->name][labels] = v;
+            continue;
+        }
+
+        if(suffix == "_bucket") {
+            // le is written last
+            size_t le = labels.rfind("le=\"");
+            if(le == std::string::npos)
+                return false;
+            const std::string bound = labels.substr(le + 4, labels.size() - le - 5);
+            labels = labels.substr(0, le > 0 ? le - 1 : 0);
+
+            size_t index = num_bounds;
+            if(bound != "+Inf") {
+                const double b = strtod(bound.c_str(), nullptr);
+                for(index = 0; index < num_bounds && std::fabs(bounds[index] - b) > 1e-9; index++) {
+                }
+                // a bucket layout this build does not have
+                if(index == num_bounds)
+                    continue;
+            }
+            histograms[f->name][labels].buckets[index] = v;
+        } else if(suffix == "_count") {
+            histograms[f->name][labels].count = v;
+        } else {
+            histograms[f->name][labels].sum = v;
+        }
+    }
+    return true;
+}
+
+std::string BSLMetrics::to_openmetrics() const
+{
+    std::string out;
+    for(const _family &f : families) {
+        if(f.kind == Kind::Histogram) {
+            auto it = histograms.find(f.name);
+            if(it == histograms.end())
+                continue;
+
+            out += std::string("# TYPE ") + f.name + " histogram\n# HELP " + f.name + " " + f.help + "\n";
+            for(const auto &[labels, h] : it->second) {
+                const std::string sep = labels.empty() ? "" : ",";
+                for(size_t i = 0; i <= num_bounds; i++) {
+                    out += std::string(f.name) + "_bucket{" + labels + sep + "le=\"" + (i < num_bounds ? format_bound(bounds[i]) : "+Inf") +
+                        "\"} " + format_number(h.buckets[i]) + "\n";
+                }
+                out += std::string(f.name) + "_count{" + labels + "} " + format_number(h.count) + "\n";
+                out += std::string(f.name) + "_sum{" + labels + "} " + format_number(h.sum) + "\n";
+            }
+            continue;
+        }
+
+        auto it = values.find(f.name);
+        if(it == values.end())
+            continue;
+
+        const bool counter = f.kind == Kind::Counter;
+        out += std::string("# TYPE ") + f.name + (counter ? " counter\n" : " gauge\n") + "# HELP " + f.name + " " + f.help + "\n";
+        for(const auto &[labels, v] : it->second)
+            out += std::string(f.name) + (counter ? "_total" : "") + "{" + labels + "} " + format_number(v) + "\n";
+    }
+    out += "# EOF\n";
+    return out;
+}
+
+bool BSLMetrics::update_file(const std::string &path) const
+{
+    // serializes read, merge and rename of runs sharing the file
+    const std::string lock_path = path + ".lock";
+    int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0) {
+        BSLLog::printf("Error %i locking %s: %s\n", errno, lock_path.c_str(), strerror(errno));
+        if(lock_fd >= 0)
+            close(lock_fd);
+        return false;
+    }
+
+    BSLMetrics total;
+    FILE* in = fopen(path.c_str(), "r");
+    if(in != nullptr) {
+        std::string text;
+        char buf[4096];
+        size_t n;
+        while((n = fread(buf, 1, sizeof(buf), in)) > 0)
+            text.append(buf, n);
+        fclose(in);
+        if(!total.parse(text)) {
+            BSLLog::printf("Metrics file %s is malformed, starting over\n", path.c_str());
+            total.clear();
+        }
+    }
+    total.merge(*this);
+
+    const std::string content = total.to_openmetrics();
+    const std::string tmp_path = path + ".tmp";
+    bool status = false;
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd >= 0) {
+        status = write(fd, content.data(), content.size()) == (ssize_t) content.size() && fsync(fd) == 0;
+        status = (close(fd) == 0) && status;
+        status = status && rename(tmp_path.c_str(), path.c_str()) == 0;
+        if(!status)
+            unlink(tmp_path.c_str());
+    }
+    if(!status)
+        BSLLog::printf("Error %i writing metrics file %s: %s\n", errno, path.c_str(), strerror(errno));
+
+    close(lock_fd);
+    return status;
+}
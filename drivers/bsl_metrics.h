@@ -0,0 +1,85 @@
+/*
+ * bsl_metrics.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <map>
+#include <string>
+
+class BSLTool;
+
+/*
+ * Station metrics in the OpenMetrics text format, for the node exporter's
+ * textfile collector or a scrape through the daemon.
+ *
+ * Counters and histograms add up over all units, gauges hold the last unit's
+ * value. Each flasher run adds its unit to the file: the file is read, merged
+ * and replaced through a temp file and rename, under a lock next to it, so
+ * parallel runs on one station do not lose units and a reader never sees a
+ * partial file.
+ *
+ *   mspm0_bsl_units_total{port,result}                  units flashed, result ok or failed
+ *   mspm0_bsl_programmed_bytes_total{port}              payload bytes the BSL acknowledged
+ *   mspm0_bsl_program_seconds_total{port}               time spent programming them
+ *   mspm0_bsl_frame_retries_total{port}                 program frames sent again
+ *   mspm0_bsl_line_errors_total{port}                   resynchronizations after line errors
+ *   mspm0_bsl_errors_total{port,phase,ack,message}      BSL errors by AckType and CoreMessage
+ *   mspm0_bsl_crc_mismatches_total{port}                verifications with a different CRC
+ *   mspm0_bsl_phase_duration_seconds{port,phase}        histogram per phase (connect, program, ...)
+ *   mspm0_bsl_baud{port}                                negotiated baudrate of the last unit
+ *   mspm0_bsl_throughput_bytes_per_second{port}         programming rate of the last unit
+ *   mspm0_bsl_last_unit_timestamp_seconds{port}         end of the last unit, unix time
+ */
+class BSLMetrics {
+    public:
+        // adds the session of tool, flashed on port, ok: the whole flash succeeded
+        void record_unit(BSLTool &tool, const std::string &port, bool ok);
+        void merge(const BSLMetrics &other);
+        void clear();
+        bool empty() const { return values.empty() && histograms.empty(); }
+
+        // families it does not know are skipped, false on malformed samples
+        bool parse(const std::string &text);
+        std::string to_openmetrics() const;
+        // adds these numbers to the ones in path and replaces it atomically
+        bool update_file(const std::string &path) const;
+
+    private:
+        enum class Kind {
+            Counter,
+            Gauge,
+            Histogram
+        };
+
+        struct _family {
+            const char* name;
+            Kind kind;
+            const char* help;
+        };
+
+        static constexpr double bounds[] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 60, 120};
+        static constexpr size_t num_bounds = sizeof(bounds) / sizeof(bounds[0]);
+        static const _family families[];
+
+        // cumulative like the exposition, the last bucket is +Inf
+        struct _histogram {
+            uint64_t buckets[num_bounds + 1] = {0};
+            uint64_t count = 0;
+            double sum = 0;
+        };
+
+        static const _family* find_family(const std::string &name, std::string &suffix);
+        static std::string label(const char* name, const std::string &value);
+
+        void add(const char* family, const std::string &labels, double v);
+        void set(const char* family, const std::string &labels, double v);
+        void observe(const char* family, const std::string &labels, double v, uint64_t n=1);
+
+        // family -> label set ("port=\"/dev/ttyUSB0\",result=\"ok\"") -> value
+        std::map<std::string, std::map<std::string, double>> values;
+        std::map<std::string, std::map<std::string, _histogram>> histograms;
+};
@@ -0,0 +1,15 @@
+/*
+ * bsl_modem.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_modem.h"
+
+BSL_Modem::BSL_Modem(Transport* _serial, int _verbose_level, _modem_def _def) : BSL_Entry(_verbose_level), serial(_serial), def(_def)
+{
+    // opening the tty asserts DTR/RTS, release both right away
+    set_reset(false);
+    set_bsl(false);
+}
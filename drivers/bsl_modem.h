@@ -0,0 +1,36 @@
+/*
+ * bsl_modem.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "serial.h"
+#include "bsl_entry.h"
+
+/*
+ * BSL entry through the DTR/RTS lines of the already open serial port,
+ * common wiring on USB-UART adapters (NRST on DTR, BSL invoke on RTS).
+ */
+class BSL_Modem : public BSL_Entry {
+    public:
+        struct _modem_def {
+            int reset_line;     // TIOCM_DTR or TIOCM_RTS
+            int bsl_line;
+            bool reset_invert;  // false: asserted line = reset active
+            bool bsl_invert;    // false: asserted line = BSL invoked
+        };
+
+        static constexpr _modem_def default_modem_def = {.reset_line=TIOCM_DTR, .bsl_line=TIOCM_RTS, .reset_invert=false, .bsl_invert=false};
+
+        BSL_Modem(Transport* _serial, int _verbose_level, _modem_def _def=default_modem_def);
+
+    protected:
+        bool set_bsl(bool active) override { return serial->set_modem_line(def.bsl_line, active != def.bsl_invert); }
+        bool set_reset(bool active) override { return serial->set_modem_line(def.reset_line, active != def.reset_invert); }
+
+    private:
+        Transport* serial = nullptr;
+        _modem_def def;
+};
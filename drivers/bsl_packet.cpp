@@ -0,0 +1,79 @@
+/*
+ * bsl_packet.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_packet.h"
+#include <cstring>
+
+namespace BSL {
+
+    void fill_cmd_header(uint8_t* buffer, uint16_t core_len, CoreCmd cmd)
+    {
+        // header + data length
+        *buffer = CMD_HEADER;
+        memcpy(buffer+1, &core_len, 2);
+        *(buffer+3) = static_cast<uint8_t>(cmd);
+    }
+
+    void fill_cmd_data(uint8_t* buffer, const uint8_t* data, size_t data_len)
+    {
+        memcpy(buffer+header_len+1, data, data_len);
+    }
+
+    void append_crc(uint8_t* buffer, uint16_t core_len)
+    {
+        // crc over cmd+data
+        uint32_t crc = softwareCRC(buffer+header_len, core_len);
+        memcpy(buffer+header_len+core_len, &crc, 4);
+    }
+
+    size_t build_packet(uint8_t* buffer, CoreCmd cmd, const uint8_t* data, uint16_t data_len)
+    {
+        const uint16_t core_len = 1 + data_len;
+        fill_cmd_header(buffer, core_len, cmd);
+        if(data_len > 0)
+            fill_cmd_data(buffer, data, data_len);
+        append_crc(buffer, core_len);
+        return packet_len(core_len);
+    }
+
+    bool parse_response(const uint8_t* buffer, size_t len, _response_view &rsp)
+    {
+        if(len < packet_len(1) || buffer[0] != RSP_HEADER)
+            return false;
+
+        uint16_t core_len;
+        memcpy(&core_len, buffer+1, 2);
+        if(core_len == 0 || len < packet_len(core_len))
+            return false;
+
+        uint32_t crc;
+        memcpy(&crc, buffer+header_len+core_len, 4);
+
+        rsp.code = static_cast<CoreResponse>(buffer[header_len]);
+        rsp.data = buffer+header_len+1;
+        rsp.data_len = core_len - 1;
+        rsp.crc_ok = softwareCRC(buffer+header_len, core_len) == crc;
+        return true;
+    }
+
+    bool parse_device_info(const _response_view &rsp, _device_info &device_info)
+    {
+        if(rsp.code != CoreResponse::GetDeviceInfo || rsp.data_len < device_info_len)
+            return false;
+
+        const uint8_t* d = rsp.data;
+        memcpy(&device_info.cmd_interpreter_version, d+0, 2);
+        memcpy(&device_info.build_id, d+2, 2);
+        memcpy(&device_info.app_version, d+4, 4);
+        memcpy(&device_info.plugin_if_version, d+8, 2);
+        memcpy(&device_info.bsl_max_buff_size, d+10, 2);
+        memcpy(&device_info.bsl_buff_start_addr, d+12, 4);
+        memcpy(&device_info.bcr_conf_id, d+16, 4);
+        memcpy(&device_info.bsl_conf_id, d+20, 4);
+        return true;
+    }
+};
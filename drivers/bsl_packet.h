@@ -0,0 +1,38 @@
+/*
+ * bsl_packet.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <cstddef>
+#include "bsl_protocol.h"
+
+namespace BSL {
+
+    static constexpr uint8_t header_len = 3;
+    static constexpr uint8_t crc_len = 4;
+    static constexpr uint16_t device_info_len = 24;     // GetDeviceInfo response data
+
+    // core_len counts the command/response byte plus its data
+    inline constexpr size_t packet_len(uint16_t core_len) { return header_len + core_len + crc_len; }
+
+    /* command packets */
+    void fill_cmd_header(uint8_t* buffer, uint16_t core_len, CoreCmd cmd);
+    void fill_cmd_data(uint8_t* buffer, const uint8_t* data, size_t data_len);
+    void append_crc(uint8_t* buffer, uint16_t core_len);
+    size_t build_packet(uint8_t* buffer, CoreCmd cmd, const uint8_t* data, uint16_t data_len);
+
+    /* response packets, views point into the receive buffer */
+    struct _response_view {
+        CoreResponse code;
+        const uint8_t* data;    // after the response code
+        uint16_t data_len;
+        bool crc_ok;
+    };
+
+    bool parse_response(const uint8_t* buffer, size_t len, _response_view &rsp);
+    bool parse_device_info(const _response_view &rsp, _device_info &device_info);
+};
@@ -0,0 +1,208 @@
+/*
+ * bsl_progress.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_progress.h"
+#include "bsl_log.h"
+#include "bsl_tool.h"
+#include "bsl_timing.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <unistd.h>
+
+BSLProgress::BSLProgress(const _config &_cfg) : cfg(_cfg)
+{
+    start = BSLTiming::now();
+    reporter = std::thread(&BSLProgress::run, this);
+}
+
+BSLProgress::~BSLProgress()
+{
+    if(reporter.joinable())
+        finish(false);
+}
+
+void BSLProgress::attach(BSLTool &tool)
+{
+    tool.set_phase_callback([this](const char* name) { phase(name); });
+    tool.set_progress_callback([this](const BSLTool::_progress &p) { update(p.done, p.total, p.frames, p.retries); });
+}
+
+uint64_t BSLProgress::now_us() const
+{
+    return BSLTiming::elapsed_us(start);
+}
+
+void BSLProgress::phase(const char* name)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        // the reporter still owes the final numbers of a transfer
+        phases.push_back({name, now_us(), state});
+        state = _state();
+        state.phase = name;
+    }
+    cond.notify_all();
+}
+
+void BSLProgress::update(uint32_t done, uint32_t total, uint32_t frames, uint32_t retries)
+{
+    const uint64_t t = now_us();
+    std::lock_guard<std::mutex> guard(lock);
+    if(done != state.done || !state.transfer)
+        state.t_progress_us = t;
+    state.done = done;
+    state.total = total;
+    state.frames = frames;
+    state.retries = retries;
+    state.transfer = true;
+}
+
+void BSLProgress::finish(bool ok)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if(stop)
+            return;
+        stop = true;
+        result = ok;
+    }
+    cond.notify_all();
+    reporter.join();
+}
+
+void BSLProgress::run()
+{
+    // a reader that went away shows up as EPIPE here instead of killing the flasher
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, nullptr);
+
+    while(true) {
+        std::deque<_phase> due_phases;
+        _state s;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cond.wait_for(guard, std::chrono::milliseconds(cfg.interval_ms), [&]() { return stop || !phases.empty(); });
+            due_phases.swap(phases);
+            s = state;
+            stopping = stop;
+        }
+
+        const uint64_t t = now_us();
+        for(auto &p : due_phases) {
+            if(p.previous.transfer)
+                report(p.previous, p.t_us);
+            end_line();
+            write_record("{\"event\":\"phase\",\"t_ms\":" + std::to_string(p.t_us / 1000) + ",\"port\":" + BSLLog::json_string(cfg.port) +
+                ",\"phase\":" + BSLLog::json_string(p.name) + "}");
+            reset_rates();
+        }
+        if(s.transfer)
+            report(s, t);
+
+        if(stopping) {
+            end_line();
+            write_record("{\"event\":\"end\",\"t_ms\":" + std::to_string(t / 1000) + ",\"port\":" + BSLLog::json_string(cfg.port) +
+                ",\"ok\":" + (result ? "true" : "false") + "}");
+            return;
+        }
+    }
+}
+
+void BSLProgress::reset_rates()
+{
+    t_first_us = 0;
+    t_last_us = 0;
+    rate_bps = 0;
+}
+
+void BSLProgress::report(const _state &s, uint64_t t)
+{
+    // rates count from the first update seen, a resumed flash starts past 0
+    if(t_first_us == 0) {
+        first_done = s.done;
+        first_frames = s.frames;
+        t_first_us = s.t_progress_us;
+        last_done = s.done;
+        t_last_us = s.t_progress_us;
+    }
+
+    if(t > t_last_us) {
+        const double current = (double) (s.done - last_done) * 1e6 / (t - t_last_us);
+        rate_bps = (rate_bps == 0) ? current : (rate_bps + current) / 2;
+        last_done = s.done;
+        t_last_us = t;
+    }
+
+    const uint64_t elapsed_us = t > t_first_us ? t - t_first_us : 0;
+    const double avg_bps = elapsed_us ? (double) (s.done - first_done) * 1e6 / elapsed_us : 0;
+    const double fps = elapsed_us ? (double) (s.frames - first_frames) * 1e6 / elapsed_us : 0;
+    const bool stalled = s.done < s.total && t - s.t_progress_us > (uint64_t) cfg.stall_ms * 1000;
+    const double eta_rate = rate_bps > 0 ? rate_bps : avg_bps;
+    const int64_t eta_s = (s.done >= s.total) ? 0 : (eta_rate > 0 && !stalled) ? (int64_t) ((s.total - s.done) / eta_rate + 0.5) : -1;
+
+    if(cfg.terminal) {
+        char eta[32] = "--";
+        if(eta_s >= 0)
+            snprintf(eta, sizeof(eta), "%lld:%02lld", (long long) eta_s / 60, (long long) eta_s % 60);
+        fprintf(stderr, "\r%-8s %7.1f/%.1f kB %3u%%  %6.2f kB/s (avg %.2f)  %5.1f fps  %u retries  ETA %s%s\033[K",
+            s.phase.c_str(), s.done / 1024.0, s.total / 1024.0, s.total ? (unsigned) ((uint64_t) s.done * 100 / s.total) : 0,
+            rate_bps / 1024, avg_bps / 1024, fps, s.retries, eta, stalled ? "  STALLED" : "");
+        fflush(stderr);
+        line_open = true;
+    }
+
+    if(cfg.fd >= 0) {
+        char record[384];
+        snprintf(record, sizeof(record),
+            "{\"event\":\"progress\",\"t_ms\":%llu,\"port\":%s,\"phase\":%s,\"done\":%u,\"total\":%u,\"frames\":%u,\"retries\":%u,"
+            "\"rate_bps\":%.0f,\"avg_bps\":%.0f,\"fps\":%.1f,\"eta_s\":%s,\"stalled\":%s}",
+            (unsigned long long) t / 1000, BSLLog::json_string(cfg.port).c_str(), BSLLog::json_string(s.phase).c_str(), s.done, s.total, s.frames, s.retries,
+            rate_bps, avg_bps, fps, eta_s >= 0 ? std::to_string(eta_s).c_str() : "null", stalled ? "true" : "false");
+        write_record(record);
+    }
+}
+
+void BSLProgress::end_line()
+{
+    if(!line_open)
+        return;
+    fputc('\n', stderr);
+    line_open = false;
+}
+
+void BSLProgress::write_record(const std::string &record)
+{
+    if(cfg.fd < 0)
+        return;
+
+    std::string line = record + "\n";
+    const char* p = line.data();
+    size_t len = line.size();
+    while(len > 0) {
+        ssize_t n = write(cfg.fd, p, len);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0) {
+            // reader gone, drop the pending SIGPIPE and stop writing
+            if(errno == EPIPE) {
+                sigset_t pipe_set;
+                sigemptyset(&pipe_set);
+                sigaddset(&pipe_set, SIGPIPE);
+                const timespec zero = {0, 0};
+                sigtimedwait(&pipe_set, nullptr, &zero);
+            }
+            cfg.fd = -1;
+            return;
+        }
+        p += n;
+        len -= n;
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * bsl_progress.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <time.h>
+
+class BSLTool;
+
+/*
+ * Live progress of a flash for the operator and the line controller.
+ *
+ * The tool's callbacks only store the latest numbers under a short lock. A
+ * reporter thread turns them into a terminal status line (stderr) and/or
+ * newline-delimited JSON records on a file descriptor every interval, so a
+ * slow terminal or reader never holds up the transfer loop. Records keep
+ * coming while a transfer makes no progress, flagged stalled once nothing
+ * was confirmed for stall_ms.
+ *
+ * NDJSON records, t_ms counts from the start:
+ *   {"event":"phase","t_ms":..,"port":..,"phase":"program"}
+ *   {"event":"progress","t_ms":..,"port":..,"phase":..,"done":..,"total":..,"frames":..,"retries":..,
+ *    "rate_bps":..,"avg_bps":..,"fps":..,"eta_s":..,"stalled":false}
+ *   {"event":"end","t_ms":..,"port":..,"ok":true}
+ */
+class BSLProgress {
+    public:
+        struct _config {
+            bool terminal = false;      // status line on stderr
+            int fd = -1;                // NDJSON records, -1: none
+            uint32_t interval_ms = 250;
+            uint32_t stall_ms = 1000;
+            std::string port;
+        };
+
+        BSLProgress(const _config &_cfg);
+        ~BSLProgress();
+
+        // installs the phase and progress callbacks of the tool
+        void attach(BSLTool &tool);
+        // final record, stops the reporter
+        void finish(bool ok);
+
+        void phase(const char* name);
+        void update(uint32_t done, uint32_t total, uint32_t frames, uint32_t retries);
+
+    private:
+        struct _state {
+            std::string phase;
+            uint32_t done = 0;
+            uint32_t total = 0;
+            uint32_t frames = 0;
+            uint32_t retries = 0;
+            uint64_t t_progress_us = 0;     // last confirmed bytes
+            bool transfer = false;          // phase has progress updates
+        };
+
+        struct _phase {
+            std::string name;
+            uint64_t t_us;
+            _state previous;                // final numbers of the phase it ends
+        };
+
+        void run();
+        void report(const _state &s, uint64_t now_us);
+        void reset_rates();
+        void end_line();
+        void write_record(const std::string &record);
+        uint64_t now_us() const;
+
+        _config cfg;
+        timespec start;
+
+        // written by the transfer thread
+        std::mutex lock;
+        std::condition_variable cond;
+        _state state;
+        std::deque<_phase> phases;          // not yet reported
+        bool stop = false;
+        bool result = false;
+
+        // reporter thread only
+        uint32_t first_done = 0;
+        uint32_t first_frames = 0;
+        uint64_t t_first_us = 0;
+        uint32_t last_done = 0;
+        uint64_t t_last_us = 0;
+        double rate_bps = 0;                // smoothed over the last intervals
+        bool line_open = false;
+
+        std::thread reporter;
+};
@@ -4,8 +4,12 @@
  *  Created on: Nov 30, 2023
  *      Author: Jonas Rockstroh
  */
+#pragma once
 
 #include "stdint.h"
+#include <cstdio>
+#include <string>
+#include <termios.h>
 #include <unordered_map>
 
 namespace BSL {
@@ -31,7 +35,8 @@ namespace BSL {
         BSL_ERROR_UNKNOWN_ERROR         = 0x55,
         BSL_ERROR_UNKNOWN_BAUD_RATE     = 0x56,
         ERR_TIMEOUT                     = 0xA0,
-        ERR_UNDEFINED                   = 0xA1
+        ERR_UNDEFINED                   = 0xA1,
+        ERR_RX_CHECKSUM                 = 0xA2  // response packet failed its CRC
     };
 
     enum class CoreCmd {
@@ -101,12 +106,10 @@ namespace BSL {
     * from MSPM0 BSL example
     */
     #define CRC32_POLY 0xEDB88320
-    inline uint32_t softwareCRC(const uint8_t *data, uint32_t length)
+    // crc: the result over the preceding bytes to continue it, no final XOR
+    inline uint32_t softwareCRC(const uint8_t *data, uint32_t length, uint32_t crc = 0xFFFFFFFF)
     {
-        uint32_t ii, jj, byte, crc, mask;
-        ;
-
-        crc = 0xFFFFFFFF;
+        uint32_t ii, jj, byte, mask;
 
         for (ii = 0; ii < length; ii++) {
             byte = data[ii];
@@ -121,7 +124,7 @@ namespace BSL {
         return crc;
     }
 
-    static const char* AckTypeToString(AckType ack) 
+    inline const char* AckTypeToString(AckType ack) 
     {
         switch(ack) {
         case AckType::BSL_ACK:
@@ -142,12 +145,64 @@ namespace BSL {
             return "Serial timeout";                    
         case AckType::ERR_UNDEFINED:
             return "UNDEFINED";   
+        case AckType::ERR_RX_CHECKSUM:
+            return "Response checksum wrong";
+        default:
+            return "default undefined";
+        }
+    }
+
+    inline const char* CoreCmdToString(CoreCmd cmd)
+    {
+        switch(cmd) {
+        case CoreCmd::Connection:
+            return "Connection";
+        case CoreCmd::UnlockBootloader:
+            return "UnlockBootloader";
+        case CoreCmd::FlashRangeErase:
+            return "FlashRangeErase";
+        case CoreCmd::MassErase:
+            return "MassErase";
+        case CoreCmd::ProgramData:
+            return "ProgramData";
+        case CoreCmd::ProgramDataFast:
+            return "ProgramDataFast";
+        case CoreCmd::MemoryRead:
+            return "MemoryRead";
+        case CoreCmd::FactoryReset:
+            return "FactoryReset";
+        case CoreCmd::GetDeviceInfo:
+            return "GetDeviceInfo";
+        case CoreCmd::StandaloneVerification:
+            return "StandaloneVerification";
+        case CoreCmd::StartApplication:
+            return "StartApplication";
+        case CoreCmd::ChangeBaudrate:
+            return "ChangeBaudrate";
         default:
             return "default undefined";
         }
     }
 
-    static const char* CoreMessageToString(CoreMessage msg) 
+    inline const char* CoreResponseToString(CoreResponse rsp)
+    {
+        switch(rsp) {
+        case CoreResponse::MemoryRead:
+            return "MemoryRead";
+        case CoreResponse::GetDeviceInfo:
+            return "GetDeviceInfo";
+        case CoreResponse::StandaloneVerification:
+            return "StandaloneVerification";
+        case CoreResponse::Message:
+            return "Message";
+        case CoreResponse::DetailedError:
+            return "DetailedError";
+        default:
+            return "default undefined";
+        }
+    }
+
+    inline const char* CoreMessageToString(CoreMessage msg) 
     {
         switch(msg) {
         case CoreMessage::SUCCESS:
@@ -181,7 +236,7 @@ namespace BSL {
         }
     }
 
-    static speed_t BSLBaudToSerialBaud(Baudrate rate)
+    inline speed_t BSLBaudToSerialBaud(Baudrate rate)
     {
         switch(rate) {
         case Baudrate::BSL_B4800:
@@ -207,10 +262,40 @@ namespace BSL {
         }
     }
     
-    static const char* DeviceInfoToString(struct _device_info device_info)
+    inline uint32_t BSLBaudToBitrate(Baudrate rate)
+    {
+        switch(rate) {
+        case Baudrate::BSL_B4800:
+            return 4800;
+        case Baudrate::BSL_B9600:
+            return 9600;
+        case Baudrate::BSL_B19200:
+            return 19200;
+        case Baudrate::BSL_B38400:
+            return 38400;
+        case Baudrate::BSL_B57600:
+            return 57600;
+        case Baudrate::BSL_B115200:
+            return 115200;
+        case Baudrate::BSL_B1000000:
+            return 1000000;
+        case Baudrate::BSL_B2000000:
+            return 2000000;
+        case Baudrate::BSL_B3000000:
+            return 3000000;
+        default:
+            return 9600;
+        }
+    }
+
+    inline std::string DeviceInfoToString(const struct _device_info &device_info)
     {
-        // TODO -> C++20 format maybe?
-        return "";
+        char buf[192];
+        snprintf(buf, sizeof(buf), "cmd interpreter 0x%04x, build 0x%04x, app 0x%08x, plugin if 0x%04x, "
+            "buffer 0x%04x@0x%08x, BCR conf 0x%08x, BSL conf 0x%08x",
+            device_info.cmd_interpreter_version, device_info.build_id, device_info.app_version, device_info.plugin_if_version,
+            device_info.bsl_max_buff_size, device_info.bsl_buff_start_addr, device_info.bcr_conf_id, device_info.bsl_conf_id);
+        return buf;
     }
 
 };
\ No newline at end of file
@@ -0,0 +1,212 @@
+/*
+ * bsl_region.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_region.h"
+#include "bsl_image_source.h"
+#include "bsl_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <map>
+
+namespace BSLRegion {
+
+    static constexpr uint32_t word_size = 8;        // ProgramData granularity
+    static constexpr uint32_t hex_max_gap = 16;     // filled rather than split
+
+    // plain or compressed, inflated
+    static bool read_all(const std::string &path, std::vector<uint8_t> &data)
+    {
+        ImageSource source;
+        if(!source.open(path.c_str()) || !source.scan())
+            return false;
+        data.resize(source.size());
+        return source.read(data.data(), data.size());
+    }
+
+    static int hex_digit(char c)
+    {
+        if(c >= '0' && c <= '9')
+            return c - '0';
+        if(c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        if(c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        return -1;
+    }
+
+    bool is_hex(const std::string &path)
+    {
+        // no messages, a file that can not be read is no HEX file either
+        BSLLog::Redirect quiet([](const char*) {});
+        ImageSource source;
+        uint8_t first = 0;
+        return source.open(path.c_str()) && source.read(&first, 1) && first == ':';
+    }
+
+    bool load_spec(const std::string &spec, std::vector<_region> &regions)
+    {
+        size_t at = spec.rfind('@');
+        if(at == std::string::npos) {
+            if(is_hex(spec))
+                return load_hex(spec, regions);
+            BSLLog::printf("Region %s needs an address, file@addr\n", spec.c_str());
+            return false;
+        }
+
+        const std::string path = spec.substr(0, at);
+        const std::string addr_text = spec.substr(at + 1);
+        char* end = nullptr;
+        errno = 0;
+        unsigned long addr = strtoul(addr_text.c_str(), &end, 0);
+        if(addr_text.empty() || *end != '\0' || errno != 0 || addr > UINT32_MAX) {
+            BSLLog::printf("Region %s: invalid address %s\n", spec.c_str(), addr_text.c_str());
+            return false;
+        }
+        return load_file(path, addr, regions);
+    }
+
+    bool load_file(const std::string &path, uint32_t addr, std::vector<_region> &regions)
+    {
+        _region region;
+        region.addr = addr;
+        region.source = path;
+        if(!read_all(path, region.data))
+            return false;
+        if((uint64_t) addr + region.data.size() > (uint64_t) UINT32_MAX + 1) {
+            BSLLog::printf("Region %s at 0x%08x ends past the address space\n", path.c_str(), addr);
+            return false;
+        }
+        regions.push_back(std::move(region));
+        return true;
+    }
+
+    bool load_hex(const std::string &path, std::vector<_region> &regions)
+    {
+        std::vector<uint8_t> text;
+        if(!read_all(path, text))
+            return false;
+
+        // address -> data of each record, sorted
+        std::map<uint32_t, std::vector<uint8_t>> records;
+        uint32_t base = 0;
+        bool eof = false;
+        size_t line_no = 0;
+
+        for(size_t pos = 0; pos < text.size() && !eof; ) {
+            size_t end = pos;
+            while(end < text.size() && text[end] != '\n')
+                end++;
+            std::string line((const char*) text.data() + pos, end - pos);
+            pos = end + 1;
+            line_no++;
+            while(!line.empty() && (line.back() == '\r' || line.back() == ' '))
+                line.pop_back();
+            if(line.empty())
+                continue;
+
+            // :LLAAAATT<data>CC
+            std::vector<uint8_t> rec;
+            bool valid = line[0] == ':' && line.size() % 2 == 1 && line.size() >= 11;
+            for(size_t i = 1; valid && i < line.size(); i += 2) {
+                int hi = hex_digit(line[i]), lo = hex_digit(line[i + 1]);
+                valid = hi >= 0 && lo >= 0;
+                rec.push_back(hi << 4 | lo);
+            }
+            uint8_t sum = 0;
+            for(uint8_t b : rec)
+                sum += b;
+            if(!valid || rec.size() != 5u + rec[0] || sum != 0) {
+                BSLLog::printf("%s:%zu: not a valid Intel HEX record\n", path.c_str(), line_no);
+                return false;
+            }
+
+            const uint8_t len = rec[0];
+            const uint32_t offset = rec[1] << 8 | rec[2];
+            const uint8_t* payload = rec.data() + 4;
+            switch(rec[3]) {
+            case 0x00: {
+                const uint32_t addr = base + offset;
+                auto &data = records[addr];
+                if(!data.empty()) {
+                    BSLLog::printf("%s:%zu: address 0x%08x is written twice\n", path.c_str(), line_no, addr);
+                    return false;
+                }
+                data.assign(payload, payload + len);
+                break;
+            }
+            case 0x01:
+                eof = true;
+                break;
+            case 0x02:
+                base = (payload[0] << 8 | payload[1]) << 4;
+                break;
+            case 0x04:
+                base = (uint32_t) (payload[0] << 8 | payload[1]) << 16;
+                break;
+            default:
+                // start addresses, nothing to program
+                break;
+            }
+        }
+
+        // contiguous records form a region
+        const size_t first = regions.size();
+        for(auto &[addr, data] : records) {
+            if(data.empty())
+                continue;
+            if(regions.size() > first) {
+                _region &last = regions.back();
+                const uint64_t last_end = (uint64_t) last.addr + last.data.size();
+                if(addr < last_end) {
+                    BSLLog::printf("%s: records overlap at 0x%08x\n", path.c_str(), addr);
+                    // none of the file's regions
+                    regions.resize(first);
+                    return false;
+                }
+                if(addr - last_end <= hex_max_gap) {
+                    last.data.resize(addr - last.addr, 0xFF);
+                    last.data.insert(last.data.end(), data.begin(), data.end());
+                    continue;
+                }
+            }
+            _region region;
+            region.addr = addr;
+            region.data = std::move(data);
+            region.source = path;
+            regions.push_back(std::move(region));
+        }
+
+        if(regions.size() == first) {
+            BSLLog::printf("%s holds no data\n", path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool prepare(std::vector<_region> &regions)
+    {
+        for(_region &r : regions) {
+            // whole words, the padding is erased flash
+            const uint32_t lead = r.addr % word_size;
+            r.addr -= lead;
+            r.data.insert(r.data.begin(), lead, 0xFF);
+            r.data.resize((r.data.size() + word_size - 1) / word_size * word_size, 0xFF);
+        }
+
+        std::sort(regions.begin(), regions.end(), [](const _region &a, const _region &b) { return a.addr < b.addr; });
+        for(size_t i = 1; i < regions.size(); i++) {
+            const _region &prev = regions[i - 1];
+            if((uint64_t) prev.addr + prev.data.size() > regions[i].addr) {
+                BSLLog::printf("Regions %s and %s overlap at 0x%08x\n", prev.source.c_str(), regions[i].source.c_str(), regions[i].addr);
+                return false;
+            }
+        }
+        return true;
+    }
+};
@@ -0,0 +1,36 @@
+/*
+ * bsl_region.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <string>
+#include <vector>
+
+/*
+ * Memory regions flashed in one BSL session: application, data flash,
+ * NONMAIN configuration. They come from "file@addr" pairs or from the
+ * segments of an Intel HEX file, plain and compressed files alike.
+ */
+namespace BSLRegion {
+
+    struct _region {
+        uint32_t addr = 0;
+        std::vector<uint8_t> data;
+        std::string source;     // file it came from, for messages
+    };
+
+    // "file@addr", addr in C notation; an Intel HEX file without @addr adds its segments
+    bool load_spec(const std::string &spec, std::vector<_region> &regions);
+    bool load_file(const std::string &path, uint32_t addr, std::vector<_region> &regions);
+    // one region per contiguous run of records, small gaps are filled with 0xFF
+    bool load_hex(const std::string &path, std::vector<_region> &regions);
+    // content starts with an Intel HEX record
+    bool is_hex(const std::string &path);
+
+    // pads to 8 byte words with 0xFF and sorts by address, false if two regions overlap
+    bool prepare(std::vector<_region> &regions);
+};
@@ -0,0 +1,107 @@
+/*
+ * bsl_rto.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_rto.h"
+#include "bsl_log.h"
+#include "bsl_timing.h"
+#include <algorithm>
+#include <cstdio>
+
+static std::string rto_file(const std::string &port)
+{
+    return BSLTiming::state_file("rto_" + port);
+}
+
+bool BSLRto::known(BSL::CoreCmd cmd) const
+{
+    auto it = estimates.find(cmd);
+    return it != estimates.end() && it->second.samples > 0;
+}
+
+uint32_t BSLRto::timeout_us(BSL::CoreCmd cmd) const
+{
+    auto it = estimates.find(cmd);
+    if(it == estimates.end() || it->second.samples == 0)
+        return max_timeout_us;
+
+    // RFC 6298 uses srtt + 4 rttvar, a steady command has no variance
+    // though and still deserves twice its usual time
+    const _estimate &e = it->second;
+    uint64_t rto = (uint64_t) e.srtt_us + std::max<uint64_t>(4ULL * e.rttvar_us, e.srtt_us);
+    rto <<= std::min(e.backoff, 8);
+    return std::clamp<uint64_t>(rto, min_timeout_us, max_timeout_us);
+}
+
+void BSLRto::sample(BSL::CoreCmd cmd, uint32_t us)
+{
+    _estimate &e = estimates[cmd];
+    if(e.samples == 0) {
+        e.srtt_us = us;
+        e.rttvar_us = us / 2;
+    } else {
+        const uint32_t delta = e.srtt_us > us ? e.srtt_us - us : us - e.srtt_us;
+        e.rttvar_us = (3ULL * e.rttvar_us + delta) / 4;
+        e.srtt_us = (7ULL * e.srtt_us + us) / 8;
+    }
+    e.samples++;
+    e.backoff = 0;
+}
+
+void BSLRto::timed_out(BSL::CoreCmd cmd)
+{
+    auto it = estimates.find(cmd);
+    if(it != estimates.end())
+        it->second.backoff++;
+}
+
+bool BSLRto::load(const std::string &port)
+{
+    std::string path = rto_file(port);
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr) {
+        return false;
+    }
+
+    unsigned cmd;
+    _estimate e;
+    while(fscanf(f, "cmd=%x srtt_us=%u rttvar_us=%u samples=%u\n", &cmd, &e.srtt_us, &e.rttvar_us, &e.samples) == 4) {
+        estimates[static_cast<BSL::CoreCmd>(cmd)] = e;
+    }
+    fclose(f);
+
+    return true;
+}
+
+bool BSLRto::store(const std::string &port) const
+{
+    if(estimates.empty())
+        return true;
+
+    std::string path = rto_file(port);
+    std::string tmp_path = path + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "w");
+    if(f == nullptr) {
+        BSLLog::printf("Can not write timeouts %s\n", path.c_str());
+        return false;
+    }
+
+    for(const auto &[cmd, e] : estimates) {
+        fprintf(f, "cmd=%02x srtt_us=%u rttvar_us=%u samples=%u\n", static_cast<unsigned>(cmd), e.srtt_us, e.rttvar_us, e.samples);
+    }
+    fclose(f);
+
+    return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+void BSLRto::print() const
+{
+    BSLLog::printf("Response timeouts:\n");
+    for(const auto &[cmd, e] : estimates) {
+        BSLLog::printf("\tcmd 0x%02x: srtt %.1fms, rttvar %.1fms, timeout %.1fms (%u samples)\n", static_cast<unsigned>(cmd),
+            e.srtt_us / 1000.0, e.rttvar_us / 1000.0, timeout_us(cmd) / 1000.0, e.samples);
+    }
+}
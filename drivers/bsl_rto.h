@@ -0,0 +1,47 @@
+/*
+ * bsl_rto.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include "bsl_protocol.h"
+#include <map>
+#include <string>
+
+/*
+ * Response timeout per BSL command, estimated like the TCP retransmission
+ * timer (RFC 6298): smoothed response time and its variation per CoreCmd,
+ * a timeout doubles the value until the next answer arrives.
+ *
+ * Times exclude the bytes on the wire, the command's and those of its answer,
+ * callers add both for the current baudrate and payload. Estimates are kept
+ * per port in the state directory.
+ */
+class BSLRto {
+    public:
+        struct _estimate {
+            uint32_t srtt_us = 0;
+            uint32_t rttvar_us = 0;
+            uint32_t samples = 0;
+            int backoff = 0;        // timeouts since the last answer, not persisted
+        };
+
+        static constexpr uint32_t min_timeout_us = 50000;       // USB UART latency timers, scheduling
+        static constexpr uint32_t max_timeout_us = 10000000;    // the old 10 x 1s read budget
+
+        // false until the command was answered once, callers fall back to their fixed budget
+        bool known(BSL::CoreCmd cmd) const;
+        uint32_t timeout_us(BSL::CoreCmd cmd) const;
+        void sample(BSL::CoreCmd cmd, uint32_t us);
+        void timed_out(BSL::CoreCmd cmd);
+
+        bool load(const std::string &port);
+        bool store(const std::string &port) const;
+        void print() const;
+
+    private:
+        std::map<BSL::CoreCmd, _estimate> estimates;
+};
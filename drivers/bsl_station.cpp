@@ -0,0 +1,410 @@
+/*
+ * bsl_station.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_station.h"
+#include "bsl_log.h"
+#include "bsl_metrics.h"
+#include "bsl_tool.h"
+#include "bsl_timing.h"
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <glob.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <set>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int)
+{
+    stop = 1;
+}
+
+static std::string dir_of(const std::string &path)
+{
+    size_t slash = path.rfind('/');
+    if(slash == std::string::npos)
+        return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+BSLStation::BSLStation(const _config &_cfg) : cfg(_cfg)
+{
+}
+
+BSLStation::~BSLStation()
+{
+    for(auto &[port, worker] : busy)
+        worker.join();
+
+    if(netlink_fd >= 0)
+        close(netlink_fd);
+    if(inotify_fd >= 0)
+        close(inotify_fd);
+    if(wake_fd >= 0)
+        close(wake_fd);
+}
+
+std::string BSLStation::slot_name(const std::string &port)
+{
+    static const char by_path[] = "/dev/serial/by-path";
+
+    char target[PATH_MAX];
+    if(realpath(port.c_str(), target) == nullptr)
+        return port;
+
+    DIR* dir = opendir(by_path);
+    if(dir == nullptr)
+        return port;
+
+    std::string slot = port;
+    while(dirent* entry = readdir(dir)) {
+        if(entry->d_name[0] == '.')
+            continue;
+        const std::string link = std::string(by_path) + "/" + entry->d_name;
+        char resolved[PATH_MAX];
+        if(realpath(link.c_str(), resolved) != nullptr && !strcmp(resolved, target)) {
+            slot = link;
+            break;
+        }
+    }
+    closedir(dir);
+    return slot;
+}
+
+bool BSLStation::open_netlink()
+{
+    netlink_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if(netlink_fd < 0)
+        return false;
+
+    // group 1: the kernel's own events, udev's come later on group 2
+    sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_pid = 0;
+    addr.nl_groups = 1;
+    if(bind(netlink_fd, (sockaddr*) &addr, sizeof(addr)) < 0) {
+        close(netlink_fd);
+        netlink_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool BSLStation::open_inotify()
+{
+    // the directories of the filters, /dev only when there are no uevents
+    std::set<std::string> dirs;
+    for(const std::string &filter : cfg.filters) {
+        const std::string dir = dir_of(filter);
+        if(dir != "/dev" || netlink_fd < 0)
+            dirs.insert(dir);
+    }
+    if(dirs.empty())
+        return true;
+
+    inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if(inotify_fd < 0) {
+        BSLLog::printf("Error %i setting up inotify: %s\n", errno, strerror(errno));
+        return false;
+    }
+    for(const std::string &dir : dirs) {
+        int wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM);
+        if(wd < 0) {
+            BSLLog::printf("Error %i watching %s: %s\n", errno, dir.c_str(), strerror(errno));
+            return false;
+        }
+        watches[wd] = dir;
+    }
+    return true;
+}
+
+void BSLStation::read_netlink()
+{
+    char buf[uevent_len];
+    ssize_t n;
+    while((n = recv(netlink_fd, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[n] = '\0';
+
+        // "action@devpath" then NUL separated KEY=value
+        std::string action, subsystem, devname;
+        for(ssize_t pos = strlen(buf) + 1; pos < n; pos += strlen(buf + pos) + 1) {
+            const char* field = buf + pos;
+            if(!strncmp(field, "ACTION=", 7))
+                action = field + 7;
+            else if(!strncmp(field, "SUBSYSTEM=", 10))
+                subsystem = field + 10;
+            else if(!strncmp(field, "DEVNAME=", 8))
+                devname = field + 8;
+        }
+        if(subsystem != "tty" || devname.empty())
+            continue;
+
+        const std::string port = devname[0] == '/' ? devname : "/dev/" + devname;
+        if(action == "add")
+            attached(port);
+        else if(action == "remove")
+            detached(port);
+    }
+}
+
+void BSLStation::read_inotify()
+{
+    alignas(inotify_event) char buf[4096];
+    ssize_t n;
+    while((n = read(inotify_fd, buf, sizeof(buf))) > 0) {
+        for(ssize_t pos = 0; pos < n; ) {
+            const inotify_event* ev = (const inotify_event*) (buf + pos);
+            pos += sizeof(inotify_event) + ev->len;
+
+            auto dir = watches.find(ev->wd);
+            if(ev->len == 0 || dir == watches.end())
+                continue;
+            const std::string port = (dir->second == "/" ? "" : dir->second) + "/" + ev->name;
+            if(ev->mask & (IN_CREATE | IN_MOVED_TO))
+                attached(port);
+            else if(ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                detached(port);
+        }
+    }
+}
+
+bool BSLStation::matches(const std::string &path) const
+{
+    for(const std::string &filter : cfg.filters) {
+        if(fnmatch(filter.c_str(), path.c_str(), FNM_PATHNAME) == 0)
+            return true;
+    }
+    return false;
+}
+
+void BSLStation::attached(const std::string &port)
+{
+    if(!matches(port))
+        return;
+    // one job per port, a second event for it changes nothing; after a removal
+    // it is the next board, flashed when the worker of the last one is done
+    if(busy.count(port)) {
+        if(removed.count(port)) {
+            reattached.insert(port);
+            BSLLog::printf("%s: attached again, flashing it next\n", port.c_str());
+        }
+        else if(cfg.verbose_level > 0)
+            BSLLog::printf("%s: already flashing\n", port.c_str());
+        return;
+    }
+
+    if(cfg.verbose_level > 0)
+        BSLLog::printf("%s: attached\n", port.c_str());
+
+    busy[port] = std::thread([this, port]() {
+        _result result;
+        result.port = port;
+        flash(result);
+
+        std::lock_guard<std::mutex> guard(lock);
+        finished.push_back(std::move(result));
+        const uint64_t one = 1;
+        ssize_t n = write(wake_fd, &one, sizeof(one));
+        (void) n;
+    });
+}
+
+void BSLStation::detached(const std::string &port)
+{
+    if(!matches(port))
+        return;
+    if(busy.count(port)) {
+        removed.insert(port);
+        reattached.erase(port);
+        BSLLog::printf("%s: removed while flashing\n", port.c_str());
+    }
+    else if(cfg.verbose_level > 0)
+        BSLLog::printf("%s: removed\n", port.c_str());
+}
+
+void BSLStation::flash(_result &result) const
+{
+    BSLLog::Redirect redirect([&result](const char* text) { result.log += text; });
+
+    // udev is setting up the node meanwhile
+    usleep(cfg.settle_ms * 1000);
+    if(access(result.port.c_str(), F_OK) != 0) {
+        result.gone = true;
+        return;
+    }
+    result.slot = slot_name(result.port);
+
+    const timespec start = BSLTiming::now();
+    try {
+        BSLTool tool(result.port.c_str(), cfg.entry_method, cfg.verbose_level, cfg.modem_def);
+        tool.load_entry_timing(cfg.fixture);
+        tool.set_pipeline(cfg.pipeline, cfg.window);
+        tool.set_max_retries(cfg.max_retries);
+        tool.set_resume(cfg.resume);
+
+        BSLLog::printf("Using serial %s to flash %s\nFirmware version:%s\n\n", result.port.c_str(), cfg.image.c_str(), image->version.c_str());
+        if(cfg.entry_method != BSL_Entry::Method::None) {
+            BSLLog::printf("Entering BSL mode\n");
+            if(!tool.enter_bsl())
+                result.error = "Could not enter BSL mode";
+        }
+        if(result.error.empty()) {
+            result.ok = tool.flash_image(image->data, image->size, image->crc, cfg.force);
+            if(!result.ok)
+                result.error = BSLLog::last_line(result.log);
+        }
+
+        if(!cfg.metrics_file.empty()) {
+            BSLMetrics unit;
+            unit.record_unit(tool, result.slot, result.ok);
+            unit.update_file(cfg.metrics_file);
+        }
+    }
+    catch(std::exception &e) {
+        result.error = e.what();
+    }
+    result.elapsed_us = BSLTiming::elapsed_us(start);
+}
+
+void BSLStation::post(const _result &result)
+{
+    if(result.gone) {
+        if(cfg.verbose_level > 0)
+            BSLLog::printf("%s: removed before it was opened\n", result.port.c_str());
+        return;
+    }
+
+    if(cfg.verbose_level > 0)
+        BSLLog::printf("=== %s\n%s\n", result.port.c_str(), result.log.c_str());
+
+    auto &counts = slots[result.slot];
+    (result.ok ? counts.first : counts.second)++;
+    BSLLog::printf("[%s] %s in %.1fs%s%s\n", result.slot.c_str(), result.ok ? "PASS" : "FAIL", result.elapsed_us / 1e6,
+        result.ok ? "" : ": ", result.error.c_str());
+    fflush(stdout);
+
+    if(cfg.results_file.empty())
+        return;
+
+    const std::string line = "{\"slot\":" + BSLLog::json_string(result.slot) + ",\"port\":" + BSLLog::json_string(result.port) +
+        ",\"ok\":" + (result.ok ? "true" : "false") + ",\"error\":" + (result.ok ? "null" : BSLLog::json_string(result.error)) +
+        ",\"elapsed_ms\":" + std::to_string(result.elapsed_us / 1000) + ",\"timestamp\":" + std::to_string(time(nullptr)) + "}\n";
+
+    // one write per line, readers never see half of it
+    int fd = open(cfg.results_file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd < 0 || write(fd, line.data(), line.size()) != (ssize_t) line.size())
+        BSLLog::printf("Can not write results to %s: %s\n", cfg.results_file.c_str(), strerror(errno));
+    if(fd >= 0)
+        close(fd);
+}
+
+void BSLStation::collect()
+{
+    std::vector<_result> results;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        results.swap(finished);
+    }
+
+    for(const _result &result : results) {
+        auto worker = busy.find(result.port);
+        if(worker != busy.end()) {
+            worker->second.join();
+            busy.erase(worker);
+        }
+        post(result);
+
+        removed.erase(result.port);
+        if(reattached.erase(result.port) && !stop)
+            attached(result.port);
+    }
+}
+
+bool BSLStation::run()
+{
+    // the image stays in memory for all units of the session
+    image = images.get(cfg.image);
+    if(image == nullptr)
+        return false;
+
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(wake_fd < 0) {
+        BSLLog::printf("Error %i creating eventfd: %s\n", errno, strerror(errno));
+        return false;
+    }
+    if(!open_netlink() && cfg.verbose_level > 0)
+        BSLLog::printf("No uevents (%s), watching /dev instead\n", strerror(errno));
+    if(!open_inotify())
+        return false;
+
+    // no SA_RESTART, a signal has to wake up poll()
+    struct sigaction sa = {};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    BSLLog::printf("Station flashing %s, firmware version:%s\n", cfg.image.c_str(), image->version.c_str());
+    if(cfg.present) {
+        for(const std::string &filter : cfg.filters) {
+            glob_t found;
+            if(glob(filter.c_str(), 0, nullptr, &found) == 0) {
+                for(size_t i = 0; i < found.gl_pathc; i++)
+                    attached(found.gl_pathv[i]);
+            }
+            globfree(&found);
+        }
+    }
+    BSLLog::printf("Waiting for boards\n");
+    fflush(stdout);
+
+    while(!stop) {
+        pollfd pfds[3];
+        nfds_t count = 0;
+        pfds[count++] = {.fd=wake_fd, .events=POLLIN, .revents=0};
+        if(netlink_fd >= 0)
+            pfds[count++] = {.fd=netlink_fd, .events=POLLIN, .revents=0};
+        if(inotify_fd >= 0)
+            pfds[count++] = {.fd=inotify_fd, .events=POLLIN, .revents=0};
+
+        if(poll(pfds, count, -1) <= 0)
+            continue;
+
+        uint64_t done;
+        if(read(wake_fd, &done, sizeof(done)) > 0)
+            collect();
+        if(netlink_fd >= 0)
+            read_netlink();
+        if(inotify_fd >= 0)
+            read_inotify();
+        fflush(stdout);
+    }
+
+    if(!busy.empty())
+        BSLLog::printf("Waiting for %zu boards\n", busy.size());
+    for(auto &[port, worker] : busy)
+        worker.join();
+    busy.clear();
+    collect();
+
+    BSLLog::printf("Stopping\n");
+    for(const auto &[slot, counts] : slots)
+        BSLLog::printf("%s: %u passed, %u failed\n", slot.c_str(), counts.first, counts.second);
+    return true;
+}
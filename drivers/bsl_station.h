@@ -0,0 +1,104 @@
+/*
+ * bsl_station.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "bsl_modem.h"
+#include "bsl_image_cache.h"
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class BSLTool;
+
+/*
+ * Hands-off production station: serial ports appearing and disappearing are
+ * followed and every new port matching one of the filters is flashed on its
+ * own thread, while the operator swaps the next board.
+ *
+ * Kernel uevents of the tty subsystem arrive on a netlink socket. Where that
+ * is not available (containers) and for filters outside /dev, the directories
+ * of the filters are watched with inotify instead. The device node is opened
+ * settle_ms after it appeared, udev sets up permissions and links meanwhile.
+ * A board swapped while the last one is still being flashed is flashed next.
+ *
+ * Each result is posted for the slot: the /dev/serial/by-path name of the
+ * port if udev made one, the port otherwise. ttyUSB numbers follow the order
+ * boards are attached in, by-path names stay with the socket of the fixture.
+ */
+class BSLStation {
+    public:
+        struct _config {
+            std::string image;
+            std::vector<std::string> filters = {"/dev/ttyUSB*", "/dev/ttyACM*"};   // fnmatch patterns on device paths
+            BSL_Entry::Method entry_method = BSL_Entry::Method::Modem;
+            BSL_Modem::_modem_def modem_def = BSL_Modem::default_modem_def;
+            std::string fixture = "default";
+            bool pipeline = false;
+            int window = 0;
+            int max_retries = 3;
+            bool resume = true;
+            bool force = false;
+            bool present = true;        // flash the matching ports there at start
+            int settle_ms = 500;        // wait after a port appeared before it is opened
+            std::string results_file;   // NDJSON line per unit, empty: none
+            std::string metrics_file;   // every unit is added to it, empty: none
+            int verbose_level = 0;
+        };
+
+        struct _result {
+            std::string port;
+            std::string slot;
+            bool gone = false;          // removed before it could be opened
+            bool ok = false;
+            std::string error;
+            uint64_t elapsed_us = 0;
+            std::string log;            // the tool's output on this port
+        };
+
+        BSLStation(const _config &_cfg);
+        ~BSLStation();
+
+        // flashes attached boards until SIGINT/SIGTERM, false on setup errors
+        bool run();
+
+        // /dev/serial/by-path link to port, port if there is none
+        static std::string slot_name(const std::string &port);
+
+    private:
+        bool open_netlink();
+        bool open_inotify();
+        void read_netlink();
+        void read_inotify();
+        bool matches(const std::string &path) const;
+        void attached(const std::string &port);
+        void detached(const std::string &port);
+        void flash(_result &result) const;
+        void post(const _result &result);
+        void collect();
+
+        static constexpr size_t uevent_len = 8192;
+
+        _config cfg;
+        ImageCache images;
+        std::shared_ptr<const ImageCache::_image> image;
+
+        int netlink_fd = -1;
+        int inotify_fd = -1;
+        int wake_fd = -1;                           // eventfd, a worker finished
+        std::map<int, std::string> watches;         // inotify wd -> directory
+
+        std::map<std::string, std::thread> busy;    // port -> worker flashing it
+        std::set<std::string> removed;              // busy ports removed meanwhile
+        std::set<std::string> reattached;           // and attached again, flashed once their worker is done
+        std::map<std::string, std::pair<unsigned, unsigned>> slots; // slot -> passed, failed
+
+        std::mutex lock;
+        std::vector<_result> finished;              // by the workers, under lock
+};
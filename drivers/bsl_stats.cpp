@@ -0,0 +1,209 @@
+/*
+ * bsl_stats.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_stats.h"
+#include "bsl_log.h"
+#include "bsl_timing.h"
+#include <cstdio>
+
+BSLStats::Scope::Scope(BSLStats* _stats, const char* _name) : stats(_stats), name(_name)
+{
+    if(stats != nullptr)
+        start = BSLTiming::now();
+}
+
+BSLStats::Scope::~Scope()
+{
+    if(stats != nullptr)
+        stats->record(name, BSLTiming::elapsed_us(start));
+}
+
+int BSLStats::bucket_of(uint64_t us)
+{
+    int bucket = 0;
+    while(us != 0 && bucket < num_buckets-1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+uint64_t BSLStats::_histogram::percentile_us(double p) const
+{
+    if(count == 0)
+        return 0;
+
+    // upper bound of the bucket the percentile falls into, clamped to the observed range
+    uint64_t rank = (uint64_t)(p * count + 0.5);
+    uint64_t seen = 0;
+    for(int i = 0; i < num_buckets; i++) {
+        seen += buckets[i];
+        if(seen >= rank && seen > 0) {
+            uint64_t upper = (i == 0) ? 0 : ((1ULL << i) - 1);
+            if(upper < min_us)
+                return min_us;
+            return upper < max_us ? upper : max_us;
+        }
+    }
+    return max_us;
+}
+
+void BSLStats::record(const char* name, uint64_t us)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = hist.find(name);
+    if(it == hist.end())
+        it = hist.emplace(name, _histogram()).first;
+
+    auto &h = it->second;
+    h.count++;
+    h.sum_us += us;
+    if(us < h.min_us)
+        h.min_us = us;
+    if(us > h.max_us)
+        h.max_us = us;
+    h.buckets[bucket_of(us)]++;
+}
+
+void BSLStats::count(const char* name, uint64_t n)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = cnt.find(name);
+    if(it == cnt.end())
+        cnt.emplace(name, n);
+    else
+        it->second += n;
+}
+
+void BSLStats::merge(const BSLStats &other)
+{
+    auto other_hist = other.histograms();
+    auto other_cnt = other.counters();
+
+    std::lock_guard<std::mutex> guard(lock);
+    for(const auto &[name, o] : other_hist) {
+        auto &h = hist[name];
+        h.count += o.count;
+        h.sum_us += o.sum_us;
+        if(o.min_us < h.min_us)
+            h.min_us = o.min_us;
+        if(o.max_us > h.max_us)
+            h.max_us = o.max_us;
+        for(int i = 0; i < num_buckets; i++)
+            h.buckets[i] += o.buckets[i];
+    }
+    for(const auto &[name, n] : other_cnt)
+        cnt[name] += n;
+}
+
+void BSLStats::clear()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    hist.clear();
+    cnt.clear();
+}
+
+std::map<std::string, BSLStats::_histogram, std::less<>> BSLStats::histograms() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return hist;
+}
+
+std::map<std::string, uint64_t, std::less<>> BSLStats::counters() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return cnt;
+}
+
+std::string BSLStats::to_json() const
+{
+    auto h_copy = histograms();
+    auto c_copy = counters();
+    std::string out = "{\"histograms\":{";
+    char buf[256];
+
+    bool first = true;
+    for(const auto &[name, h] : h_copy) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":{\"count\":%lu,\"sum_us\":%lu,\"min_us\":%lu,\"max_us\":%lu,\"mean_us\":%lu,\"p50_us\":%lu,\"p90_us\":%lu,\"p99_us\":%lu,\"buckets\":[",
+            first ? "" : ",", name.c_str(), h.count, h.sum_us, h.min_us, h.max_us, h.sum_us / h.count,
+            h.percentile_us(0.5), h.percentile_us(0.9), h.percentile_us(0.99));
+        out += buf;
+        first = false;
+
+        // only populated buckets, le_us is the inclusive upper bound
+        bool first_bucket = true;
+        for(int i = 0; i < num_buckets; i++) {
+            if(h.buckets[i] == 0)
+                continue;
+            snprintf(buf, sizeof(buf), "%s{\"le_us\":%llu,\"count\":%lu}", first_bucket ? "" : ",",
+                (i == 0) ? 0ULL : ((1ULL << i) - 1), h.buckets[i]);
+            out += buf;
+            first_bucket = false;
+        }
+        out += "]}";
+    }
+
+    out += "},\"counters\":{";
+    first = true;
+    for(const auto &[name, n] : c_copy) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":%lu", first ? "" : ",", name.c_str(), n);
+        out += buf;
+        first = false;
+    }
+    out += "}}\n";
+
+    return out;
+}
+
+std::string BSLStats::to_csv() const
+{
+    auto h_copy = histograms();
+    auto c_copy = counters();
+    std::string out = "name,count,sum_us,min_us,max_us,mean_us,p50_us,p90_us,p99_us\n";
+    char buf[256];
+
+    for(const auto &[name, h] : h_copy) {
+        snprintf(buf, sizeof(buf), "%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+            name.c_str(), h.count, h.sum_us, h.min_us, h.max_us, h.sum_us / h.count,
+            h.percentile_us(0.5), h.percentile_us(0.9), h.percentile_us(0.99));
+        out += buf;
+    }
+
+    // counters as single value rows
+    for(const auto &[name, n] : c_copy) {
+        snprintf(buf, sizeof(buf), "%s,%lu,,,,,,,\n", name.c_str(), n);
+        out += buf;
+    }
+
+    return out;
+}
+
+bool BSLStats::export_file(const char* path, const std::string &format) const
+{
+    std::string content;
+    if(format == "json") {
+        content = to_json();
+    } else if(format == "csv") {
+        content = to_csv();
+    } else {
+        BSLLog::printf("Unknown stats format '%s'\n", format.c_str());
+        return false;
+    }
+
+    FILE* f = fopen(path, "w");
+    if(f == nullptr) {
+        BSLLog::printf("Can not write stats file %s\n", path);
+        return false;
+    }
+
+    bool status = fwrite(content.data(), 1, content.size(), f) == content.size();
+    fclose(f);
+
+    return status;
+}
@@ -0,0 +1,62 @@
+/*
+ * bsl_stats.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <map>
+#include <mutex>
+#include <string>
+#include <time.h>
+
+/*
+ * Latency histograms (log2 buckets in us) and counters of one session.
+ * All methods are thread safe, a nullptr BSLStats* is accepted by Scope.
+ */
+class BSLStats {
+    public:
+        static constexpr int num_buckets = 32;  // bucket i counts [2^(i-1), 2^i) us, bucket 0 counts 0us
+
+        struct _histogram {
+            uint64_t count = 0;
+            uint64_t sum_us = 0;
+            uint64_t min_us = UINT64_MAX;
+            uint64_t max_us = 0;
+            uint64_t buckets[num_buckets] = {0};
+
+            uint64_t percentile_us(double p) const;
+        };
+
+        // times the enclosing block
+        class Scope {
+            public:
+                Scope(BSLStats* _stats, const char* _name);
+                ~Scope();
+            private:
+                BSLStats* stats;
+                const char* name;
+                timespec start;
+        };
+
+        void record(const char* name, uint64_t us);
+        void count(const char* name, uint64_t n=1);
+        void merge(const BSLStats &other);
+        void clear();
+
+        std::map<std::string, _histogram, std::less<>> histograms() const;
+        std::map<std::string, uint64_t, std::less<>> counters() const;
+
+        std::string to_json() const;
+        std::string to_csv() const;
+        bool export_file(const char* path, const std::string &format) const;
+
+    private:
+        static int bucket_of(uint64_t us);
+
+        mutable std::mutex lock;
+        std::map<std::string, _histogram, std::less<>> hist;
+        std::map<std::string, uint64_t, std::less<>> cnt;
+};
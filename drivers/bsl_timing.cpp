@@ -0,0 +1,115 @@
+/*
+ * bsl_timing.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_timing.h"
+#include "bsl_log.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace BSLTiming {
+
+    timespec now()
+    {
+        timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t;
+    }
+
+    void add_us(timespec &t, uint32_t us)
+    {
+        t.tv_sec += us / 1000000;
+        t.tv_nsec += (us % 1000000) * 1000L;
+        if(t.tv_nsec >= 1000000000L) {
+            t.tv_sec++;
+            t.tv_nsec -= 1000000000L;
+        }
+    }
+
+    void sleep_until(const timespec &deadline)
+    {
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+            // interrupted by a signal, deadline is absolute so just go again
+        }
+    }
+
+    uint64_t elapsed_us(const timespec &since)
+    {
+        timespec t = now();
+        int64_t ns = (int64_t)(t.tv_sec - since.tv_sec) * 1000000000LL + (t.tv_nsec - since.tv_nsec);
+        return ns > 0 ? ns / 1000 : 0;
+    }
+
+    std::string state_dir()
+    {
+        std::string dir;
+        const char* xdg = getenv("XDG_STATE_HOME");
+        const char* home = getenv("HOME");
+        if(xdg != nullptr && *xdg) {
+            dir = xdg;
+        } else if(home != nullptr && *home) {
+            dir = std::string(home) + "/.local/state";
+        } else {
+            dir = "/tmp";
+        }
+
+        mkdir(dir.c_str(), 0755);
+        dir += "/" _PROJECT_NAME_;
+        mkdir(dir.c_str(), 0755);
+
+        return dir;
+    }
+
+    std::string state_file(const std::string &name)
+    {
+        // names are often derived from device paths
+        std::string clean = name;
+        for(auto &c : clean) {
+            if(c == '/')
+                c = '_';
+        }
+        return state_dir() + "/" + clean;
+    }
+
+    bool load_entry_timing(const std::string &fixture, _entry_timing &timing)
+    {
+        std::string path = state_file("entry_timing_" + fixture);
+        FILE* f = fopen(path.c_str(), "r");
+        if(f == nullptr) {
+            return false;
+        }
+
+        _entry_timing loaded = timing;
+        int matched = fscanf(f, "us_reset=%u\nus_settle=%u\n", &loaded.us_reset, &loaded.us_settle);
+        fclose(f);
+
+        if(matched != 2) {
+            BSLLog::printf("Ignoring malformed timing file %s\n", path.c_str());
+            return false;
+        }
+
+        timing = loaded;
+        return true;
+    }
+
+    bool store_entry_timing(const std::string &fixture, const _entry_timing &timing)
+    {
+        std::string path = state_file("entry_timing_" + fixture);
+        std::string tmp_path = path + ".tmp";
+        FILE* f = fopen(tmp_path.c_str(), "w");
+        if(f == nullptr) {
+            BSLLog::printf("Can not write timing file %s\n", path.c_str());
+            return false;
+        }
+
+        fprintf(f, "us_reset=%u\nus_settle=%u\n", timing.us_reset, timing.us_settle);
+        fclose(f);
+
+        return rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+};
@@ -0,0 +1,35 @@
+/*
+ * bsl_timing.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <string>
+#include <time.h>
+
+namespace BSLTiming {
+
+    /* pin timing of the BSL entry sequence */
+    struct _entry_timing {
+        uint32_t us_reset;      // reset pulse width
+        uint32_t us_settle;     // BSL invoke pin settle before and after reset
+    };
+
+    static constexpr _entry_timing default_entry_timing = {.us_reset=10000, .us_settle=10000};
+
+    // absolute deadlines on CLOCK_MONOTONIC, so edge timing does not accumulate wakeup latency
+    timespec now();
+    void add_us(timespec &t, uint32_t us);
+    void sleep_until(const timespec &deadline);
+    uint64_t elapsed_us(const timespec &since);
+
+    // per-user state directory, created on demand
+    std::string state_dir();
+    std::string state_file(const std::string &name);
+
+    bool load_entry_timing(const std::string &fixture, _entry_timing &timing);
+    bool store_entry_timing(const std::string &fixture, const _entry_timing &timing);
+};
@@ -6,52 +6,256 @@
  */
 
 #include "bsl_tool.h"
+#include "bsl_log.h"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <thread>
+#include <vector>
 
 
-BSLTool::BSLTool(const char* serial_port, bool use_gpio, int _verbose_level) : verbose_level(_verbose_level)
+BSLTool::BSLTool(const char* serial_port, BSL_Entry::Method entry_method, int _verbose_level, BSL_Modem::_modem_def modem_def) :
+    BSLTool(serial_port != nullptr ? Transport::create(serial_port, _verbose_level) : nullptr, entry_method, _verbose_level, modem_def)
 {
-    if(serial_port != nullptr) {
-        uart_wrapper = new BSL_UART(serial_port, verbose_level);
+    if(serial_port != nullptr)
+        port_name = serial_port;
+
+    // response times learned on this port in earlier runs
+    if(uart_wrapper != nullptr && !port_name.empty())
+        uart_wrapper->get_rto().load(port_name);
+}
+
+BSLTool::BSLTool(Transport* transport, BSL_Entry::Method entry_method, int _verbose_level, BSL_Modem::_modem_def modem_def) : verbose_level(_verbose_level)
+{
+    if(transport != nullptr) {
+        uart_wrapper = new BSL_UART(transport, verbose_level);
+        uart_wrapper->set_stats(&stats);
+        uart_wrapper->set_retry_callback([this](BSL::AckType ack, BSL::CoreMessage msg) { record_error(ack, msg); });
     }
 
-    if(use_gpio) {
-        gpio_wrapper = new BSL_GPIO(verbose_level);
+    if(entry_method == BSL_Entry::Method::GPIO) {
+        entry_wrapper = new BSL_GPIO(verbose_level);
+    } else if(entry_method == BSL_Entry::Method::Modem) {
+        // shares the fd with the UART, entry and connect go back-to-back
+        if(uart_wrapper == nullptr) {
+            throw std::runtime_error("Modem line BSL entry needs a serial port");
+        }
+        entry_wrapper = new BSL_Modem(uart_wrapper->get_transport(), verbose_level, modem_def);
     }
 };
 
 BSLTool::~BSLTool() 
 {
-    if(uart_wrapper != nullptr)
+    // releases held GPIO line requests, modem entry uses the UART's serial
+    if(entry_wrapper != nullptr)
+        delete entry_wrapper;
+
+    if(uart_wrapper != nullptr) {
+        if(!port_name.empty())
+            uart_wrapper->get_rto().store(port_name);
+        if(verbose_level > 1)
+            uart_wrapper->get_rto().print();
         delete uart_wrapper;
+    }
+
+    // after the UART, so the last chunks are flushed
+    if(trace != nullptr)
+        delete trace;
 };
 
+void BSLTool::set_pipeline(bool enabled, int window)
+{
+    if(uart_wrapper != nullptr)
+        uart_wrapper->set_pipeline(enabled, window);
+}
+
+void BSLTool::set_max_retries(int max_retries)
+{
+    if(uart_wrapper != nullptr)
+        uart_wrapper->set_max_retries(max_retries);
+}
+
+void BSLTool::reset_session()
+{
+    isConnected = false;
+    isUnlocked = false;
+    isErased = false;
+    isProgrammed = false;
+    isVerified = false;
+    isStarted = false;
+    stats.clear();
+    errors.clear();
+    crc_mismatches = 0;
+    program_total = BSL_UART::_program_report();
+
+    if(uart_wrapper != nullptr) {
+        uart_wrapper->reset_baudrate();
+        uart_wrapper->clear_program_report();
+    }
+}
+
+bool BSLTool::start_trace(const char* path, uint16_t port_id)
+{
+    if(uart_wrapper == nullptr || trace != nullptr) {
+        return false;
+    }
+
+    trace = new WireTrace(path, port_id);
+    if(!trace->is_open()) {
+        delete trace;
+        trace = nullptr;
+        return false;
+    }
+
+    uart_wrapper->set_trace(trace);
+    return true;
+}
+
 bool BSLTool::enter_bsl()
 {
-    if(gpio_wrapper != nullptr) {
-        return gpio_wrapper->enter_bsl();
+    BSLStats::Scope timer(&stats, "bsl_entry");
+    phase("bsl_entry");
+    if(entry_wrapper != nullptr) {
+        return entry_wrapper->enter_bsl();
     } else {
         return false;
     }
 }
 
+bool BSLTool::hard_reset()
+{
+    if(entry_wrapper != nullptr) {
+        return entry_wrapper->hard_reset();
+    } else {
+        return false;
+    }
+}
+
+bool BSLTool::load_entry_timing(const std::string &fixture)
+{
+    if(entry_wrapper == nullptr) {
+        return false;
+    }
+
+    auto timing = entry_wrapper->get_timing();
+    if(!BSLTiming::load_entry_timing(fixture, timing)) {
+        return false;
+    }
+
+    if(verbose_level > 0) {
+        BSLLog::printf("Using calibrated entry timing for '%s': reset %uus, settle %uus\n", fixture.c_str(), timing.us_reset, timing.us_settle);
+    }
+    entry_wrapper->set_timing(timing);
+    return true;
+}
+
+bool BSLTool::probe_entry(BSLTiming::_entry_timing timing, int trials)
+{
+    const auto default_timing = BSLTiming::default_entry_timing;
+
+    for(int i = 0; i < trials; i++) {
+        // boot into the application first, otherwise a too short reset
+        // would leave the BSL of the previous trial running and pass anyway
+        entry_wrapper->set_timing(default_timing);
+        if(!entry_wrapper->hard_reset()) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(calib_app_boot_ms));
+
+        entry_wrapper->set_timing(timing);
+        uart_wrapper->flush();
+        if(!entry_wrapper->enter_bsl()) {
+            return false;
+        }
+
+        auto ack = uart_wrapper->connect(calib_connect_tries);
+        if(verbose_level > 1) {
+            BSLLog::printf("   reset %6uus settle %6uus trial %d: %s\n", timing.us_reset, timing.us_settle, i, BSL::AckTypeToString(ack));
+        }
+        if(ack != BSL::AckType::BSL_ACK) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t BSLTool::search_min_us(uint32_t lo, uint32_t hi, int trials, bool search_reset, BSLTiming::_entry_timing base)
+{
+    // hi is known to work, lo is assumed not to
+    while(hi - lo > calib_resolution_us) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        auto timing = base;
+        if(search_reset)
+            timing.us_reset = mid;
+        else
+            timing.us_settle = mid;
+
+        if(probe_entry(timing, trials))
+            hi = mid;
+        else
+            lo = mid;
+    }
+
+    return hi;
+}
+
+bool BSLTool::calibrate_entry(const std::string &fixture, int trials, int margin_percent)
+{
+    if(entry_wrapper == nullptr || uart_wrapper == nullptr) {
+        BSLLog::printf("Calibration needs a BSL entry method and serial port\n");
+        return false;
+    }
+
+    auto timing = BSLTiming::default_entry_timing;
+    BSLLog::printf(">> Checking default entry timing (reset %uus, settle %uus)\n", timing.us_reset, timing.us_settle);
+    if(!probe_entry(timing, trials)) {
+        BSLLog::printf("BSL entry is not reliable with the default timing. Stopping...\n");
+        return false;
+    }
+
+    BSLLog::printf(">> Searching minimal reset pulse\n");
+    timing.us_reset = search_min_us(0, timing.us_reset, trials, true, timing);
+    BSLLog::printf(">> Searching minimal settle time\n");
+    timing.us_settle = search_min_us(0, timing.us_settle, trials, false, timing);
+
+    BSLTiming::_entry_timing stored = {
+        .us_reset = timing.us_reset + timing.us_reset * margin_percent / 100,
+        .us_settle = timing.us_settle + timing.us_settle * margin_percent / 100
+    };
+
+    // confirm the value that is going to be used
+    if(!probe_entry(stored, trials)) {
+        BSLLog::printf("Calibrated timing did not confirm. Stopping...\n");
+        return false;
+    }
+
+    BSLLog::printf("Minimal timing: reset %uus, settle %uus\n", timing.us_reset, timing.us_settle);
+    BSLLog::printf("Stored timing for '%s' (+%d%%): reset %uus, settle %uus\n", fixture.c_str(), margin_percent, stored.us_reset, stored.us_settle);
+
+    entry_wrapper->set_timing(stored);
+    return BSLTiming::store_entry_timing(fixture, stored);
+}
+
 bool BSLTool::connect(bool force)
 {
     if(!force && isConnected) {
-        printf("Already connected.");
+        BSLLog::printf("Already connected.");
         return isConnected;
     }
 
-    printf(">> Connecting\n");
+    BSLStats::Scope timer(&stats, "connect");
+    phase("connect");
+    BSLLog::printf(">> Connecting\n");
     auto resp = uart_wrapper->connect();
 
     if(verbose_level > 1) {
-        printf("<< %s\n", BSL::AckTypeToString(resp));
+        BSLLog::printf("<< %s\n", BSL::AckTypeToString(resp));
     }
 
     if(resp != BSL::AckType::BSL_ACK) {
-        printf("Could not connect. Stopping...\n");
+        record_error(resp);
+        BSLLog::printf("Could not connect. Stopping...\n");
         isConnected = false;
         return isConnected;
     }
@@ -62,15 +266,18 @@ bool BSLTool::connect(bool force)
 
 bool BSLTool::change_baud(BSL::Baudrate baud)
 {
-    printf(">> Changing baudrate to 115200\n");
+    BSLStats::Scope timer(&stats, "change_baud");
+    phase("change_baud");
+    BSLLog::printf(">> Changing baudrate to 115200\n");
     auto resp = uart_wrapper->change_baudrate(baud);
 
     if(verbose_level > 1) {
-        printf("<< %s\n", BSL::AckTypeToString(resp));
+        BSLLog::printf("<< %s\n", BSL::AckTypeToString(resp));
     }
 
     if(resp != BSL::AckType::BSL_ACK) {
-        printf("Could not change baudrate. Stopping...\n");
+        record_error(resp);
+        BSLLog::printf("Could not change baudrate. Stopping...\n");
         return false;
     }
     return true;
@@ -78,28 +285,32 @@ bool BSLTool::change_baud(BSL::Baudrate baud)
 
 bool BSLTool::get_device_info()
 {
-    printf(">> Getting device info\n");
-    const auto [ack, device_info] = uart_wrapper->get_device_info();
+    BSLStats::Scope timer(&stats, "device_info");
+    phase("device_info");
+    BSLLog::printf(">> Getting device info\n");
+    const auto [ack, info] = uart_wrapper->get_device_info();
 
     if(verbose_level > 1) {
-        printf("<< %s\n", BSL::AckTypeToString(ack));
+        BSLLog::printf("<< %s\n", BSL::AckTypeToString(ack));
     }
 
     if(ack != BSL::AckType::BSL_ACK) {
-        printf("Could not get device info. Stopping...\n");
+        record_error(ack);
+        BSLLog::printf("Could not get device info. Stopping...\n");
         return false;
     }
 
+    device_info = info;
     if(verbose_level > 0) {
-        printf("<< Device Info: \n");
-        printf("\tCommand interpreter version: 0x%x\n", device_info.cmd_interpreter_version);
-        printf("\tBuild ID: 0x%x\n", device_info.build_id);
-        printf("\tApplication version: 0x%x\n", device_info.app_version);
-        printf("\tPlug-In interface version: 0x%x\n", device_info.plugin_if_version);
-        printf("\tBSL max buffer size: 0x%x\n", device_info.bsl_max_buff_size);
-        printf("\tBSL start address: 0x%x\n", device_info.bsl_buff_start_addr);
-        printf("\tBCR conf ID: 0x%x\n", device_info.bcr_conf_id);
-        printf("\tBSL conf ID: 0x%x\n", device_info.bsl_conf_id);
+        BSLLog::printf("<< Device Info: \n");
+        BSLLog::printf("\tCommand interpreter version: 0x%x\n", device_info.cmd_interpreter_version);
+        BSLLog::printf("\tBuild ID: 0x%x\n", device_info.build_id);
+        BSLLog::printf("\tApplication version: 0x%x\n", device_info.app_version);
+        BSLLog::printf("\tPlug-In interface version: 0x%x\n", device_info.plugin_if_version);
+        BSLLog::printf("\tBSL max buffer size: 0x%x\n", device_info.bsl_max_buff_size);
+        BSLLog::printf("\tBSL start address: 0x%x\n", device_info.bsl_buff_start_addr);
+        BSLLog::printf("\tBCR conf ID: 0x%x\n", device_info.bcr_conf_id);
+        BSLLog::printf("\tBSL conf ID: 0x%x\n", device_info.bsl_conf_id);
     }
 
     return true;
@@ -107,15 +318,18 @@ bool BSLTool::get_device_info()
 
 bool BSLTool::unlock()
 {
-    printf(">> Unlocking bootloader\n");
+    BSLStats::Scope timer(&stats, "unlock");
+    phase("unlock");
+    BSLLog::printf(">> Unlocking bootloader\n");
     const auto [ack, msg] = uart_wrapper->unlock_bootloader();
 
     if(verbose_level > 1) {
-        printf("<< %s\n", BSL::AckTypeToString(ack));
+        BSLLog::printf("<< %s\n", BSL::AckTypeToString(ack));
     }
 
     if(ack != BSL::AckType::BSL_ACK) {
-        printf("Could not unlock bootloader. Please check configured password. Stopping...\n");
+        record_error(ack, msg);
+        BSLLog::printf("Could not unlock bootloader. Please check configured password. Stopping...\n");
         isUnlocked = false;
         return isUnlocked;
     }
@@ -126,15 +340,40 @@ bool BSLTool::unlock()
 
 bool BSLTool::mass_erase()
 {
-    printf(">> Mass erase before programming\n");
+    BSLStats::Scope timer(&stats, "mass_erase");
+    phase("mass_erase");
+    BSLLog::printf(">> Mass erase before programming\n");
     const auto [ack, msg] = uart_wrapper->mass_erase();
 
     if(verbose_level > 1) {
-        printf("<< %s\n", BSL::AckTypeToString(ack));
+        BSLLog::printf("<< %s\n", BSL::AckTypeToString(ack));
     }
 
     if(ack != BSL::AckType::BSL_ACK) {
-        printf("Could not mass erase flash. Stopping...\n");
+        record_error(ack, msg);
+        BSLLog::printf("Could not mass erase flash. Stopping...\n");
+        isErased = false;
+        return isErased;
+    }
+
+    isErased = true;
+    return isErased;
+}
+
+bool BSLTool::range_erase(uint32_t start_addr, uint32_t end_addr)
+{
+    BSLStats::Scope timer(&stats, "range_erase");
+    phase("range_erase");
+    BSLLog::printf(">> Erase 0x%08x-0x%08x\n", start_addr, end_addr);
+    const auto [ack, msg] = uart_wrapper->range_erase(start_addr, end_addr);
+
+    if(verbose_level > 1) {
+        BSLLog::printf("<< ACK: %s MSG: %s\n", BSL::AckTypeToString(ack), BSL::CoreMessageToString(msg));
+    }
+
+    if((ack != BSL::AckType::BSL_ACK) || (msg != BSL::CoreMessage::SUCCESS)) {
+        record_error(ack, msg);
+        BSLLog::printf("Could not erase flash range. Stopping...\n");
         isErased = false;
         return isErased;
     }
@@ -143,78 +382,139 @@ bool BSLTool::mass_erase()
     return isErased;
 }
 
-bool BSLTool::program_data(uint8_t* data, uint32_t load_addr, uint32_t size)
+bool BSLTool::program_data(const uint8_t* data, uint32_t load_addr, uint32_t size)
+{
+    size_t pos = 0;
+    return program_data([&](uint8_t* dst, uint32_t len) {
+        memcpy(dst, data + pos, len);
+        pos += len;
+        return true;
+    }, load_addr, size);
+}
+
+bool BSLTool::program_data(BSL_UART::_source source, uint32_t load_addr, uint32_t size)
 {
-    printf(">> Program data @0x%08x, size=%d bytes\n", load_addr, size);
-    const auto [ack, msg] = uart_wrapper->program_data(load_addr, data, size);
+    BSLStats::Scope timer(&stats, "program");
+    phase("program");
+    BSLLog::printf(">> Program data @0x%08x, size=%d bytes\n", load_addr, size);
+    const auto [ack, msg] = uart_wrapper->program_data(load_addr, source, size);
+
+    const auto &report = uart_wrapper->get_program_report();
+    program_total.frames += report.frames;
+    program_total.confirmed += report.confirmed;
+    program_total.tx_bytes += report.tx_bytes;
+    program_total.retry_bytes += report.retry_bytes;
+    program_total.rx_bytes += report.rx_bytes;
+    program_total.elapsed_us += report.elapsed_us;
+    program_total.wire_us += report.wire_us;
+    program_total.retries += report.retries;
+    program_total.resyncs += report.resyncs;
 
     if(verbose_level > 1) {
-        printf("<< ACK: %s MSG: %s\n", BSL::AckTypeToString(ack), BSL::CoreMessageToString(msg));
+        BSLLog::printf("<< ACK: %s MSG: %s\n", BSL::AckTypeToString(ack), BSL::CoreMessageToString(msg));
     }
 
     if((ack != BSL::AckType::BSL_ACK) || (msg != BSL::CoreMessage::SUCCESS)) {
-        printf("Could not program. Stopping...\n");
+        record_error(ack, msg);
+        BSLLog::printf("Could not program. Stopping...\n");
         isProgrammed = false;
         return isProgrammed;
     }
 
+    BSLLog::printf("Programmed %u frames in %.1fms, %.1f kB/s, link utilization %.0f%%\n", report.frames, report.elapsed_us / 1000.0,
+        report.elapsed_us ? size * 1000.0 / report.elapsed_us : 0, report.utilization() * 100);
+    if(report.retries > 0) {
+        BSLLog::printf("Resent %u frames, %lu bytes, after %u line errors\n", report.retries, report.retry_bytes, report.resyncs);
+    }
+    stats.count("program_wire_us", report.wire_us);
+    stats.count("program_elapsed_us", report.elapsed_us);
+
     isProgrammed = true;
     return isProgrammed;
 }
 
-bool BSLTool::verify(uint8_t *data, uint32_t load_addr, uint32_t size, uint32_t offset)
+bool BSLTool::verify(const uint8_t *data, uint32_t load_addr, uint32_t size, uint32_t offset)
 {
+    return check_crc(BSL::softwareCRC(data+offset, size-offset), load_addr, size, offset);
+}
+
+bool BSLTool::check_crc(uint32_t prog_crc, uint32_t load_addr, uint32_t size, uint32_t offset)
+{
+    BSLStats::Scope timer(&stats, "verify");
+    phase("verify");
     
     const uint32_t block_size = size-offset;
     const uint32_t addr = load_addr+offset;
-    printf(">> Standalone verification");
+    BSLLog::printf(">> Standalone verification");
     if(verbose_level > 1) {
-        printf(" @0x%08x, size=%dbytes", addr, block_size);
+        BSLLog::printf(" @0x%08x, size=%dbytes", addr, block_size);
     }
-    printf("\n");
+    BSLLog::printf("\n");
 
     const auto [ack, msg, mcu_crc] = uart_wrapper->verify(addr, block_size);
 
     if(verbose_level > 1) {
-        printf("<< ACK: %s MSG: %s MCU_CRC: 0x%08x\n", BSL::AckTypeToString(ack), BSL::CoreMessageToString(msg), mcu_crc);
+        BSLLog::printf("<< ACK: %s MSG: %s MCU_CRC: 0x%08x\n", BSL::AckTypeToString(ack), BSL::CoreMessageToString(msg), mcu_crc);
     }
 
     if(ack != BSL::AckType::BSL_ACK) {
-        printf("Could not receive verification response. Stopping...\n");
+        record_error(ack, msg);
+        BSLLog::printf("Could not receive verification response. Stopping...\n");
         isVerified = false;
         return isVerified;
     }
 
-    // do CRC over input image
-    uint32_t prog_size = block_size;
-    auto prog_crc = BSL::softwareCRC(data+offset, block_size);
     if(verbose_level > 2) {
-        printf("Prog CRC: 0x%08x\n", prog_crc);
+        BSLLog::printf("Prog CRC: 0x%08x\n", prog_crc);
     }
 
     if(prog_crc != mcu_crc) {
-        printf("CRC mismatch\n");
+        crc_mismatches++;
+        BSLLog::printf("CRC mismatch\n");
         isVerified = false;
         return isVerified;
     }
 
-    printf(">> Verified programmed data\n");
+    BSLLog::printf(">> Verified programmed data\n");
 
     isVerified = true;
     return isVerified;
 }
 
+bool BSLTool::read_crc(uint32_t addr, uint32_t size, uint32_t &crc)
+{
+    BSLStats::Scope timer(&stats, "verify");
+    phase("verify");
+    const auto [ack, msg, mcu_crc] = uart_wrapper->verify(addr, size);
+
+    if(verbose_level > 1) {
+        BSLLog::printf("<< ACK: %s MSG: %s MCU_CRC: 0x%08x\n", BSL::AckTypeToString(ack), BSL::CoreMessageToString(msg), mcu_crc);
+    }
+
+    if(ack != BSL::AckType::BSL_ACK) {
+        record_error(ack, msg);
+        BSLLog::printf("Could not read the CRC of 0x%08x-0x%08x\n", addr, addr + size - 1);
+        return false;
+    }
+
+    crc = mcu_crc;
+    return true;
+}
+
 bool BSLTool::start_application()
 {
-    printf(">> Starting application\n");
+    BSLStats::Scope timer(&stats, "start");
+    phase("start");
+    BSLLog::printf(">> Starting application\n");
     auto ack = uart_wrapper->start_application();
 
     if(verbose_level > 1) {
-        printf("<< %s\n", BSL::AckTypeToString(ack));
+        BSLLog::printf("<< %s\n", BSL::AckTypeToString(ack));
     }
 
     if(ack != BSL::AckType::BSL_ACK) {
-        printf("Could not start application. Stopping...\n");
+        record_error(ack);
+        BSLLog::printf("Could not start application. Stopping...\n");
         isStarted = false;
         return isStarted;
     }
@@ -227,61 +527,85 @@ bool BSLTool::open_file(const char* path, uint32_t &size)
 {
     close_file();
 
-    input_file_handle = fopen(path, "rb");
-    if(input_file_handle == nullptr) {
-        printf("Read file: Can not open file %s\n", path);
+    // a compressed image is inflated once for its size and CRCs
+    if(!input_file.open(path) || !input_file.scan()) {
+        input_file.close();
         return false;
     }
+    if(verbose_level > 0 && input_file.format() != ImageSource::Format::Raw) {
+        BSLLog::printf("%s image, %u bytes inflated\n", ImageSource::format_name(input_file.format()), input_file.size());
+    }
 
-    fseek(input_file_handle, 0L, SEEK_END);
-    size = ftell(input_file_handle);
-    fseek(input_file_handle, 0L, SEEK_SET);
-
+    size = input_file.size();
     return true;
 }
 
 bool BSLTool::close_file()
 {
-    if(input_file_handle) {
-        if(!fclose(input_file_handle))
-            return false;
-    }
+    input_file.close();
     return true;
 }
 
 uint32_t BSLTool::read_file(uint8_t *dst, uint32_t size)
 {
-    uint32_t bytes_read = 0;
-    bytes_read = fread(dst, size, 1, input_file_handle);
-    return bytes_read;
+    if(!input_file.is_open() || !input_file.rewind()) {
+        return 0;
+    }
+    return input_file.read(dst, size) ? 1 : 0;
 }
 
 std::string BSLTool::read_file_version(uint32_t offset, uint32_t fw_version_len)
 {
-    if(input_file_handle == nullptr) {
-        printf("Open file first!\n");
+    if(!input_file.is_open()) {
+        BSLLog::printf("Open file first!\n");
         return "";
     }  
 
-    uint32_t bytes_read = 0;
-    char fw_version[fw_version_len] = "";
-
-    fseek(input_file_handle, offset, SEEK_SET);
-    bytes_read = fread(fw_version, 1, fw_version_len, input_file_handle);
-
-    if(bytes_read != fw_version_len) {
-        printf("Error reading fw version\n");
+    std::string fw_version(fw_version_len, '\0');
+    if(!input_file.rewind() || !input_file.skip(offset) || !input_file.read((uint8_t*) &fw_version[0], fw_version_len)) {
+        BSLLog::printf("Error reading fw version\n");
         return "";
     }
 
-    return fw_version;
+    return fw_version.c_str();
 }
 
-bool BSLTool::flash_image(const char* filepath, bool force)
+uint32_t BSLTool::find_resume_point(const _image &image, uint32_t load_addr)
 {
-    bool status = false;
+    const uint32_t size = image.size;
+    BSLJournal::_checkpoint cp;
+    if(!BSLJournal::load(port_name, cp)) {
+        return 0;
+    }
 
-    status = connect();
+    if(cp.image_crc != image.crc || cp.image_size != size || cp.load_addr != load_addr) {
+        if(verbose_level > 0)
+            BSLLog::printf("Journal is for a different image, starting over\n");
+        return 0;
+    }
+
+    // a partly written sector can not be programmed again without erase
+    const uint32_t prefix = cp.confirmed / sector_size * sector_size;
+    if(prefix < min_verify_len) {
+        return 0;
+    }
+
+    // the journal only says what was acknowledged, the flash has the last word
+    BSLStats::Scope timer(&stats, "resume_verify");
+    phase("resume_verify");
+    const auto [ack, msg, mcu_crc] = uart_wrapper->verify(load_addr, prefix);
+    if(ack != BSL::AckType::BSL_ACK || mcu_crc != image.prefix_crc(prefix)) {
+        BSLLog::printf("Journaled prefix does not verify, starting over\n");
+        return 0;
+    }
+
+    BSLLog::printf(">> Resuming at 0x%08x, %u of %u bytes already programmed\n", load_addr + prefix, prefix, size);
+    return prefix;
+}
+
+bool BSLTool::open_session()
+{
+    bool status = connect();
     if(!status) {
         return false;
     }
@@ -299,30 +623,125 @@ bool BSLTool::flash_image(const char* filepath, bool force)
     }
 
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    status = unlock();
-    if(!status) {
+    return unlock();
+}
+
+bool BSLTool::verify_image(const uint8_t* data, uint32_t size)
+{
+    if(!open_session()) {
+        return false;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return verify(data, 0x0, size);
+}
+
+bool BSLTool::dump_memory(uint32_t addr, uint32_t size, uint8_t* dst)
+{
+    if(!open_session()) {
         return false;
     }
 
+    BSLStats::Scope timer(&stats, "dump");
+    phase("dump");
+    BSLLog::printf(">> Reading %u bytes @0x%08x\n", size, addr);
+
+    // the response has to fit the BSL's buffer
+    const uint32_t chunk_max = std::min<uint32_t>(read_chunk_size, device_info.bsl_max_buff_size - 16);
+    for(uint32_t offset = 0; offset < size; offset += chunk_max) {
+        const uint32_t chunk = std::min(chunk_max, size - offset);
+        const auto [ack, msg] = uart_wrapper->readback_data(addr + offset, chunk, dst + offset);
+        if(ack != BSL::AckType::BSL_ACK || msg != BSL::CoreMessage::SUCCESS) {
+            record_error(ack, msg);
+            BSLLog::printf("Could not read 0x%08x: %s %s. Stopping...\n", addr + offset, BSL::AckTypeToString(ack), BSL::CoreMessageToString(msg));
+            return false;
+        }
+        if(on_progress)
+            on_progress({offset + chunk, size, offset / chunk_max + 1, 0});
+    }
+
+    return true;
+}
+
+void BSLTool::phase(const char* name)
+{
+    current_phase = name;
+    if(on_phase)
+        on_phase(name);
+}
+
+void BSLTool::record_error(BSL::AckType ack, BSL::CoreMessage msg)
+{
+    errors[{current_phase, ack, msg}]++;
+}
+
+bool BSLTool::flash_image(const char* filepath, bool force)
+{
     uint32_t size = 0;
-    status = open_file(filepath, size);
-    if(!status) {
-        printf("Error opening file %s\n", filepath);
+    if(!open_file(filepath, size)) {
+        BSLLog::printf("Error opening file %s\n", filepath);
         return false;
     }
+    return flash_file(force);
+}
+
+bool BSLTool::flash_file(bool force)
+{
+    if(!input_file.is_open()) {
+        BSLLog::printf("Open file first!\n");
+        return false;
+    }
+
+    _image image;
+    image.size = input_file.size();
+    image.crc = input_file.crc();
+    image.verify_crc = input_file.verify_crc();
+    image.prefix_crc = [this](uint32_t len) { return input_file.prefix_crc(len); };
+    // read again from the file, frame by frame
+    image.source = [this](uint32_t offset) -> BSL_UART::_source {
+        if(!input_file.rewind() || !input_file.skip(offset))
+            return nullptr;
+        return [this](uint8_t* dst, uint32_t len) { return input_file.read(dst, len); };
+    };
+
+    return flash(image, force);
+}
 
-    uint8_t data[size] = {0};
-    status = read_file(data, size);
+bool BSLTool::flash_image(const uint8_t* data, uint32_t size, uint32_t image_crc, bool force)
+{
+    _image image;
+    image.size = size;
+    image.crc = image_crc;
+    image.verify_crc = BSL::softwareCRC(data + verify_offset, size - verify_offset);
+    image.prefix_crc = [data](uint32_t len) { return BSL::softwareCRC(data, len); };
+    image.source = [data](uint32_t offset) -> BSL_UART::_source {
+        return [pos = data + offset](uint8_t* dst, uint32_t len) mutable {
+            memcpy(dst, pos, len);
+            pos += len;
+            return true;
+        };
+    };
+
+    return flash(image, force);
+}
+
+bool BSLTool::flash(const _image &image, bool force)
+{
+    BSLStats::Scope timer(&stats, "flash_total");
+    program_total = BSL_UART::_program_report();
+    const uint32_t size = image.size;
+    bool status = false;
+
+    status = open_session();
     if(!status) {
-        printf("Error reading file %s\n", filepath);
         return false;
     }
 
     if(!force) {
         std::this_thread::sleep_for(std::chrono::milliseconds(200));
-        status = verify(data, 0x0, size);
+        status = check_crc(image.verify_crc, 0x0, size, verify_offset);
         if(status) {
-            printf("Already up-to-date");
+            BSLLog::printf("Already up-to-date");
 
             std::this_thread::sleep_for(std::chrono::milliseconds(200));
             status = start_application();
@@ -330,28 +749,63 @@ bool BSLTool::flash_image(const char* filepath, bool force)
                 return true;
             }
         } else {
-            printf("Updating");
+            BSLLog::printf("Updating");
         }
     }
 
+    // journal of this flash, confirmed bytes are checkpointed per sector
+    BSLJournal::_checkpoint cp = {.image_crc=image.crc, .image_size=size, .load_addr=0x0, .confirmed=0};
+    const bool journal = resume && !port_name.empty();
+    if(journal) {
+        cp.confirmed = find_resume_point(image, cp.load_addr);
+    }
+
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    status = mass_erase();
+    if(cp.confirmed > 0) {
+        status = range_erase(cp.load_addr + cp.confirmed, cp.load_addr + size - 1);
+    } else {
+        status = mass_erase();
+    }
     if(!status) {
         return false;
     }
 
+    const uint32_t skip = cp.confirmed;
+    if(journal) {
+        BSLJournal::store(port_name, cp);
+    }
+    uart_wrapper->set_confirm_callback([&, skip](const BSL_UART::_program_report &report) {
+        if(journal && (skip + report.confirmed) / sector_size != cp.confirmed / sector_size) {
+            cp.confirmed = skip + report.confirmed;
+            BSLJournal::store(port_name, cp);
+        }
+        if(on_progress)
+            on_progress({skip + report.confirmed, size, report.frames, report.retries});
+    });
+
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    status = program_data(data, 0x0, size);
+    BSL_UART::_source source = image.source(skip);
+    status = source != nullptr && program_data(source, cp.load_addr + skip, size - skip);
+    uart_wrapper->set_confirm_callback(nullptr);
+    if(journal) {
+        cp.confirmed = skip + uart_wrapper->get_program_report().confirmed;
+        BSLJournal::store(port_name, cp);
+    }
     if(!status) {
         return false;
     }
 
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
-    status = verify(data, 0x0, size);
+    status = check_crc(image.verify_crc, 0x0, size, verify_offset);
     if(!status) {
         return false;
     }
 
+    // a verified image needs no resume
+    if(journal) {
+        BSLJournal::clear(port_name);
+    }
+
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
     status = start_application();
     if(!status) {
@@ -359,7 +813,229 @@ bool BSLTool::flash_image(const char* filepath, bool force)
     }
 
     // debug print flag summary
-    printf("\nStatus:\n\tProgrammed: %d\n\tVerified: %d\n\tStarted: %d\n", isProgrammed, isVerified, isStarted);
+    BSLLog::printf("\nStatus:\n\tProgrammed: %d\n\tVerified: %d\n\tStarted: %d\n", isProgrammed, isVerified, isStarted);
 
     return true;
 }
+
+bool BSLTool::region_matches(const BSLRegion::_region &region)
+{
+    const uint32_t size = region.data.size();
+    // the application keeps the offset of the single image verification
+    const uint32_t offset = region.addr == 0x0 ? verify_offset : 0;
+    if(size >= offset + min_verify_len) {
+        uint32_t crc;
+        return read_crc(region.addr + offset, size - offset, crc) && crc == BSL::softwareCRC(region.data.data() + offset, size - offset);
+    }
+
+    // too short for standalone verification, read back if the BSL allows it
+    std::vector<uint8_t> flash(size);
+    const BSL::CoreMessage msg = read_back(region.addr, size, flash.data());
+    if(msg != BSL::CoreMessage::SUCCESS) {
+        if(verbose_level > 0)
+            BSLLog::printf("0x%08x can not be read back (%s), programming it\n", region.addr, BSL::CoreMessageToString(msg));
+        return false;
+    }
+    return flash == region.data;
+}
+
+BSL::CoreMessage BSLTool::read_back(uint32_t addr, uint32_t size, uint8_t* dst)
+{
+    const uint32_t chunk_max = std::min<uint32_t>(read_chunk_size, device_info.bsl_max_buff_size - 16);
+    for(uint32_t pos = 0; pos < size; pos += chunk_max) {
+        const uint32_t chunk = std::min(chunk_max, size - pos);
+        const auto [ack, msg] = uart_wrapper->readback_data(addr + pos, chunk, dst + pos);
+        if(ack != BSL::AckType::BSL_ACK || msg != BSL::CoreMessage::SUCCESS) {
+            return ack != BSL::AckType::BSL_ACK ? BSL::CoreMessage::BSL_UART_UNDEFINED : msg;
+        }
+    }
+    return BSL::CoreMessage::SUCCESS;
+}
+
+bool BSLTool::flash_regions(const std::vector<BSLRegion::_region> &regions, bool force)
+{
+    BSLStats::Scope timer(&stats, "flash_total");
+    program_total = BSL_UART::_program_report();
+    bool status = open_session();
+    if(!status) {
+        return false;
+    }
+
+    // sectors [first, end) of a region
+    auto first_sector = [](const BSLRegion::_region &r) { return r.addr / sector_size; };
+    auto end_sector = [](const BSLRegion::_region &r) { return (uint32_t) (((uint64_t) r.addr + r.data.size() + sector_size - 1) / sector_size); };
+
+    std::vector<bool> changed(regions.size(), true);
+    if(!force) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        for(size_t i = 0; i < regions.size(); i++) {
+            changed[i] = !region_matches(regions[i]);
+        }
+    }
+    // erasing a changed region takes the regions sharing its sectors along
+    for(bool grown = true; grown; ) {
+        grown = false;
+        for(size_t i = 0; i < regions.size(); i++) {
+            for(size_t j = 0; j < regions.size(); j++) {
+                if(changed[i] && !changed[j] && first_sector(regions[j]) < end_sector(regions[i]) && first_sector(regions[i]) < end_sector(regions[j])) {
+                    changed[j] = true;
+                    grown = true;
+                }
+            }
+        }
+    }
+
+    if(std::find(changed.begin(), changed.end(), true) == changed.end()) {
+        BSLLog::printf("Already up-to-date");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return start_application();
+    }
+
+    // adjacent sectors are erased in one go, regions are sorted by address
+    std::vector<std::pair<uint32_t, uint32_t>> runs;
+    uint32_t total = 0;
+    for(size_t i = 0; i < regions.size(); i++) {
+        if(!changed[i]) {
+            continue;
+        }
+        total += regions[i].data.size();
+        if(!runs.empty() && first_sector(regions[i]) <= runs.back().second) {
+            runs.back().second = std::max(runs.back().second, end_sector(regions[i]));
+        } else {
+            runs.push_back({first_sector(regions[i]), end_sector(regions[i])});
+        }
+    }
+
+    // a run after programming: its regions, and what its sectors held around them, read back
+    // before the erase takes it along; erased flash in between stays erased
+    std::vector<std::vector<uint8_t>> images(runs.size());
+    // [data, data+len) goes to addr, the regions and the bytes kept around them
+    struct _write { const uint8_t* data; uint32_t addr; uint32_t len; };
+    std::vector<_write> writes;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for(size_t k = 0; k < runs.size(); k++) {
+        const uint32_t run_addr = runs[k].first * sector_size;
+        std::vector<uint8_t> &image = images[k];
+        image.assign((uint64_t) (runs[k].second - runs[k].first) * sector_size, 0xFF);
+
+        auto keep = [&](uint32_t from, uint32_t to) {
+            if(from >= to) {
+                return true;
+            }
+            uint8_t* dst = image.data() + (from - run_addr);
+            const BSL::CoreMessage msg = read_back(from, to - from, dst);
+            if(msg != BSL::CoreMessage::SUCCESS) {
+                BSLLog::printf("0x%08x can not be read back (%s), erasing its sector would lose it. Align the regions to %u byte sectors\n", from, BSL::CoreMessageToString(msg), sector_size);
+                return false;
+            }
+            if(!std::all_of(dst, dst + (to - from), [](uint8_t b) { return b == 0xFF; })) {
+                writes.push_back({dst, from, to - from});
+                total += to - from;
+            }
+            return true;
+        };
+
+        uint32_t pos = run_addr;
+        for(size_t i = 0; i < regions.size(); i++) {
+            const BSLRegion::_region &r = regions[i];
+            if(!changed[i] || first_sector(r) < runs[k].first || end_sector(r) > runs[k].second) {
+                continue;
+            }
+            if(!keep(pos, r.addr)) {
+                return false;
+            }
+            std::copy(r.data.begin(), r.data.end(), image.begin() + (r.addr - run_addr));
+            writes.push_back({r.data.data(), r.addr, (uint32_t) r.data.size()});
+            pos = r.addr + r.data.size();
+        }
+        if(!keep(pos, run_addr + image.size())) {
+            return false;
+        }
+    }
+
+    for(const auto &[first, end] : runs) {
+        if(!range_erase(first * sector_size, end * sector_size - 1)) {
+            return false;
+        }
+    }
+
+    uint32_t done = 0;
+    for(const _write &w : writes) {
+        uart_wrapper->set_confirm_callback([&](const BSL_UART::_program_report &report) {
+            if(on_progress)
+                on_progress({done + report.confirmed, total, report.frames, report.retries});
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        status = program_data(w.data, w.addr, w.len);
+        uart_wrapper->set_confirm_callback(nullptr);
+        if(!status) {
+            return false;
+        }
+        done += w.len;
+    }
+
+    // short regions get verified with their run too
+    for(size_t k = 0; k < runs.size(); k++) {
+        const uint32_t run_addr = runs[k].first * sector_size;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if(!verify(images[k].data(), run_addr, images[k].size(), run_addr == 0x0 ? verify_offset : 0)) {
+            return false;
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    status = start_application();
+    if(!status) {
+        return false;
+    }
+
+    // debug print flag summary
+    BSLLog::printf("\nStatus:\n\tProgrammed: %d\n\tVerified: %d\n\tStarted: %d\n", isProgrammed, isVerified, isStarted);
+
+    return true;
+}
+
+bool BSLTool::flash_changes(const uint8_t* data, uint32_t size, const uint8_t* previous, uint32_t previous_size)
+{
+    BSLStats::Scope timer(&stats, "flash_changes");
+    program_total = BSL_UART::_program_report();
+
+    // a sector that only one of the images reaches into differs as well
+    auto differs = [&](uint32_t offset) {
+        const uint32_t len = offset < size ? std::min(sector_size, size - offset) : 0;
+        const uint32_t previous_len = offset < previous_size ? std::min(sector_size, previous_size - offset) : 0;
+        return len != previous_len || memcmp(data + offset, previous + offset, len) != 0;
+    };
+
+    const uint32_t end = std::max(size, previous_size);
+    uint32_t sectors = 0;
+    for(uint32_t offset = 0; offset < end; offset += sector_size) {
+        if(differs(offset)) {
+            sectors++;
+        }
+    }
+    BSLLog::printf(">> %u of %u sectors changed\n", sectors, (end + sector_size - 1) / sector_size);
+
+    // each run of differing sectors is erased and programmed in one go,
+    // sectors past the end of data only need the erase
+    for(uint32_t start = 0; start < end; start += sector_size) {
+        if(!differs(start)) {
+            continue;
+        }
+
+        uint32_t run_end = start + sector_size;
+        while(run_end < end && differs(run_end)) {
+            run_end += sector_size;
+        }
+
+        if(!range_erase(start, run_end - 1)) {
+            return false;
+        }
+        if(start < size && !program_data(data + start, start, std::min(run_end, size) - start)) {
+            return false;
+        }
+        start = run_end - sector_size;
+    }
+
+    return verify(data, 0x0, size);
+}
@@ -5,18 +5,29 @@
  *      Author: Jonas Rockstroh
  */
 
+#include <map>
 #include <string>
+#include <tuple>
 //#include <vector>
 #include "bsl_uart.h"
 #include "bsl_gpio.h"
+#include "bsl_modem.h"
+#include "bsl_journal.h"
+#include "bsl_image_source.h"
+#include "bsl_region.h"
 
 class BSLTool {
     public:
-        BSLTool(const char* serial_port, bool use_gpio, int _verbose_level=0);
+        BSLTool(const char* serial_port, BSL_Entry::Method entry_method, int _verbose_level=0, BSL_Modem::_modem_def modem_def=BSL_Modem::default_modem_def);
+        BSLTool(Transport* transport, BSL_Entry::Method entry_method, int _verbose_level=0, BSL_Modem::_modem_def modem_def=BSL_Modem::default_modem_def);
         ~BSLTool();
 
-        // GPIO
+        // GPIO / modem lines
         bool enter_bsl();
+        // the target restarts into its application
+        bool hard_reset();
+        bool load_entry_timing(const std::string &fixture);
+        bool calibrate_entry(const std::string &fixture, int trials, int margin_percent);
 
         // UART
         bool connect(bool force = false);
@@ -24,20 +35,122 @@ class BSLTool {
         bool get_device_info();
         bool unlock();
         bool mass_erase();
-        bool program_data(uint8_t* data, uint32_t load_addr, uint32_t size);
-        bool verify(uint8_t *data, uint32_t load_addr, uint32_t size, uint32_t offset=0x8);
+        bool range_erase(uint32_t start_addr, uint32_t end_addr);
+        bool program_data(const uint8_t* data, uint32_t load_addr, uint32_t size);
+        bool program_data(BSL_UART::_source source, uint32_t load_addr, uint32_t size);
+        void set_pipeline(bool enabled, int window=0);
+        void set_max_retries(int max_retries);
+        bool verify(const uint8_t *data, uint32_t load_addr, uint32_t size, uint32_t offset=0x8);
+        // CRC of the device memory [addr, addr+size) by standalone verification, size at least 1KB
+        bool read_crc(uint32_t addr, uint32_t size, uint32_t &crc);
         bool start_application();
 
+        // plain, gzip or zstd image, size is the inflated one
         bool open_file(const char* path, uint32_t &size);
         uint32_t read_file(uint8_t *dst, uint32_t size);
         bool close_file();
+        // of the open file, inflated
+        uint32_t file_crc() const { return input_file.crc(); }
         std::string read_file_version(uint32_t offset=0x000000c0, uint32_t fw_version_len=51);
 
+        // connect, 115200 baud, device info, unlock
+        bool open_session();
+        // streams the file into the program frames, compressed ones are inflated on the way
         bool flash_image(const char* filepath, bool force);
+        // the file open_file() scanned, without inflating it for its CRCs again
+        bool flash_file(bool force);
+        bool flash_image(const uint8_t* data, uint32_t size, uint32_t image_crc, bool force);
+        // all regions in one session: erases the sectors they touch, programs and verifies them,
+        // regions as BSLRegion::prepare leaves them; what else the sectors hold is read back and kept
+        bool flash_regions(const std::vector<BSLRegion::_region> &regions, bool force);
+        // on an open session: erases and programs only the sectors in which data differs from previous,
+        // the image the device holds, then verifies all of data
+        bool flash_changes(const uint8_t* data, uint32_t size, const uint8_t* previous, uint32_t previous_size);
+        bool verify_image(const uint8_t* data, uint32_t size);
+        bool dump_memory(uint32_t addr, uint32_t size, uint8_t* dst);
+        // a held port gets the next unit: flags and stats cleared, host back at the BSL's initial baudrate
+        void reset_session();
+        // continue an interrupted flash of the same image from the port's journal (default: on)
+        void set_resume(bool enabled) { resume = enabled; }
+
+        BSLStats &get_stats() { return stats; }
+        const BSL::_device_info &last_device_info() const { return device_info; }
+        // the program_data() calls of the last flash together, a flash may program several ranges
+        const BSL_UART::_program_report &get_program_report() const { return program_total; }
+        uint32_t get_link_baud() const { return uart_wrapper != nullptr ? uart_wrapper->get_link_baud() : 0; }
+
+        // BSL errors of the session by phase, resent frames included, BSL_UART_UNDEFINED: no core message
+        typedef std::map<std::tuple<std::string, BSL::AckType, BSL::CoreMessage>, uint32_t> _error_counts;
+        const _error_counts &get_errors() const { return errors; }
+        // standalone verifications that answered with a different CRC
+        uint32_t get_crc_mismatches() const { return crc_mismatches; }
+
+        // how far the last session got
+        bool is_connected() const { return isConnected; }
+        bool is_unlocked() const { return isUnlocked; }
+        bool is_programmed() const { return isProgrammed; }
+        bool is_verified() const { return isVerified; }
+        bool is_started() const { return isStarted; }
+
+        // called with the stats name of each step as it starts (connect, unlock, program, ...)
+        void set_phase_callback(std::function<void(const char*)> callback) { on_phase = callback; }
+        struct _progress {
+            uint32_t done = 0;          // bytes of the image confirmed while programming, read while dumping
+            uint32_t total = 0;
+            uint32_t frames = 0;        // frames (chunks) answered so far
+            uint32_t retries = 0;       // frames sent again
+        };
+        // called after each frame, on the transfer thread
+        void set_progress_callback(std::function<void(const _progress &)> callback) { on_progress = callback; }
+        bool start_trace(const char* path, uint16_t port_id=0);
     private:
+        bool probe_entry(BSLTiming::_entry_timing timing, int trials);
+        uint32_t search_min_us(uint32_t lo, uint32_t hi, int trials, bool search_reset, BSLTiming::_entry_timing base);
+
+        static constexpr uint32_t calib_resolution_us = 50;
+        static constexpr uint32_t calib_app_boot_ms = 50;
+        static constexpr int calib_connect_tries = 1;
+
+        // what flashing needs of an image, in memory or streamed from a file
+        struct _image {
+            uint32_t size = 0;
+            uint32_t crc = 0;                                   // of the whole image, the journal key
+            uint32_t verify_crc = 0;                            // from verify_offset on
+            std::function<uint32_t(uint32_t len)> prefix_crc;   // of the first len bytes, len a multiple of sector_size
+            std::function<BSL_UART::_source(uint32_t offset)> source;  // the image from offset on, nullptr on errors
+        };
+
+        void phase(const char* name);
+        void record_error(BSL::AckType ack, BSL::CoreMessage msg=BSL::CoreMessage::BSL_UART_UNDEFINED);
+        bool flash(const _image &image, bool force);
+        // standalone verification of [load_addr+offset, load_addr+size) against prog_crc
+        bool check_crc(uint32_t prog_crc, uint32_t load_addr, uint32_t size, uint32_t offset);
+        uint32_t find_resume_point(const _image &image, uint32_t load_addr);
+        // the device holds the region: CRC from 1KB on, read back below
+        bool region_matches(const BSLRegion::_region &region);
+        // [addr, addr+size) in chunks the BSL's buffer takes, SUCCESS or the first failure
+        BSL::CoreMessage read_back(uint32_t addr, uint32_t size, uint8_t* dst);
+
+        static constexpr uint32_t sector_size = 1024;
+        static constexpr uint32_t verify_offset = 0x8;
+        static constexpr uint32_t min_verify_len = 1024;    // StandaloneVerification lower limit
+        static constexpr uint32_t read_chunk_size = 1024;
+
         BSL_UART* uart_wrapper = nullptr;
-        FILE* input_file_handle = nullptr;
-        BSL_GPIO* gpio_wrapper = nullptr;
+        WireTrace* trace = nullptr;
+        ImageSource input_file;
+        BSL_Entry* entry_wrapper = nullptr;
+
+        BSLStats stats;
+        std::string port_name;      // journal and timeout key, empty for transports without a path
+        bool resume = true;
+        BSL::_device_info device_info = {};
+        std::function<void(const char*)> on_phase;
+        std::function<void(const _progress &)> on_progress;
+        const char* current_phase = "";
+        _error_counts errors;
+        uint32_t crc_mismatches = 0;
+        BSL_UART::_program_report program_total;
 
         bool isConnected = false;
         bool isUnlocked = false;
@@ -0,0 +1,170 @@
+/*
+ * bsl_trace.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_trace.h"
+#include "bsl_log.h"
+#include "bsl_timing.h"
+#include <chrono>
+#include <cstring>
+
+WireTrace::WireTrace(const char* path, uint16_t _port_id, size_t ring_size) : port_id(_port_id)
+{
+    // power of two so positions can be masked
+    size_t size = 1;
+    while(size < ring_size)
+        size <<= 1;
+    ring.resize(size);
+    ring_mask = size - 1;
+
+    file = fopen(path, "wb");
+    if(file == nullptr) {
+        BSLLog::printf("Can not open trace file %s\n", path);
+        return;
+    }
+
+    uint8_t header[8] = {0};
+    memcpy(header, file_magic, 4);
+    memcpy(header+4, &file_version, 2);
+    fwrite(header, 1, sizeof(header), file);
+
+    running = true;
+    writer = std::thread(&WireTrace::writer_loop, this);
+}
+
+WireTrace::~WireTrace()
+{
+    if(file == nullptr)
+        return;
+
+    flush();
+    running = false;
+    writer.join();
+    fclose(file);
+}
+
+void WireTrace::copy_in(uint64_t at, const uint8_t* src, size_t len)
+{
+    size_t pos = at & ring_mask;
+    size_t first = std::min(len, ring.size() - pos);
+    memcpy(&ring[pos], src, first);
+    memcpy(&ring[0], src + first, len - first);
+}
+
+void WireTrace::record(Direction direction, const uint8_t* data, size_t len)
+{
+    if(file == nullptr)
+        return;
+
+    timespec now = BSLTiming::now();
+    uint64_t t_ns = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+    // keep single records well below the ring size
+    const size_t max_chunk = std::min<size_t>(UINT16_MAX, ring.size() / 4);
+
+    do {
+        uint16_t chunk = (uint16_t) std::min(len, max_chunk);
+        uint8_t header[record_header_len];
+        memcpy(header, &t_ns, 8);
+        memcpy(header+8, &port_id, 2);
+        header[10] = static_cast<uint8_t>(direction);
+        header[11] = 0;
+        memcpy(header+12, &chunk, 2);
+
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        const size_t total = record_header_len + chunk;
+
+        // wait for the writer instead of dropping, the trace must be complete for replay
+        while(h + total - tail.load(std::memory_order_acquire) > ring.size()) {
+            std::this_thread::yield();
+        }
+
+        copy_in(h, header, record_header_len);
+        copy_in(h + record_header_len, data, chunk);
+        head.store(h + total, std::memory_order_release);
+
+        data += chunk;
+        len -= chunk;
+    } while(len > 0);
+}
+
+void WireTrace::writer_loop()
+{
+    while(true) {
+        uint64_t h = head.load(std::memory_order_acquire);
+        uint64_t t = tail.load(std::memory_order_relaxed);
+
+        if(h == t) {
+            if(!running)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        size_t pos = t & ring_mask;
+        size_t len = h - t;
+        size_t first = std::min(len, ring.size() - pos);
+        fwrite(&ring[pos], 1, first, file);
+        fwrite(&ring[0], 1, len - first, file);
+
+        tail.store(h, std::memory_order_release);
+    }
+}
+
+void WireTrace::flush()
+{
+    if(file == nullptr)
+        return;
+
+    while(tail.load(std::memory_order_acquire) != head.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    fflush(file);
+}
+
+bool WireTrace::read_file(const char* path, std::vector<_record> &records)
+{
+    FILE* f = fopen(path, "rb");
+    if(f == nullptr) {
+        BSLLog::printf("Can not open trace file %s\n", path);
+        return false;
+    }
+
+    uint8_t header[8];
+    if(fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, file_magic, 4) != 0) {
+        BSLLog::printf("%s is not a wire trace\n", path);
+        fclose(f);
+        return false;
+    }
+
+    uint16_t version;
+    memcpy(&version, header+4, 2);
+    if(version != file_version) {
+        BSLLog::printf("Unsupported trace version %d\n", version);
+        fclose(f);
+        return false;
+    }
+
+    uint8_t rec_header[record_header_len];
+    while(fread(rec_header, 1, record_header_len, f) == record_header_len) {
+        _record rec;
+        uint16_t len;
+        memcpy(&rec.t_ns, rec_header, 8);
+        memcpy(&rec.port_id, rec_header+8, 2);
+        rec.direction = static_cast<Direction>(rec_header[10]);
+        memcpy(&len, rec_header+12, 2);
+
+        rec.data.resize(len);
+        if(fread(rec.data.data(), 1, len, f) != len) {
+            BSLLog::printf("Truncated trace record\n");
+            break;
+        }
+        records.push_back(std::move(rec));
+    }
+
+    fclose(f);
+    return true;
+}
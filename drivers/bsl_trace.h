@@ -0,0 +1,72 @@
+/*
+ * bsl_trace.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Binary wire trace of one port.
+ *
+ * The I/O path copies each TX/RX chunk with a timestamp into a lock-free
+ * single-producer/single-consumer ring, a background thread writes the ring
+ * to the trace file. The ring never drops data, if the writer falls behind
+ * the producer yields until there is space again.
+ *
+ * File layout (little endian):
+ *   header: "BSLT", u16 version, u16 reserved
+ *   record: u64 t_ns (CLOCK_MONOTONIC), u16 port_id, u8 direction, u8 reserved, u16 len, len bytes
+ */
+class WireTrace {
+    public:
+        enum class Direction : uint8_t {
+            TX = 0,
+            RX = 1
+        };
+
+        struct _record {
+            uint64_t t_ns;
+            uint16_t port_id;
+            Direction direction;
+            std::vector<uint8_t> data;
+        };
+
+        static constexpr char file_magic[4] = {'B', 'S', 'L', 'T'};
+        static constexpr uint16_t file_version = 1;
+        static constexpr size_t record_header_len = 14;
+        static constexpr size_t default_ring_size = 1 << 20;
+
+        WireTrace(const char* path, uint16_t _port_id=0, size_t ring_size=default_ring_size);
+        ~WireTrace();
+        bool is_open() const { return file != nullptr; }
+
+        // hot path, called from the I/O thread only
+        void record(Direction direction, const uint8_t* data, size_t len);
+
+        // blocks until everything recorded so far is in the file
+        void flush();
+
+        static bool read_file(const char* path, std::vector<_record> &records);
+
+    private:
+        void copy_in(uint64_t at, const uint8_t* src, size_t len);
+        void writer_loop();
+
+        FILE* file = nullptr;
+        uint16_t port_id;
+
+        std::vector<uint8_t> ring;
+        size_t ring_mask;
+        std::atomic<uint64_t> head{0};  // written by producer
+        std::atomic<uint64_t> tail{0};  // written by writer thread
+        std::atomic<bool> running{false};
+        std::thread writer;
+};
@@ -0,0 +1,208 @@
+/*
+ * bsl_trace_decoder.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_trace_decoder.h"
+#include "bsl_protocol.h"
+#include <cstring>
+
+static constexpr uint8_t header_len = 3;
+static constexpr uint8_t crc_len = 4;
+
+bool TraceDecoder::decode_file(const char* path)
+{
+    std::vector<WireTrace::_record> records;
+    if(!WireTrace::read_file(path, records)) {
+        return false;
+    }
+
+    for(const auto &rec : records) {
+        feed(rec);
+    }
+
+    // leftovers of an interrupted exchange
+    for(auto &[key, stream] : streams) {
+        if(!stream.pending.empty()) {
+            print_prefix(stream.t_ns, key >> 1, (key & 1) ? "RX" : "TX");
+            fprintf(out, "incomplete frame, %zu bytes\n", stream.pending.size());
+        }
+    }
+
+    return true;
+}
+
+void TraceDecoder::feed(const WireTrace::_record &rec)
+{
+    if(t0_ns == 0)
+        t0_ns = rec.t_ns;
+
+    uint32_t key = (rec.port_id << 1) | static_cast<uint8_t>(rec.direction);
+    auto &stream = streams[key];
+    if(stream.pending.empty())
+        stream.t_ns = rec.t_ns;
+
+    if(show_raw) {
+        print_prefix(rec.t_ns, rec.port_id, rec.direction == WireTrace::Direction::TX ? "tx" : "rx");
+        for(auto b : rec.data)
+            fprintf(out, "%02x ", b);
+        fprintf(out, "\n");
+    }
+
+    stream.pending.insert(stream.pending.end(), rec.data.begin(), rec.data.end());
+
+    if(rec.direction == WireTrace::Direction::TX)
+        decode_tx(stream, rec.port_id);
+    else
+        decode_rx(stream, rec.port_id);
+}
+
+void TraceDecoder::print_prefix(uint64_t t_ns, uint16_t port_id, const char* dir)
+{
+    fprintf(out, "%12.3fms p%u %s ", (t_ns - t0_ns) / 1e6, port_id, dir);
+}
+
+void TraceDecoder::decode_tx(_stream &stream, uint16_t port_id)
+{
+    auto &buf = stream.pending;
+
+    while(!buf.empty()) {
+        if(buf[0] != BSL::CMD_HEADER) {
+            print_prefix(stream.t_ns, port_id, "TX");
+            fprintf(out, "garbage byte 0x%02x\n", buf[0]);
+            buf.erase(buf.begin());
+            continue;
+        }
+
+        if(buf.size() < header_len)
+            return;
+
+        uint16_t len;
+        memcpy(&len, &buf[1], 2);
+        if(buf.size() < (size_t) header_len + len + crc_len)
+            return;
+
+        uint32_t crc;
+        memcpy(&crc, &buf[header_len + len], 4);
+        bool crc_ok = BSL::softwareCRC(&buf[header_len], len) == crc;
+
+        print_prefix(stream.t_ns, port_id, "TX");
+        print_command(&buf[header_len], len, crc_ok);
+        buf.erase(buf.begin(), buf.begin() + header_len + len + crc_len);
+    }
+}
+
+void TraceDecoder::decode_rx(_stream &stream, uint16_t port_id)
+{
+    auto &buf = stream.pending;
+
+    while(!buf.empty()) {
+        // anything that is not a response header is an acknowledgement
+        if(buf[0] != BSL::RSP_HEADER) {
+            print_prefix(stream.t_ns, port_id, "RX");
+            fprintf(out, "%s\n", BSL::AckTypeToString(static_cast<BSL::AckType>(buf[0])));
+            buf.erase(buf.begin());
+            continue;
+        }
+
+        if(buf.size() < header_len)
+            return;
+
+        uint16_t len;
+        memcpy(&len, &buf[1], 2);
+        if(buf.size() < (size_t) header_len + len + crc_len)
+            return;
+
+        uint32_t crc;
+        memcpy(&crc, &buf[header_len + len], 4);
+        bool crc_ok = BSL::softwareCRC(&buf[header_len], len) == crc;
+
+        print_prefix(stream.t_ns, port_id, "RX");
+        print_response(&buf[header_len], len, crc_ok);
+        buf.erase(buf.begin(), buf.begin() + header_len + len + crc_len);
+    }
+}
+
+void TraceDecoder::print_command(const uint8_t* core, uint16_t len, bool crc_ok)
+{
+    if(len == 0) {
+        fprintf(out, "empty packet%s\n", crc_ok ? "" : " [CRC ERROR]");
+        return;
+    }
+
+    auto cmd = static_cast<BSL::CoreCmd>(core[0]);
+    const uint8_t* data = core + 1;
+    const uint16_t data_len = len - 1;
+    uint32_t a = 0, b = 0;
+
+    fprintf(out, "%s", BSL::CoreCmdToString(cmd));
+    switch(cmd) {
+    case BSL::CoreCmd::ProgramData:
+    case BSL::CoreCmd::ProgramDataFast:
+        if(data_len >= 4) {
+            memcpy(&a, data, 4);
+            fprintf(out, " @0x%08x, %d bytes", a, data_len - 4);
+        }
+        break;
+    case BSL::CoreCmd::MemoryRead:
+    case BSL::CoreCmd::StandaloneVerification:
+    case BSL::CoreCmd::FlashRangeErase:
+        if(data_len >= 8) {
+            memcpy(&a, data, 4);
+            memcpy(&b, data+4, 4);
+            fprintf(out, (cmd == BSL::CoreCmd::FlashRangeErase) ? " 0x%08x-0x%08x" : " @0x%08x, %u bytes", a, b);
+        }
+        break;
+    case BSL::CoreCmd::ChangeBaudrate:
+        if(data_len >= 1)
+            fprintf(out, " rate id %d", data[0]);
+        break;
+    default:
+        break;
+    }
+
+    fprintf(out, "%s\n", crc_ok ? "" : " [CRC ERROR]");
+}
+
+void TraceDecoder::print_response(const uint8_t* core, uint16_t len, bool crc_ok)
+{
+    if(len == 0) {
+        fprintf(out, "empty response%s\n", crc_ok ? "" : " [CRC ERROR]");
+        return;
+    }
+
+    auto rsp = static_cast<BSL::CoreResponse>(core[0]);
+    const uint8_t* data = core + 1;
+    const uint16_t data_len = len - 1;
+
+    fprintf(out, "%s", BSL::CoreResponseToString(rsp));
+    switch(rsp) {
+    case BSL::CoreResponse::Message:
+        if(data_len >= 1)
+            fprintf(out, ": %s", BSL::CoreMessageToString(static_cast<BSL::CoreMessage>(data[0])));
+        break;
+    case BSL::CoreResponse::StandaloneVerification:
+        if(data_len >= 4) {
+            uint32_t crc;
+            memcpy(&crc, data, 4);
+            fprintf(out, " CRC 0x%08x", crc);
+        }
+        break;
+    case BSL::CoreResponse::GetDeviceInfo:
+        if(data_len >= 24) {
+            uint16_t max_buff;
+            uint32_t app_version;
+            memcpy(&app_version, data+4, 4);
+            memcpy(&max_buff, data+10, 2);
+            fprintf(out, " app version 0x%x, max buffer %u", app_version, max_buff);
+        }
+        break;
+    default:
+        fprintf(out, ", %d bytes", data_len);
+        break;
+    }
+
+    fprintf(out, "%s\n", crc_ok ? "" : " [CRC ERROR]");
+}
@@ -0,0 +1,42 @@
+/*
+ * bsl_trace_decoder.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "bsl_trace.h"
+
+/*
+ * Reassembles BSL frames from a wire trace and pretty-prints them.
+ * TX carries command packets (0x80), RX carries ACK bytes followed by
+ * optional response packets (0x08).
+ */
+class TraceDecoder {
+    public:
+        TraceDecoder(FILE* _out=stdout, bool _show_raw=false) : out(_out), show_raw(_show_raw) {}
+        bool decode_file(const char* path);
+        void feed(const WireTrace::_record &rec);
+
+    private:
+        struct _stream {
+            std::vector<uint8_t> pending;
+            uint64_t t_ns = 0;
+        };
+
+        void decode_tx(_stream &stream, uint16_t port_id);
+        void decode_rx(_stream &stream, uint16_t port_id);
+        void print_command(const uint8_t* core, uint16_t len, bool crc_ok);
+        void print_response(const uint8_t* core, uint16_t len, bool crc_ok);
+        void print_prefix(uint64_t t_ns, uint16_t port_id, const char* dir);
+
+        FILE* out;
+        bool show_raw;
+        uint64_t t0_ns = 0;
+        std::map<uint32_t, _stream> streams;    // key: port_id << 1 | direction
+};
@@ -5,102 +5,106 @@
  *      Author: Jonas Rockstroh
  */
 #include "bsl_uart.h"
+#include "bsl_log.h"
+#include "bsl_timing.h"
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
-void fill_cmd_header(uint8_t* buffer, uint16_t data_len, BSL::CoreCmd cmd);
-void fill_cmd_data(uint8_t *buffer, uint8_t *data, size_t data_len);
-void write_buffer(Serial* serial, const uint8_t* buffer, size_t buffer_len);
-BSL::AckType receive_ack(Serial* serial);
+void commit_buffer(Transport* transport, size_t buffer_len);
+BSL::AckType receive_ack(Transport* transport, int max_timeout_tries=10);
 
-BSL_UART::BSL_UART(const char* _serial_port, int _verbose_level) : verbose_level(_verbose_level)
+BSL_UART::BSL_UART(const char* _serial_port, int _verbose_level) : BSL_UART(Transport::create(_serial_port, _verbose_level), _verbose_level)
 {
-    serial = new Serial(_serial_port, verbose_level);
-    if(!serial->_open()) {
+
+}
+
+BSL_UART::BSL_UART(Transport* _transport, int _verbose_level) : transport(_transport), verbose_level(_verbose_level)
+{
+    if(!transport->_open()) {
+       delete transport;
        throw std::runtime_error("Failed to open serial port");
     }
 }
 
 BSL_UART::~BSL_UART() 
 {
-    delete serial;
+    delete transport;
+}
+
+void BSL_UART::set_stats(BSLStats* _stats)
+{
+    stats = _stats;
+    transport->set_stats(_stats);
+}
+
+void BSL_UART::flush()
+{
+    if(transport != nullptr)
+        transport->_flush();
 }
 
-BSL::AckType BSL_UART::connect()
+BSL::AckType BSL_UART::connect(int max_timeout_tries)
 {
-    if(serial == nullptr)
+    if(transport == nullptr)
         throw;
 
     // cmd specific
     constexpr uint16_t data_len = 1;
-    constexpr uint8_t ack_len = 1;
 
     constexpr uint8_t tx_buffer_len = header_len+crc_len+data_len;
-    uint8_t tx_buf[tx_buffer_len] = {0};
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
 
     // wrap packet
-    fill_cmd_header(tx_buf, data_len, BSL::CoreCmd::Connection);
-    // calc crc over cmd+data
-    auto crc = BSL::softwareCRC(tx_buf+header_len, data_len);
-    // append crc
-    *((uint32_t*) (tx_buf+header_len+data_len)) = crc;
+    BSL::fill_cmd_header(tx_buf, data_len, BSL::CoreCmd::Connection);
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, data_len);
 
     // write packet via uart
-    write_buffer(serial, tx_buf, tx_buffer_len);
+    send_packet(BSL::CoreCmd::Connection, tx_buffer_len, ack_len);
 
     // receive ACK,
     // connection cmd does not send additional response data
-    auto ack = receive_ack(serial);
+    auto ack = await_ack(max_timeout_tries);
 
     return ack;
 }
 
 std::tuple<BSL::AckType, BSL::_device_info> BSL_UART::get_device_info()
 {
-    if(serial == nullptr)
+    if(transport == nullptr)
         throw;
 
     // cmd specific
     constexpr uint16_t data_len = 1;
 
     constexpr uint8_t tx_buffer_len = header_len+crc_len+data_len;
-    uint8_t tx_buf[tx_buffer_len] = {0};
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
 
     // wrap packet
-    fill_cmd_header(tx_buf, data_len, BSL::CoreCmd::GetDeviceInfo);
-    // calc crc over cmd+data
-    auto crc = BSL::softwareCRC(tx_buf+header_len, data_len);
-    // append crc
-    *((uint32_t*) (tx_buf+header_len+data_len)) = crc;       
+    BSL::fill_cmd_header(tx_buf, data_len, BSL::CoreCmd::GetDeviceInfo);
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, data_len);
 
     // write packet via uart
-    write_buffer(serial, tx_buf, tx_buffer_len);
+    send_packet(BSL::CoreCmd::GetDeviceInfo, tx_buffer_len, ack_len + BSL::packet_len(1 + BSL::device_info_len));
 
     // receive ACK,
-    auto ack = receive_ack(serial);
+    auto ack = await_ack();
+    BSL::_device_info device_info;
+    if(ack != BSL::AckType::BSL_ACK)
+        return {ack, device_info};
 
     // receive device info
-    BSL::_device_info device_info;
-    constexpr uint16_t resp_data_len = 0x19;
-    constexpr uint16_t rx_buffer_len = header_len+resp_data_len+crc_len;
-    uint8_t rx_buf[rx_buffer_len] = {0};
-    int bytes_read = 0;
-
-    bytes_read = serial->readBytes((char*) rx_buf, rx_buffer_len);
-    if(bytes_read != rx_buffer_len)
-        return {BSL::AckType::ERR_TIMEOUT, device_info};
-
-    uint8_t* resp_code = rx_buf+header_len;
-    uint8_t* resp_data = resp_code+1;
-
-    device_info.cmd_interpreter_version = *((uint16_t *)(&resp_data[0]));
-    device_info.build_id = *((uint16_t *)(&resp_data[2]));
-    device_info.app_version = *((uint32_t *)(&resp_data[4]));
-    device_info.plugin_if_version = *((uint16_t *)(&resp_data[8]));
-    device_info.bsl_max_buff_size = *((uint16_t *)(&resp_data[10]));
-    device_info.bsl_buff_start_addr = *((uint32_t *)(&resp_data[12]));
-    device_info.bcr_conf_id = *((uint32_t *)(&resp_data[16]));
-    device_info.bsl_conf_id = *((uint32_t *)(&resp_data[20]));
+    BSL::_response_view rsp;
+    auto status = receive_response(rsp);
+    if(status != BSL::AckType::BSL_ACK)
+        return {status, device_info};
+
+    bool parsed = BSL::parse_device_info(rsp, device_info);
+    release_response();
+    if(!parsed)
+        return {BSL::AckType::ERR_UNDEFINED, device_info};
 
     set_bsl_max_buff_size(device_info.bsl_max_buff_size);
 
@@ -114,77 +118,60 @@ void BSL_UART::set_bsl_max_buff_size(uint32_t _bsl_max_buff_size)
 
 BSL::AckType BSL_UART::start_application()
 {
-    if(serial == nullptr)
+    if(transport == nullptr)
         throw;
 
     // cmd specific
     constexpr uint16_t data_len = 1;
 
     constexpr uint8_t tx_buffer_len = header_len+crc_len+data_len;
-    uint8_t tx_buf[tx_buffer_len] = {0};
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
 
     // wrap packet
-    fill_cmd_header(tx_buf, data_len, BSL::CoreCmd::StartApplication);
-    // calc crc over cmd+data
-    auto crc = BSL::softwareCRC(tx_buf+header_len, data_len);
-    // append crc
-    *((uint32_t*) (tx_buf+4)) = crc;       
+    BSL::fill_cmd_header(tx_buf, data_len, BSL::CoreCmd::StartApplication);
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, data_len);
 
     // write packet via uart
-    write_buffer(serial, tx_buf, tx_buffer_len);
+    send_packet(BSL::CoreCmd::StartApplication, tx_buffer_len, ack_len);
 
     // receive ACK
-    auto ack = receive_ack(serial);
+    auto ack = await_ack();
 
     return ack;
 }
 
 std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::unlock_bootloader(const uint8_t* passwd)
 {   
-    if(serial == nullptr)
+    if(transport == nullptr)
         throw;   
 
     // cmd specific
     constexpr uint16_t data_len = 1+password_len;
 
     constexpr uint8_t tx_buffer_len = header_len+crc_len+data_len;
-    uint8_t tx_buf[tx_buffer_len] = {0};
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
 
-    fill_cmd_header(tx_buf, data_len, BSL::CoreCmd::UnlockBootloader);
+    BSL::fill_cmd_header(tx_buf, data_len, BSL::CoreCmd::UnlockBootloader);
     memcpy(&tx_buf[header_len+1], passwd, password_len);
     
-    auto crc = BSL::softwareCRC(tx_buf+header_len, data_len);
-    // append crc
-    *((uint32_t*) (tx_buf+header_len+data_len)) = crc;    
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, data_len);
 
-    write_buffer(serial, tx_buf, tx_buffer_len);
-    auto ack = receive_ack(serial);
-
-    // receive core message
-    BSL::CoreMessage msg = BSL::CoreMessage::BSL_UART_UNDEFINED;
-    constexpr uint16_t resp_data_len = 0x02;
-    constexpr uint16_t rx_buffer_len = header_len+resp_data_len+crc_len;
-    uint8_t rx_buf[rx_buffer_len] = {0};
-    int bytes_read = 0;
-
-    bytes_read = serial->readBytes((char*) rx_buf, rx_buffer_len);
-    if(bytes_read != rx_buffer_len)
-        return {BSL::AckType::ERR_TIMEOUT, msg};
-
-    uint8_t* resp_code = rx_buf+header_len;
-    if(static_cast<BSL::CoreResponse>(*resp_code) != BSL::CoreResponse::Message)
+    send_packet(BSL::CoreCmd::UnlockBootloader, tx_buffer_len);
+    auto ack = await_ack();
+    if(ack != BSL::AckType::BSL_ACK)
         return {ack, BSL::CoreMessage::BSL_UART_UNDEFINED};
 
-    uint8_t* resp_data = resp_code+1;
-
-    msg = static_cast<BSL::CoreMessage>(*resp_data);
+    // receive core message
+    auto msg = receive_core_message();
 
     return {ack, msg};
 }
 
 std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::readback_data(const uint32_t addr, const uint32_t readback_len, uint8_t *dst)
 {
-    if(serial == nullptr)
+    if(transport == nullptr)
         throw;  
 
     auto ack = BSL::AckType::ERR_UNDEFINED;
@@ -192,43 +179,38 @@ std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::readback_data(const uint32_
 
     constexpr uint16_t tx_data_len = 9;
     constexpr uint8_t tx_buffer_len = header_len+crc_len+tx_data_len;
-    uint8_t tx_buf[tx_buffer_len] = {0};
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
 
-    fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::MemoryRead);
+    BSL::fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::MemoryRead);
 
     *((uint32_t*) (&tx_buf[header_len+1])) = addr; 
     *((uint32_t*) (&tx_buf[header_len+5])) = readback_len; 
     
-    auto crc = BSL::softwareCRC(tx_buf+header_len, tx_data_len);
-    // append crc
-    *((uint32_t*) (tx_buf+header_len+tx_data_len)) = crc;
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, tx_data_len);
 
-    write_buffer(serial, tx_buf, tx_buffer_len);
-    ack = receive_ack(serial);
+    send_packet(BSL::CoreCmd::MemoryRead, tx_buffer_len, ack_len + BSL::packet_len(1 + readback_len));
+    ack = await_ack();
 
     if(ack != BSL::AckType::BSL_ACK) {
         return {ack, msg};
     }
 
-    const uint16_t resp_data_len = 1+readback_len;
-    const uint16_t rx_buffer_len = header_len+resp_data_len+crc_len;
-    uint8_t rx_buf[rx_buffer_len] = {0};
-    int bytes_read = 0;
-
-    // read header, length and rsp code first to check if read is valid
-    bytes_read = serial->readBytes((char*) rx_buf, 9);
-    if(bytes_read != 9)
-        return {BSL::AckType::ERR_TIMEOUT, msg};
-
-    uint8_t resp_code = *(rx_buf+header_len);
-
-    if(static_cast<BSL::CoreResponse>(resp_code) != BSL::CoreResponse::MemoryRead) {
-        printf("Failed to read. Reason: %s\n", BSL::CoreMessageToString(static_cast<BSL::CoreMessage>(*(rx_buf+header_len+1))));
+    // memory data or a core message if the BCR configuration forbids read out
+    BSL::_response_view rsp;
+    auto status = receive_response(rsp);
+    if(status != BSL::AckType::BSL_ACK)
+        return {status, msg};
+
+    if(rsp.code == BSL::CoreResponse::MemoryRead) {
+        memcpy(dst, rsp.data, std::min<uint32_t>(rsp.data_len, readback_len));
+        msg = rsp.data_len == readback_len ? BSL::CoreMessage::SUCCESS : BSL::CoreMessage::BSL_UART_UNDEFINED;
+    } else if(rsp.code == BSL::CoreResponse::Message && rsp.data_len > 0 && rsp.data[0] != static_cast<uint8_t>(BSL::CoreMessage::SUCCESS)) {
+        // a SUCCESS message is the late answer of an earlier command, no data came
+        msg = static_cast<BSL::CoreMessage>(rsp.data[0]);
+        BSLLog::printf("Failed to read. Reason: %s\n", BSL::CoreMessageToString(msg));
     }
-
-    // implement read out of memory if BCR configuration allows it
-    // postponed for now.
-
+    release_response();
 
     return {ack, msg};
 }
@@ -239,29 +221,35 @@ BSL::AckType BSL_UART::change_baudrate(BSL::Baudrate rate)
 
     constexpr uint16_t tx_data_len = 2;
     constexpr uint8_t tx_buffer_len = header_len+crc_len+tx_data_len;
-    uint8_t tx_buf[tx_buffer_len] = {0};
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
 
     uint8_t cmd_data[1] = {static_cast<uint8_t>(rate)};
 
     // wrap packet
-    fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::ChangeBaudrate);
-    fill_cmd_data(tx_buf, cmd_data, 1);
-    auto crc = BSL::softwareCRC(tx_buf+header_len, tx_data_len);
-    // append crc
-    *((uint32_t*) (tx_buf+header_len+tx_data_len)) = crc;
+    BSL::fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::ChangeBaudrate);
+    BSL::fill_cmd_data(tx_buf, cmd_data, 1);
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, tx_data_len);
 
     // write and get ack
-    write_buffer(serial, tx_buf, tx_buffer_len);
-    ack = receive_ack(serial);
+    send_packet(BSL::CoreCmd::ChangeBaudrate, tx_buffer_len, ack_len);
+    ack = await_ack();
 
     if(ack == BSL::AckType::BSL_ACK) {
-        serial->_close();
-        serial->_open(BSL::BSLBaudToSerialBaud(rate));
+        transport->set_baud(BSL::BSLBaudToSerialBaud(rate));
+        link_baud = BSL::BSLBaudToBitrate(rate);
     }
 
     return ack;
 }
 
+void BSL_UART::reset_baudrate()
+{
+    transport->set_baud(B9600);
+    link_baud = 9600;
+    transport->_flush();
+}
+
 std::tuple<BSL::AckType, BSL::CoreMessage, uint32_t> BSL_UART::verify(const uint32_t addr, const uint32_t size)
 {
     auto ack = BSL::AckType::ERR_UNDEFINED;
@@ -270,64 +258,66 @@ std::tuple<BSL::AckType, BSL::CoreMessage, uint32_t> BSL_UART::verify(const uint
 
     constexpr uint16_t tx_data_len = 9;
     constexpr uint8_t tx_buffer_len = header_len+crc_len+tx_data_len;
-    uint8_t tx_buf[tx_buffer_len] = {0};
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
 
     uint32_t cmd_data[2];
     cmd_data[0] = addr;
     cmd_data[1] = size;
 
     // wrap packet
-    fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::StandaloneVerification);
-    fill_cmd_data(tx_buf, (uint8_t*) cmd_data, 8);
-    auto crc = BSL::softwareCRC(tx_buf+header_len, tx_data_len);
-    // append crc
-    *((uint32_t*) (tx_buf+header_len+tx_data_len)) = crc;
+    BSL::fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::StandaloneVerification);
+    BSL::fill_cmd_data(tx_buf, (uint8_t*) cmd_data, 8);
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, tx_data_len);
 
     // write and get ack
-    write_buffer(serial, tx_buf, tx_buffer_len);
-    ack = receive_ack(serial);
-
-
-    // receive and check if standalone msg or core message
-    constexpr uint16_t resp_data_len = 0x05;
-    constexpr uint16_t rx_buffer_len = header_len+resp_data_len+crc_len;
-    uint8_t rx_buf[rx_buffer_len] = {0};
-    int bytes_read = 0;
-
-    bytes_read = serial->readBytes((char*) rx_buf, header_len+2);
-    if(bytes_read != header_len+2)
-        return {BSL::AckType::ERR_TIMEOUT, msg, mem_block_crc};
-
-    uint8_t* resp_code = rx_buf+header_len;
-    if(static_cast<BSL::CoreResponse>(*resp_code) != BSL::CoreResponse::StandaloneVerification)
-        return {ack, static_cast<BSL::CoreMessage>(*(resp_code+1)), 0};
+    send_packet(BSL::CoreCmd::StandaloneVerification, tx_buffer_len, ack_len + BSL::packet_len(1 + 4));
+    ack = await_ack();
 
-    // read rest of standalone response
-    bytes_read += serial->readBytes((char*) rx_buf+bytes_read, rx_buffer_len-bytes_read);
-    if(bytes_read != rx_buffer_len)
-        return {BSL::AckType::ERR_TIMEOUT, msg, mem_block_crc};
 
-    uint8_t* resp_data = resp_code+1;
-
-    mem_block_crc = *((uint32_t*) resp_data);
+    if(ack != BSL::AckType::BSL_ACK)
+        return {ack, msg, mem_block_crc};
 
+    // receive and check if standalone msg or core message
+    BSL::_response_view rsp;
+    auto status = receive_response(rsp);
+    if(status != BSL::AckType::BSL_ACK)
+        return {status, msg, mem_block_crc};
+
+    if(rsp.code == BSL::CoreResponse::StandaloneVerification && rsp.data_len >= 4) {
+        memcpy(&mem_block_crc, rsp.data, 4);
+        msg = BSL::CoreMessage::SUCCESS;
+    } else if(rsp.code == BSL::CoreResponse::Message && rsp.data_len > 0) {
+        msg = static_cast<BSL::CoreMessage>(rsp.data[0]);
+    }
+    release_response();
 
-    return {ack, BSL::CoreMessage::SUCCESS, mem_block_crc};
+    return {ack, msg, mem_block_crc};
 }
 
 std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::program_data(const uint32_t addr, const uint8_t* program_data, size_t program_size)
+{
+    size_t pos = 0;
+    return this->program_data(addr, [&](uint8_t* dst, uint32_t len) {
+        memcpy(dst, program_data + pos, len);
+        pos += len;
+        return true;
+    }, program_size);
+}
+
+std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::program_data(const uint32_t addr, _source source, size_t program_size)
 {
     auto ack = BSL::AckType::ERR_UNDEFINED;
     auto msg = BSL::CoreMessage::BSL_UART_UNDEFINED;   
 
     // addr and program size have to be 8 byte aligned
     if((addr % 8) != 0) {
-        printf("program addr needs to be 8byte aligned! Canceling.\n");
+        BSLLog::printf("program addr needs to be 8byte aligned! Canceling.\n");
         return {ack, msg};
     }
 
     if((program_size % 8) != 0) {
-        printf("program size needs to be 8byte aligned! Canceling.\n");
+        BSLLog::printf("program size needs to be 8byte aligned! Canceling.\n");
         return {ack, msg};
     }
 
@@ -336,62 +326,410 @@ std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::program_data(const uint32_t
     // => actually do not know if this is true when we only send 128byte payloads anyway, so try without
     /*
     if(program_size > bsl_max_buff_size) {
-        printf("program_data size > bsl_max_buffer_size. Canceling.\n");
+        BSLLog::printf("program_data size > bsl_max_buffer_size. Canceling.\n");
         return {ack, msg};
     }
     */
 
-    uint32_t bytes_to_write = program_size;
-    uint32_t bytes_written = 0;
-    uint16_t data_block_size = 0;
-    uint32_t block_count = 0;
+    // frames end on sector boundaries, a sector that has to be rewritten holds whole frames
+    auto frame_size = [&](uint32_t offset) {
+        return std::min<uint32_t>({MAX_PAYLOAD_SIZE, (uint32_t) program_size - offset, sector_size - (addr + offset) % sector_size});
+    };
+    uint32_t frames_total = 0;
+    for(uint32_t offset = 0; offset < program_size; offset += frame_size(offset))
+        frames_total++;
 
-    while(bytes_to_write > 0) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
-        if (bytes_to_write >= MAX_PAYLOAD_SIZE)
-            data_block_size = MAX_PAYLOAD_SIZE;
-        else
-            data_block_size = bytes_to_write;
+    const size_t in_flight_max = std::max(1, window > 0 ? window : transport->preferred_window());
+    FrameQueue queue(in_flight_max + queue_ahead, header_len+crc_len+cmd_len+addr_len+MAX_PAYLOAD_SIZE);
 
-        bytes_to_write -= data_block_size;
-    
-
-        const uint32_t tx_data_len = 1+4+data_block_size;
-        const uint32_t tx_buffer_len = header_len+crc_len+tx_data_len;
-        uint8_t tx_buf[tx_buffer_len] = {0};
+    uint32_t build_offset = 0;
+    auto build_frame = [&](FrameQueue::_frame* frame) {
+        const uint16_t data_block_size = frame_size(build_offset);
+        const uint32_t tx_data_len = cmd_len+addr_len+data_block_size;
+        uint8_t* tx_buf = frame->buf.data();
 
         uint8_t* addr_field = tx_buf+header_len+cmd_len;
         uint8_t* tx_program_data_start = addr_field+addr_len;
 
         // wrap packet
-        fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::ProgramData);
-        //fill_cmd_data(tx_buf, cmd_data, 8);
-        *((uint32_t*) addr_field) = addr+bytes_written;
-        memcpy(tx_program_data_start, program_data+bytes_written, data_block_size);
-        auto crc = BSL::softwareCRC(tx_buf+header_len, tx_data_len);
-        // append crc
-        *((uint32_t*) (tx_buf+header_len+tx_data_len)) = crc;
+        BSL::fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::ProgramData);
+        *((uint32_t*) addr_field) = addr+build_offset;
+        if(!source(tx_program_data_start, data_block_size))
+            return false;
+        // append crc over cmd+data
+        BSL::append_crc(tx_buf, tx_data_len);
+
+        frame->len = header_len+crc_len+tx_data_len;
+        frame->addr = addr+build_offset;
+        frame->data_len = data_block_size;
+        frame->acked = false;
+        frame->retries = 0;
+        build_offset += data_block_size;
+        return true;
+    };
+
+    // pipelined: frames are built ahead while earlier ones are on the wire
+    std::thread producer;
+    if(pipeline) {
+        producer = std::thread([&]() {
+            for(uint32_t i = 0; i < frames_total; i++) {
+                auto frame = queue.acquire();
+                if(frame == nullptr || !build_frame(frame))
+                    break;
+                queue.publish();
+            }
+            queue.finish();
+        });
+    }
 
-        // write and get ack
-        write_buffer(serial, tx_buf, tx_buffer_len);
-        ack = receive_ack(serial);   
+    program_report = _program_report();
+    // frames are timed one by one below
+    rtt_pending = false;
+    const timespec start = BSLTiming::now();
+    uint32_t frames_sent = 0;
+    uint32_t sent_offset = 0;
+    uint32_t block_count = 0;
+    bool source_failed = false;
+    _sector_log log;
+    log.start = addr;
+    log.end = addr + program_size;
+
+    while(block_count < frames_total) {
+        while(!source_failed && frames_sent < frames_total && frames_sent - block_count < in_flight_max) {
+            if(!pipeline) {
+                // a local UART gets paced, a windowed link is paced by the ACKs
+                if(in_flight_max == 1)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                if(!build_frame(queue.acquire())) {
+                    source_failed = true;
+                    break;
+                }
+                queue.publish();
+            }
+
+            // nullptr: the producer stopped early
+            auto frame = queue.next_to_send();
+            if(frame == nullptr) {
+                source_failed = true;
+                break;
+            }
+            frame->t_sent = BSLTiming::now();
+            if(transport->writeBytes((const char*) frame->buf.data(), frame->len) != (int) frame->len) {
+                BSLLog::printf("Error writing, not enough bytes written\n");
+            }
+            program_report.tx_bytes += frame->len;
+            queue.sent();
+            frames_sent++;
+            sent_offset += frame->data_len;
+        }
 
-        msg = receive_core_message();
+        // the frames built before the source failed are answered first
+        if(source_failed && frames_sent == block_count) {
+            BSLLog::printf("Reading the image failed at 0x%08x\n", addr + sent_offset);
+            queue.close();
+            if(producer.joinable())
+                producer.join();
+            return {BSL::AckType::ERR_UNDEFINED, BSL::CoreMessage::BSL_UART_UNDEFINED};
+        }
+
+        // response of the oldest frame, the BSL answers in order
+        auto frame = queue.oldest();
+        if(frame->acked) {
+            ack = BSL::AckType::BSL_ACK;
+            msg = BSL::CoreMessage::SUCCESS;
+        } else {
+            // the frames ahead of it are on the line as well, their answers come back meanwhile
+            const uint64_t frame_wire_us = wire_us(frame->len) * (frames_sent - block_count) + wire_us(message_rsp_len);
+            arm_timeout(BSL::CoreCmd::ProgramData, frame_wire_us, frame_ack_tries);
+            ack = receive_ack(transport, read_tries);
+            // only an ACK is followed by a core message
+            msg = (ack == BSL::AckType::BSL_ACK) ? receive_core_message() : BSL::CoreMessage::BSL_UART_UNDEFINED;
+            program_report.rx_bytes += 1 + header_len + 2 + crc_len;
+
+            const uint64_t frame_us = BSLTiming::elapsed_us(frame->t_sent);
+            if(stats != nullptr)
+                stats->record("program_frame", frame_us);
+            if(msg == BSL::CoreMessage::SUCCESS)
+                rto.sample(BSL::CoreCmd::ProgramData, frame_us > frame_wire_us ? frame_us - frame_wire_us : 0);
+            else if(ack == BSL::AckType::ERR_TIMEOUT || msg == BSL::CoreMessage::BSL_UART_UNDEFINED)
+                rto.timed_out(BSL::CoreCmd::ProgramData);
+        }
 
-        //return immediately if block was written unsuccessfully
         if((ack != BSL::AckType::BSL_ACK) || (msg != BSL::CoreMessage::SUCCESS)) {
-            printf("Programming failed at block %d, addr 0x%08x\n", block_count, addr+bytes_written);
+            // line errors get the frame resent, anything the BSL rejected on purpose does not
+            if(is_transient(ack, msg) && frame->retries < max_retries) {
+                if(verbose_level > 0) {
+                    BSLLog::printf("Block %d at 0x%08x: %s, retry %d/%d\n", block_count, frame->addr,
+                        BSL::AckTypeToString(ack), frame->retries + 1, max_retries);
+                }
+                if(stats != nullptr)
+                    stats->count(ack == BSL::AckType::ERR_TIMEOUT ? "program_retry_timeout" : "program_retry_error");
+                if(on_retry)
+                    on_retry(ack, msg);
+                if(retransmit(queue, log, frame->retries++))
+                    continue;
+                BSLLog::printf("Block %d at 0x%08x: device state unknown after a line error\n", block_count, frame->addr);
+            }
+
+            BSLLog::printf("Programming failed at block %d, addr 0x%08x\n", block_count, frame->addr);
+            queue.close();
+            if(producer.joinable())
+                producer.join();
+            // answers to frames still in flight are stale now
+            if(frames_sent - block_count > 1)
+                transport->_flush();
             return {ack, msg};
         }
 
-        bytes_written += data_block_size;
+        // a rewrite of this frame's sector has to restore it
+        const uint8_t* payload = frame->buf.data() + header_len+cmd_len+addr_len;
+        if(log.data.empty() || log.addr / sector_size != frame->addr / sector_size) {
+            log.addr = frame->addr;
+            log.data.clear();
+        }
+        log.data.insert(log.data.end(), payload, payload + frame->data_len);
+
+        program_report.confirmed += frame->data_len;
+        program_report.frames++;
+        queue.release();
         block_count++;
+
+        if(on_confirm)
+            on_confirm(program_report);
     }
 
+    if(producer.joinable())
+        producer.join();
+
+    program_report.elapsed_us = BSLTiming::elapsed_us(start);
+    program_report.wire_us = wire_us(program_report.tx_bytes - program_report.retry_bytes);
 
     return {ack, msg};
 }
 
+bool BSL_UART::is_transient(BSL::AckType ack, BSL::CoreMessage msg)
+{
+    switch(ack) {
+    case BSL::AckType::BSL_ACK:
+        // ACKed but the core message got lost or mangled
+        return msg == BSL::CoreMessage::BSL_UART_UNDEFINED;
+    case BSL::AckType::BSL_ERROR_UNKNOWN_ERROR:
+    case BSL::AckType::BSL_ERROR_UNKNOWN_BAUD_RATE:
+        return false;
+    default:
+        // error ACKs of a broken packet, timeouts and bytes that are no ACK at all
+        return true;
+    }
+}
+
+bool BSL_UART::retransmit(FrameQueue &queue, _sector_log &log, int attempt)
+{
+    // answers carry no sequence number and a mangled one can take its neighbour
+    // along, the answers behind it can not be matched to their frames any more:
+    // back off and drop everything until the line is quiet
+    const uint64_t frame_line_ms = (header_len+crc_len+cmd_len+addr_len+MAX_PAYLOAD_SIZE) * 10 * 1000 / link_baud + 1;
+    const uint64_t backoff_ms = std::min(retry_backoff_ms << attempt, retry_backoff_max_ms);
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::max(backoff_ms, frame_line_ms)));
+    drain_quiet(queue.in_flight());
+    program_report.resyncs++;
+    if(stats != nullptr)
+        stats->count("program_resyncs");
+
+    // a flash word must not be programmed twice without an erase: the device may
+    // have written a frame whose answer got lost, ask the flash what it holds.
+    // Read backs are answered behind all frames in flight, whatever they did is done.
+    const size_t in_flight = queue.in_flight();
+    for(size_t i = 0; i < in_flight; i++) {
+        auto frame = queue.in_flight_at(i);
+        if(frame->acked)
+            continue;
+
+        FrameState state;
+        const uint8_t* payload = frame->buf.data() + header_len+cmd_len+addr_len;
+        if(!probe(frame->addr, payload, frame->data_len, state))
+            return false;
+        if(state == FrameState::Written) {
+            frame->acked = true;
+        } else if(state == FrameState::Mixed) {
+            // half written or not readable: erase its sector and program it from the start
+            const uint32_t sector = frame->addr / sector_size * sector_size;
+            if(!rewrite_sector(log, sector))
+                return false;
+            for(size_t j = 0; j < in_flight; j++) {
+                if(queue.in_flight_at(j)->addr / sector_size * sector_size == sector)
+                    queue.in_flight_at(j)->acked = false;
+            }
+        }
+    }
+
+    resend(queue);
+    return true;
+}
+
+bool BSL_UART::probe(uint32_t addr, const uint8_t* data, uint32_t len, FrameState &state)
+{
+    std::vector<uint8_t> flash(len);
+    auto msg = read_flash(addr, flash.data(), len);
+    if(msg == BSL::CoreMessage::BSL_UART_UNDEFINED)
+        return false;
+
+    if(msg != BSL::CoreMessage::SUCCESS)
+        // the BCR configuration forbids read out, the content is unknown
+        state = FrameState::Mixed;
+    else if(!memcmp(flash.data(), data, len))
+        state = FrameState::Written;
+    else if(std::all_of(flash.begin(), flash.end(), [](uint8_t b) { return b == 0xFF; }))
+        state = FrameState::Erased;
+    else
+        state = FrameState::Mixed;
+    return true;
+}
+
+BSL::CoreMessage BSL_UART::read_flash(uint32_t addr, uint8_t* dst, uint32_t len)
+{
+    for(uint32_t done = 0; done < len; ) {
+        const uint32_t n = std::min<uint32_t>(len - done, MAX_PAYLOAD_SIZE);
+        auto ack = BSL::AckType::ERR_UNDEFINED;
+        auto msg = BSL::CoreMessage::BSL_UART_UNDEFINED;
+        int attempt = 0;
+        for(; attempt <= max_retries; attempt++) {
+            std::tie(ack, msg) = readback_data(addr + done, n, dst + done);
+            if(ack == BSL::AckType::BSL_ACK && msg != BSL::CoreMessage::BSL_UART_UNDEFINED)
+                break;
+            drain_quiet(1);
+        }
+        // the answer that did not come in time may still be on its way
+        if(attempt > 0)
+            drain_quiet(1);
+        if(msg != BSL::CoreMessage::SUCCESS)
+            return msg;
+        done += n;
+    }
+    return BSL::CoreMessage::SUCCESS;
+}
+
+bool BSL_UART::rewrite_sector(const _sector_log &log, uint32_t sector)
+{
+    const uint32_t sector_end = sector + sector_size;
+    if(verbose_level > 0)
+        BSLLog::printf("Rewriting sector 0x%08x\n", sector);
+    if(stats != nullptr)
+        stats->count("program_sector_rewrites");
+
+    // bytes of the sector outside this call's range belong to someone else, keep them
+    const uint32_t head_end = std::max(sector, std::min(log.start, sector_end));
+    const uint32_t tail_start = std::min(sector_end, std::max(log.end, sector));
+    std::vector<uint8_t> head(head_end - sector), tail(sector_end - tail_start);
+    if(read_flash(sector, head.data(), head.size()) != BSL::CoreMessage::SUCCESS ||
+       read_flash(tail_start, tail.data(), tail.size()) != BSL::CoreMessage::SUCCESS) {
+        BSLLog::printf("Sector 0x%08x: can not read the data to keep\n", sector);
+        return false;
+    }
+
+    int attempt = 0;
+    for(; attempt <= max_retries; attempt++) {
+        auto [ack, msg] = range_erase(sector, sector_end - 1);
+        if(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS)
+            break;
+        // erasing twice does no harm
+        drain_quiet(1);
+    }
+    if(attempt > max_retries) {
+        BSLLog::printf("Sector 0x%08x: erase failed\n", sector);
+        return false;
+    }
+
+    // back to where the frames in flight start, they are sent again
+    if(!program_words(sector, head.data(), head.size()) || !program_words(tail_start, tail.data(), tail.size()))
+        return false;
+    if(log.addr / sector_size * sector_size == sector && !program_words(log.addr, log.data.data(), log.data.size()))
+        return false;
+    return true;
+}
+
+bool BSL_UART::program_words(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+    for(uint32_t done = 0; done < len; ) {
+        const uint32_t n = std::min<uint32_t>(len - done, MAX_PAYLOAD_SIZE);
+        // erased already
+        const bool blank = std::all_of(data + done, data + done + n, [](uint8_t b) { return b == 0xFF; });
+        if(!blank && !program_frame(addr + done, data + done, n))
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+bool BSL_UART::program_frame(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+    // one frame answered before the next, same rules for a lost answer
+    for(int attempt = 0; attempt <= max_retries; attempt++) {
+        const uint32_t tx_data_len = cmd_len+addr_len+len;
+        const size_t tx_buffer_len = header_len+crc_len+tx_data_len;
+        uint8_t* tx_buf = transport->prepare(tx_buffer_len);
+        BSL::fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::ProgramData);
+        memcpy(tx_buf+header_len+cmd_len, &addr, addr_len);
+        memcpy(tx_buf+header_len+cmd_len+addr_len, data, len);
+        BSL::append_crc(tx_buf, tx_data_len);
+
+        send_packet(BSL::CoreCmd::ProgramData, tx_buffer_len);
+        // only recovery sends these
+        program_report.tx_bytes += tx_buffer_len;
+        program_report.retry_bytes += tx_buffer_len;
+        auto ack = await_ack(frame_ack_tries);
+        auto msg = (ack == BSL::AckType::BSL_ACK) ? receive_core_message() : BSL::CoreMessage::BSL_UART_UNDEFINED;
+        if(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS)
+            return true;
+        if(!is_transient(ack, msg))
+            return false;
+
+        drain_quiet(1);
+        FrameState state;
+        if(!probe(addr, data, len, state) || state == FrameState::Mixed)
+            return false;
+        if(state == FrameState::Written)
+            return true;
+    }
+    return false;
+}
+
+void BSL_UART::drain_quiet(size_t in_flight)
+{
+    const size_t frame_len = header_len+crc_len+cmd_len+addr_len+MAX_PAYLOAD_SIZE;
+    arm_timeout(BSL::CoreCmd::ProgramData, wire_us(frame_len) * in_flight, 1);
+
+    uint64_t dropped = 0;
+    while(transport->peek(1, read_tries) != nullptr) {
+        transport->consume(1);
+        dropped++;
+    }
+    if(stats != nullptr)
+        stats->count("program_stale_bytes", dropped);
+    if(verbose_level > 1) {
+        BSLLog::printf("Dropped %lu bytes until the line was quiet\n", dropped);
+    }
+}
+
+void BSL_UART::resend(FrameQueue &queue)
+{
+    // only the frames the device did not write, each copy is answered once and in order
+    const size_t in_flight = queue.in_flight();
+    for(size_t i = 0; i < in_flight; i++) {
+        auto frame = queue.in_flight_at(i);
+        if(frame->acked)
+            continue;
+        frame->t_sent = BSLTiming::now();
+        if(transport->writeBytes((const char*) frame->buf.data(), frame->len) != (int) frame->len) {
+            BSLLog::printf("Error writing, not enough bytes written\n");
+        }
+        program_report.tx_bytes += frame->len;
+        program_report.retry_bytes += frame->len;
+        program_report.retries++;
+        if(stats != nullptr)
+            stats->count("program_retries");
+    }
+}
+
 std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::mass_erase()
 {
     auto ack = BSL::AckType::ERR_UNDEFINED;
@@ -399,98 +737,208 @@ std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::mass_erase()
 
     const uint16_t tx_data_len = 1;
     const uint8_t tx_buffer_len = header_len+crc_len+tx_data_len;
-    uint8_t tx_buf[tx_buffer_len] = {0};
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
 
     // wrap packet
-    fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::MassErase);
-    auto crc = BSL::softwareCRC(tx_buf+header_len, tx_data_len);
-    // append crc
-    *((uint32_t*) (tx_buf+header_len+tx_data_len)) = crc;
+    BSL::fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::MassErase);
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, tx_data_len);
 
     // write and get ack
-    write_buffer(serial, tx_buf, tx_buffer_len);
-    ack = receive_ack(serial);    
+    send_packet(BSL::CoreCmd::MassErase, tx_buffer_len);
+    ack = await_ack();    
+    if(ack != BSL::AckType::BSL_ACK)
+        return {ack, msg};
 
     // receive core message
-    constexpr uint16_t resp_data_len = 0x02;
-    constexpr uint16_t rx_buffer_len = header_len+resp_data_len+crc_len;
-    uint8_t rx_buf[rx_buffer_len] = {0};
-    int bytes_read = 0;
+    msg = receive_core_message();
 
-    bytes_read = serial->readBytes((char*) rx_buf, rx_buffer_len);
-    if(bytes_read != rx_buffer_len)
-        return {BSL::AckType::ERR_TIMEOUT, msg};
+    return {ack, msg};
+}
 
-    uint8_t* resp_code = rx_buf+header_len;
-    if(static_cast<BSL::CoreResponse>(*resp_code) != BSL::CoreResponse::Message)
-        return {ack, BSL::CoreMessage::BSL_UART_UNDEFINED};
+std::tuple<BSL::AckType, BSL::CoreMessage> BSL_UART::range_erase(const uint32_t start_addr, const uint32_t end_addr)
+{
+    auto ack = BSL::AckType::ERR_UNDEFINED;
+    auto msg = BSL::CoreMessage::BSL_UART_UNDEFINED;
 
-    uint8_t* resp_data = resp_code+1;
-    
-    msg = static_cast<BSL::CoreMessage>(*resp_data);
+    constexpr uint16_t tx_data_len = 9;
+    constexpr uint8_t tx_buffer_len = header_len+crc_len+tx_data_len;
+    uint8_t* tx_buf = transport->prepare(tx_buffer_len);
+
+    // erases every sector touched by [start_addr, end_addr]
+    uint32_t cmd_data[2];
+    cmd_data[0] = start_addr;
+    cmd_data[1] = end_addr;
+
+    // wrap packet
+    BSL::fill_cmd_header(tx_buf, tx_data_len, BSL::CoreCmd::FlashRangeErase);
+    BSL::fill_cmd_data(tx_buf, (uint8_t*) cmd_data, 8);
+    // append crc over cmd+data
+    BSL::append_crc(tx_buf, tx_data_len);
+
+    // write and get ack
+    send_packet(BSL::CoreCmd::FlashRangeErase, tx_buffer_len);
+    ack = await_ack();
+    if(ack != BSL::AckType::BSL_ACK)
+        return {ack, msg};
+
+    msg = receive_core_message();
 
     return {ack, msg};
 }
 
-void fill_cmd_header(uint8_t* buffer, uint16_t data_len, BSL::CoreCmd cmd)
+void commit_buffer(Transport* transport, size_t buffer_len)
 {
-    // header + data length
-    *buffer = BSL::CMD_HEADER; 
-    *((uint16_t *)(buffer+1)) = data_len;
-    *(buffer+3) = static_cast<uint8_t>(cmd);
+    int bytesWritten = 0;
+    bytesWritten = transport->commit(buffer_len);
+    if(bytesWritten != (int) buffer_len) {
+        BSLLog::printf("Error writing, not enough bytes written\n");
+    }
+}
+
+BSL::AckType receive_ack(Transport* transport, int max_timeout_tries)
+{
+    // receive ACK
+    const uint8_t* rx = transport->peek(1, max_timeout_tries);
+    if(rx == nullptr) {
+        return BSL::AckType::ERR_TIMEOUT;
+    }
+
+    auto ack = static_cast<BSL::AckType>(*rx);
+    transport->consume(1);
+
+    return ack;
 }
 
-void fill_cmd_data(uint8_t *buffer, uint8_t *data, size_t data_len)
+void BSL_UART::send_packet(BSL::CoreCmd cmd, size_t len, size_t rsp_len)
 {
-    memcpy(buffer+4, data, data_len);
+    commit_buffer(transport, len);
+    rtt_cmd = cmd;
+    rtt_start = BSLTiming::now();
+    rtt_wire_us = wire_us(len + rsp_len);
+    rtt_pending = true;
 }
 
-void write_buffer(Serial* serial, const uint8_t* buffer, size_t buffer_len)
+BSL::AckType BSL_UART::await_ack(int max_timeout_tries)
 {
-    int bytesWritten = 0;
-    bytesWritten = serial->writeBytes((const char*) buffer, buffer_len);
-    if(bytesWritten != buffer_len) {
-        printf("Error writing, not enough bytes written\n");
+    arm_timeout(rtt_cmd, rtt_wire_us, max_timeout_tries);
+    auto ack = receive_ack(transport, read_tries);
+    if(ack == BSL::AckType::ERR_TIMEOUT) {
+        rtt_timeout();
+    } else if(ack != BSL::AckType::BSL_ACK) {
+        // rejected before processing, says nothing about the command's time
+        rtt_pending = false;
+    } else if(rtt_cmd == BSL::CoreCmd::Connection || rtt_cmd == BSL::CoreCmd::StartApplication ||
+              rtt_cmd == BSL::CoreCmd::ChangeBaudrate) {
+        // the ACK is all these get
+        rtt_done();
     }
+    return ack;
 }
 
-BSL::AckType receive_ack(Serial* serial)
+void BSL_UART::arm_timeout(BSL::CoreCmd cmd, uint64_t wire, int max_timeout_tries)
 {
-    // receive ACK
-    BSL::AckType ack;
-    char rxByte = 0xFF;
-    int bytes_read = 0;
-    bytes_read = serial->readBytes(&rxByte, 1);
-    if(bytes_read == 0) {
-        return BSL::AckType::ERR_TIMEOUT;
+    // never answered on this port: the fixed budget of 1s tries
+    if(!rto.known(cmd)) {
+        transport->set_read_timeout_ms(1000);
+        read_tries = max_timeout_tries;
+        return;
     }
 
-    if(bytes_read < 0)
-        return BSL::AckType::ERR_UNDEFINED;
+    transport->set_read_timeout_ms((wire + rto.timeout_us(cmd) + 999) / 1000);
+    read_tries = 1;
+}
 
-    ack = static_cast<BSL::AckType>(rxByte);
+void BSL_UART::rtt_done()
+{
+    if(!rtt_pending)
+        return;
+    rtt_pending = false;
 
-    return ack;
+    const uint64_t us = BSLTiming::elapsed_us(rtt_start);
+    rto.sample(rtt_cmd, us > rtt_wire_us ? us - rtt_wire_us : 0);
 }
 
-BSL::CoreMessage BSL_UART::receive_core_message()
+void BSL_UART::rtt_timeout()
 {
-    // receive core message
-    constexpr uint16_t resp_data_len = 0x02;
-    constexpr uint16_t rx_buffer_len = header_len+resp_data_len+crc_len;
-    uint8_t rx_buf[rx_buffer_len] = {0};
-    int bytes_read = 0;
+    if(!rtt_pending)
+        return;
+    rtt_pending = false;
 
-    bytes_read = serial->readBytes((char*) rx_buf, rx_buffer_len);
-    if(bytes_read != rx_buffer_len)
-        return BSL::CoreMessage::BSL_UART_UNDEFINED;
+    rto.timed_out(rtt_cmd);
+    if(stats != nullptr)
+        stats->count("response_timeouts");
+}
 
-    uint8_t* resp_code = rx_buf+header_len;
-    if(static_cast<BSL::CoreResponse>(*resp_code) != BSL::CoreResponse::Message)
+BSL::CoreMessage BSL_UART::receive_core_message()
+{
+    BSL::_response_view rsp;
+    if(receive_response(rsp) != BSL::AckType::BSL_ACK)
         return BSL::CoreMessage::BSL_UART_UNDEFINED;
 
-    uint8_t* resp_data = resp_code+1;
-    
-    return static_cast<BSL::CoreMessage>(*resp_data);
+    auto msg = BSL::CoreMessage::BSL_UART_UNDEFINED;
+    if(rsp.code == BSL::CoreResponse::Message && rsp.data_len > 0)
+        msg = static_cast<BSL::CoreMessage>(rsp.data[0]);
 
-}
\ No newline at end of file
+    release_response();
+    return msg;
+}
+
+BSL::AckType BSL_UART::receive_response(BSL::_response_view &rsp)
+{
+    while(true) {
+        // anything in front of a response header is line noise, skip it
+        const uint8_t* rx_buf = transport->peek(1, read_tries);
+        if(rx_buf == nullptr) {
+            rtt_timeout();
+            return BSL::AckType::ERR_TIMEOUT;
+        }
+        if(*rx_buf != BSL::RSP_HEADER) {
+            transport->consume(1);
+            if(stats != nullptr)
+                stats->count("rx_skipped_bytes");
+            continue;
+        }
+
+        rx_buf = transport->peek(header_len, read_tries);
+        if(rx_buf == nullptr) {
+            rtt_timeout();
+            return BSL::AckType::ERR_TIMEOUT;
+        }
+
+        // a length no response can have means the header byte was noise as well
+        uint16_t core_len;
+        memcpy(&core_len, rx_buf+1, 2);
+        if(core_len == 0 || core_len > max_response_len) {
+            transport->consume(1);
+            if(stats != nullptr)
+                stats->count("rx_skipped_bytes");
+            continue;
+        }
+
+        const size_t packet_len = BSL::packet_len(core_len);
+        rx_buf = transport->peek(packet_len, read_tries);
+        if(rx_buf == nullptr) {
+            rtt_timeout();
+            return BSL::AckType::ERR_TIMEOUT;
+        }
+
+        BSL::parse_response(rx_buf, packet_len, rsp);
+        if(!rsp.crc_ok) {
+            transport->consume(packet_len);
+            if(stats != nullptr)
+                stats->count("rx_crc_errors");
+            return BSL::AckType::ERR_RX_CHECKSUM;
+        }
+
+        response_len = packet_len;
+        rtt_done();
+        return BSL::AckType::BSL_ACK;
+    }
+}
+
+void BSL_UART::release_response()
+{
+    transport->consume(response_len);
+    response_len = 0;
+}
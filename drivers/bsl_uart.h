@@ -7,29 +7,113 @@
 
 #include "serial.h"
 #include "bsl_protocol.h"
+#include "bsl_packet.h"
+#include "bsl_frame_queue.h"
+#include "bsl_rto.h"
+#include <algorithm>
+#include <functional>
 
 class BSL_UART {
     public:
+        // outcome of the last program_data() call
+        struct _program_report {
+            uint32_t frames = 0;
+            uint32_t confirmed = 0;     // payload bytes acknowledged, also after a failure
+            uint64_t tx_bytes = 0;      // resent ones included
+            uint64_t retry_bytes = 0;   // of tx_bytes sent again, resent frames and rewritten sectors
+            uint64_t rx_bytes = 0;
+            uint64_t elapsed_us = 0;
+            uint64_t wire_us = 0;       // host to device line busy with first transmissions at the current baudrate
+            uint32_t retries = 0;       // frames sent again
+            uint32_t resyncs = 0;       // input flushes after a line error
+            double utilization() const { return elapsed_us ? std::min(1.0, (double) wire_us / elapsed_us) : 0; }
+        };
+
         BSL_UART(const char* _serial_port, int _verbose_level=0);
+        BSL_UART(Transport* _transport, int _verbose_level=0);  // takes ownership, e.g. a ReplaySerial or loopback
         ~BSL_UART();
         bool open_serial();
-        BSL::AckType connect();
+        BSL::AckType connect(int max_timeout_tries=10);
+        void flush();
         std::tuple<BSL::AckType, BSL::_device_info> get_device_info();
         BSL::AckType start_application();
         std::tuple<BSL::AckType, BSL::CoreMessage> unlock_bootloader(const uint8_t* passwd = bootloader_default_pw);
         std::tuple<BSL::AckType, BSL::CoreMessage> readback_data(const uint32_t addr, const uint32_t readback_len, uint8_t *dst);
         std::tuple<BSL::AckType, BSL::CoreMessage, uint32_t> verify(const uint32_t addr, const uint32_t size);
         std::tuple<BSL::AckType, BSL::CoreMessage> program_data(const uint32_t addr, const uint8_t* program_data, size_t program_size);
+        // copies the next len payload bytes to dst, called in address order, false stops programming
+        typedef std::function<bool(uint8_t* dst, uint32_t len)> _source;
+        std::tuple<BSL::AckType, BSL::CoreMessage> program_data(const uint32_t addr, _source source, size_t program_size);
         std::tuple<BSL::AckType, BSL::CoreMessage> mass_erase();
+        std::tuple<BSL::AckType, BSL::CoreMessage> range_erase(const uint32_t start_addr, const uint32_t end_addr);
         void set_bsl_max_buff_size(uint32_t _bsl_max_buff_size);
         BSL::AckType change_baudrate(BSL::Baudrate rate);
+        // back to the 9600 baud a freshly entered BSL listens at
+        void reset_baudrate();
+        Transport* get_transport() { return transport; }
+        void set_stats(BSLStats* _stats);
+        void set_trace(WireTrace* trace) { transport->set_trace(trace); }
+
+        // prebuild ProgramData frames on a producer thread, window = frames in flight (0: transport default)
+        void set_pipeline(bool enabled, int _window=0) { pipeline = enabled; window = _window; }
+        // resend a ProgramData frame up to this many times on checksum errors and timeouts
+        void set_max_retries(int _max_retries) { max_retries = _max_retries; }
+        const _program_report &get_program_report() const { return program_report; }
+        void clear_program_report() { program_report = _program_report(); }
+        // called with the confirmed payload bytes after every acknowledged ProgramData frame
+        void set_confirm_callback(std::function<void(const _program_report &)> callback) { on_confirm = callback; }
+        // called with the answer of every ProgramData frame that is sent again
+        void set_retry_callback(std::function<void(BSL::AckType, BSL::CoreMessage)> callback) { on_retry = callback; }
+        uint32_t get_link_baud() const { return link_baud; }
+        // learned response times, BSLTool keeps them per port
+        BSLRto &get_rto() { return rto; }
         
     private:
-        Serial* serial = nullptr;
+        Transport* transport = nullptr;
 
         BSL::CoreMessage receive_core_message();
+        // next response packet: scans for the header, frames it by its length and checks the CRC,
+        // BSL_ACK when rsp is valid, it points into the RX span until release_response()
+        BSL::AckType receive_response(BSL::_response_view &rsp);
+        void release_response();
+
+        // response timing, a command's reads wait for what its estimate allows; the estimate is
+        // the device's time, the len bytes sent and the rsp_len bytes of its answer are on the wire
+        void send_packet(BSL::CoreCmd cmd, size_t len, size_t rsp_len=message_rsp_len);
+        BSL::AckType await_ack(int max_timeout_tries=10);
+        void arm_timeout(BSL::CoreCmd cmd, uint64_t wire, int max_timeout_tries);
+        void rtt_done();
+        void rtt_timeout();
+        // 8N1: 10 bit times per byte
+        uint64_t wire_us(size_t bytes) const { return bytes * 10 * 1000000ULL / link_baud; }
+        static bool is_transient(BSL::AckType ack, BSL::CoreMessage msg);
+
+        // what a lost answer leaves behind: a frame the device wrote must not be written again
+        enum class FrameState { Written, Erased, Mixed };
+        // payload confirmed in the sector of the last released frame, a rewrite of that sector needs it
+        struct _sector_log {
+            uint32_t start = 0;     // range of the program_data() call
+            uint32_t end = 0;
+            uint32_t addr = 0;      // of data[0]
+            std::vector<uint8_t> data;
+        };
+        // false when the device can not be brought back to a known state
+        bool retransmit(FrameQueue &queue, _sector_log &log, int attempt);
+        bool probe(uint32_t addr, const uint8_t* data, uint32_t len, FrameState &state);
+        bool rewrite_sector(const _sector_log &log, uint32_t sector);
+        // SUCCESS, the device's refusal or BSL_UART_UNDEFINED when no valid answer came
+        BSL::CoreMessage read_flash(uint32_t addr, uint8_t* dst, uint32_t len);
+        bool program_words(uint32_t addr, const uint8_t* data, uint32_t len);
+        bool program_frame(uint32_t addr, const uint8_t* data, uint32_t len);
+        void drain_quiet(size_t in_flight);
+        void resend(FrameQueue &queue);
 
         static constexpr uint16_t MAX_PAYLOAD_SIZE = 128;
+        static constexpr size_t queue_ahead = 4;    // frames prebuilt beyond the window
+        static constexpr int frame_ack_tries = 2;   // a ProgramData ACK is due within milliseconds
+        static constexpr int retry_backoff_ms = 5;  // doubled per attempt
+        static constexpr int retry_backoff_max_ms = 200;
+        static constexpr uint32_t sector_size = 1024;  // flash erase unit, no frame crosses one
 
         // "cmd global" const stuff
         static constexpr uint8_t header_len = 3;
@@ -37,6 +121,9 @@ class BSL_UART {
         static constexpr uint8_t cmd_len = 1;
         static constexpr uint8_t addr_len = 4;
         static constexpr uint8_t password_len = 32;
+        static constexpr uint16_t max_response_len = 0x1000;   // above any BSL buffer size
+        static constexpr size_t ack_len = 1;
+        static constexpr size_t message_rsp_len = ack_len + BSL::packet_len(2);    // ACK and core message
 
         static constexpr uint8_t bootloader_default_pw[password_len] = {
             0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
@@ -46,6 +133,21 @@ class BSL_UART {
         };
 
         uint32_t bsl_max_buff_size = 0;
+        uint32_t link_baud = 9600;
+        bool pipeline = false;
+        int window = 0;
+        int max_retries = 3;
+        size_t response_len = 0;    // packet behind the last valid response view
+        BSLRto rto;
+        BSL::CoreCmd rtt_cmd = BSL::CoreCmd::Connection;
+        timespec rtt_start;
+        uint64_t rtt_wire_us = 0;
+        bool rtt_pending = false;
+        int read_tries = 10;        // tries of the armed read timeout
+        _program_report program_report;
+        std::function<void(const _program_report &)> on_confirm;
+        std::function<void(BSL::AckType, BSL::CoreMessage)> on_retry;
+        BSLStats* stats = nullptr;
 
         int verbose_level = 0;
 };
\ No newline at end of file
@@ -0,0 +1,193 @@
+/*
+ * bsl_watch.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_watch.h"
+#include "bsl_log.h"
+#include "bsl_tool.h"
+#include "bsl_timing.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int)
+{
+    stop = 1;
+}
+
+BSLWatch::BSLWatch(const _config &_cfg) : cfg(_cfg)
+{
+    size_t slash = cfg.image.rfind('/');
+    dir = (slash == std::string::npos) ? "." : (slash == 0 ? "/" : cfg.image.substr(0, slash));
+    name = (slash == std::string::npos) ? cfg.image : cfg.image.substr(slash + 1);
+}
+
+BSLWatch::~BSLWatch()
+{
+    if(inotify_fd >= 0)
+        close(inotify_fd);
+    if(tool != nullptr)
+        delete tool;
+}
+
+bool BSLWatch::read_image(std::vector<uint8_t> &data)
+{
+    int fd = open(cfg.image.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        BSLLog::printf("Can not open image %s: %s\n", cfg.image.c_str(), strerror(errno));
+        return false;
+    }
+
+    data.clear();
+    uint8_t buf[65536];
+    ssize_t n;
+    while((n = read(fd, buf, sizeof(buf))) > 0)
+        data.insert(data.end(), buf, buf + n);
+    close(fd);
+
+    if(n < 0 || data.empty()) {
+        BSLLog::printf("Can not read image %s\n", cfg.image.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool BSLWatch::open_session()
+{
+    if(session_open)
+        return true;
+
+    // a started application left the BSL, it comes back at its initial baudrate
+    tool->reset_session();
+    if(cfg.entry_method != BSL_Entry::Method::None) {
+        BSLLog::printf("Entering BSL mode\n");
+        if(!tool->enter_bsl()) {
+            BSLLog::printf("Could not enter BSL mode\n");
+            return false;
+        }
+    }
+    session_open = tool->open_session();
+    return session_open;
+}
+
+bool BSLWatch::update(const std::vector<uint8_t> &data)
+{
+    const timespec start = BSLTiming::now();
+    if(!open_session())
+        return false;
+
+    // nothing known about the device yet: it may hold the image already
+    if(device_image.empty() && tool->verify(data.data(), 0x0, data.size())) {
+        BSLLog::printf("Already up-to-date\n");
+        device_image = data;
+    } else {
+        const std::vector<uint8_t> previous = device_image;
+        // the content is unknown until the update verified
+        device_image.clear();
+        if(!tool->flash_changes(data.data(), data.size(), previous.data(), previous.size())) {
+            session_open = false;
+            return false;
+        }
+        device_image = data;
+        BSLLog::printf("Updated in %.1fs\n", BSLTiming::elapsed_us(start) / 1e6);
+    }
+
+    if(cfg.start) {
+        session_open = false;
+        if(!tool->start_application())
+            return false;
+    }
+    return true;
+}
+
+bool BSLWatch::wait_change()
+{
+    bool changed = false;
+    int timeout = -1;
+    alignas(inotify_event) char buf[4096];
+
+    while(!stop) {
+        pollfd pfd = {.fd=inotify_fd, .events=POLLIN, .revents=0};
+        int ready = poll(&pfd, 1, timeout);
+        if(ready < 0 && errno != EINTR)
+            return false;
+        if(ready == 0)
+            return changed;
+        if(ready < 0)
+            continue;
+
+        ssize_t n = read(inotify_fd, buf, sizeof(buf));
+        for(ssize_t pos = 0; pos < n; ) {
+            const inotify_event* ev = (const inotify_event*) (buf + pos);
+            if(ev->len > 0 && name == ev->name) {
+                changed = true;
+                // wait for the writes to settle
+                timeout = cfg.quiet_ms;
+            }
+            pos += sizeof(inotify_event) + ev->len;
+        }
+    }
+    return false;
+}
+
+bool BSLWatch::run()
+{
+    inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if(inotify_fd < 0 || inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MODIFY) < 0) {
+        BSLLog::printf("Error %i watching %s: %s\n", errno, dir.c_str(), strerror(errno));
+        return false;
+    }
+
+    try {
+        tool = new BSLTool(cfg.port.c_str(), cfg.entry_method, cfg.verbose_level, cfg.modem_def);
+    }
+    catch(std::exception &e) {
+        BSLLog::printf("error: %s\n", e.what());
+        return false;
+    }
+    tool->load_entry_timing(cfg.fixture);
+    tool->set_pipeline(cfg.pipeline, cfg.window);
+    tool->set_max_retries(cfg.max_retries);
+
+    // no SA_RESTART, a signal has to wake up poll()
+    struct sigaction sa = {};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    std::vector<uint8_t> data;
+    if(read_image(data) && !update(data))
+        BSLLog::printf("Update failed, the next build is flashed in full\n");
+    BSLLog::printf("Watching %s\n", cfg.image.c_str());
+    fflush(stdout);
+
+    while(wait_change()) {
+        std::vector<uint8_t> next;
+        if(!read_image(next))
+            continue;
+        // touched, not rebuilt
+        if(next == device_image) {
+            if(cfg.verbose_level > 0)
+                BSLLog::printf("%s unchanged\n", name.c_str());
+            continue;
+        }
+
+        BSLLog::printf("\n%s changed, %zu bytes\n", name.c_str(), next.size());
+        if(!update(next))
+            BSLLog::printf("Update failed, the next build is flashed in full\n");
+        fflush(stdout);
+    }
+
+    BSLLog::printf("Stopping\n");
+    return true;
+}
@@ -0,0 +1,66 @@
+/*
+ * bsl_watch.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "bsl_modem.h"
+#include <string>
+#include <vector>
+
+class BSLTool;
+
+/*
+ * Edit, build, test loop on one target: the image file is watched with
+ * inotify and every rebuild is compared to the image on the device sector by
+ * sector. Only the sectors that changed are erased and programmed, then the
+ * whole image is verified and the application started.
+ *
+ * The directory is watched rather than the file, build tools replace images
+ * by rename as often as they rewrite them. Events are collected until the
+ * file was quiet for quiet_ms, a half written image is never flashed.
+ *
+ * Without start the session stays open between builds. Otherwise each build
+ * re-enters the BSL with the entry method, entry none expects the target to
+ * be back in the BSL by itself.
+ */
+class BSLWatch {
+    public:
+        struct _config {
+            std::string port;
+            std::string image;
+            BSL_Entry::Method entry_method = BSL_Entry::Method::GPIO;
+            BSL_Modem::_modem_def modem_def = BSL_Modem::default_modem_def;
+            std::string fixture = "default";
+            bool pipeline = false;
+            int window = 0;
+            int max_retries = 3;
+            bool start = true;          // start the application after each update
+            int quiet_ms = 300;
+            int verbose_level = 0;
+        };
+
+        BSLWatch(const _config &_cfg);
+        ~BSLWatch();
+
+        // flashes the image, then every change of it until SIGINT/SIGTERM, false on setup errors
+        bool run();
+
+    private:
+        bool read_image(std::vector<uint8_t> &data);
+        // brings the device to data, false leaves its content unknown
+        bool update(const std::vector<uint8_t> &data);
+        bool open_session();
+        // true when the image file changed and then stayed quiet
+        bool wait_change();
+
+        _config cfg;
+        BSLTool* tool = nullptr;
+        std::string dir;
+        std::string name;
+        int inotify_fd = -1;
+        bool session_open = false;
+        std::vector<uint8_t> device_image;  // what the device holds, empty: unknown
+};
@@ -0,0 +1,123 @@
+/*
+ * gpio_chardev.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "gpio_chardev.h"
+#include "bsl_log.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+GPIOLine::GPIOLine(uint8_t _chip, uint32_t _offset, int _verbose_level) : chip(_chip), offset(_offset), verbose_level(_verbose_level)
+{
+
+}
+
+GPIOLine::~GPIOLine()
+{
+    release();
+}
+
+GPIOLine::GPIOLine(GPIOLine &&other) noexcept : chip(other.chip), offset(other.offset), line_fd(other.line_fd), verbose_level(other.verbose_level)
+{
+    other.line_fd = -1;
+}
+
+GPIOLine &GPIOLine::operator=(GPIOLine &&other) noexcept
+{
+    if(this != &other) {
+        release();
+        chip = other.chip;
+        offset = other.offset;
+        line_fd = other.line_fd;
+        verbose_level = other.verbose_level;
+        other.line_fd = -1;
+    }
+    return *this;
+}
+
+bool GPIOLine::request(bool initial_level)
+{
+    release();
+
+    char chip_path[32];
+    snprintf(chip_path, sizeof(chip_path), chip_path_fmt, chip);
+
+    int chip_fd = open(chip_path, O_RDWR | O_CLOEXEC);
+    if(chip_fd < 0) {
+        if(verbose_level > 0) {
+            BSLLog::printf("Error %i opening %s: %s\n", errno, chip_path, strerror(errno));
+        }
+        return false;
+    }
+
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = offset;
+    req.num_lines = 1;
+    strncpy(req.consumer, consumer, sizeof(req.consumer)-1);
+    req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    // drive the requested level right away, no glitch to the default value
+    req.config.num_attrs = 1;
+    req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    req.config.attrs[0].attr.values = initial_level ? 1 : 0;
+    req.config.attrs[0].mask = 1;
+
+    int status = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    int err = errno;
+    close(chip_fd);
+
+    if(status < 0) {
+        if(verbose_level > 0) {
+            BSLLog::printf("Error %i requesting line %s:%d: %s\n", err, chip_path, offset, strerror(err));
+        }
+        return false;
+    }
+
+    line_fd = req.fd;
+
+    // debug printfs
+    if(verbose_level > 2) {
+        BSLLog::printf("gpio chardev %s %d=%d (requested)\n", chip_path, offset, (initial_level ? 1 : 0));
+    }
+
+    return true;
+}
+
+bool GPIOLine::set(bool level)
+{
+    if(line_fd < 0) {
+        return request(level);
+    }
+
+    struct gpio_v2_line_values values;
+    values.bits = level ? 1 : 0;
+    values.mask = 1;
+
+    if(ioctl(line_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0) {
+        BSLLog::printf("Error %i setting line %d:%d: %s\n", errno, chip, offset, strerror(errno));
+        return false;
+    }
+
+    // debug printfs
+    if(verbose_level > 2) {
+        BSLLog::printf("gpio chardev %d %d=%d\n", chip, offset, (level ? 1 : 0));
+    }
+
+    return true;
+}
+
+void GPIOLine::release()
+{
+    if(line_fd >= 0) {
+        close(line_fd);
+        line_fd = -1;
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * gpio_chardev.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+
+/*
+ * Single output line requested through the GPIO character device (uAPI v2).
+ * The line request is held open until release() or destruction, so toggling
+ * the pin is a single ioctl instead of a gpioset process.
+ */
+class GPIOLine {
+    public:
+        GPIOLine(uint8_t _chip, uint32_t _offset, int _verbose_level=0);
+        ~GPIOLine();
+        // the line request has one owner, a copy would release it twice
+        GPIOLine(const GPIOLine &) = delete;
+        GPIOLine &operator=(const GPIOLine &) = delete;
+        GPIOLine(GPIOLine &&other) noexcept;
+        GPIOLine &operator=(GPIOLine &&other) noexcept;
+        bool request(bool initial_level);
+        bool set(bool level);
+        void release();
+        bool is_requested() const { return line_fd >= 0; }
+
+        // works with /dev/gpiochipN of real hardware as well as gpio-sim/gpio-mockup
+        static constexpr const char* chip_path_fmt = "/dev/gpiochip%d";
+        static constexpr const char* consumer = "MSPM0_bsl_flasher";
+
+    private:
+        uint8_t chip;
+        uint32_t offset;
+        int line_fd = -1;
+
+        int verbose_level = 0;
+};
@@ -0,0 +1,266 @@
+/*
+ * mspm0_bsl.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "mspm0_bsl.h"
+#include "bsl_tool.h"
+#include "bsl_log.h"
+
+struct mspm0_bsl_session {
+    BSLTool* tool = nullptr;
+    mspm0_bsl_entry entry = MSPM0_BSL_ENTRY_NONE;
+
+    mspm0_bsl_event_cb event_cb = nullptr;
+    mspm0_bsl_progress_cb progress_cb = nullptr;
+    void* user = nullptr;
+    std::string line;           // output up to the next newline
+};
+
+// hands the drivers' output to the event callback line by line while a call runs
+class SessionOutput {
+    public:
+        SessionOutput(mspm0_bsl_session* _session) :
+            session(_session), redirect(_session->event_cb ? BSLLog::_sink([this](const char* text) { append(text); }) : BSLLog::_sink()) {}
+        ~SessionOutput()
+        {
+            if(!session->line.empty())
+                emit();
+        }
+
+    private:
+        void append(const char* text)
+        {
+            for(; *text; text++) {
+                if(*text == '\n')
+                    emit();
+                else
+                    session->line += *text;
+            }
+        }
+
+        void emit()
+        {
+            session->event_cb(session->user, MSPM0_BSL_EVENT_LOG, session->line.c_str());
+            session->line.clear();
+        }
+
+        mspm0_bsl_session* session;
+        BSLLog::Redirect redirect;
+};
+
+static void fill_result(mspm0_bsl_session* session, uint32_t size, uint32_t crc, mspm0_bsl_result* result)
+{
+    if(result == nullptr)
+        return;
+
+    BSLTool* tool = session->tool;
+    const auto &report = tool->get_program_report();
+    const auto &info = tool->last_device_info();
+    auto histograms = tool->get_stats().histograms();
+    auto total = histograms.find("flash_total");
+
+    *result = mspm0_bsl_result();
+    result->programmed = tool->is_programmed();
+    result->verified = tool->is_verified();
+    result->started = tool->is_started();
+    result->up_to_date = tool->is_verified() && !tool->is_programmed();
+    result->image_size = size;
+    result->image_crc = crc;
+    result->frames = report.frames;
+    result->retries = report.retries;
+    result->program_us = report.elapsed_us;
+    result->total_us = total != histograms.end() ? total->second.sum_us : 0;
+    result->bsl_build_id = info.build_id;
+    result->app_version = info.app_version;
+}
+
+static mspm0_bsl_status enter(mspm0_bsl_session* session)
+{
+    session->tool->reset_session();
+    if(session->entry == MSPM0_BSL_ENTRY_NONE)
+        return MSPM0_BSL_OK;
+    return session->tool->enter_bsl() ? MSPM0_BSL_OK : MSPM0_BSL_ERR_ENTRY;
+}
+
+// which step of a failed flash or verify gave up
+static mspm0_bsl_status failure(const BSLTool* tool)
+{
+    if(!tool->is_connected() || !tool->is_unlocked())
+        return MSPM0_BSL_ERR_SESSION;
+    if(tool->is_programmed() && !tool->is_verified())
+        return MSPM0_BSL_ERR_VERIFY;
+    return MSPM0_BSL_ERR_FLASH;
+}
+
+extern "C" {
+
+void mspm0_bsl_config_init(mspm0_bsl_config* config)
+{
+    if(config == nullptr)
+        return;
+    *config = mspm0_bsl_config();
+    config->entry = MSPM0_BSL_ENTRY_GPIO;
+    config->max_retries = 3;
+    config->resume = 1;
+}
+
+mspm0_bsl_session* mspm0_bsl_open(const mspm0_bsl_config* config, mspm0_bsl_status* status)
+{
+    mspm0_bsl_status dummy;
+    if(status == nullptr)
+        status = &dummy;
+
+    if(config == nullptr || config->port == nullptr) {
+        *status = MSPM0_BSL_ERR_ARGUMENT;
+        return nullptr;
+    }
+
+    BSL_Entry::Method method = BSL_Entry::Method::None;
+    if(config->entry == MSPM0_BSL_ENTRY_GPIO)
+        method = BSL_Entry::Method::GPIO;
+    else if(config->entry == MSPM0_BSL_ENTRY_MODEM)
+        method = BSL_Entry::Method::Modem;
+
+    auto session = new mspm0_bsl_session();
+    session->entry = config->entry;
+    try {
+        session->tool = new BSLTool(config->port, method, config->verbose);
+    }
+    catch(std::exception &e) {
+        BSLLog::printf("error: %s\n", e.what());
+        delete session;
+        *status = MSPM0_BSL_ERR_OPEN;
+        return nullptr;
+    }
+
+    session->tool->load_entry_timing(config->fixture != nullptr ? config->fixture : "default");
+    session->tool->set_pipeline(config->pipeline, config->window);
+    session->tool->set_max_retries(config->max_retries);
+    session->tool->set_resume(config->resume);
+
+    *status = MSPM0_BSL_OK;
+    return session;
+}
+
+void mspm0_bsl_close(mspm0_bsl_session* session)
+{
+    if(session == nullptr)
+        return;
+    delete session->tool;
+    delete session;
+}
+
+void mspm0_bsl_set_callbacks(mspm0_bsl_session* session, mspm0_bsl_event_cb event_cb, mspm0_bsl_progress_cb progress_cb, void* user)
+{
+    if(session == nullptr)
+        return;
+
+    session->event_cb = event_cb;
+    session->progress_cb = progress_cb;
+    session->user = user;
+
+    if(event_cb != nullptr)
+        session->tool->set_phase_callback([session](const char* name) { session->event_cb(session->user, MSPM0_BSL_EVENT_PHASE, name); });
+    else
+        session->tool->set_phase_callback(nullptr);
+
+    if(progress_cb != nullptr)
+        session->tool->set_progress_callback([session](const BSLTool::_progress &p) { session->progress_cb(session->user, p.done, p.total); });
+    else
+        session->tool->set_progress_callback(nullptr);
+}
+
+mspm0_bsl_status mspm0_bsl_flash(mspm0_bsl_session* session, const uint8_t* image, uint32_t size, int force, mspm0_bsl_result* result)
+{
+    if(session == nullptr || image == nullptr || size == 0)
+        return MSPM0_BSL_ERR_ARGUMENT;
+
+    SessionOutput output(session);
+    const uint32_t crc = BSL::softwareCRC(image, size);
+    mspm0_bsl_status status = enter(session);
+    if(status == MSPM0_BSL_OK && !session->tool->flash_image(image, size, crc, force))
+        status = failure(session->tool);
+
+    fill_result(session, size, crc, result);
+    return status;
+}
+
+mspm0_bsl_status mspm0_bsl_flash_file(mspm0_bsl_session* session, const char* path, int force, mspm0_bsl_result* result)
+{
+    if(session == nullptr || path == nullptr)
+        return MSPM0_BSL_ERR_ARGUMENT;
+
+    SessionOutput output(session);
+    uint32_t size = 0;
+    if(!session->tool->open_file(path, size) || size == 0) {
+        BSLLog::printf("Error reading file %s\n", path);
+        return MSPM0_BSL_ERR_IMAGE;
+    }
+    const uint32_t crc = session->tool->file_crc();
+
+    // streamed from the file, frame by frame
+    mspm0_bsl_status status = enter(session);
+    if(status == MSPM0_BSL_OK && !session->tool->flash_file(force))
+        status = failure(session->tool);
+
+    fill_result(session, size, crc, result);
+    return status;
+}
+
+mspm0_bsl_status mspm0_bsl_verify(mspm0_bsl_session* session, const uint8_t* image, uint32_t size, mspm0_bsl_result* result)
+{
+    if(session == nullptr || image == nullptr || size == 0)
+        return MSPM0_BSL_ERR_ARGUMENT;
+
+    SessionOutput output(session);
+    mspm0_bsl_status status = enter(session);
+    if(status == MSPM0_BSL_OK && !session->tool->verify_image(image, size))
+        status = session->tool->is_unlocked() ? MSPM0_BSL_ERR_VERIFY : MSPM0_BSL_ERR_SESSION;
+
+    fill_result(session, size, BSL::softwareCRC(image, size), result);
+    return status;
+}
+
+mspm0_bsl_status mspm0_bsl_dump(mspm0_bsl_session* session, uint32_t addr, uint32_t size, uint8_t* dst)
+{
+    if(session == nullptr || dst == nullptr)
+        return MSPM0_BSL_ERR_ARGUMENT;
+
+    SessionOutput output(session);
+    mspm0_bsl_status status = enter(session);
+    if(status == MSPM0_BSL_OK && !session->tool->dump_memory(addr, size, dst))
+        status = session->tool->is_unlocked() ? MSPM0_BSL_ERR_READ : MSPM0_BSL_ERR_SESSION;
+
+    return status;
+}
+
+const char* mspm0_bsl_status_string(mspm0_bsl_status status)
+{
+    switch(status) {
+    case MSPM0_BSL_OK:
+        return "ok";
+    case MSPM0_BSL_ERR_ARGUMENT:
+        return "invalid argument";
+    case MSPM0_BSL_ERR_OPEN:
+        return "could not open port";
+    case MSPM0_BSL_ERR_ENTRY:
+        return "BSL entry failed";
+    case MSPM0_BSL_ERR_SESSION:
+        return "BSL session failed";
+    case MSPM0_BSL_ERR_IMAGE:
+        return "image not readable";
+    case MSPM0_BSL_ERR_FLASH:
+        return "flashing failed";
+    case MSPM0_BSL_ERR_VERIFY:
+        return "verification failed";
+    case MSPM0_BSL_ERR_READ:
+        return "memory read failed";
+    default:
+        return "unknown";
+    }
+}
+
+}
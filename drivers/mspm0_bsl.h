@@ -0,0 +1,99 @@
+/*
+ * mspm0_bsl.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * C API of the MSPM0 BSL flasher library, for test executives that flash
+ * in process instead of running the CLI and reading its output.
+ *
+ * A session owns one port. Calls on one session must not overlap, separate
+ * sessions may run in parallel threads. Callbacks run on the calling thread.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MSPM0_BSL_API_VERSION 1
+
+typedef struct mspm0_bsl_session mspm0_bsl_session;
+
+typedef enum {
+    MSPM0_BSL_OK = 0,
+    MSPM0_BSL_ERR_ARGUMENT,     /* invalid argument or NULL session */
+    MSPM0_BSL_ERR_OPEN,         /* port or entry lines could not be opened */
+    MSPM0_BSL_ERR_ENTRY,        /* BSL entry sequence failed */
+    MSPM0_BSL_ERR_SESSION,      /* connect, baudrate change, device info or unlock failed */
+    MSPM0_BSL_ERR_IMAGE,        /* image file could not be read */
+    MSPM0_BSL_ERR_FLASH,        /* erase, program, verify or start failed */
+    MSPM0_BSL_ERR_VERIFY,       /* device CRC differs from the image */
+    MSPM0_BSL_ERR_READ          /* memory read rejected, e.g. by the BCR configuration */
+} mspm0_bsl_status;
+
+typedef enum {
+    MSPM0_BSL_ENTRY_NONE = 0,   /* target already in BSL mode */
+    MSPM0_BSL_ENTRY_GPIO,       /* host GPIOs from the build configuration */
+    MSPM0_BSL_ENTRY_MODEM       /* DTR drives reset, RTS drives BSL invoke */
+} mspm0_bsl_entry;
+
+typedef enum {
+    MSPM0_BSL_EVENT_LOG = 0,    /* text: one line of output, without the newline */
+    MSPM0_BSL_EVENT_PHASE       /* text: step that starts, e.g. "connect", "program", "verify" */
+} mspm0_bsl_event;
+
+typedef void (*mspm0_bsl_event_cb)(void* user, mspm0_bsl_event event, const char* text);
+typedef void (*mspm0_bsl_progress_cb)(void* user, uint32_t done, uint32_t total);
+
+typedef struct {
+    const char* port;           /* serial device, tcp://host:port or rfc2217://host:port */
+    mspm0_bsl_entry entry;
+    const char* fixture;        /* calibrated entry timing, NULL: "default" */
+    int verbose;                /* 0-3 */
+    int pipeline;               /* prebuild program frames */
+    int window;                 /* program frames in flight, 0: link default */
+    int max_retries;            /* per program frame */
+    int resume;                 /* continue interrupted flashes from the port's journal */
+} mspm0_bsl_config;
+
+typedef struct {
+    int programmed;
+    int verified;
+    int started;
+    int up_to_date;             /* image was already on the device, nothing programmed */
+    uint32_t image_size;
+    uint32_t image_crc;
+    uint32_t frames;            /* program frames acknowledged */
+    uint32_t retries;           /* program frames sent again */
+    uint64_t program_us;
+    uint64_t total_us;
+    uint16_t bsl_build_id;
+    uint32_t app_version;
+} mspm0_bsl_result;
+
+/* defaults of the CLI: GPIO entry, 3 retries, resume on */
+void mspm0_bsl_config_init(mspm0_bsl_config* config);
+
+mspm0_bsl_session* mspm0_bsl_open(const mspm0_bsl_config* config, mspm0_bsl_status* status);
+void mspm0_bsl_close(mspm0_bsl_session* session);
+
+/* either callback may be NULL, without an event callback the output goes to stdout */
+void mspm0_bsl_set_callbacks(mspm0_bsl_session* session, mspm0_bsl_event_cb event_cb, mspm0_bsl_progress_cb progress_cb, void* user);
+
+/* enter BSL, program the image at 0x0 unless force is 0 and it is already there, verify and start it */
+mspm0_bsl_status mspm0_bsl_flash(mspm0_bsl_session* session, const uint8_t* image, uint32_t size, int force, mspm0_bsl_result* result);
+mspm0_bsl_status mspm0_bsl_flash_file(mspm0_bsl_session* session, const char* path, int force, mspm0_bsl_result* result);
+/* enter BSL and compare the device CRC over size bytes at 0x0 with the image */
+mspm0_bsl_status mspm0_bsl_verify(mspm0_bsl_session* session, const uint8_t* image, uint32_t size, mspm0_bsl_result* result);
+/* enter BSL and read size bytes at addr */
+mspm0_bsl_status mspm0_bsl_dump(mspm0_bsl_session* session, uint32_t addr, uint32_t size, uint8_t* dst);
+
+const char* mspm0_bsl_status_string(mspm0_bsl_status status);
+
+#ifdef __cplusplus
+}
+#endif
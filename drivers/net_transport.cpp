@@ -0,0 +1,342 @@
+/*
+ * net_transport.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "net_transport.h"
+#include "bsl_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static uint32_t speed_to_baud(speed_t speed)
+{
+    switch(speed) {
+    case B4800: return 4800;
+    case B9600: return 9600;
+    case B19200: return 19200;
+    case B38400: return 38400;
+    case B57600: return 57600;
+    case B115200: return 115200;
+    case B1000000: return 1000000;
+    case B2000000: return 2000000;
+    case B3000000: return 3000000;
+    default: return 0;
+    }
+}
+
+bool NetTransport::is_url(const char* path)
+{
+    return strncmp(path, "tcp://", 6) == 0 || strncmp(path, "rfc2217://", 10) == 0;
+}
+
+NetTransport::NetTransport(const char* url, int _verbose_level, int _window) : Transport(_verbose_level), window(_window)
+{
+    std::string s(url);
+    size_t start = s.find("://");
+    rfc2217 = s.compare(0, start, "rfc2217") == 0;
+    s = s.substr(start + 3);
+
+    // host:port, [v6]:port
+    size_t colon = s.rfind(':');
+    if(colon != std::string::npos) {
+        host = s.substr(0, colon);
+        service = s.substr(colon + 1);
+    } else {
+        host = s;
+    }
+    if(host.size() > 1 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+}
+
+NetTransport::~NetTransport()
+{
+    _close();
+}
+
+bool NetTransport::_open(speed_t __speed)
+{
+    if(service.empty()) {
+        BSLLog::printf("Missing port in %s://%s\n", rfc2217 ? "rfc2217" : "tcp", host.c_str());
+        return false;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    int err = getaddrinfo(host.c_str(), service.c_str(), &hints, &res);
+    if(err != 0) {
+        BSLLog::printf("Error resolving %s: %s\n", host.c_str(), gai_strerror(err));
+        return false;
+    }
+
+    for(addrinfo* ai = res; ai != nullptr; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if(sock < 0)
+            continue;
+        if(connect(sock, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(res);
+
+    if(sock < 0) {
+        BSLLog::printf("Error %i connecting to %s:%s: %s\n", errno, host.c_str(), service.c_str(), strerror(errno));
+        return false;
+    }
+
+    // frames are small and latency bound
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if(rfc2217) {
+        const uint8_t data_size = 8, parity_none = 1, stop_one = 1;
+        bool ok = send_option(WILL, OPT_BINARY) && send_option(DO, OPT_BINARY) &&
+            send_option(WILL, OPT_SGA) && send_option(DO, OPT_SGA) &&
+            send_option(WILL, OPT_COM_PORT) &&
+            send_com_port(CPO_SET_DATASIZE, &data_size, 1) &&
+            send_com_port(CPO_SET_PARITY, &parity_none, 1) &&
+            send_com_port(CPO_SET_STOPSIZE, &stop_one, 1) &&
+            set_baud(__speed);
+        if(!ok) {
+            _close();
+            return false;
+        }
+    }
+
+    if(verbose_level > 0) {
+        BSLLog::printf("Connected to %s:%s (%s)\n", host.c_str(), service.c_str(), rfc2217 ? "rfc2217" : "raw tcp");
+    }
+
+    return true;
+}
+
+int NetTransport::_close()
+{
+    if(sock < 0)
+        return -1;
+
+    int ret = close(sock);
+    sock = -1;
+    return ret;
+}
+
+bool NetTransport::send_all(const uint8_t* data, size_t len)
+{
+    while(len > 0) {
+        ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+        if(n < 0) {
+            if(errno == EINTR)
+                continue;
+            BSLLog::printf("Error %i from send: %s\n", errno, strerror(errno));
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool NetTransport::send_option(uint8_t verb, uint8_t option)
+{
+    const uint8_t cmd[3] = {IAC, verb, option};
+    return send_all(cmd, sizeof(cmd));
+}
+
+bool NetTransport::send_com_port(uint8_t cmd, const uint8_t* value, size_t len)
+{
+    std::vector<uint8_t> sb = {IAC, SB, OPT_COM_PORT, cmd};
+    for(size_t i = 0; i < len; i++) {
+        sb.push_back(value[i]);
+        if(value[i] == IAC)
+            sb.push_back(IAC);
+    }
+    sb.push_back(IAC);
+    sb.push_back(SE);
+    return send_all(sb.data(), sb.size());
+}
+
+bool NetTransport::set_baud(speed_t __speed)
+{
+    // raw TCP has no way to reach the remote line settings
+    if(!rfc2217)
+        return true;
+
+    uint32_t baud = speed_to_baud(__speed);
+    if(baud == 0)
+        return false;
+
+    const uint8_t value[4] = {(uint8_t) (baud >> 24), (uint8_t) (baud >> 16), (uint8_t) (baud >> 8), (uint8_t) baud};
+    if(verbose_level > 1) {
+        BSLLog::printf("Remote baudrate %u\n", baud);
+    }
+    return send_com_port(CPO_SET_BAUDRATE, value, sizeof(value));
+}
+
+bool NetTransport::set_modem_line(int line, bool asserted)
+{
+    if(!rfc2217 || sock < 0)
+        return false;
+
+    uint8_t value;
+    if(line == TIOCM_DTR)
+        value = asserted ? 8 : 9;
+    else if(line == TIOCM_RTS)
+        value = asserted ? 11 : 12;
+    else
+        return false;
+
+    return send_com_port(CPO_SET_CONTROL, &value, 1);
+}
+
+void NetTransport::_flush()
+{
+    drop_staged();
+    if(sock < 0)
+        return;
+
+    // drop whatever already arrived, then ask the server to purge its buffers
+    uint8_t junk[256];
+    while(recv(sock, junk, sizeof(junk), MSG_DONTWAIT) > 0) {
+    }
+    state = TelnetState::Data;
+
+    if(rfc2217) {
+        const uint8_t both = 3;
+        send_com_port(CPO_PURGE_DATA, &both, 1);
+    }
+}
+
+size_t NetTransport::decode_telnet(const uint8_t* in, size_t len, uint8_t* out)
+{
+    size_t n = 0;
+    for(size_t i = 0; i < len; i++) {
+        const uint8_t c = in[i];
+        switch(state) {
+        case TelnetState::Data:
+            if(c == IAC)
+                state = TelnetState::Iac;
+            else
+                out[n++] = c;
+            break;
+        case TelnetState::Iac:
+            if(c == IAC) {
+                out[n++] = IAC;
+                state = TelnetState::Data;
+            } else if(c == SB) {
+                state = TelnetState::Sub;
+            } else if(c >= WILL && c <= DONT) {
+                verb = c;
+                state = TelnetState::Option;
+            } else {
+                state = TelnetState::Data;
+            }
+            break;
+        case TelnetState::Option: {
+            // refuse everything we did not ask for, answers to our own requests are ignored
+            const bool ours = (c == OPT_BINARY) || (c == OPT_SGA) || (c == OPT_COM_PORT && verb == DO);
+            if(!ours && verb == DO)
+                send_option(WONT, c);
+            else if(!ours && verb == WILL)
+                send_option(DONT, c);
+            state = TelnetState::Data;
+            break;
+        }
+        case TelnetState::Sub:
+            // COM-PORT-OPTION notifications and acks carry nothing we act on
+            if(c == IAC)
+                state = TelnetState::SubIac;
+            break;
+        case TelnetState::SubIac:
+            state = (c == SE) ? TelnetState::Data : TelnetState::Sub;
+            break;
+        }
+    }
+    return n;
+}
+
+int NetTransport::writeBytes(const char buff[], size_t buf_size)
+{
+    if(sock < 0)
+        return -1;
+
+    BSLStats::Scope timer(stats, "serial_write");
+
+    const uint8_t* data = (const uint8_t*) buff;
+    bool ok;
+    if(rfc2217 && memchr(buff, IAC, buf_size) != nullptr) {
+        // 0xFF is doubled on a telnet link
+        tx_escaped.clear();
+        for(size_t i = 0; i < buf_size; i++) {
+            tx_escaped.push_back(data[i]);
+            if(data[i] == IAC)
+                tx_escaped.push_back(IAC);
+        }
+        ok = send_all(tx_escaped.data(), tx_escaped.size());
+    } else {
+        ok = send_all(data, buf_size);
+    }
+
+    if(!ok)
+        return -1;
+
+    if(trace != nullptr) {
+        trace->record(WireTrace::Direction::TX, data, buf_size);
+    }
+    return buf_size;
+}
+
+int NetTransport::readBytes(char buff[], size_t buf_size, int _max_timeout_tries)
+{
+    if(sock < 0)
+        return -1;
+
+    BSLStats::Scope timer(stats, "serial_read");
+    int timeout_tries = _max_timeout_tries;
+    size_t bytes_read = 0;
+    uint8_t raw[512];
+
+    while(bytes_read != buf_size) {
+        pollfd pfd = {.fd=sock, .events=POLLIN, .revents=0};
+        int ready = poll(&pfd, 1, read_timeout_ms);
+        if(ready < 0 && errno == EINTR)
+            continue;
+        if(ready <= 0) {
+            if(--timeout_tries == 0)
+                return -1;
+            continue;
+        }
+
+        // never read more raw bytes than still fit after decoding
+        ssize_t n = recv(sock, raw, std::min(sizeof(raw), buf_size - bytes_read), 0);
+        if(n <= 0) {
+            BSLLog::printf("Connection to %s:%s closed\n", host.c_str(), service.c_str());
+            _close();
+            return -1;
+        }
+
+        size_t decoded = rfc2217 ? decode_telnet(raw, n, (uint8_t*) buff + bytes_read) : n;
+        if(!rfc2217)
+            memcpy(buff + bytes_read, raw, n);
+
+        if(trace != nullptr && decoded > 0) {
+            trace->record(WireTrace::Direction::RX, (const uint8_t*) buff + bytes_read, decoded);
+        }
+        bytes_read += decoded;
+        timeout_tries = _max_timeout_tries;
+    }
+
+    return bytes_read;
+}
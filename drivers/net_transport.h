@@ -0,0 +1,77 @@
+/*
+ * net_transport.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "transport.h"
+#include <string>
+
+/*
+ * Remote serial port behind a ser2net style server.
+ *
+ *   tcp://host:port       raw TCP, the server owns the line settings
+ *   rfc2217://host:port   telnet COM-PORT-OPTION, baudrate and DTR/RTS are
+ *                         set on the remote port
+ *
+ * Nagle is off so single frames are not held back. Every ACK costs a network
+ * round trip, preferred_window() tells BSL_UART how many frames it may keep
+ * queued in the socket to overlap that with the device's processing.
+ */
+class NetTransport : public Transport {
+    public:
+        static constexpr int default_window = 4;
+
+        NetTransport(const char* url, int _verbose_level=0, int _window=default_window);
+        ~NetTransport();
+
+        bool _open(speed_t __speed = B9600) override;
+        int _close() override;
+        void _flush() override;
+        bool set_baud(speed_t __speed) override;
+        bool set_modem_line(int line, bool asserted) override;
+        int readBytes(char buff[], size_t buf_size, int _max_timeout_tries=10) override;
+        int writeBytes(const char buff[], size_t buf_size) override;
+        int preferred_window() const override { return window; }
+
+        static bool is_url(const char* path);
+
+    private:
+        // telnet / RFC2217 codes
+        static constexpr uint8_t IAC = 255;
+        static constexpr uint8_t DONT = 254;
+        static constexpr uint8_t DO = 253;
+        static constexpr uint8_t WONT = 252;
+        static constexpr uint8_t WILL = 251;
+        static constexpr uint8_t SB = 250;
+        static constexpr uint8_t SE = 240;
+        static constexpr uint8_t OPT_BINARY = 0;
+        static constexpr uint8_t OPT_SGA = 3;
+        static constexpr uint8_t OPT_COM_PORT = 44;
+        static constexpr uint8_t CPO_SET_BAUDRATE = 1;
+        static constexpr uint8_t CPO_SET_DATASIZE = 2;
+        static constexpr uint8_t CPO_SET_PARITY = 3;
+        static constexpr uint8_t CPO_SET_STOPSIZE = 4;
+        static constexpr uint8_t CPO_SET_CONTROL = 5;
+        static constexpr uint8_t CPO_PURGE_DATA = 12;
+
+        bool send_all(const uint8_t* data, size_t len);
+        bool send_option(uint8_t verb, uint8_t option);
+        bool send_com_port(uint8_t cmd, const uint8_t* value, size_t len);
+        size_t decode_telnet(const uint8_t* in, size_t len, uint8_t* out);
+
+        std::string host;
+        std::string service;
+        bool rfc2217 = false;
+        int sock = -1;
+        int window;
+
+        // telnet parser state, commands may be split across reads
+        enum class TelnetState {
+            Data, Iac, Option, Sub, SubIac
+        } state = TelnetState::Data;
+        uint8_t verb = 0;
+        std::vector<uint8_t> tx_escaped;
+};
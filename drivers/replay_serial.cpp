@@ -0,0 +1,155 @@
+/*
+ * replay_serial.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "replay_serial.h"
+#include "bsl_log.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+ReplaySerial::ReplaySerial(const char* trace_path, Timing _timing, int _verbose_level) : Transport(_verbose_level), path(trace_path), timing(_timing)
+{
+
+}
+
+bool ReplaySerial::_open(speed_t)
+{
+    std::vector<WireTrace::_record> records;
+    if(!WireTrace::read_file(path, records)) {
+        BSLLog::printf("Error reading replay trace %s\n", path);
+        return false;
+    }
+
+    expected_tx.clear();
+    rx_chunks.clear();
+    if(records.empty())
+        return true;
+
+    // one session per replay, the first port in the file
+    const uint16_t port_id = records[0].port_id;
+    uint64_t last_tx_ns = records[0].t_ns;
+
+    for(auto &rec : records) {
+        if(rec.port_id != port_id)
+            continue;
+
+        if(rec.direction == WireTrace::Direction::TX) {
+            expected_tx.insert(expected_tx.end(), rec.data.begin(), rec.data.end());
+            last_tx_ns = rec.t_ns;
+        } else {
+            _chunk chunk;
+            chunk.tx_before = expected_tx.size();
+            chunk.delay_ns = rec.t_ns > last_tx_ns ? rec.t_ns - last_tx_ns : 0;
+            chunk.data = std::move(rec.data);
+            rx_chunks.push_back(std::move(chunk));
+        }
+    }
+
+    loaded = true;
+    release_chunks();
+
+    if(verbose_level > 0) {
+        BSLLog::printf("Replaying %s: %zu TX bytes, %zu RX chunks, %s timing\n", path, expected_tx.size(), rx_chunks.size(),
+            timing == Timing::Original ? "original" : "fast");
+    }
+
+    return true;
+}
+
+void ReplaySerial::release_chunks()
+{
+    // anchor chunks at the write that made them due
+    const timespec t = BSLTiming::now();
+    for(size_t i = rx_index; i < rx_chunks.size() && rx_chunks[i].tx_before <= tx_pos; i++) {
+        auto &chunk = rx_chunks[i];
+        if(chunk.released)
+            continue;
+        chunk.released = true;
+        chunk.release_at = t;
+        BSLTiming::add_us(chunk.release_at, chunk.delay_ns / 1000);
+    }
+}
+
+int ReplaySerial::writeBytes(const char buff[], size_t buf_size)
+{
+    if (!loaded)
+        return -1;
+
+    BSLStats::Scope timer(stats, "serial_write");
+
+    for(size_t i = 0; i < buf_size; i++, tx_pos++) {
+        if(tx_pos < expected_tx.size() && expected_tx[tx_pos] == (uint8_t) buff[i])
+            continue;
+        if(tx_mismatches++ == 0) {
+            first_mismatch = tx_pos;
+            if(verbose_level > 0)
+                BSLLog::printf("Replay: TX diverges at byte %lu\n", tx_pos);
+        }
+    }
+
+    if(trace != nullptr && buf_size > 0) {
+        trace->record(WireTrace::Direction::TX, (const uint8_t*) buff, buf_size);
+    }
+
+    release_chunks();
+    return buf_size;
+}
+
+int ReplaySerial::readBytes(char buff[], size_t buf_size, int)
+{
+    if (!loaded)
+        return -1;
+
+    BSLStats::Scope timer(stats, "serial_read");
+    size_t bytes_read = 0;
+
+    while(bytes_read != buf_size) {
+        if(rx_index >= rx_chunks.size() || !rx_chunks[rx_index].released) {
+            // the recording has nothing more for this point of the exchange, a timeout on the real line
+            rx_missing += buf_size - bytes_read;
+            if(verbose_level > 0)
+                BSLLog::printf("Replay: no recorded response for %zu bytes\n", buf_size - bytes_read);
+            return -1;
+        }
+
+        auto &chunk = rx_chunks[rx_index];
+        if(timing == Timing::Original)
+            BSLTiming::sleep_until(chunk.release_at);
+
+        size_t n = std::min(buf_size - bytes_read, chunk.data.size() - rx_offset);
+        memcpy(buff + bytes_read, &chunk.data[rx_offset], n);
+        if(trace != nullptr) {
+            trace->record(WireTrace::Direction::RX, (const uint8_t*) buff + bytes_read, n);
+        }
+        bytes_read += n;
+        rx_offset += n;
+        rx_served += n;
+
+        if(rx_offset == chunk.data.size()) {
+            rx_index++;
+            rx_offset = 0;
+        }
+    }
+
+    return bytes_read;
+}
+
+bool ReplaySerial::diverged() const
+{
+    return tx_mismatches != 0 || tx_pos != expected_tx.size() || rx_missing != 0;
+}
+
+void ReplaySerial::print_summary() const
+{
+    BSLLog::printf("Replay: %lu of %zu TX bytes sent, %lu mismatching", tx_pos, expected_tx.size(), tx_mismatches);
+    if(tx_mismatches != 0)
+        BSLLog::printf(" (first at byte %lu)", first_mismatch);
+    BSLLog::printf(", %lu RX bytes served", rx_served);
+    if(rx_missing != 0)
+        BSLLog::printf(", %lu RX bytes missing", rx_missing);
+    BSLLog::printf("\n");
+}
@@ -0,0 +1,68 @@
+/*
+ * replay_serial.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "transport.h"
+#include "bsl_timing.h"
+#include <vector>
+
+/*
+ * Plays the device side of a recorded wire trace back to BSL_UART.
+ *
+ * RX chunks are released once the host has written as many bytes as it had
+ * when the chunk arrived in the recording. With original timing a chunk is
+ * held back by its recorded delay after the write that released it, fast
+ * timing hands it out immediately.
+ *
+ * Every written byte is compared against the recorded TX stream, so a host
+ * side change that alters the bytes on the wire shows up as a divergence.
+ */
+class ReplaySerial : public Transport {
+    public:
+        enum class Timing {
+            Fast,
+            Original
+        };
+
+        ReplaySerial(const char* trace_path, Timing _timing=Timing::Fast, int _verbose_level=0);
+
+        bool _open(speed_t = B9600) override;
+        int _close() override { return 0; }
+        void _flush() override { drop_staged(); }
+        bool set_baud(speed_t) override { return true; }
+        bool set_modem_line(int, bool) override { return true; }
+        int readBytes(char buff[], size_t buf_size, int _max_timeout_tries=10) override;
+        int writeBytes(const char buff[], size_t buf_size) override;
+
+        bool diverged() const;
+        void print_summary() const;
+
+    private:
+        struct _chunk {
+            uint64_t tx_before;         // host bytes written before the chunk arrived
+            uint64_t delay_ns;          // arrival after the last preceding TX chunk
+            std::vector<uint8_t> data;
+            bool released = false;
+            timespec release_at = {};
+        };
+
+        void release_chunks();
+
+        const char* path;
+        Timing timing;
+        bool loaded = false;
+        std::vector<uint8_t> expected_tx;
+        std::vector<_chunk> rx_chunks;
+        size_t rx_index = 0;            // next chunk to serve
+        size_t rx_offset = 0;           // consumed bytes of that chunk
+
+        uint64_t tx_pos = 0;
+        uint64_t tx_mismatches = 0;
+        uint64_t first_mismatch = UINT64_MAX;
+        uint64_t rx_served = 0;
+        uint64_t rx_missing = 0;
+};
@@ -1,6 +1,7 @@
 #include "serial.h"
+#include "bsl_log.h"
 
-Serial::Serial(const char* __file, int _verbose_level) : port(__file), verbose_level(_verbose_level)
+Serial::Serial(const char* __file, int _verbose_level) : Transport(_verbose_level), port(__file)
 {
     
 }
@@ -14,12 +15,12 @@ bool Serial::_open(speed_t __speed)
 {
     serial_port = open(port, O_RDWR);
     if (serial_port < 0) {
-        printf("Error %i from open: %s\n", errno, strerror(errno));
+        BSLLog::printf("Error %i from open: %s\n", errno, strerror(errno));
         return false;
     }
     
     if(tcgetattr(serial_port, &tty) != 0) {
-        printf("Error %i from tcgetattr: %s\n", errno, strerror(errno));
+        BSLLog::printf("Error %i from tcgetattr: %s\n", errno, strerror(errno));
         serial_port = -1;
         return false;
     }
@@ -29,6 +30,7 @@ bool Serial::_open(speed_t __speed)
     tty.c_cflag |= CS8; // 8 bits per byte (most common)
     tty.c_cflag &= ~CRTSCTS; // Disable RTS/CTS hardware flow control (most common)
     tty.c_cflag |= CREAD | CLOCAL; // Turn on READ & ignore ctrl lines (CLOCAL = 1)
+    tty.c_cflag &= ~HUPCL; // Keep DTR/RTS on close, they may drive reset/BSL invoke
     tty.c_lflag &= ~ICANON;
     tty.c_lflag &= ~ECHO; // Disable echo
     tty.c_lflag &= ~ECHOE; // Disable erasure
@@ -39,13 +41,13 @@ bool Serial::_open(speed_t __speed)
     tty.c_oflag &= ~OPOST; // Prevent special interpretation of output bytes (e.g. newline chars)
     tty.c_oflag &= ~ONLCR; // Prevent conversion of newline to carriage return/line feed
 
-    tty.c_cc[VTIME] = 10;   // Wait for up to 1s (10 deciseconds), returning as soon as any data is received.
-    tty.c_cc[VMIN] = 0;     // purely time based read
+    tty.c_cc[VTIME] = 0;    // reads never block, poll() waits with millisecond timeouts
+    tty.c_cc[VMIN] = 0;
 
     change_baud(__speed);
 
     if (tcsetattr(serial_port, TCSANOW, &tty) != 0) {
-        printf("Error %i from tcsetattr: %s\n", errno, strerror(errno));
+        BSLLog::printf("Error %i from tcsetattr: %s\n", errno, strerror(errno));
         serial_port = -1;
         return false;
     } 
@@ -62,8 +64,38 @@ inline void Serial::change_baud(speed_t __speed)
     cfsetospeed(&tty, __speed);
 }
 
-inline void Serial::_flush()
+bool Serial::set_baud(speed_t __speed)
 {
+    // reconfigure in place, reopening would toggle the modem lines
+    change_baud(__speed);
+    if (tcsetattr(serial_port, TCSADRAIN, &tty) != 0) {
+        BSLLog::printf("Error %i from tcsetattr: %s\n", errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool Serial::set_modem_line(int line, bool asserted)
+{
+    if (serial_port < 0)
+        return false;
+
+    if (ioctl(serial_port, asserted ? TIOCMBIS : TIOCMBIC, &line) != 0) {
+        BSLLog::printf("Error %i from modem line ioctl: %s\n", errno, strerror(errno));
+        return false;
+    }
+
+    // debug printfs
+    if(verbose_level > 2) {
+        BSLLog::printf("Serial modem line 0x%03x=%d\n", line, (asserted ? 1 : 0));
+    }
+
+    return true;
+}
+
+void Serial::_flush()
+{
+    drop_staged();
     ioctl(serial_port, TCFLSH, 0); // flush receive
     ioctl(serial_port, TCFLSH, 1); // flush transmit
     ioctl(serial_port, TCFLSH, 2); // flush both
@@ -82,17 +114,22 @@ int Serial::writeBytes(const char buff[], size_t buf_size)
     if (serial_port < 0)
         return -1;
 
-    // debug printfs
-    if(verbose_level > 2) {
-        printf("Serial write %ld bytes: ", buf_size);
-        for(int i=0; i < buf_size; i++) {
-            printf("%02x ", (unsigned char) buff[i]);
+    BSLStats::Scope timer(stats, "serial_write");
+
+    // debug printfs, the wire trace replaces them when enabled
+    if(verbose_level > 2 && trace == nullptr) {
+        BSLLog::printf("Serial write %ld bytes: ", buf_size);
+        for(size_t i=0; i < buf_size; i++) {
+            BSLLog::printf("%02x ", (unsigned char) buff[i]);
         }
-        printf("\n");
+        BSLLog::printf("\n");
     }
 
 
     int n = write(serial_port, buff, buf_size);
+    if(trace != nullptr && n > 0) {
+        trace->record(WireTrace::Direction::TX, (const uint8_t*) buff, n);
+    }
     return n;
 }
 
@@ -101,30 +138,40 @@ int Serial::readBytes(char buff[], size_t buf_size, int _max_timeout_tries)
     if (serial_port < 0)
         return -1;
 
+    BSLStats::Scope timer(stats, "serial_read");
     int timeout_tries = _max_timeout_tries;
     int bytes_read = 0;
 
-    while(bytes_read != buf_size) {
-        int new_bytes_read = read(serial_port, (char*) buff+bytes_read, buf_size-bytes_read);
-        bytes_read += new_bytes_read;
+    while((size_t) bytes_read != buf_size) {
+        pollfd pfd = {.fd=serial_port, .events=POLLIN, .revents=0};
+        int ready = poll(&pfd, 1, read_timeout_ms);
+        if(ready < 0 && errno == EINTR)
+            continue;
+
+        int new_bytes_read = ready > 0 ? read(serial_port, (char*) buff+bytes_read, buf_size-bytes_read) : 0;
+        if(trace != nullptr && new_bytes_read > 0) {
+            trace->record(WireTrace::Direction::RX, (const uint8_t*) buff+bytes_read, new_bytes_read);
+        }
 
-        if(new_bytes_read == 0)
+        if(new_bytes_read <= 0) {
             timeout_tries--;
-        else
+        } else {
+            bytes_read += new_bytes_read;
             timeout_tries = _max_timeout_tries;
+        }
         
         if(timeout_tries == 0) {
             return -1;
         }
     }
 
-    // debug printfs
-    if(verbose_level > 2) {
-        printf("Serial read %d bytes: ", bytes_read);
+    // debug printfs, the wire trace replaces them when enabled
+    if(verbose_level > 2 && trace == nullptr) {
+        BSLLog::printf("Serial read %d bytes: ", bytes_read);
         for(int i=0; i < bytes_read; i++) {
-            printf("%02x ", (unsigned char) buff[i]);
+            BSLLog::printf("%02x ", (unsigned char) buff[i]);
         }
-        printf("\n");
+        BSLLog::printf("\n");
     }
 
     return bytes_read;
@@ -4,29 +4,32 @@
  *  Created on: Dec 1, 2023
  *      Author: Jonas Rockstroh
  */
+#pragma once
 
 #include <iostream>
 #include "fcntl.h"
 #include "errno.h"
 #include "termio.h"
 #include "unistd.h"
+#include "poll.h"
 #include "cstring"
+#include "transport.h"
 
-class Serial {
+class Serial : public Transport {
     public:
         Serial(const char* __file, int _verbose_level=0);
         ~Serial();
-        bool _open(speed_t __speed = B9600);
-        int _close();
-        void _flush();
+        bool _open(speed_t __speed = B9600) override;
+        int _close() override;
+        void _flush() override;
         void change_baud(speed_t __speed);
-        int readBytes(char buff[], size_t buf_size, int _max_timeout_tries=10);
-        int writeBytes(const char buff[], size_t buf_size);
+        bool set_baud(speed_t __speed) override;
+        bool set_modem_line(int line, bool asserted) override;
+        int readBytes(char buff[], size_t buf_size, int _max_timeout_tries=10) override;
+        int writeBytes(const char buff[], size_t buf_size) override;
         
     private:
         const char* port;
-        int serial_port;
+        int serial_port = -1;
         struct termios tty;
-
-        int verbose_level = 0;
 };
\ No newline at end of file
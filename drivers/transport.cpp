@@ -0,0 +1,59 @@
+/*
+ * transport.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "transport.h"
+#include "serial.h"
+#include "net_transport.h"
+#include <cstring>
+
+const uint8_t* Transport::peek(size_t len, int _max_timeout_tries)
+{
+    size_t have = rx_stage.size() - rx_head;
+    if(have >= len)
+        return &rx_stage[rx_head];
+
+    // keep the span contiguous, move leftovers to the front
+    if(rx_head > 0) {
+        memmove(rx_stage.data(), &rx_stage[rx_head], have);
+        rx_head = 0;
+    }
+
+    rx_stage.resize(len);
+    int n = readBytes((char*) &rx_stage[have], len - have, _max_timeout_tries);
+    if(n != (int) (len - have)) {
+        rx_stage.resize(have);
+        return nullptr;
+    }
+
+    return rx_stage.data();
+}
+
+void Transport::consume(size_t len)
+{
+    rx_head += len;
+    if(rx_head >= rx_stage.size())
+        drop_staged();
+}
+
+uint8_t* Transport::prepare(size_t len)
+{
+    if(tx_stage.size() < len)
+        tx_stage.resize(len);
+    return tx_stage.data();
+}
+
+int Transport::commit(size_t len)
+{
+    return writeBytes((const char*) tx_stage.data(), len);
+}
+
+Transport* Transport::create(const char* path, int _verbose_level)
+{
+    if(NetTransport::is_url(path))
+        return new NetTransport(path, _verbose_level);
+    return new Serial(path, _verbose_level);
+}
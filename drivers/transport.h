@@ -0,0 +1,71 @@
+/*
+ * transport.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <cstddef>
+#include <termios.h>
+#include <vector>
+#include "bsl_stats.h"
+#include "bsl_trace.h"
+
+/*
+ * Byte link between BSL_UART and a device.
+ *
+ * Besides the copying readBytes/writeBytes, a transport hands out spans:
+ * peek() returns at least len received bytes in place, consume() drops them,
+ * prepare() returns a buffer the caller builds a packet in and commit() sends
+ * it. The defaults stage through readBytes/writeBytes, links that hold the
+ * bytes in memory anyway override them to avoid the copy.
+ */
+class Transport {
+    public:
+        Transport(int _verbose_level=0) : verbose_level(_verbose_level) {}
+        virtual ~Transport() {}
+
+        virtual bool _open(speed_t __speed = B9600) = 0;
+        virtual int _close() = 0;
+        virtual void _flush() = 0;
+        virtual bool set_baud(speed_t __speed) = 0;
+        virtual bool set_modem_line(int, bool) { return false; }
+        virtual int readBytes(char buff[], size_t buf_size, int _max_timeout_tries=10) = 0;
+        virtual int writeBytes(const char buff[], size_t buf_size) = 0;
+
+        // nullptr on timeout, valid until the next consume()/peek()
+        virtual const uint8_t* peek(size_t len, int _max_timeout_tries=10);
+        virtual void consume(size_t len);
+        // valid until commit(), returns the bytes sent
+        virtual uint8_t* prepare(size_t len);
+        virtual int commit(size_t len);
+
+        // how long one of the _max_timeout_tries of a read waits for the next byte
+        void set_read_timeout_ms(int ms) { read_timeout_ms = ms; }
+
+        // frames BSL_UART may send ahead of their ACK, >1 on links with round trip latency
+        virtual int preferred_window() const { return 1; }
+
+        // serial device path, tcp://host:port or rfc2217://host:port
+        static Transport* create(const char* path, int _verbose_level=0);
+
+        void set_stats(BSLStats* _stats) { stats = _stats; }
+        void set_trace(WireTrace* _trace) { trace = _trace; }
+
+    protected:
+        // drop staged RX bytes, implementations call this from _flush()
+        void drop_staged() { rx_stage.clear(); rx_head = 0; }
+
+        BSLStats* stats = nullptr;
+        WireTrace* trace = nullptr;
+
+        int verbose_level = 0;
+        int read_timeout_ms = 1000;
+
+    private:
+        std::vector<uint8_t> rx_stage;
+        size_t rx_head = 0;
+        std::vector<uint8_t> tx_stage;
+};
@@ -1,70 +1,100 @@
+#include <climits>
 #include <iostream>
 #include "bsl_tool.h"
-#include <boost/program_options.hpp>
+#include "bsl_trace_decoder.h"
+#include "replay_serial.h"
+#include "bsl_daemon.h"
+#include "bsl_cli.h"
+#include "bsl_cli_options.h"
+#include "bsl_progress.h"
+#include "bsl_metrics.h"
+#include "bsl_inventory.h"
+#include "bsl_watch.h"
+#include "bsl_station.h"
+#include <fcntl.h>
+#include <memory>
 
-namespace po = boost::program_options;
 using namespace std;
 
 void print_usage();
 void print_version();
-int flash(po::variables_map &vm, po::parsed_options &parsed);               // flash subcommand
-int reset(po::variables_map &vm, po::parsed_options &parsed);               // reset subcommand
-int enter_bsl(po::variables_map &vm, po::parsed_options &parsed);           // enter_bsl subcommand
-int read_binary_version(po::variables_map &vm, po::parsed_options &parsed); // read_binary_version subcommand
+int flash(const BSLCli::Args &args);                // flash subcommand
+int reset(const BSLCli::Args &args);                // reset subcommand
+int enter_bsl(const BSLCli::Args &args);            // enter_bsl subcommand
+int read_binary_version(const BSLCli::Args &args);  // read_binary_version subcommand
+int calibrate(const BSLCli::Args &args);            // calibrate subcommand
+int decode_trace(const BSLCli::Args &args);         // decode_trace subcommand
+int daemon(const BSLCli::Args &args);               // daemon subcommand
+int submit(const BSLCli::Args &args);               // submit subcommand
+int metrics(const BSLCli::Args &args);              // metrics subcommand
+int inventory(const BSLCli::Args &args);            // inventory subcommand
+int watch(const BSLCli::Args &args);                // watch subcommand
+int station(const BSLCli::Args &args);              // station subcommand
+BSL_Entry::Method parse_entry_options(const BSLCli::Args &args, BSL_Modem::_modem_def &modem_def);
+std::unique_ptr<BSLTool> entry_tool(const BSLCli::Args &args, int verbose_level);
+
+static const BSLCli::_command commands[] = {
+    {"flash", "program, verify and start a firmware image", {BSLCli::group(BSLCli::flash_options), BSLCli::group(BSLCli::entry_options)}, flash},
+    {"reset", "reset the target via GPIO or DTR/RTS", {BSLCli::group(BSLCli::gpio_options), BSLCli::group(BSLCli::entry_options)}, reset},
+    {"enter_bsl", "put the target into BSL mode via GPIO or DTR/RTS", {BSLCli::group(BSLCli::gpio_options), BSLCli::group(BSLCli::entry_options)}, enter_bsl},
+    {"read_binary_version", "print the firmware version of an image", {BSLCli::group(BSLCli::read_binary_version_options)}, read_binary_version},
+    {"calibrate", "measure the minimum BSL entry timing of a fixture", {BSLCli::group(BSLCli::calibrate_options), BSLCli::group(BSLCli::entry_options)}, calibrate},
+    {"decode_trace", "print a recorded wire trace", {BSLCli::group(BSLCli::decode_trace_options)}, decode_trace},
+    {"daemon", "serve flash jobs on a Unix socket", {BSLCli::group(BSLCli::daemon_options), BSLCli::group(BSLCli::entry_options)}, daemon},
+    {"submit", "hand a flash job to a running daemon", {BSLCli::group(BSLCli::submit_options)}, submit},
+    {"metrics", "print the OpenMetrics text of a running daemon", {BSLCli::group(BSLCli::metrics_options)}, metrics},
+    {"inventory", "read device info and firmware CRC of many ports at once", {BSLCli::group(BSLCli::inventory_options), BSLCli::group(BSLCli::entry_options)}, inventory},
+    {"watch", "reflash the changed sectors of an image on every rebuild", {BSLCli::group(BSLCli::watch_options), BSLCli::group(BSLCli::entry_options)}, watch},
+    {"station", "flash every board as its serial port is plugged in", {BSLCli::group(BSLCli::station_options), BSLCli::group(BSLCli::entry_options)}, station},
+};
 
 int main(int argc, char** argv) {
     try {
-        // main options/commands
-        po::options_description main_desc("Main options");
-        main_desc.add_options()
-            ("help,h", "produce help message")
-            ("version,v", "print version")
-            ("command", po::value<string>(), "command (flash, reset, enter_bsl, read_binary_version)")
-            ("cmd-args", po::value<std::vector<std::string> >(), "arguments for command")
-        ;
-
-        po::positional_options_description p;
-        p.add("command", 1);
-        p.add("cmd-args", -1);
-
-        // parse
-        po::variables_map vm;
-        po::parsed_options parsed = po::command_line_parser(argc, argv).
-            options(main_desc).
-            positional(p).
-            allow_unregistered().
-            run();
-        po::store(parsed, vm);
-        po::notify(vm);
+        // main options, the first positional is the command, everything else belongs to it
+        bool help = false, version = false;
+        int cmd_at = 0;
+        for(int i = 1; i < argc; i++) {
+            if(!strcmp(argv[i], "--")) {
+                // the rest is positional, the command parse sees the -- too
+                if(cmd_at == 0 && i + 1 < argc)
+                    cmd_at = i + 1;
+                break;
+            }
+            if(!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help"))
+                help = true;
+            else if(!strcmp(argv[i], "-v") || !strcmp(argv[i], "--version"))
+                version = true;
+            else if(argv[i][0] != '-' && cmd_at == 0)
+                cmd_at = i;
+        }
 
         // print version
-        if(vm.count("version")) {
+        if(version) {
             print_version();
             return 0;
         }
 
         // handle subcommands
-        if(vm.count("command")) {
-            string cmd = vm["command"].as<string>();
-            if(cmd == "flash"){
-                return flash(vm, parsed);
-            } else if(cmd == "reset"){
-                return reset(vm, parsed);
-            } else if(cmd == "enter_bsl") {
-                return enter_bsl(vm, parsed);
-            } else if(cmd == "read_binary_version") {
-                return read_binary_version(vm, parsed);
-            } else {
-                printf("Unknown command '%s'!\n\n", cmd.c_str());
-                cout << main_desc << "\n";
+        if(cmd_at != 0) {
+            int cmd = BSLCli::find_command(commands, argv[cmd_at]);
+            if(cmd < 0) {
+                printf("Unknown command '%s'!\n\n", argv[cmd_at]);
+                print_usage();
                 return 0;
             }
+
+            // erase command name, parse the rest against the command's table
+            std::vector<const char*> opts(argv + 1, argv + argc);
+            opts.erase(opts.begin() + cmd_at - 1);
+
+            BSLCli::Args args;
+            args.parse(commands[cmd], opts.size(), opts.data());
+            return commands[cmd].run(args);
         }
 
         // handle help/no command
-        if (vm.count("help") || !vm.count("command")) {
+        if(help || cmd_at == 0) {
             print_usage();
-            cout << main_desc << "\n";
             return 0;
         }
     }
@@ -80,60 +110,147 @@ int main(int argc, char** argv) {
     return 0;
 }
 
-int flash(po::variables_map &vm, po::parsed_options &parsed)
+int flash(const BSLCli::Args &args)
 {
     try {
-        // flash command options
-        po::options_description desc("flash options");
-        desc.add_options()
-            ("help,h", "produce help message")
-            ("serial-port,p", po::value<string>(), "serial port (e.g. /dev/ttyACM0)")
-            ("firmware-file,i", po::value<string>(), "firmware file")
-            ("enter-bsl", po::value<bool>()->default_value(true), "enter BSL mode via GPIOs (default: true)")
-            ("verbose", po::value<int>()->default_value(0), "verbosity level 0-3 (default: 0)")
-            ("force", po::value<bool>()->default_value(false), "Force the update (default: false)")
-        ;
-
-        po::positional_options_description p;
-        p.add("serial-port", 1);
-        p.add("firmware-file", 2);
-
-        // erase command name
-        std::vector<std::string> opts = po::collect_unrecognized(parsed.options, po::include_positional);
-        opts.erase(opts.begin());
-
-        // reparse
-        po::store(po::command_line_parser(opts).options(desc).positional(p).run(), vm);
-
-        if (vm.count("help") || !vm.count("serial-port") || !vm.count("firmware-file")) {
-            cout << desc << "\n";
+
+        if (args.count("help") || (!args.count("serial-port") && !args.count("replay")) || (!args.count("firmware-file") && !args.count("region"))) {
+            args.print_options(stdout);
             printf("Usage: MSPM0_bsl_flasher flash <serial> <binary> [options]\n");
-            printf("=> Example: MSPM0_bsl_flasher flash /dev/ttyACM0 /home/foo/bar.bin\n\n");
+            printf("=> Example: MSPM0_bsl_flasher flash /dev/ttyACM0 /home/foo/bar.bin\n");
+            printf("=> Regions: MSPM0_bsl_flasher flash /dev/ttyACM0 app.bin --region data.bin@0x41d00000,nonmain.bin@0x41c00000\n");
+            printf("=> Replay:  MSPM0_bsl_flasher flash --replay /tmp/flash.trace -i /home/foo/bar.bin\n\n");
             return 0;
         }
 
         bool status;
-        int verbose_level = vm["verbose"].as<int>();
-        bool enter_bsl_gpio = vm["enter-bsl"].as<bool>();
-        const char* serial_path = vm["serial-port"].as<string>().c_str();
-        const char* file_path = vm["firmware-file"].as<string>().c_str();
+        int verbose_level = args.get_int("verbose");
+        bool enter_bsl = args.get_bool("enter-bsl");
+        string serial_arg = args.count("replay") ? args.get_string("replay") : args.get_string("serial-port");
+        string file_arg = args.count("firmware-file") ? args.get_string("firmware-file") : "";
+        const char* serial_path = serial_arg.c_str();
+        const char* file_path = file_arg.c_str();
         uint32_t size = 0;
 
-        auto b = BSLTool(serial_path, enter_bsl_gpio, verbose_level);
-        b.open_file(file_path, size);
-        std::string fw_version = b.read_file_version();
-        printf("Using serial %s to flash %s\nFirmware version:%s\n\n", serial_path, file_path, fw_version.c_str());
+        // several images or a HEX file are programmed region by region
+        std::vector<BSLRegion::_region> regions;
+        const bool multi_region = args.count("region") || (!file_arg.empty() && BSLRegion::is_hex(file_arg));
+        if(multi_region) {
+            if(!file_arg.empty() && !BSLRegion::load_spec(BSLRegion::is_hex(file_arg) ? file_arg : file_arg + "@0x0", regions)) {
+                return 1;
+            }
+            for(const string &spec : args.get_list("region")) {
+                if(!BSLRegion::load_spec(spec, regions)) {
+                    return 1;
+                }
+            }
+            if(!BSLRegion::prepare(regions)) {
+                return 1;
+            }
+        }
+
+        BSL_Modem::_modem_def modem_def;
+        auto entry_method = parse_entry_options(args, modem_def);
+        if(!enter_bsl) {
+            entry_method = BSL_Entry::Method::None;
+        }
+
+        // replay: the recorded device answers, there are no lines to toggle
+        ReplaySerial* replay = nullptr;
+        if(args.count("replay")) {
+            string timing = args.get_string("replay-timing");
+            if(timing != "fast" && timing != "original") {
+                cerr << "error: unknown replay timing " << timing << "\n";
+                return 1;
+            }
+            replay = new ReplaySerial(serial_path, timing == "original" ? ReplaySerial::Timing::Original : ReplaySerial::Timing::Fast, verbose_level);
+            entry_method = BSL_Entry::Method::None;
+        }
+
+        auto b = replay != nullptr ? BSLTool(replay, entry_method, verbose_level) : BSLTool(serial_path, entry_method, verbose_level, modem_def);
+        b.load_entry_timing(args.get_string("fixture"));
+        b.set_pipeline(args.get_bool("pipeline"), args.get_int("window"));
+        b.set_max_retries(args.get_int("retries"));
+        b.set_resume(args.get_bool("resume"));
+        if(args.count("trace")) {
+            b.start_trace(args.get_string("trace").c_str());
+        }
+
+        // live progress, reported from its own thread
+        BSLProgress::_config progress_cfg;
+        string progress_mode = args.get_string("progress");
+        if(progress_mode != "auto" && progress_mode != "on" && progress_mode != "off") {
+            cerr << "error: progress must be auto, on or off\n";
+            return 1;
+        }
+        progress_cfg.terminal = progress_mode == "on" || (progress_mode == "auto" && isatty(STDERR_FILENO));
+        if(args.count("progress-fd")) {
+            progress_cfg.fd = args.get_int("progress-fd");
+            if(fcntl(progress_cfg.fd, F_GETFD) < 0) {
+                cerr << "error: progress-fd " << progress_cfg.fd << " is not open\n";
+                return 1;
+            }
+        }
+        progress_cfg.interval_ms = std::max(args.get_int("progress-interval"), 10);
+        progress_cfg.port = serial_path;
+        std::unique_ptr<BSLProgress> progress;
+        if(progress_cfg.terminal || progress_cfg.fd >= 0) {
+            progress.reset(new BSLProgress(progress_cfg));
+            progress->attach(b);
+        }
+        BSLMetrics metrics;
+        if(multi_region) {
+            printf("Using serial %s to flash %zu regions\n", serial_path, regions.size());
+            for(const auto &r : regions) {
+                printf("  0x%08x-0x%08x %s\n", r.addr, (uint32_t) (r.addr + r.data.size() - 1), r.source.c_str());
+            }
+            printf("\n");
+        } else {
+            // scanned once here, flash_file() streams it from the start again
+            if(!b.open_file(file_path, size)) {
+                printf("Error opening file %s\n", file_path);
+                return 1;
+            }
+            std::string fw_version = b.read_file_version();
+            printf("Using serial %s to flash %s\nFirmware version:%s\n\n", serial_path, file_path, fw_version.c_str());
+        }
 
-        if(enter_bsl_gpio) {
+        if(entry_method != BSL_Entry::Method::None) {
             printf("Entering BSL mode\n");
             status = b.enter_bsl();
             if(!status) {
                 printf("Could not enter BSL mode. Stopping...\n");
+                if(args.count("metrics-file")) {
+                    metrics.record_unit(b, serial_arg, false);
+                    metrics.update_file(args.get_string("metrics-file"));
+                }
                 return !status;
             }
         }
 
-        status = b.flash_image(file_path, vm["force"].as<bool>());
+        if(multi_region) {
+            status = b.flash_regions(regions, args.get_bool("force"));
+        } else {
+            status = b.flash_file(args.get_bool("force"));
+        }
+        if(progress) {
+            progress->finish(status);
+        }
+
+        if(args.count("metrics-file")) {
+            metrics.record_unit(b, serial_arg, status);
+            metrics.update_file(args.get_string("metrics-file"));
+        }
+
+        if(args.count("stats-file")) {
+            b.get_stats().export_file(args.get_string("stats-file").c_str(), args.get_string("stats-format"));
+        }
+
+        if(replay != nullptr) {
+            replay->print_summary();
+            status = status && !replay->diverged();
+        }
+
         return !status;
     }
     catch(exception& e) {
@@ -148,36 +265,24 @@ int flash(po::variables_map &vm, po::parsed_options &parsed)
     return 0;
 }
 
-int reset(po::variables_map &vm, po::parsed_options &parsed)
+int reset(const BSLCli::Args &args)
 {
     try {
-        // reset command options
-        po::options_description desc("reset options");
-        desc.add_options()
-            ("help,h", "produce help message")
-            ("verbose", po::value<int>()->default_value(0), "verbosity level 0-3 (default: 0)")
-        ;
-
-        // erase command name
-        std::vector<std::string> opts = po::collect_unrecognized(parsed.options, po::include_positional);
-        opts.erase(opts.begin());
-
-        // reparse
-        po::store(po::command_line_parser(opts).options(desc).run(), vm);
-
-        if (vm.count("help")) {
-            cout << desc << "\n";
+
+        if (args.count("help")) {
+            args.print_options(stdout);
             printf("Usage: MSPM0_bsl_flasher reset [options]\n");
-            printf("=> Example: MSPM0_bsl_flasher reset\n\n");
+            printf("=> Example: MSPM0_bsl_flasher reset\n");
+            printf("=> Example: MSPM0_bsl_flasher reset /dev/ttyUSB0 --entry modem\n\n");
             return 0;
         }
 
         bool status;
-        int verbose_level = vm["verbose"].as<int>();
+        int verbose_level = args.get_int("verbose");
 
-        auto gpio = BSL_GPIO(verbose_level);
-        printf("Resetting via GPIO\n");
-        status = gpio.hard_reset();
+        auto b = entry_tool(args, verbose_level);
+        printf("Resetting via %s\n", args.get_string("entry") == "modem" ? "DTR/RTS" : "GPIO");
+        status = b->hard_reset();
 
         return !status;
     }
@@ -193,36 +298,24 @@ int reset(po::variables_map &vm, po::parsed_options &parsed)
     return 0;
 }
 
-int enter_bsl(po::variables_map &vm, po::parsed_options &parsed)
+int enter_bsl(const BSLCli::Args &args)
 {
     try {
-        // enter_bsl command options
-        po::options_description desc("enter_bsl options");
-        desc.add_options()
-            ("help,h", "produce help message")
-            ("verbose", po::value<int>()->default_value(0), "verbosity level 0-3 (default: 0)")
-        ;
-
-        // erase command name
-        std::vector<std::string> opts = po::collect_unrecognized(parsed.options, po::include_positional);
-        opts.erase(opts.begin());
-
-        // reparse
-        po::store(po::command_line_parser(opts).options(desc).run(), vm);
-
-        if (vm.count("help")) {
-            cout << desc << "\n";
+
+        if (args.count("help")) {
+            args.print_options(stdout);
             printf("Usage: MSPM0_bsl_flasher enter_bsl [options]\n");
-            printf("=> Example: MSPM0_bsl_flasher enter_bsl\n\n");
+            printf("=> Example: MSPM0_bsl_flasher enter_bsl\n");
+            printf("=> Example: MSPM0_bsl_flasher enter_bsl /dev/ttyUSB0 --entry modem\n\n");
             return 0;
         }
 
         bool status;
-        int verbose_level = vm["verbose"].as<int>();
+        int verbose_level = args.get_int("verbose");
 
-        auto gpio = BSL_GPIO(verbose_level);
+        auto b = entry_tool(args, verbose_level);
         printf("Entering BSL mode\n");
-        status = gpio.enter_bsl();
+        status = b->enter_bsl();
 
         return !status;
     }
@@ -238,40 +331,23 @@ int enter_bsl(po::variables_map &vm, po::parsed_options &parsed)
     return 0;
 }
 
-int read_binary_version(po::variables_map &vm, po::parsed_options &parsed)
+int read_binary_version(const BSLCli::Args &args)
 {
     try {
-        // read_binary_version command options
-        po::options_description read_version_desc("read_binary_version options");
-        read_version_desc.add_options()
-            ("help,h", "produce help message")
-            ("firmware-file,i", po::value<string>(), "firmware file")
-            ("verbose", po::value<int>()->default_value(0), "verbosity level 0-3 (default: 0)")
-        ;
-
-        po::positional_options_description p;
-        p.add("firmware-file", 1);
-
-        // erase command name
-        std::vector<std::string> opts = po::collect_unrecognized(parsed.options, po::include_positional);
-        opts.erase(opts.begin());
-
-        // reparse
-        po::store(po::command_line_parser(opts).options(read_version_desc).positional(p).run(), vm);
-
-        if (vm.count("help") || !vm.count("firmware-file")) {
-            cout << read_version_desc << "\n";
+
+        if (args.count("help") || !args.count("firmware-file")) {
+            args.print_options(stdout);
             printf("Usage: MSPM0_bsl_flasher read_binary_version <binary> [options]\n");
             printf("=> Example: MSPM0_bsl_flasher read_binary_version /home/foo/bar.bin\n\n");
             return 0;
         }
 
-        bool status;
-        int verbose_level = vm["verbose"].as<int>();
-        const char* file_path = vm["firmware-file"].as<string>().c_str();
+        int verbose_level = args.get_int("verbose");
+        string file_arg = args.get_string("firmware-file");
+        const char* file_path = file_arg.c_str();
         uint32_t size = 0;
 
-        auto b = BSLTool(nullptr, 0, verbose_level);
+        auto b = BSLTool((const char*) nullptr, BSL_Entry::Method::None, verbose_level);
         b.open_file(file_path, size);
         std::string fw_version = b.read_file_version();
         printf("Binary: %s\nFirmware version: %s\n", file_path, fw_version.c_str());
@@ -290,10 +366,400 @@ int read_binary_version(po::variables_map &vm, po::parsed_options &parsed)
     return 0;
 }
 
+int calibrate(const BSLCli::Args &args)
+{
+    try {
+
+        if (args.count("help") || !args.count("serial-port")) {
+            args.print_options(stdout);
+            printf("Usage: MSPM0_bsl_flasher calibrate <serial> [options]\n");
+            printf("=> Example: MSPM0_bsl_flasher calibrate /dev/ttyACM0 --fixture station1\n");
+            printf("Needs a programmed application, the target is reset into it between trials.\n\n");
+            return 0;
+        }
+
+        bool status;
+        int verbose_level = args.get_int("verbose");
+        string serial_arg = args.get_string("serial-port");
+        const char* serial_path = serial_arg.c_str();
+
+        BSL_Modem::_modem_def modem_def;
+        auto entry_method = parse_entry_options(args, modem_def);
+
+        auto b = BSLTool(serial_path, entry_method, verbose_level, modem_def);
+        status = b.calibrate_entry(args.get_string("fixture"), args.get_int("trials"), args.get_int("margin"));
+
+        return !status;
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int decode_trace(const BSLCli::Args &args)
+{
+    try {
+
+        if (args.count("help") || !args.count("trace-file")) {
+            args.print_options(stdout);
+            printf("Usage: MSPM0_bsl_flasher decode_trace <trace> [options]\n");
+            printf("=> Example: MSPM0_bsl_flasher decode_trace /tmp/flash.trace\n\n");
+            return 0;
+        }
+
+        auto decoder = TraceDecoder(stdout, args.get_bool("raw"));
+        bool status = decoder.decode_file(args.get_string("trace-file").c_str());
+
+        return !status;
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int daemon(const BSLCli::Args &args)
+{
+    try {
+
+        if (args.count("help")) {
+            args.print_options(stdout);
+            printf("Usage: MSPM0_bsl_flasher daemon [options]\n");
+            printf("=> Example: MSPM0_bsl_flasher daemon --entry modem\n");
+            printf("Keeps ports, entry lines and images open, jobs come in with the submit command.\n");
+            printf("The entry GPIOs reset a single target, with --entry gpio only the first port submitted is served.\n\n");
+            return 0;
+        }
+
+        BSLDaemon::_config cfg;
+        if(args.count("socket"))
+            cfg.socket_path = args.get_string("socket");
+        cfg.entry_method = parse_entry_options(args, cfg.modem_def);
+        cfg.fixture = args.get_string("fixture");
+        cfg.pipeline = args.get_bool("pipeline");
+        cfg.window = args.get_int("window");
+        cfg.max_retries = args.get_int("retries");
+        cfg.resume = args.get_bool("resume");
+        cfg.verbose_level = args.get_int("verbose");
+        if(args.count("metrics-file"))
+            cfg.metrics_file = args.get_string("metrics-file");
+
+        BSLDaemon d(cfg);
+        return !d.run();
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int submit(const BSLCli::Args &args)
+{
+    try {
+
+        if (args.count("help") || !args.count("serial-port") || !args.count("firmware-file")) {
+            args.print_options(stdout);
+            printf("Usage: MSPM0_bsl_flasher submit <serial> <binary> [options]\n");
+            printf("=> Example: MSPM0_bsl_flasher submit /dev/ttyACM0 /home/foo/bar.bin\n\n");
+            return 0;
+        }
+
+        // the daemon has its own working directory
+        auto absolute = [](const string &path) {
+            char cwd[PATH_MAX];
+            if(path.empty() || path[0] == '/' || getcwd(cwd, sizeof(cwd)) == nullptr)
+                return path;
+            return string(cwd) + "/" + path;
+        };
+
+        BSLDaemon::_job job = {
+            {"cmd", "flash"},
+            {"port", args.get_string("serial-port")},
+            {"image", absolute(args.get_string("firmware-file"))},
+            {"enter", args.get_bool("enter-bsl") ? "1" : "0"},
+            {"force", args.get_bool("force") ? "1" : "0"}
+        };
+        if(args.count("stats-file"))
+            job["stats-file"] = absolute(args.get_string("stats-file"));
+
+        string socket_path = args.count("socket") ? args.get_string("socket") : BSLDaemon::default_socket();
+        return BSLDaemon::submit(socket_path, job);
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int metrics(const BSLCli::Args &args)
+{
+    try {
+
+        if (args.count("help")) {
+            args.print_options(stdout);
+            printf("Usage: MSPM0_bsl_flasher metrics [options]\n");
+            printf("=> Example: MSPM0_bsl_flasher metrics > /var/lib/node_exporter/mspm0_bsl.prom\n");
+            printf("Counts the units the daemon flashed since it started, flash --metrics-file keeps a file across runs.\n\n");
+            return 0;
+        }
+
+        BSLDaemon::_job job = {{"cmd", "metrics"}};
+        string socket_path = args.count("socket") ? args.get_string("socket") : BSLDaemon::default_socket();
+        return BSLDaemon::submit(socket_path, job);
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int inventory(const BSLCli::Args &args)
+{
+    try {
+
+        if (args.count("help") || !args.count("serial-port")) {
+            args.print_options(stdout);
+            printf("Usage: MSPM0_bsl_flasher inventory <serial> [<serial> ...] [options]\n");
+            printf("=> Example: MSPM0_bsl_flasher inventory /dev/ttyUSB* --entry modem -i app_v1.bin,app_v2.bin --format json\n\n");
+            return 0;
+        }
+
+        auto parse_u32 = [](const string &text, const char* name) {
+            char* end = nullptr;
+            errno = 0;
+            unsigned long v = strtoul(text.c_str(), &end, 0);
+            if(text.empty() || *end != '\0' || errno != 0 || v > UINT32_MAX)
+                throw std::invalid_argument(string("the argument ('") + text + "') for option '--" + name + "' is invalid");
+            return (uint32_t) v;
+        };
+
+        BSLInventory::_config cfg;
+        cfg.ports = args.get_list("serial-port");
+        cfg.images = args.get_list("image");
+        cfg.entry_method = parse_entry_options(args, cfg.modem_def);
+        cfg.fixture = args.get_string("fixture");
+        cfg.addr = parse_u32(args.get_string("addr"), "addr");
+        if(args.count("length"))
+            cfg.length = parse_u32(args.get_string("length"), "length");
+        cfg.jobs = args.get_int("jobs");
+        cfg.start = args.get_bool("start");
+        cfg.verbose_level = args.get_int("verbose");
+
+        string format = args.get_string("format");
+        if(format != "table" && format != "json") {
+            cerr << "error: format must be table or json\n";
+            return 1;
+        }
+        // the entry GPIOs are wired to one target
+        if(cfg.entry_method == BSL_Entry::Method::GPIO && cfg.ports.size() > 1) {
+            cerr << "error: gpio entry drives a single target, use --entry modem or none for several ports\n";
+            return 1;
+        }
+        if(cfg.length == 0 && cfg.images.empty()) {
+            cerr << "warning: no --length or --image, the CRC is not read\n";
+        }
+
+        std::vector<BSLInventory::_unit> units;
+        BSLInventory inv(cfg);
+        if(!inv.run(units))
+            return 1;
+
+        if(cfg.verbose_level > 0) {
+            for(const auto &u : units)
+                fprintf(stderr, "=== %s\n%s\n", u.port.c_str(), u.log.c_str());
+        }
+        string out = format == "json" ? inv.to_json(units) : inv.to_table(units);
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        bool status = std::all_of(units.begin(), units.end(), [](const BSLInventory::_unit &u) { return u.ok; });
+        return !status;
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int watch(const BSLCli::Args &args)
+{
+    try {
+
+        if (args.count("help") || !args.count("serial-port") || !args.count("firmware-file")) {
+            args.print_options(stdout);
+            printf("Usage: MSPM0_bsl_flasher watch <serial> <firmware-file> [options]\n");
+            printf("=> Example: MSPM0_bsl_flasher watch /dev/ttyACM0 build/app.bin --entry modem\n\n");
+            return 0;
+        }
+
+        BSLWatch::_config cfg;
+        cfg.port = args.get_string("serial-port");
+        cfg.image = args.get_string("firmware-file");
+        cfg.entry_method = parse_entry_options(args, cfg.modem_def);
+        cfg.fixture = args.get_string("fixture");
+        cfg.pipeline = args.get_bool("pipeline");
+        cfg.window = args.get_int("window");
+        cfg.max_retries = args.get_int("retries");
+        cfg.start = args.get_bool("start");
+        cfg.quiet_ms = args.get_int("quiet-ms");
+        cfg.verbose_level = args.get_int("verbose");
+
+        BSLWatch watcher(cfg);
+        return !watcher.run();
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int station(const BSLCli::Args &args)
+{
+    try {
+
+        if (args.count("help") || !args.count("firmware-file")) {
+            args.print_options(stdout);
+            printf("Usage: MSPM0_bsl_flasher station <firmware-file> [options]\n");
+            printf("=> Example: MSPM0_bsl_flasher station app.bin --entry modem --filter '/dev/ttyUSB*' --results-file results.ndjson\n\n");
+            return 0;
+        }
+
+        BSLStation::_config cfg;
+        cfg.image = args.get_string("firmware-file");
+        cfg.filters = args.get_list("filter");
+        cfg.entry_method = parse_entry_options(args, cfg.modem_def);
+        cfg.fixture = args.get_string("fixture");
+        cfg.pipeline = args.get_bool("pipeline");
+        cfg.window = args.get_int("window");
+        cfg.max_retries = args.get_int("retries");
+        cfg.resume = args.get_bool("resume");
+        cfg.force = args.get_bool("force");
+        cfg.present = args.get_bool("present");
+        cfg.settle_ms = args.get_int("settle-ms");
+        cfg.verbose_level = args.get_int("verbose");
+        if(args.count("results-file"))
+            cfg.results_file = args.get_string("results-file");
+        if(args.count("metrics-file"))
+            cfg.metrics_file = args.get_string("metrics-file");
+
+        // the entry GPIOs are wired to one target
+        if(cfg.entry_method == BSL_Entry::Method::GPIO) {
+            cerr << "error: gpio entry drives a single target, use --entry modem or none for a station\n";
+            return 1;
+        }
+
+        BSLStation s(cfg);
+        return !s.run();
+    }
+    catch(exception& e) {
+        cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    catch(...) {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+BSL_Entry::Method parse_entry_options(const BSLCli::Args &args, BSL_Modem::_modem_def &modem_def)
+{
+    modem_def = BSL_Modem::default_modem_def;
+
+    string reset_line = args.get_string("modem-reset");
+    if(reset_line == "rts") {
+        modem_def.reset_line = TIOCM_RTS;
+        modem_def.bsl_line = TIOCM_DTR;
+    } else if(reset_line != "dtr") {
+        throw std::invalid_argument("modem-reset must be dtr or rts");
+    }
+    modem_def.reset_invert = args.get_bool("modem-invert-reset");
+    modem_def.bsl_invert = args.get_bool("modem-invert-bsl");
+
+    string entry = args.get_string("entry");
+    if(entry == "gpio") {
+        return BSL_Entry::Method::GPIO;
+    } else if(entry == "modem") {
+        return BSL_Entry::Method::Modem;
+    } else if(entry == "none") {
+        return BSL_Entry::Method::None;
+    }
+    throw std::invalid_argument("entry must be gpio, modem or none");
+}
+
+// the entry lines alone, host GPIOs or the DTR/RTS lines of the serial port
+std::unique_ptr<BSLTool> entry_tool(const BSLCli::Args &args, int verbose_level)
+{
+    BSL_Modem::_modem_def modem_def;
+    auto entry_method = parse_entry_options(args, modem_def);
+    if(entry_method == BSL_Entry::Method::None) {
+        throw std::invalid_argument("entry none has no lines to drive");
+    }
+    if(entry_method == BSL_Entry::Method::Modem && !args.count("serial-port")) {
+        throw std::invalid_argument("entry modem needs the serial port");
+    }
+
+    const string serial_arg = entry_method == BSL_Entry::Method::Modem ? args.get_string("serial-port") : "";
+    std::unique_ptr<BSLTool> b(new BSLTool(serial_arg.empty() ? nullptr : serial_arg.c_str(), entry_method, verbose_level, modem_def));
+    b->load_entry_timing(args.get_string("fixture"));
+    return b;
+}
+
 void print_usage()
 {
     printf("Usage: MSPM0_bsl_flasher <cmd> <cmd args> [options]\n");
     printf("=> Example: MSPM0_bsl_flasher flash /dev/ttyACM0 /home/foo/bar.bin\n\n");
+
+    const BSLCli::_group main_group = BSLCli::group(BSLCli::main_options);
+    BSLCli::print_group(stdout, "Main options", &main_group, 1);
+
+    printf("Commands:\n");
+    for(const auto &cmd : commands)
+        printf("  %-22s%s\n", cmd.name, cmd.summary);
+    printf("\n");
 }
 
 void print_version()
@@ -0,0 +1,477 @@
+/*
+ * bsl_sim.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * MSPM0 BSL target simulator on a pseudo terminal or a TCP port.
+ * Point the flasher at the printed pty (or --link path) with --enter-bsl false,
+ * or at tcp://localhost:<port> / rfc2217://localhost:<port> with --tcp.
+ */
+
+#include "bsl_target.h"
+#include "bsl_timing.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <deque>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int)
+{
+    stop = 1;
+}
+
+static void print_usage()
+{
+    printf("Usage: MSPM0_bsl_sim [options]\n");
+    printf("  --link <path>         create a symlink to the pty slave\n");
+    printf("  --tcp <port>          listen on a TCP port instead of a pty (ser2net stand-in)\n");
+    printf("  --rfc2217             speak telnet COM-PORT-OPTION on the TCP port\n");
+    printf("  --net-delay <us>      one way network delay added to the TCP link\n");
+    printf("  --flash-size <bytes>  main flash size (default: 131072)\n");
+    printf("  --baud <rate>         initial baudrate (default: 9600)\n");
+    printf("  --virtual-time        do not sleep, only account modeled time\n");
+    printf("  --no-readout          reject MemoryRead like a locked BCR\n");
+    printf("  --error-rate <p>      flip a bit in a byte with probability p, both directions\n");
+    printf("  --seed <n>            seed of the error injection (default: 1)\n");
+    printf("  --verbose <level>     0-2 (default: 0)\n");
+}
+
+// modeled timeline of one session, all values in us
+struct _timeline {
+    uint64_t rx_line_until = 0;     // last command byte on the wire
+    uint64_t device_until = 0;      // device done processing
+    uint64_t tx_line_until = 0;     // last response byte on the wire
+};
+
+// response bytes waiting for their modeled release time
+struct _pending {
+    uint64_t due_us;
+    std::vector<uint8_t> data;
+};
+
+static uint64_t to_us(const timespec &t)
+{
+    return (uint64_t) t.tv_sec * 1000000ULL + t.tv_nsec / 1000;
+}
+
+static timespec from_us(uint64_t us)
+{
+    timespec t;
+    t.tv_sec = us / 1000000ULL;
+    t.tv_nsec = (us % 1000000ULL) * 1000;
+    return t;
+}
+
+static void print_counters(const BSLTarget &target, uint64_t modeled_us)
+{
+    auto &c = target.get_counters();
+    printf("frames: %lu (bad %lu), programmed: %lu bytes, erased sectors: %lu, modeled time: %.3fms\n",
+        c.frames, c.bad_frames, c.bytes_programmed, c.sectors_erased, modeled_us / 1000.0);
+    if(c.injected_errors > 0)
+        printf("injected bit errors: %lu\n", c.injected_errors);
+    if(c.words_reprogrammed > 0)
+        printf("flash words programmed again without an erase: %lu\n", c.words_reprogrammed);
+}
+
+static bool write_all(int fd, const uint8_t* data, size_t len)
+{
+    while(len > 0) {
+        ssize_t n = write(fd, data, len);
+        if(n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/*
+ * Server side of RFC2217: strips telnet commands from the client stream,
+ * agrees to binary/SGA/COM-PORT-OPTION and acknowledges com port settings.
+ */
+class TelnetServer {
+    public:
+        TelnetServer(int _verbose_level) : verbose_level(_verbose_level) {}
+
+        void reset() { state = State::Data; sub.clear(); }
+
+        // returns the payload bytes, answers go to out
+        size_t decode(const uint8_t* in, size_t len, uint8_t* data, std::vector<uint8_t> &out)
+        {
+            size_t n = 0;
+            for(size_t i = 0; i < len; i++) {
+                const uint8_t c = in[i];
+                switch(state) {
+                case State::Data:
+                    if(c == IAC)
+                        state = State::Iac;
+                    else
+                        data[n++] = c;
+                    break;
+                case State::Iac:
+                    if(c == IAC) {
+                        data[n++] = IAC;
+                        state = State::Data;
+                    } else if(c == SB) {
+                        sub.clear();
+                        state = State::Sub;
+                    } else if(c >= WILL && c <= DONT) {
+                        verb = c;
+                        state = State::Option;
+                    } else {
+                        state = State::Data;
+                    }
+                    break;
+                case State::Option:
+                    answer_option(c, out);
+                    state = State::Data;
+                    break;
+                case State::Sub:
+                    if(c == IAC)
+                        state = State::SubIac;
+                    else
+                        sub.push_back(c);
+                    break;
+                case State::SubIac:
+                    if(c == SE) {
+                        answer_sub(out);
+                        state = State::Data;
+                    } else {
+                        sub.push_back(c);
+                        state = State::Sub;
+                    }
+                    break;
+                }
+            }
+            return n;
+        }
+
+        static void escape(const std::vector<uint8_t> &in, std::vector<uint8_t> &out)
+        {
+            for(auto c : in) {
+                out.push_back(c);
+                if(c == IAC)
+                    out.push_back(IAC);
+            }
+        }
+
+    private:
+        static constexpr uint8_t IAC = 255, DONT = 254, DO = 253, WONT = 252, WILL = 251, SB = 250, SE = 240;
+        static constexpr uint8_t OPT_BINARY = 0, OPT_SGA = 3, OPT_COM_PORT = 44;
+
+        void answer_option(uint8_t option, std::vector<uint8_t> &out)
+        {
+            const bool supported = (option == OPT_BINARY) || (option == OPT_SGA) || (option == OPT_COM_PORT);
+            uint8_t reply;
+            if(verb == WILL)
+                reply = supported ? DO : DONT;
+            else if(verb == DO)
+                reply = (supported && option != OPT_COM_PORT) ? WILL : WONT;
+            else
+                return;
+            out.insert(out.end(), {IAC, reply, option});
+        }
+
+        void answer_sub(std::vector<uint8_t> &out)
+        {
+            if(sub.size() < 2 || sub[0] != OPT_COM_PORT)
+                return;
+
+            // server answers carry the client command + 100 and the value in effect
+            if(sub[1] == 1 && sub.size() >= 6 && verbose_level > 0) {
+                uint32_t baud = ((uint32_t) sub[2] << 24) | (sub[3] << 16) | (sub[4] << 8) | sub[5];
+                printf("rfc2217 baudrate %u\n", baud);
+            }
+            out.insert(out.end(), {IAC, SB, OPT_COM_PORT, (uint8_t) (sub[1] + 100)});
+            escape(std::vector<uint8_t>(sub.begin() + 2, sub.end()), out);
+            out.insert(out.end(), {IAC, SE});
+        }
+
+        enum class State {
+            Data, Iac, Option, Sub, SubIac
+        } state = State::Data;
+        uint8_t verb = 0;
+        std::vector<uint8_t> sub;
+        int verbose_level;
+};
+
+static int listen_tcp(uint16_t port)
+{
+    int fd = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0)
+        return -1;
+
+    int one = 1, zero = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+
+    sockaddr_in6 addr = {};
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(port);
+    if(bind(fd, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char** argv)
+{
+    BSLTarget::_config cfg;
+    const char* link_path = nullptr;
+    bool virtual_time = false;
+    int verbose_level = 0;
+    int tcp_port = -1;
+    bool rfc2217 = false;
+    uint64_t net_delay_us = 0;
+
+    static const struct option long_opts[] = {
+        {"link", required_argument, nullptr, 'l'},
+        {"tcp", required_argument, nullptr, 'p'},
+        {"rfc2217", no_argument, nullptr, 'R'},
+        {"net-delay", required_argument, nullptr, 'd'},
+        {"flash-size", required_argument, nullptr, 'f'},
+        {"baud", required_argument, nullptr, 'b'},
+        {"virtual-time", no_argument, nullptr, 't'},
+        {"no-readout", no_argument, nullptr, 'r'},
+        {"error-rate", required_argument, nullptr, 'e'},
+        {"seed", required_argument, nullptr, 's'},
+        {"verbose", required_argument, nullptr, 'v'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    int opt;
+    while((opt = getopt_long(argc, argv, "l:p:Rd:f:b:tre:s:v:h", long_opts, nullptr)) != -1) {
+        switch(opt) {
+        case 'l':
+            link_path = optarg;
+            break;
+        case 'p':
+            tcp_port = atoi(optarg);
+            break;
+        case 'R':
+            rfc2217 = true;
+            break;
+        case 'd':
+            net_delay_us = strtoull(optarg, nullptr, 0);
+            break;
+        case 'f':
+            cfg.flash_size = strtoul(optarg, nullptr, 0);
+            break;
+        case 'b':
+            cfg.initial_baud = strtoul(optarg, nullptr, 0);
+            break;
+        case 't':
+            virtual_time = true;
+            break;
+        case 'r':
+            cfg.readout_enabled = false;
+            break;
+        case 'e':
+            cfg.error_rate = strtod(optarg, nullptr);
+            break;
+        case 's':
+            cfg.error_seed = strtoul(optarg, nullptr, 0);
+            break;
+        case 'v':
+            verbose_level = atoi(optarg);
+            break;
+        default:
+            print_usage();
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if(rfc2217 && tcp_port < 0) {
+        printf("--rfc2217 needs --tcp\n");
+        return 1;
+    }
+
+    int master = -1, slave = -1, listener = -1;
+    int link = -1;      // fd the host talks to
+
+    if(tcp_port >= 0) {
+        listener = listen_tcp(tcp_port);
+        if(listener < 0) {
+            printf("Error %i listening on port %d: %s\n", errno, tcp_port, strerror(errno));
+            return 1;
+        }
+    } else {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+            printf("Error %i opening pty: %s\n", errno, strerror(errno));
+            return 1;
+        }
+        const char* slave_path = ptsname(master);
+
+        // hold the slave open, so the master does not see a hangup between host runs
+        slave = open(slave_path, O_RDWR | O_NOCTTY);
+        termios tty;
+        tcgetattr(slave, &tty);
+        cfmakeraw(&tty);
+        tcsetattr(slave, TCSANOW, &tty);
+
+        if(link_path != nullptr) {
+            unlink(link_path);
+            if(symlink(slave_path, link_path) != 0) {
+                printf("Error %i creating link %s: %s\n", errno, link_path, strerror(errno));
+                return 1;
+            }
+        }
+        link = master;
+        printf("BSL simulator on %s\n", link_path ? link_path : slave_path);
+    }
+
+    if(listener >= 0)
+        printf("BSL simulator on %s://localhost:%d\n", rfc2217 ? "rfc2217" : "tcp", tcp_port);
+    fflush(stdout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    BSLTarget target(cfg);
+    BSLTarget::_reply reply;
+    TelnetServer telnet(verbose_level);
+    _timeline tl;
+    std::deque<_pending> out;
+    bool in_session = false;
+    uint64_t session_start_us = 0;
+    uint64_t virtual_now_us = 0;
+    uint8_t buf[4096];
+    uint8_t data[4096];
+
+    auto end_session = [&]() {
+        print_counters(target, tl.tx_line_until - session_start_us);
+        fflush(stdout);
+        target.reset();
+        in_session = false;
+    };
+
+    while(!stop) {
+        // sleep until input or the next due response, whatever comes first
+        timespec timeout = from_us(200000);
+        if(!out.empty()) {
+            const uint64_t now_us = to_us(BSLTiming::now());
+            timeout = from_us(out.front().due_us > now_us ? std::min<uint64_t>(out.front().due_us - now_us, 200000) : 0);
+        }
+
+        pollfd pfd[2];
+        nfds_t nfds = 0;
+        if(link >= 0)
+            pfd[nfds++] = {.fd=link, .events=POLLIN, .revents=0};
+        if(listener >= 0 && link < 0)
+            pfd[nfds++] = {.fd=listener, .events=POLLIN, .revents=0};
+
+        if(ppoll(pfd, nfds, &timeout, nullptr) > 0) {
+            if(pfd[0].fd == listener && (pfd[0].revents & POLLIN)) {
+                link = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                int one = 1;
+                setsockopt(link, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                telnet.reset();
+                if(verbose_level > 0)
+                    printf("client connected\n");
+            } else if(pfd[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t n = read(link, buf, sizeof(buf));
+                if(n <= 0 && listener >= 0) {
+                    // client gone, the next one starts a new session
+                    close(link);
+                    link = -1;
+                    out.clear();
+                    if(in_session)
+                        end_session();
+                    if(verbose_level > 0)
+                        printf("client disconnected\n");
+                    continue;
+                }
+
+                // in virtual time the host answers instantly after the last response
+                const uint64_t arrival_us = (virtual_time ? virtual_now_us : to_us(BSLTiming::now())) + net_delay_us;
+                if(n > 0 && !in_session) {
+                    session_start_us = arrival_us;
+                    in_session = true;
+                }
+
+                const uint8_t* payload = buf;
+                if(rfc2217) {
+                    std::vector<uint8_t> answers;
+                    n = telnet.decode(buf, n, data, answers);
+                    payload = data;
+                    if(!answers.empty())
+                        write_all(link, answers.data(), answers.size());
+                }
+
+                if(n > 0)
+                    target.feed(payload, n);
+                while(n > 0 && target.process(reply)) {
+                    tl.rx_line_until = std::max(tl.rx_line_until, arrival_us) + target.wire_us(reply.rx_len);
+                    tl.device_until = std::max(tl.device_until, tl.rx_line_until) + reply.busy_us;
+                    tl.tx_line_until = std::max(tl.tx_line_until, tl.device_until) + target.wire_us(reply.tx.size());
+
+                    if(virtual_time)
+                        virtual_now_us = tl.tx_line_until + net_delay_us;
+
+                    _pending p = {virtual_time ? 0 : tl.tx_line_until + net_delay_us, {}};
+                    if(rfc2217)
+                        TelnetServer::escape(reply.tx, p.data);
+                    else
+                        p.data = reply.tx;
+                    out.push_back(std::move(p));
+
+                    if(verbose_level > 1) {
+                        printf("frame %zu bytes -> %zu bytes, busy %luus\n", reply.rx_len, reply.tx.size(), reply.busy_us);
+                    }
+
+                    if(reply.new_baud != 0) {
+                        if(verbose_level > 0)
+                            printf("baudrate %u -> %u\n", target.get_baud(), reply.new_baud);
+                        target.set_baud(reply.new_baud);
+                    }
+
+                    if(reply.reset)
+                        end_session();
+                }
+            }
+        }
+
+        // release due responses
+        const uint64_t now_us = to_us(BSLTiming::now());
+        while(!out.empty() && out.front().due_us <= now_us) {
+            if(link >= 0 && !write_all(link, out.front().data.data(), out.front().data.size())) {
+                printf("Short write to link\n");
+            }
+            out.pop_front();
+        }
+    }
+
+    if(in_session)
+        print_counters(target, tl.tx_line_until - session_start_us);
+
+    if(link_path != nullptr)
+        unlink(link_path);
+    if(listener >= 0)
+        close(listener);
+    if(link >= 0 && link != master)
+        close(link);
+    if(slave >= 0)
+        close(slave);
+    if(master >= 0)
+        close(master);
+
+    return 0;
+}
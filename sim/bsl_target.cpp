@@ -0,0 +1,329 @@
+/*
+ * bsl_target.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "bsl_target.h"
+#include "bsl_protocol.h"
+#include <cstring>
+
+static constexpr uint8_t header_len = 3;
+static constexpr uint8_t crc_len = 4;
+
+BSLTarget::BSLTarget(_config _cfg) : cfg(_cfg), flash(_cfg.flash_size, 0xFF), baud(_cfg.initial_baud), rng(_cfg.error_seed)
+{
+
+}
+
+void BSLTarget::reset()
+{
+    // flash content survives, session state does not
+    rx.clear();
+    unlocked = false;
+    baud = cfg.initial_baud;
+}
+
+uint64_t BSLTarget::wire_us(size_t bytes) const
+{
+    // 8N1: 10 bit times per byte
+    return (uint64_t) bytes * 10 * 1000000 / baud;
+}
+
+uint32_t BSLTarget::baud_from_id(uint8_t id)
+{
+    switch(static_cast<BSL::Baudrate>(id)) {
+    case BSL::Baudrate::BSL_B4800:
+        return 4800;
+    case BSL::Baudrate::BSL_B9600:
+        return 9600;
+    case BSL::Baudrate::BSL_B19200:
+        return 19200;
+    case BSL::Baudrate::BSL_B38400:
+        return 38400;
+    case BSL::Baudrate::BSL_B57600:
+        return 57600;
+    case BSL::Baudrate::BSL_B115200:
+        return 115200;
+    case BSL::Baudrate::BSL_B1000000:
+        return 1000000;
+    case BSL::Baudrate::BSL_B2000000:
+        return 2000000;
+    case BSL::Baudrate::BSL_B3000000:
+        return 3000000;
+    default:
+        return 0;
+    }
+}
+
+void BSLTarget::feed(const uint8_t* data, size_t len)
+{
+    const size_t start = rx.size();
+    rx.insert(rx.end(), data, data + len);
+    inject_errors(&rx[start], len);
+}
+
+void BSLTarget::inject_errors(uint8_t* data, size_t len)
+{
+    if(cfg.error_rate <= 0)
+        return;
+
+    std::bernoulli_distribution hit(cfg.error_rate);
+    std::uniform_int_distribution<int> bit(0, 7);
+    for(size_t i = 0; i < len; i++) {
+        if(hit(rng)) {
+            data[i] ^= 1 << bit(rng);
+            counters.injected_errors++;
+        }
+    }
+}
+
+bool BSLTarget::process(_reply &reply)
+{
+    if(!process_frame(reply))
+        return false;
+
+    inject_errors(reply.tx.data(), reply.tx.size());
+    return true;
+}
+
+bool BSLTarget::process_frame(_reply &reply)
+{
+    reply = _reply();
+
+    if(rx.empty())
+        return false;
+
+    // the BSL answers every broken packet with a single error ACK
+    if(rx[0] != BSL::CMD_HEADER) {
+        reply.tx.push_back(static_cast<uint8_t>(BSL::AckType::BSL_ERROR_HEADER_INCORRECT));
+        reply.rx_len = 1;
+        rx.erase(rx.begin());
+        counters.bad_frames++;
+        return true;
+    }
+
+    if(rx.size() < header_len)
+        return false;
+
+    uint16_t len;
+    memcpy(&len, &rx[1], 2);
+
+    if(len == 0 || len > cfg.max_buff_size) {
+        reply.tx.push_back(static_cast<uint8_t>(len == 0 ? BSL::AckType::BSL_ERROR_PACKET_SIZE_ZERO : BSL::AckType::BSL_ERROR_PACKET_SIZE_TOO_BIG));
+        reply.rx_len = header_len;
+        rx.erase(rx.begin(), rx.begin() + header_len);
+        counters.bad_frames++;
+        return true;
+    }
+
+    const size_t frame_len = header_len + len + crc_len;
+    if(rx.size() < frame_len)
+        return false;
+
+    reply.rx_len = frame_len;
+    reply.busy_us = cfg.us_cmd_overhead;
+
+    uint32_t crc;
+    memcpy(&crc, &rx[header_len + len], 4);
+    if(BSL::softwareCRC(&rx[header_len], len) != crc) {
+        reply.tx.push_back(static_cast<uint8_t>(BSL::AckType::BSL_ERROR_CHECKSUM_INCORRECT));
+        counters.bad_frames++;
+    } else {
+        reply.tx.push_back(static_cast<uint8_t>(BSL::AckType::BSL_ACK));
+        handle(&rx[header_len], len, reply);
+        counters.frames++;
+    }
+
+    rx.erase(rx.begin(), rx.begin() + frame_len);
+    return true;
+}
+
+void BSLTarget::respond(_reply &reply, uint8_t rsp, const uint8_t* data, uint16_t len)
+{
+    const uint16_t core_len = 1 + len;
+    const size_t start = reply.tx.size();
+
+    reply.tx.resize(start + header_len + core_len + crc_len);
+    uint8_t* p = &reply.tx[start];
+    p[0] = BSL::RSP_HEADER;
+    memcpy(p+1, &core_len, 2);
+    p[3] = rsp;
+    if(len > 0)
+        memcpy(p+4, data, len);
+
+    uint32_t crc = BSL::softwareCRC(p + header_len, core_len);
+    memcpy(p + header_len + core_len, &crc, 4);
+}
+
+void BSLTarget::respond_message(_reply &reply, uint8_t msg)
+{
+    respond(reply, static_cast<uint8_t>(BSL::CoreResponse::Message), &msg, 1);
+}
+
+bool BSLTarget::in_flash(uint32_t addr, uint32_t len) const
+{
+    return (uint64_t) addr + len <= flash.size();
+}
+
+uint64_t BSLTarget::erase(uint32_t start, uint32_t end)
+{
+    // whole sectors covering [start, end]
+    uint32_t first = start / cfg.sector_size;
+    uint32_t last = end / cfg.sector_size;
+    for(uint32_t s = first; s <= last; s++) {
+        memset(&flash[s * cfg.sector_size], 0xFF, cfg.sector_size);
+    }
+    counters.sectors_erased += last - first + 1;
+    return (uint64_t) (last - first + 1) * cfg.us_sector_erase;
+}
+
+void BSLTarget::handle(const uint8_t* core, uint16_t len, _reply &reply)
+{
+    using BSL::CoreCmd;
+    using BSL::CoreMessage;
+
+    const auto cmd = static_cast<CoreCmd>(core[0]);
+    const uint8_t* data = core + 1;
+    const uint16_t data_len = len - 1;
+    uint32_t a = 0, b = 0;
+    if(data_len >= 4)
+        memcpy(&a, data, 4);
+    if(data_len >= 8)
+        memcpy(&b, data+4, 4);
+
+    const bool needs_unlock = (cmd == CoreCmd::MassErase) || (cmd == CoreCmd::FlashRangeErase) ||
+        (cmd == CoreCmd::ProgramData) || (cmd == CoreCmd::ProgramDataFast) ||
+        (cmd == CoreCmd::MemoryRead) || (cmd == CoreCmd::StandaloneVerification);
+    if(needs_unlock && !unlocked) {
+        if(cmd != CoreCmd::ProgramDataFast)
+            respond_message(reply, static_cast<uint8_t>(CoreMessage::BSL_LOCKED));
+        return;
+    }
+
+    switch(cmd) {
+    case CoreCmd::Connection:
+        break;
+
+    case CoreCmd::GetDeviceInfo: {
+        uint8_t info[24] = {0};
+        const uint16_t cmd_interpreter_version = 0x0001;
+        const uint16_t build_id = 0x0100;
+        const uint32_t app_version = 0x00000000;
+        const uint16_t plugin_if_version = 0x0001;
+        const uint32_t bsl_buff_start_addr = 0x20000160;
+        const uint32_t bcr_conf_id = 0x00000001;
+        const uint32_t bsl_conf_id = 0x00000001;
+        memcpy(info+0, &cmd_interpreter_version, 2);
+        memcpy(info+2, &build_id, 2);
+        memcpy(info+4, &app_version, 4);
+        memcpy(info+8, &plugin_if_version, 2);
+        memcpy(info+10, &cfg.max_buff_size, 2);
+        memcpy(info+12, &bsl_buff_start_addr, 4);
+        memcpy(info+16, &bcr_conf_id, 4);
+        memcpy(info+20, &bsl_conf_id, 4);
+        respond(reply, static_cast<uint8_t>(BSL::CoreResponse::GetDeviceInfo), info, sizeof(info));
+        break;
+    }
+
+    case CoreCmd::UnlockBootloader:
+        unlocked = (data_len == sizeof(default_password)) && (memcmp(data, default_password, sizeof(default_password)) == 0);
+        respond_message(reply, static_cast<uint8_t>(unlocked ? CoreMessage::SUCCESS : CoreMessage::BSL_PWD_ERR));
+        break;
+
+    case CoreCmd::MassErase:
+        memset(flash.data(), 0xFF, flash.size());
+        counters.sectors_erased += flash.size() / cfg.sector_size;
+        reply.busy_us += cfg.us_mass_erase;
+        respond_message(reply, static_cast<uint8_t>(CoreMessage::SUCCESS));
+        break;
+
+    case CoreCmd::FlashRangeErase:
+        if(data_len < 8 || b < a || !in_flash(a, b - a + 1)) {
+            respond_message(reply, static_cast<uint8_t>(CoreMessage::INVALID_MEM_RANGE));
+            break;
+        }
+        reply.busy_us += erase(a, b);
+        respond_message(reply, static_cast<uint8_t>(CoreMessage::SUCCESS));
+        break;
+
+    case CoreCmd::ProgramData:
+    case CoreCmd::ProgramDataFast: {
+        const uint32_t n = data_len >= 4 ? data_len - 4 : 0;
+        uint8_t msg = static_cast<uint8_t>(CoreMessage::SUCCESS);
+        if(data_len < 4 || (a % 8) != 0 || (n % 8) != 0) {
+            msg = static_cast<uint8_t>(CoreMessage::INV_ADDR_OR_LEN);
+        } else if(!in_flash(a, n)) {
+            msg = static_cast<uint8_t>(CoreMessage::INVALID_MEM_RANGE);
+        } else {
+            const bool lost = ++counters.program_frames == cfg.lose_program_answer;
+            const uint32_t written = (lost && cfg.lose_torn) ? n / 16 * 8 : n;
+            // flash cells only go from 1 to 0 without an erase
+            for(uint32_t w = 0; w < written; w += 8) {
+                bool erased = true;
+                for(uint32_t i = w; i < w + 8; i++) {
+                    erased = erased && flash[a + i] == 0xFF;
+                    flash[a + i] &= data[4 + i];
+                }
+                if(!erased)
+                    counters.words_reprogrammed++;
+            }
+            counters.bytes_programmed += written;
+            reply.busy_us += (uint64_t) (written / 8) * cfg.us_word_program;
+            if(lost) {
+                reply.tx.clear();
+                break;
+            }
+        }
+        // fast variant only acknowledges the packet
+        if(cmd == CoreCmd::ProgramData)
+            respond_message(reply, msg);
+        break;
+    }
+
+    case CoreCmd::MemoryRead:
+        if(!cfg.readout_enabled) {
+            respond_message(reply, static_cast<uint8_t>(CoreMessage::READOUT_ERR));
+        } else if(data_len < 8 || !in_flash(a, b) || b + 1 > cfg.max_buff_size) {
+            respond_message(reply, static_cast<uint8_t>(CoreMessage::INVALID_MEM_RANGE));
+        } else {
+            respond(reply, static_cast<uint8_t>(BSL::CoreResponse::MemoryRead), &flash[a], b);
+        }
+        break;
+
+    case CoreCmd::StandaloneVerification:
+        if(data_len < 8 || !in_flash(a, b)) {
+            respond_message(reply, static_cast<uint8_t>(CoreMessage::INVALID_MEM_RANGE));
+        } else if(b < 1024) {
+            respond_message(reply, static_cast<uint8_t>(CoreMessage::INV_LEN_VERIFICATION));
+        } else {
+            uint32_t crc = BSL::softwareCRC(&flash[a], b);
+            reply.busy_us += (uint64_t) b * cfg.us_crc_per_kb / 1024;
+            respond(reply, static_cast<uint8_t>(BSL::CoreResponse::StandaloneVerification), (uint8_t*) &crc, 4);
+        }
+        break;
+
+    case CoreCmd::StartApplication:
+        reply.reset = true;
+        break;
+
+    case CoreCmd::ChangeBaudrate: {
+        uint32_t new_baud = data_len >= 1 ? baud_from_id(data[0]) : 0;
+        if(new_baud == 0) {
+            reply.tx.back() = static_cast<uint8_t>(BSL::AckType::BSL_ERROR_UNKNOWN_BAUD_RATE);
+        } else {
+            reply.new_baud = new_baud;
+        }
+        break;
+    }
+
+    case CoreCmd::FactoryReset:
+        respond_message(reply, static_cast<uint8_t>(CoreMessage::FACTORY_RESET_DISABLED));
+        break;
+
+    default:
+        respond_message(reply, static_cast<uint8_t>(CoreMessage::UNKNOWN_CMD));
+        break;
+    }
+}
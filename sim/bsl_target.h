@@ -0,0 +1,103 @@
+/*
+ * bsl_target.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <cstddef>
+#include <random>
+#include <vector>
+
+/*
+ * Device side of the MSPM0 BSL UART protocol with an in-memory flash model.
+ *
+ * The model does not sleep, it reports how long the device would be busy
+ * with each frame and how long the bytes take on the wire at the current
+ * baudrate. Callers turn that into real or virtual time.
+ */
+class BSLTarget {
+    public:
+        struct _config {
+            uint32_t flash_size = 128 * 1024;
+            uint32_t sector_size = 1024;
+            uint16_t max_buff_size = 0x06C0;
+            uint32_t initial_baud = 9600;
+            bool readout_enabled = true;
+
+            // line errors: probability of a flipped bit per byte, both directions
+            double error_rate = 0;
+            uint32_t error_seed = 1;
+            // a lost answer: the n-th ProgramData frame (from 1) gets none, torn leaves its second half unwritten
+            uint64_t lose_program_answer = 0;
+            bool lose_torn = false;
+
+            // device latencies
+            uint32_t us_cmd_overhead = 100;     // packet check + dispatch
+            uint32_t us_word_program = 50;      // per 64 bit flash word
+            uint32_t us_sector_erase = 4000;
+            uint32_t us_mass_erase = 25000;
+            uint32_t us_crc_per_kb = 200;       // standalone verification
+        };
+
+        // result of one processed frame
+        struct _reply {
+            std::vector<uint8_t> tx;    // ACK + optional response packet
+            size_t rx_len = 0;          // bytes of the consumed frame
+            uint64_t busy_us = 0;       // device processing time
+            uint32_t new_baud = 0;      // switch after tx was sent, 0 = keep
+            bool reset = false;         // StartApplication, device leaves BSL after tx
+        };
+
+        struct _counters {
+            uint64_t frames = 0;
+            uint64_t bad_frames = 0;
+            uint64_t bytes_programmed = 0;
+            uint64_t words_reprogrammed = 0;    // programmed again without an erase, breaks the ECC on a real device
+            uint64_t sectors_erased = 0;
+            uint64_t injected_errors = 0;
+            uint64_t program_frames = 0;
+        };
+
+        static constexpr uint8_t default_password[32] = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+        };
+
+        BSLTarget(_config _cfg);
+        BSLTarget() : BSLTarget(_config()) {}
+
+        void feed(const uint8_t* data, size_t len);
+        bool process(_reply &reply);
+        void reset();
+
+        uint32_t get_baud() const { return baud; }
+        void set_baud(uint32_t _baud) { baud = _baud; }
+        uint64_t wire_us(size_t bytes) const;
+
+        const std::vector<uint8_t> &get_flash() const { return flash; }
+        const _counters &get_counters() const { return counters; }
+
+        static uint32_t baud_from_id(uint8_t id);
+
+    private:
+        bool process_frame(_reply &reply);
+        void handle(const uint8_t* core, uint16_t len, _reply &reply);
+        void respond(_reply &reply, uint8_t rsp, const uint8_t* data, uint16_t len);
+        void respond_message(_reply &reply, uint8_t msg);
+        bool in_flash(uint32_t addr, uint32_t len) const;
+        void inject_errors(uint8_t* data, size_t len);
+        uint64_t erase(uint32_t start, uint32_t end);
+
+        _config cfg;
+        std::vector<uint8_t> flash;
+        std::vector<uint8_t> rx;
+        uint32_t baud;
+        bool unlocked = false;
+        _counters counters;
+        std::mt19937 rng;
+};
@@ -0,0 +1,74 @@
+/*
+ * loopback_transport.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+
+#include "loopback_transport.h"
+#include <cstring>
+
+void LoopbackTransport::_flush()
+{
+    rx.clear();
+    rx_head = 0;
+}
+
+const uint8_t* LoopbackTransport::peek(size_t len, int)
+{
+    if(rx.size() - rx_head < len)
+        return nullptr;
+    return &rx[rx_head];
+}
+
+void LoopbackTransport::consume(size_t len)
+{
+    rx_head += len;
+    if(rx_head >= rx.size())
+        _flush();
+}
+
+uint8_t* LoopbackTransport::prepare(size_t len)
+{
+    if(tx.size() < len)
+        tx.resize(len);
+    return tx.data();
+}
+
+int LoopbackTransport::commit(size_t len)
+{
+    if(trace != nullptr)
+        trace->record(WireTrace::Direction::TX, tx.data(), len);
+
+    target.feed(tx.data(), len);
+    while(target.process(reply)) {
+        modeled += target.wire_us(reply.rx_len) + reply.busy_us + target.wire_us(reply.tx.size());
+        if(trace != nullptr)
+            trace->record(WireTrace::Direction::RX, reply.tx.data(), reply.tx.size());
+        rx.insert(rx.end(), reply.tx.begin(), reply.tx.end());
+
+        if(reply.new_baud != 0)
+            target.set_baud(reply.new_baud);
+        if(reply.reset)
+            target.reset();
+    }
+
+    return len;
+}
+
+int LoopbackTransport::writeBytes(const char buff[], size_t buf_size)
+{
+    memcpy(prepare(buf_size), buff, buf_size);
+    return commit(buf_size);
+}
+
+int LoopbackTransport::readBytes(char buff[], size_t buf_size, int _max_timeout_tries)
+{
+    const uint8_t* src = peek(buf_size, _max_timeout_tries);
+    if(src == nullptr)
+        return -1;
+
+    memcpy(buff, src, buf_size);
+    consume(buf_size);
+    return buf_size;
+}
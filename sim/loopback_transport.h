@@ -0,0 +1,47 @@
+/*
+ * loopback_transport.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "transport.h"
+#include "bsl_target.h"
+
+/*
+ * In-process link to a BSLTarget, no file descriptors and no sleeping.
+ *
+ * commit() hands the prepared packet straight to the device model and
+ * queues its replies, peek() serves them in place. A read the model has no
+ * bytes for is a timeout right away. The time the exchange would take on a
+ * real line is accumulated from the model, see modeled_us().
+ */
+class LoopbackTransport : public Transport {
+    public:
+        LoopbackTransport(BSLTarget &_target, int _verbose_level=0) : Transport(_verbose_level), target(_target) {}
+
+        bool _open(speed_t = B9600) override { return true; }
+        int _close() override { return 0; }
+        void _flush() override;
+        bool set_baud(speed_t) override { return true; }
+        int readBytes(char buff[], size_t buf_size, int _max_timeout_tries=10) override;
+        int writeBytes(const char buff[], size_t buf_size) override;
+
+        const uint8_t* peek(size_t len, int _max_timeout_tries=10) override;
+        void consume(size_t len) override;
+        uint8_t* prepare(size_t len) override;
+        int commit(size_t len) override;
+
+        uint64_t modeled_us() const { return modeled; }
+        // reply bytes not consumed yet
+        size_t pending() const { return rx.size() - rx_head; }
+
+    private:
+        BSLTarget &target;
+        BSLTarget::_reply reply;
+        std::vector<uint8_t> tx;
+        std::vector<uint8_t> rx;
+        size_t rx_head = 0;
+        uint64_t modeled = 0;
+};
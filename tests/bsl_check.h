@@ -0,0 +1,103 @@
+/*
+ * bsl_check.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "stdint.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Checks of the behaviour tests, one executable per test registered with
+ * CTest. A failed check is printed and counted, main() returns report().
+ */
+namespace BSLCheck {
+    inline int failures = 0;
+
+    // end of main(): the exit status of the test
+    inline int report()
+    {
+        if(failures == 0)
+            printf("all checks passed\n");
+        return failures;
+    }
+
+    // images and payloads, the same bytes for the same seed on every run
+    inline std::vector<uint8_t> random_bytes(size_t len, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> data(len);
+        for(uint8_t &b : data)
+            b = rng();
+        return data;
+    }
+
+    /*
+     * Scratch directory of a test under /tmp, removed with everything in it
+     * when it goes out of scope. set_state_home() moves journals, timeouts and
+     * calibrations of the code under test into it.
+     */
+    class TempDir {
+        public:
+            TempDir(const char* name)
+            {
+                std::string tmpl = std::string("/tmp/") + name + ".XXXXXX";
+                if(mkdtemp(tmpl.data()) != nullptr)
+                    dir = tmpl;
+                else
+                    printf("Can not create a directory for %s\n", name);
+            }
+
+            ~TempDir()
+            {
+                if(dir.empty())
+                    return;
+                // depth first, the entries before their directory; symlinks are not followed
+                auto remove_entry = [](const char* path, const struct stat*, int, struct FTW*) { return remove(path); };
+                if(nftw(dir.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS) != 0)
+                    printf("Could not remove %s\n", dir.c_str());
+            }
+
+            TempDir(const TempDir&) = delete;
+            TempDir &operator=(const TempDir&) = delete;
+
+            bool ok() const { return !dir.empty(); }
+            const std::string &path() const { return dir; }
+            std::string file(const char* name) const { return dir + "/" + name; }
+
+            // returns the path of the written file
+            std::string write_file(const char* name, const void* data, size_t len) const
+            {
+                const std::string path = file(name);
+                FILE* f = fopen(path.c_str(), "wb");
+                if(f == nullptr || fwrite(data, 1, len, f) != len) {
+                    printf("Can not write %s\n", path.c_str());
+                    failures++;
+                }
+                if(f != nullptr)
+                    fclose(f);
+                return path;
+            }
+            std::string write_file(const char* name, const std::vector<uint8_t> &bytes) const { return write_file(name, bytes.data(), bytes.size()); }
+            std::string write_file(const char* name, const std::string &text) const { return write_file(name, text.data(), text.size()); }
+
+            void set_state_home() const { setenv("XDG_STATE_HOME", dir.c_str(), 1); }
+
+        private:
+            std::string dir;
+    };
+};
+
+#define CHECK(cond) do { \
+        if(!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            BSLCheck::failures++; \
+        } \
+    } while(0)
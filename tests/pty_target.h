@@ -0,0 +1,99 @@
+/*
+ * pty_target.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ */
+#pragma once
+
+#include "bsl_target.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+/*
+ * The simulator's device model behind a pty, for tests that need a real port
+ * path: journals and timeouts are kept per path, the daemon and the C API
+ * open ports by name.
+ */
+class PtyTarget {
+    public:
+        PtyTarget(const BSLTarget::_config &cfg = BSLTarget::_config()) : target(cfg)
+        {
+            master = posix_openpt(O_RDWR | O_NOCTTY);
+            grantpt(master);
+            unlockpt(master);
+            path = ptsname(master);
+
+            // held open, the master sees no hangup between sessions
+            slave = open(path.c_str(), O_RDWR | O_NOCTTY);
+            termios tty;
+            tcgetattr(slave, &tty);
+            cfmakeraw(&tty);
+            tcsetattr(slave, TCSANOW, &tty);
+
+            pump = std::thread([this]() { run(); });
+        }
+
+        ~PtyTarget()
+        {
+            stop = true;
+            pump.join();
+            close(slave);
+            close(master);
+        }
+
+        BSLTarget::_counters counters()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return target.get_counters();
+        }
+
+        std::vector<uint8_t> flash()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return target.get_flash();
+        }
+
+        std::string path;
+
+    private:
+        void run()
+        {
+            uint8_t buf[4096];
+            BSLTarget::_reply reply;
+            while(!stop) {
+                pollfd pfd = {.fd=master, .events=POLLIN, .revents=0};
+                if(poll(&pfd, 1, 50) <= 0)
+                    continue;
+                ssize_t n = read(master, buf, sizeof(buf));
+                if(n <= 0)
+                    continue;
+
+                std::lock_guard<std::mutex> guard(lock);
+                target.feed(buf, n);
+                while(target.process(reply)) {
+                    if(write(master, reply.tx.data(), reply.tx.size()) != (ssize_t) reply.tx.size())
+                        printf("Short write to the pty\n");
+                    if(reply.new_baud != 0)
+                        target.set_baud(reply.new_baud);
+                    if(reply.reset)
+                        target.reset();
+                }
+            }
+        }
+
+        BSLTarget target;
+        std::mutex lock;
+        std::thread pump;
+        std::atomic<bool> stop{false};
+        int master = -1;
+        int slave = -1;
+};
@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# sim_flash.sh
+#
+#  Created on: Oct 18, 2026
+#      Author: Jonas Rockstroh
+#
+# Flashes an image through the pty simulator with the real CLI, clean and with
+# line errors, and checks the exit status and what the simulated device saw.
+#
+# usage: sim_flash.sh <MSPM0_bsl_sim> <MSPM0_bsl_flasher>
+
+sim=$1
+flasher=$2
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+# journals and calibration stay out of the user's state directory
+export XDG_STATE_HOME="$work/state"
+
+# the same bytes every run, the injected errors hit the same frames
+seq 1 5000 | head -c 20480 > "$work/image.bin"
+failed=0
+
+# run <name> <simulator options> -- <flasher options>
+run() {
+    name=$1
+    shift
+    sim_opts=
+    while [ "$1" != "--" ]; do
+        sim_opts="$sim_opts $1"
+        shift
+    done
+    shift
+
+    "$sim" --link "$work/pty" --virtual-time $sim_opts > "$work/sim.log" 2>&1 &
+    sim_pid=$!
+    i=0
+    while [ ! -e "$work/pty" ] && [ $i -lt 50 ]; do
+        sleep 0.1
+        i=$((i + 1))
+    done
+
+    "$flasher" flash "$work/pty" "$work/image.bin" --enter-bsl false --resume false --progress off "$@" > "$work/flash.log" 2>&1
+    status=$?
+    kill -INT $sim_pid
+    wait $sim_pid
+    rm -f "$work/pty"
+
+    if [ $status -ne 0 ]; then
+        echo "$name: flash failed with status $status"
+        cat "$work/flash.log"
+        failed=1
+    elif ! grep -q "programmed: 20480 bytes" "$work/sim.log"; then
+        echo "$name: device was not programmed with exactly the image"
+        cat "$work/sim.log"
+        failed=1
+    elif grep -q "programmed again" "$work/sim.log"; then
+        echo "$name: flash words were programmed twice"
+        cat "$work/sim.log"
+        failed=1
+    else
+        echo "$name: ok"
+    fi
+}
+
+run clean -- --window 1
+run window4 -- --window 4 --pipeline true
+run line_errors --error-rate 0.0002 --seed 3 -- --window 4 --retries 8
+
+exit $failed
@@ -0,0 +1,193 @@
+/*
+ * test_c_api.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * C API from a C translation unit: a session on the pty simulator flashes a
+ * buffer and a file, verifies and dumps them, and reports through its
+ * callbacks.
+ *
+ * usage: test_c_api <MSPM0_bsl_sim>
+ */
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 700
+
+#include "mspm0_bsl.h"
+#include <ftw.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if(!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while(0)
+
+struct events {
+    int lines;
+    int program_phases;
+    uint32_t done;
+    uint32_t total;
+};
+
+static void on_event(void* user, mspm0_bsl_event event, const char* text)
+{
+    struct events* ev = (struct events*) user;
+    if(event == MSPM0_BSL_EVENT_LOG)
+        ev->lines++;
+    else if(!strcmp(text, "program"))
+        ev->program_phases++;
+}
+
+static void on_progress(void* user, uint32_t done, uint32_t total)
+{
+    struct events* ev = (struct events*) user;
+    ev->done = done;
+    ev->total = total;
+}
+
+static void fill(uint8_t* image, uint32_t size, uint32_t seed)
+{
+    for(uint32_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+}
+
+static int write_file(const char* path, const uint8_t* data, size_t len)
+{
+    FILE* f = fopen(path, "wb");
+    if(f == NULL)
+        return 0;
+    const int ok = fwrite(data, 1, len, f) == len;
+    fclose(f);
+    return ok;
+}
+
+static int remove_entry(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+    (void) st;
+    (void) type;
+    (void) ftw;
+    return remove(path);
+}
+
+static void test_session(const char* port, const char* dir)
+{
+    enum { size = 4096 };
+    static uint8_t image[size], other[size], dump[size];
+    fill(image, size, 1);
+    fill(other, size, 2);
+
+    mspm0_bsl_config config;
+    mspm0_bsl_config_init(&config);
+    CHECK(config.entry == MSPM0_BSL_ENTRY_GPIO && config.max_retries == 3 && config.resume == 1);
+    config.port = port;
+    config.entry = MSPM0_BSL_ENTRY_NONE;
+    config.resume = 0;
+
+    mspm0_bsl_status status;
+    mspm0_bsl_session* session = mspm0_bsl_open(&config, &status);
+    CHECK(session != NULL && status == MSPM0_BSL_OK);
+    if(session == NULL)
+        return;
+
+    struct events ev = {0, 0, 0, 0};
+    mspm0_bsl_set_callbacks(session, on_event, on_progress, &ev);
+
+    // a buffer
+    mspm0_bsl_result result;
+    CHECK(mspm0_bsl_flash(session, image, size, 1, &result) == MSPM0_BSL_OK);
+    CHECK(result.programmed && result.verified && result.started && !result.up_to_date);
+    CHECK(result.image_size == size && result.frames > 0);
+    const uint32_t image_crc = result.image_crc;
+    CHECK(ev.lines > 0 && ev.program_phases == 1);
+    CHECK(ev.done == size && ev.total == size);
+
+    CHECK(mspm0_bsl_verify(session, image, size, &result) == MSPM0_BSL_OK);
+    CHECK(mspm0_bsl_verify(session, other, size, &result) == MSPM0_BSL_ERR_VERIFY);
+    CHECK(mspm0_bsl_dump(session, 0x0, size, dump) == MSPM0_BSL_OK);
+    CHECK(!memcmp(dump, image, size));
+
+    // a file, streamed; the same one again is already there
+    char path[256];
+    snprintf(path, sizeof(path), "%s/other.bin", dir);
+    CHECK(write_file(path, other, size));
+    CHECK(mspm0_bsl_flash_file(session, path, 0, &result) == MSPM0_BSL_OK);
+    CHECK(result.programmed && result.verified && result.image_size == size && result.image_crc != image_crc);
+    CHECK(mspm0_bsl_dump(session, 0x0, size, dump) == MSPM0_BSL_OK);
+    CHECK(!memcmp(dump, other, size));
+    CHECK(mspm0_bsl_flash_file(session, path, 0, &result) == MSPM0_BSL_OK);
+    CHECK(result.up_to_date && !result.programmed);
+
+    // without its callbacks the output goes to stdout
+    mspm0_bsl_set_callbacks(session, NULL, NULL, NULL);
+    snprintf(path, sizeof(path), "%s/missing.bin", dir);
+    CHECK(mspm0_bsl_flash_file(session, path, 0, &result) == MSPM0_BSL_ERR_IMAGE);
+    CHECK(mspm0_bsl_flash(session, NULL, size, 0, &result) == MSPM0_BSL_ERR_ARGUMENT);
+
+    mspm0_bsl_close(session);
+}
+
+static void test_arguments(void)
+{
+    mspm0_bsl_status status;
+    mspm0_bsl_config config;
+    mspm0_bsl_config_init(&config);
+    CHECK(mspm0_bsl_open(&config, &status) == NULL && status == MSPM0_BSL_ERR_ARGUMENT);
+    CHECK(mspm0_bsl_open(NULL, NULL) == NULL);
+    CHECK(!strcmp(mspm0_bsl_status_string(MSPM0_BSL_OK), "ok"));
+    CHECK(!strcmp(mspm0_bsl_status_string(MSPM0_BSL_ERR_VERIFY), "verification failed"));
+    mspm0_bsl_close(NULL);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc != 2) {
+        printf("usage: %s <MSPM0_bsl_sim>\n", argv[0]);
+        return 1;
+    }
+
+    char dir[] = "/tmp/test_c_api.XXXXXX";
+    if(mkdtemp(dir) == NULL) {
+        printf("Can not create a directory for test_c_api\n");
+        return 1;
+    }
+    // journals and calibration stay out of the user's state directory
+    setenv("XDG_STATE_HOME", dir, 1);
+    char port[256];
+    snprintf(port, sizeof(port), "%s/pty", dir);
+
+    const pid_t sim = fork();
+    if(sim == 0) {
+        if(freopen("/dev/null", "w", stdout) == NULL)
+            _exit(1);
+        execl(argv[1], argv[1], "--link", port, (char*) NULL);
+        _exit(1);
+    }
+    for(int i = 0; i < 50 && access(port, F_OK) != 0; i++)
+        usleep(100000);
+    CHECK(access(port, F_OK) == 0);
+
+    test_arguments();
+    test_session(port, dir);
+
+    kill(sim, SIGINT);
+    waitpid(sim, NULL, 0);
+    if(nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS) != 0)
+        printf("Could not remove %s\n", dir);
+
+    if(failures == 0)
+        printf("all checks passed\n");
+    return failures;
+}
@@ -0,0 +1,140 @@
+/*
+ * test_cli.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Command lines as they were written for the Boost parser, through the
+ * option tables of main(): same values, same errors.
+ */
+
+#include "bsl_check.h"
+#include "bsl_cli.h"
+#include "bsl_cli_options.h"
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const BSLCli::_command commands[] = {
+    {"flash", "", {BSLCli::group(BSLCli::flash_options), BSLCli::group(BSLCli::entry_options)}, nullptr},
+    {"reset", "", {BSLCli::group(BSLCli::gpio_options), BSLCli::group(BSLCli::entry_options)}, nullptr},
+    {"enter_bsl", "", {BSLCli::group(BSLCli::gpio_options), BSLCli::group(BSLCli::entry_options)}, nullptr},
+    {"read_binary_version", "", {BSLCli::group(BSLCli::read_binary_version_options)}, nullptr},
+    {"inventory", "", {BSLCli::group(BSLCli::inventory_options), BSLCli::group(BSLCli::entry_options)}, nullptr},
+};
+
+struct _case {
+    std::vector<const char*> argv;      // command name first
+    std::vector<std::pair<const char*, const char*>> values;   // nullptr: not given
+    const char* error;                  // start of the expected message, nullptr: parses
+};
+
+static const _case cases[] = {
+    // flash
+    {{"flash", "/dev/ttyACM0", "/home/foo/bar.bin"},
+        {{"serial-port", "/dev/ttyACM0"}, {"firmware-file", "/home/foo/bar.bin"}, {"enter-bsl", "true"},
+         {"verbose", "0"}, {"force", "false"}, {"fixture", "default"}, {"entry", "gpio"}, {"stats-file", nullptr}}, nullptr},
+    {{"flash", "-p", "/dev/ttyACM0", "-i", "fw.bin", "--enter-bsl", "false", "--verbose", "2"},
+        {{"serial-port", "/dev/ttyACM0"}, {"firmware-file", "fw.bin"}, {"enter-bsl", "false"}, {"verbose", "2"}}, nullptr},
+    {{"flash", "--serial-port=/dev/ttyUSB0", "--firmware-file=fw.bin", "--force", "1", "--fixture", "station1"},
+        {{"serial-port", "/dev/ttyUSB0"}, {"firmware-file", "fw.bin"}, {"force", "1"}, {"fixture", "station1"}}, nullptr},
+    {{"flash", "-p/dev/ttyACM0", "-ifw.bin", "--verb", "3", "--entry", "modem", "--modem-reset", "rts"},
+        {{"serial-port", "/dev/ttyACM0"}, {"firmware-file", "fw.bin"}, {"verbose", "3"}, {"entry", "modem"}, {"modem-reset", "rts"}}, nullptr},
+    {{"flash", "/dev/ttyACM0", "fw.bin", "--stats-file", "/tmp/s.json", "--stats-format", "csv", "--trace", "/tmp/t"},
+        {{"stats-file", "/tmp/s.json"}, {"stats-format", "csv"}, {"trace", "/tmp/t"}, {"replay", nullptr}}, nullptr},
+    {{"flash", "--replay", "/tmp/t", "-i", "fw.bin", "--replay-timing", "original"},
+        {{"serial-port", nullptr}, {"replay", "/tmp/t"}, {"replay-timing", "original"}}, nullptr},
+    {{"flash", "-h"}, {{"help", ""}, {"serial-port", nullptr}}, nullptr},
+    // -- ends the options
+    {{"flash", "/dev/ttyACM0", "--", "-image.bin"},
+        {{"serial-port", "/dev/ttyACM0"}, {"firmware-file", "-image.bin"}}, nullptr},
+    {{"flash", "--verbose", "1", "--", "/dev/ttyACM0", "--help"},
+        {{"serial-port", "/dev/ttyACM0"}, {"firmware-file", "--help"}, {"help", nullptr}, {"verbose", "1"}}, nullptr},
+    {{"flash", "--", "/dev/ttyACM0", "fw.bin", "--"},
+        {}, "too many positional options have been specified on the command line"},
+    // errors, worded as Boost words them
+    {{"flash", "--verbose", "x"}, {}, "the argument ('x') for option '--verbose' is invalid"},
+    {{"flash", "--enter-bsl", "maybe"}, {}, "the argument ('maybe') for option '--enter-bsl' is invalid"},
+    {{"flash", "--bogus"}, {}, "unrecognised option '--bogus'"},
+    {{"flash", "-x"}, {}, "unrecognised option '-x'"},
+    {{"flash", "a", "b", "c"}, {}, "too many positional options have been specified on the command line"},
+    {{"flash", "-p", "/dev/ttyACM0", "fw.bin"}, {}, "option '--serial-port' cannot be specified more than once"},
+    {{"flash", "/dev/ttyACM0", "--verbose"}, {}, "the required argument for option '--verbose' is missing"},
+    {{"flash", "--verbose", "1", "--verbose", "2"}, {}, "option '--verbose' cannot be specified more than once"},
+    {{"flash", "--help=1"}, {}, "option '--help' does not take any arguments"},
+    {{"flash", "--modem-invert"}, {}, "option '--modem-invert' is ambiguous and matches '--modem-invert-bsl' and '--modem-invert-reset'"},
+    // reset and enter_bsl
+    {{"reset"}, {{"verbose", "0"}, {"fixture", "default"}, {"entry", "gpio"}, {"serial-port", nullptr}}, nullptr},
+    {{"enter_bsl", "--verbose", "3", "--fixture", "f1"}, {{"verbose", "3"}, {"fixture", "f1"}}, nullptr},
+    {{"reset", "/dev/ttyUSB0", "--entry", "modem"},
+        {{"serial-port", "/dev/ttyUSB0"}, {"entry", "modem"}, {"modem-reset", "dtr"}, {"modem-invert-reset", "false"}}, nullptr},
+    {{"enter_bsl", "-p", "/dev/ttyUSB0", "--entry", "modem", "--modem-reset", "rts", "--modem-invert-bsl", "true"},
+        {{"serial-port", "/dev/ttyUSB0"}, {"entry", "modem"}, {"modem-reset", "rts"}, {"modem-invert-bsl", "true"}}, nullptr},
+    {{"reset", "/dev/ttyACM0", "/dev/ttyACM1"}, {}, "too many positional options have been specified on the command line"},
+    // read_binary_version
+    {{"read_binary_version", "fw.bin"}, {{"firmware-file", "fw.bin"}, {"verbose", "0"}}, nullptr},
+    {{"read_binary_version", "-i", "fw.bin", "--verbose", "1"}, {{"firmware-file", "fw.bin"}, {"verbose", "1"}}, nullptr},
+    // inventory, the rest option
+    {{"inventory", "/dev/ttyUSB0", "/dev/ttyUSB1,/dev/ttyUSB2", "-j", "2"},
+        {{"serial-port", "/dev/ttyUSB0"}, {"jobs", "2"}, {"format", "table"}}, nullptr},
+};
+
+static void test_case(const _case &c)
+{
+    std::string line;
+    for(const char* a : c.argv)
+        line += std::string(line.empty() ? "" : " ") + a;
+
+    int cmd = BSLCli::find_command(commands, c.argv[0]);
+    CHECK(cmd >= 0);
+    if(cmd < 0)
+        return;
+
+    BSLCli::Args args;
+    try {
+        args.parse(commands[cmd], c.argv.size() - 1, c.argv.data() + 1);
+    } catch(std::invalid_argument &e) {
+        if(c.error == nullptr || std::string(e.what()).rfind(c.error, 0) != 0) {
+            printf("%s: %s\n", line.c_str(), e.what());
+            BSLCheck::failures++;
+        }
+        return;
+    }
+    if(c.error != nullptr) {
+        printf("%s: parsed, expected %s\n", line.c_str(), c.error);
+        BSLCheck::failures++;
+        return;
+    }
+
+    for(const auto &[name, value] : c.values) {
+        const bool given = args.count(name) != 0;
+        if(given != (value != nullptr) || (given && args.get_string(name) != value)) {
+            printf("%s: --%s is '%s', expected '%s'\n", line.c_str(), name,
+                given ? args.get_string(name).c_str() : "(not given)", value != nullptr ? value : "(not given)");
+            BSLCheck::failures++;
+        }
+    }
+}
+
+// typed getters and lists on top of the raw values
+static void test_getters()
+{
+    const char* argv[] = {"/dev/ttyUSB0", "/dev/ttyUSB1,/dev/ttyUSB2", "--start", "off", "-j", "4", "/dev/ttyUSB3"};
+    BSLCli::Args args;
+    args.parse(commands[4], sizeof(argv) / sizeof(argv[0]), argv);
+    CHECK(args.get_list("serial-port") == std::vector<std::string>({"/dev/ttyUSB0", "/dev/ttyUSB1", "/dev/ttyUSB2", "/dev/ttyUSB3"}));
+    CHECK(args.get_bool("start") == false);
+    CHECK(args.get_int("jobs") == 4);
+    CHECK(args.get_list("image").empty());
+    CHECK(args.get_bool("modem-invert-bsl") == false);
+}
+
+int main()
+{
+    for(const _case &c : cases)
+        test_case(c);
+    test_getters();
+
+    return BSLCheck::report();
+}
@@ -0,0 +1,180 @@
+/*
+ * test_daemon.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Flasher daemon: jobs submitted over the Unix socket flash the simulator and
+ * answer with the output and exit code, and with GPIO entry only one port is
+ * served.
+ */
+
+#include "bsl_check.h"
+#include "bsl_daemon.h"
+#include "bsl_timing.h"
+#include "pty_target.h"
+#include <csignal>
+#include <cstring>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static BSLCheck::TempDir tmp("test_daemon");
+
+static int connect_to(const std::string &socket_path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path.c_str());
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(connect(sock, (sockaddr*) &addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// the daemon on its own thread, stopped with the signal a service manager sends
+class DaemonThread {
+    public:
+        DaemonThread(const BSLDaemon::_config &cfg) : daemon(cfg), socket_path(cfg.socket_path)
+        {
+            thread = std::thread([this]() { ok = daemon.run(); });
+            for(int i = 0; i < 100 && !listening(); i++)
+                usleep(20000);
+        }
+
+        ~DaemonThread()
+        {
+            pthread_kill(thread.native_handle(), SIGTERM);
+            thread.join();
+            CHECK(ok);
+        }
+
+    private:
+        bool listening()
+        {
+            int sock = connect_to(socket_path);
+            if(sock >= 0)
+                close(sock);
+            return sock >= 0;
+        }
+
+        BSLDaemon daemon;
+        std::string socket_path;
+        std::thread thread;
+        std::atomic<bool> ok{false};
+};
+
+// raw client: sends the job, returns the exit code after the NUL and the output before it
+static int request(const std::string &socket_path, const BSLDaemon::_job &job, std::string &output)
+{
+    int sock = connect_to(socket_path);
+    if(sock < 0)
+        return -1;
+
+    std::string text;
+    for(const auto &[key, value] : job)
+        text += key + "=" + value + "\n";
+    text += "\n";
+    if(write(sock, text.data(), text.size()) != (ssize_t) text.size()) {
+        close(sock);
+        return -1;
+    }
+
+    std::string answer;
+    char buf[4096];
+    ssize_t n;
+    while((n = read(sock, buf, sizeof(buf))) > 0)
+        answer.append(buf, n);
+    close(sock);
+
+    const size_t nul = answer.find('\0');
+    int code;
+    if(nul == std::string::npos || sscanf(answer.c_str() + nul + 1, "exit=%d", &code) != 1)
+        return -1;
+    output = answer.substr(0, nul);
+    return code;
+}
+
+static BSLDaemon::_config config(const char* socket_name, BSL_Entry::Method entry)
+{
+    BSLDaemon::_config cfg;
+    cfg.socket_path = tmp.file(socket_name);
+    cfg.entry_method = entry;
+    return cfg;
+}
+
+static BSLDaemon::_job flash_job(const std::string &port, const std::string &image)
+{
+    return {{"cmd", "flash"}, {"port", port}, {"image", image}, {"enter", "0"}, {"force", "1"}};
+}
+
+static void test_round_trip(const std::vector<uint8_t> &image, const std::string &image_path)
+{
+    PtyTarget pty;
+    BSLDaemon::_config cfg = config("round_trip.sock", BSL_Entry::Method::None);
+    DaemonThread d(cfg);
+
+    std::string output;
+    CHECK(request(cfg.socket_path, flash_job(pty.path, image_path), output) == 0);
+    CHECK(output.find("Using serial " + pty.path) != std::string::npos);
+    const auto flash = pty.flash();
+    CHECK(!memcmp(flash.data(), image.data(), image.size()));
+
+    // the unit is counted, submit() parses the same answer
+    CHECK(request(cfg.socket_path, {{"cmd", "metrics"}}, output) == 0);
+    CHECK(output.find("mspm0_bsl_units_total{port=\"" + pty.path + "\",result=\"ok\"} 1") != std::string::npos);
+    CHECK(BSLDaemon::submit(cfg.socket_path, {{"cmd", "bogus"}}) == 2);
+
+    // a job without its keys
+    CHECK(request(cfg.socket_path, {{"cmd", "flash"}, {"port", pty.path}}, output) == 2);
+    CHECK(output == "flash needs port and image\n");
+}
+
+// a client that never finishes its job holds up no other client
+static void test_stalled_client()
+{
+    BSLDaemon::_config cfg = config("stalled.sock", BSL_Entry::Method::None);
+    DaemonThread d(cfg);
+
+    int stalled = connect_to(cfg.socket_path);
+    CHECK(stalled >= 0 && write(stalled, "cmd=metrics\n", 12) == 12);
+    usleep(50000);
+
+    std::string output;
+    const timespec start = BSLTiming::now();
+    CHECK(request(cfg.socket_path, {{"cmd", "metrics"}}, output) == 0);
+    CHECK(BSLTiming::elapsed_us(start) < 1000000);
+    close(stalled);
+}
+
+// the entry GPIOs reset one target, a second port would reset it under the first one's job
+static void test_gpio_single_port(const std::string &image_path)
+{
+    PtyTarget first, second;
+    BSLDaemon::_config cfg = config("gpio.sock", BSL_Entry::Method::GPIO);
+    DaemonThread d(cfg);
+
+    std::string output;
+    CHECK(request(cfg.socket_path, flash_job(first.path, image_path), output) == 0);
+    CHECK(request(cfg.socket_path, flash_job(second.path, image_path), output) == 2);
+    CHECK(output.find("gpio entry drives the target on " + first.path + " only") != std::string::npos);
+    CHECK(second.counters().frames == 0);
+}
+
+int main()
+{
+    if(!tmp.ok())
+        return 1;
+    tmp.set_state_home();
+
+    const auto image = BSLCheck::random_bytes(4096, 1);
+    const std::string image_path = tmp.write_file("fw.bin", image);
+
+    test_round_trip(image, image_path);
+    test_stalled_client();
+    test_gpio_single_port(image_path);
+
+    return BSLCheck::report();
+}
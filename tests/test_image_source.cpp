@@ -0,0 +1,195 @@
+/*
+ * test_image_source.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Image reader: plain and compressed images scan to the same size, CRCs,
+ * prefix CRCs and version and read back byte for byte, concatenated members
+ * continue the image and a truncated stream is an error.
+ */
+
+#include "bsl_check.h"
+#include "bsl_image_source.h"
+#include "bsl_log.h"
+#include "bsl_protocol.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#if _HAVE_ZLIB_
+#include <zlib.h>
+#endif
+#if _HAVE_ZSTD_
+#include <zstd.h>
+#endif
+
+static BSLCheck::TempDir tmp("test_image_source");
+static const char version[] = "MSPM0 test firmware 1.2.3";
+
+// several decode chunks long and not a multiple of prefix_step
+static std::vector<uint8_t> make_image(size_t len)
+{
+    std::vector<uint8_t> image = BSLCheck::random_bytes(len, 7);
+    for(size_t i = 0; i < len; i += 3)
+        image[i] = 0xFF;
+    memset(image.data() + ImageSource::version_offset, 0, ImageSource::version_len);
+    memcpy(image.data() + ImageSource::version_offset, version, strlen(version));
+    return image;
+}
+
+#if _HAVE_ZLIB_
+static std::vector<uint8_t> gzip(const uint8_t* data, size_t len)
+{
+    z_stream zs = {};
+    // 15 + 16: largest window with a gzip header
+    deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::vector<uint8_t> out(deflateBound(&zs, len));
+    zs.next_in = const_cast<uint8_t*>(data);
+    zs.avail_in = len;
+    zs.next_out = out.data();
+    zs.avail_out = out.size();
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+#endif
+
+#if _HAVE_ZSTD_
+static std::vector<uint8_t> zstd(const uint8_t* data, size_t len)
+{
+    std::vector<uint8_t> out(ZSTD_compressBound(len));
+    out.resize(ZSTD_compress(out.data(), out.size(), data, len, 1));
+    return out;
+}
+#endif
+
+// scans path and reads it back, both have to match image
+static void check_image(const std::string &path, const std::vector<uint8_t> &image, ImageSource::Format format)
+{
+    ImageSource src;
+    CHECK(src.open(path.c_str()));
+    CHECK(src.format() == format);
+    CHECK(src.scan());
+    CHECK(src.size() == image.size());
+    CHECK(src.crc() == BSL::softwareCRC(image.data(), image.size()));
+    CHECK(src.verify_crc() == BSL::softwareCRC(image.data() + ImageSource::verify_offset, image.size() - ImageSource::verify_offset));
+    CHECK(src.version() == version);
+
+    CHECK(src.prefix_crc(0) == 0xFFFFFFFF);
+    for(uint32_t len = ImageSource::prefix_step; len <= image.size(); len += ImageSource::prefix_step) {
+        if(src.prefix_crc(len) != BSL::softwareCRC(image.data(), len)) {
+            printf("%s: prefix CRC of %u bytes differs\n", path.c_str(), len);
+            BSLCheck::failures++;
+            break;
+        }
+    }
+
+    // in odd sized pieces across the chunk boundaries
+    std::vector<uint8_t> back(image.size());
+    size_t pos = 0;
+    while(pos < back.size()) {
+        const uint32_t n = std::min<size_t>(1000 + pos % 7, back.size() - pos);
+        if(!src.read(back.data() + pos, n))
+            break;
+        pos += n;
+    }
+    CHECK(back == image);
+
+    // nothing past the end
+    uint8_t extra;
+    {
+        BSLLog::Redirect quiet([](const char*) {});
+        CHECK(!src.read(&extra, 1));
+    }
+
+    // again from the start, with a skip
+    CHECK(src.rewind());
+    CHECK(src.skip(40000));
+    uint8_t b[16];
+    CHECK(src.read(b, sizeof(b)) && !memcmp(b, image.data() + 40000, sizeof(b)));
+}
+
+static void test_raw(const std::vector<uint8_t> &image)
+{
+    check_image(tmp.write_file("fw.bin", image), image, ImageSource::Format::Raw);
+
+    BSLLog::Redirect quiet([](const char*) {});
+    ImageSource src;
+    CHECK(src.open(tmp.write_file("empty.bin", std::string()).c_str()));
+    CHECK(!src.scan());
+    CHECK(!src.open(tmp.file("missing.bin").c_str()));
+}
+
+#if _HAVE_ZLIB_
+static void test_gzip(const std::vector<uint8_t> &image)
+{
+    const auto gz = gzip(image.data(), image.size());
+    check_image(tmp.write_file("fw.bin.gz", gz), image, ImageSource::Format::Gzip);
+
+    // concatenated members, as cat a.gz b.gz gives
+    const size_t split = 30001;
+    auto members = gzip(image.data(), split);
+    const auto second = gzip(image.data() + split, image.size() - split);
+    members.insert(members.end(), second.begin(), second.end());
+    check_image(tmp.write_file("members.bin.gz", members), image, ImageSource::Format::Gzip);
+
+    // cut short, within the deflate data and within the trailer
+    for(size_t cut : {(size_t) 100, (size_t) 4}) {
+        std::string log;
+        BSLLog::Redirect redirect([&log](const char* text) { log += text; });
+        const std::vector<uint8_t> truncated(gz.begin(), gz.end() - cut);
+        ImageSource src;
+        CHECK(src.open(tmp.write_file("truncated.bin.gz", truncated).c_str()));
+        CHECK(!src.scan());
+        CHECK(log.find("gzip stream is truncated") != std::string::npos);
+    }
+
+    // a broken member
+    std::vector<uint8_t> corrupt = gz;
+    corrupt[3] = 0xE0;      // reserved flag bits
+    BSLLog::Redirect quiet([](const char*) {});
+    ImageSource src;
+    CHECK(src.open(tmp.write_file("corrupt.bin.gz", corrupt).c_str()));
+    CHECK(!src.scan());
+}
+#endif
+
+#if _HAVE_ZSTD_
+static void test_zstd(const std::vector<uint8_t> &image)
+{
+    const auto zst = zstd(image.data(), image.size());
+    check_image(tmp.write_file("fw.bin.zst", zst), image, ImageSource::Format::Zstd);
+
+    const size_t split = 30001;
+    auto frames = zstd(image.data(), split);
+    const auto second = zstd(image.data() + split, image.size() - split);
+    frames.insert(frames.end(), second.begin(), second.end());
+    check_image(tmp.write_file("frames.bin.zst", frames), image, ImageSource::Format::Zstd);
+
+    std::string log;
+    BSLLog::Redirect redirect([&log](const char* text) { log += text; });
+    const std::vector<uint8_t> truncated(zst.begin(), zst.end() - 100);
+    ImageSource src;
+    CHECK(src.open(tmp.write_file("truncated.bin.zst", truncated).c_str()));
+    CHECK(!src.scan());
+    CHECK(log.find("zstd stream is truncated") != std::string::npos);
+}
+#endif
+
+int main()
+{
+    if(!tmp.ok())
+        return 1;
+
+    const auto image = make_image(70000);
+    test_raw(image);
+#if _HAVE_ZLIB_
+    test_gzip(image);
+#endif
+#if _HAVE_ZSTD_
+    test_zstd(image);
+#endif
+
+    return BSLCheck::report();
+}
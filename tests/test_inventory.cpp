@@ -0,0 +1,118 @@
+/*
+ * test_inventory.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Rack audit: ports on the pty simulator are probed in parallel, the board
+ * holding one of the images is matched to it, a blank one to none and a
+ * missing port fails, and the JSON report keeps its shape.
+ */
+
+#include "bsl_check.h"
+#include "bsl_inventory.h"
+#include "bsl_log.h"
+#include "bsl_tool.h"
+#include "pty_target.h"
+#include <algorithm>
+#include <cstring>
+#include <regex>
+
+static BSLCheck::TempDir tmp("test_inventory");
+
+static std::vector<uint8_t> image_with_version(uint32_t seed, const char* version)
+{
+    auto image = BSLCheck::random_bytes(4096, seed);
+    std::fill(image.begin() + 0xC0, image.begin() + 0xC0 + 51, 0);
+    memcpy(image.data() + 0xC0, version, strlen(version));
+    return image;
+}
+
+// the time a probe took varies from run to run
+static std::string mask_elapsed(const std::string &json)
+{
+    static const std::regex elapsed("\"elapsed_ms\":[0-9]+");
+    return std::regex_replace(json, elapsed, "\"elapsed_ms\":T");
+}
+
+static void test_rack()
+{
+    const auto a = image_with_version(1, "1.0.0"), b = image_with_version(2, "2.0.0");
+    const std::string a_path = tmp.write_file("a.bin", a), b_path = tmp.write_file("b.bin", b);
+
+    PtyTarget flashed, blank;
+    {
+        BSLLog::Redirect quiet([](const char*) {});
+        BSLTool tool(flashed.path.c_str(), BSL_Entry::Method::None);
+        CHECK(tool.flash_image(a.data(), a.size(), BSL::softwareCRC(a.data(), a.size()), true));
+    }
+    const uint64_t frames = flashed.counters().frames;
+    const uint64_t programmed = flashed.counters().bytes_programmed;
+
+    BSLInventory::_config cfg;
+    cfg.ports = {flashed.path, blank.path, tmp.file("missing")};
+    cfg.images = {b_path, a_path};
+    BSLInventory inventory(cfg);
+    std::vector<BSLInventory::_unit> units;
+    CHECK(inventory.run(units));
+    CHECK(units.size() == 3);
+    if(units.size() != 3)
+        return;
+
+    // nothing is written, the probes only read
+    CHECK(flashed.counters().frames > frames);
+    CHECK(flashed.counters().bytes_programmed == programmed);
+    CHECK(blank.counters().bytes_programmed == 0);
+
+    CHECK(units[0].ok && units[0].image == a_path && units[0].version == "1.0.0");
+    CHECK(units[0].has_crc && units[0].crc == BSL::softwareCRC(a.data(), a.size()));
+    CHECK(units[1].ok && units[1].image.empty());
+    CHECK(!units[2].ok && !units[2].has_device_info);
+
+    char crc[2][16];
+    snprintf(crc[0], sizeof(crc[0]), "0x%08x", BSL::softwareCRC(a.data(), a.size()));
+    const std::vector<uint8_t> erased(4096, 0xFF);
+    snprintf(crc[1], sizeof(crc[1]), "0x%08x", BSL::softwareCRC(erased.data(), erased.size()));
+    const std::string device_info = "\"device_info\":{\"cmd_interpreter_version\":1,\"build_id\":256,\"app_version\":0,"
+        "\"plugin_if_version\":1,\"bsl_max_buff_size\":1728,\"bsl_buff_start_addr\":536871264,\"bcr_conf_id\":1,\"bsl_conf_id\":1}";
+    const std::string golden = "[\n"
+        "{\"port\":\"" + flashed.path + "\",\"ok\":true,\"error\":null," + device_info +
+            ",\"region\":{\"addr\":0,\"length\":4096,\"crc\":\"" + crc[0] + "\"},\"image\":\"" + a_path + "\",\"version\":\"1.0.0\",\"elapsed_ms\":T},\n"
+        "{\"port\":\"" + blank.path + "\",\"ok\":true,\"error\":null," + device_info +
+            ",\"region\":{\"addr\":0,\"length\":4096,\"crc\":\"" + crc[1] + "\"},\"image\":null,\"version\":null,\"elapsed_ms\":T},\n"
+        "{\"port\":\"" + cfg.ports[2] + "\",\"ok\":false,\"error\":\"Failed to open serial port\","
+            "\"device_info\":null,\"region\":null,\"image\":null,\"version\":null,\"elapsed_ms\":T}\n"
+        "]\n";
+    const std::string json = inventory.to_json(units);
+    CHECK(mask_elapsed(json) == golden);
+    if(mask_elapsed(json) != golden)
+        printf("%s", json.c_str());
+
+    const std::string table = inventory.to_table(units);
+    CHECK(table.compare(0, 4, "PORT") == 0);
+    CHECK(std::count(table.begin(), table.end(), '\n') == 4);
+    CHECK(table.find("1.0.0") != std::string::npos);
+}
+
+// an image too short for standalone verification can not be matched
+static void test_short_image()
+{
+    BSLInventory::_config cfg;
+    cfg.images = {tmp.write_file("short.bin", BSLCheck::random_bytes(512, 3))};
+    BSLInventory inventory(cfg);
+    std::vector<BSLInventory::_unit> units;
+    BSLLog::Redirect quiet([](const char*) {});
+    CHECK(!inventory.run(units));
+}
+
+int main()
+{
+    if(!tmp.ok())
+        return 1;
+    tmp.set_state_home();
+
+    test_rack();
+    test_short_image();
+
+    return BSLCheck::report();
+}
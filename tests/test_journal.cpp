@@ -0,0 +1,136 @@
+/*
+ * test_journal.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Flash journal: what store() writes load() reads back, broken journals are
+ * ignored, and a flash resumes at the last whole sector of a journal that
+ * matches the image and verifies on the device.
+ */
+
+#include "bsl_check.h"
+#include "bsl_journal.h"
+#include "bsl_log.h"
+#include "bsl_protocol.h"
+#include "bsl_timing.h"
+#include "bsl_tool.h"
+#include "pty_target.h"
+
+// one flash with the tool's output kept back, returns it
+static std::string flash(PtyTarget &pty, const std::vector<uint8_t> &image, bool force, bool &ok)
+{
+    std::string log;
+    BSLLog::Redirect redirect([&log](const char* text) { log += text; });
+    BSLTool tool(pty.path.c_str(), BSL_Entry::Method::None);
+    ok = tool.flash_image(image.data(), image.size(), BSL::softwareCRC(image.data(), image.size()), force);
+    return log;
+}
+
+static void test_store_load()
+{
+    const BSLJournal::_checkpoint cp = {.image_crc=0xdeadbeef, .image_size=20480, .load_addr=0x1000, .confirmed=8192};
+    CHECK(BSLJournal::store("/dev/ttyTEST0", cp));
+
+    BSLJournal::_checkpoint loaded = {};
+    CHECK(BSLJournal::load("/dev/ttyTEST0", loaded));
+    CHECK(loaded.image_crc == cp.image_crc && loaded.image_size == cp.image_size);
+    CHECK(loaded.load_addr == cp.load_addr && loaded.confirmed == cp.confirmed);
+
+    // per port
+    CHECK(!BSLJournal::load("/dev/ttyTEST1", loaded));
+
+    BSLJournal::clear("/dev/ttyTEST0");
+    CHECK(!BSLJournal::load("/dev/ttyTEST0", loaded));
+}
+
+static void test_malformed()
+{
+    BSLLog::Redirect quiet([](const char*) {});
+    BSLJournal::_checkpoint loaded = {};
+
+    // cut short
+    FILE* f = fopen(BSLTiming::state_file("journal_/dev/ttyTEST2").c_str(), "w");
+    fprintf(f, "image_crc=deadbeef\nimage_size=20480\n");
+    fclose(f);
+    CHECK(!BSLJournal::load("/dev/ttyTEST2", loaded));
+
+    // more confirmed than the image has
+    const BSLJournal::_checkpoint cp = {.image_crc=0xdeadbeef, .image_size=1024, .load_addr=0, .confirmed=2048};
+    CHECK(BSLJournal::store("/dev/ttyTEST2", cp));
+    CHECK(!BSLJournal::load("/dev/ttyTEST2", loaded));
+    BSLJournal::clear("/dev/ttyTEST2");
+}
+
+static void test_resume()
+{
+    PtyTarget pty;
+    const auto image = BSLCheck::random_bytes(20480, 1);
+    const uint32_t crc = BSL::softwareCRC(image.data(), image.size());
+
+    // a complete flash leaves no journal
+    bool ok;
+    flash(pty, image, true, ok);
+    CHECK(ok);
+    BSLJournal::_checkpoint cp;
+    CHECK(!BSLJournal::load(pty.path, cp));
+
+    // interrupted within the ninth sector: resumed at its start, only the rest is erased and programmed
+    auto before = pty.counters();
+    CHECK(BSLJournal::store(pty.path, {.image_crc=crc, .image_size=20480, .load_addr=0, .confirmed=8192 + 300}));
+    std::string log = flash(pty, image, true, ok);
+    auto after = pty.counters();
+    CHECK(ok);
+    CHECK(log.find(">> Resuming at 0x00002000, 8192 of 20480 bytes already programmed") != std::string::npos);
+    CHECK(after.sectors_erased - before.sectors_erased == (20480 - 8192) / 1024);
+    CHECK(after.bytes_programmed - before.bytes_programmed == 20480 - 8192);
+    CHECK(after.words_reprogrammed == 0);
+    CHECK(!BSLJournal::load(pty.path, cp));
+
+    // a journal of another image, or with less than the verification minimum, starts over
+    const BSLJournal::_checkpoint stale[] = {
+        {.image_crc=crc ^ 1, .image_size=20480, .load_addr=0, .confirmed=8192},
+        {.image_crc=crc, .image_size=16384, .load_addr=0, .confirmed=8192},
+        {.image_crc=crc, .image_size=20480, .load_addr=0, .confirmed=1000},
+    };
+    for(const auto &journal : stale) {
+        before = pty.counters();
+        CHECK(BSLJournal::store(pty.path, journal));
+        log = flash(pty, image, true, ok);
+        after = pty.counters();
+        CHECK(ok);
+        CHECK(log.find("Resuming") == std::string::npos);
+        CHECK(after.bytes_programmed - before.bytes_programmed == 20480);
+    }
+}
+
+// the flash does not hold the journaled prefix
+static void test_resume_unverified()
+{
+    PtyTarget pty;
+    const auto image = BSLCheck::random_bytes(20480, 2);
+    const uint32_t crc = BSL::softwareCRC(image.data(), image.size());
+
+    bool ok;
+    CHECK(BSLJournal::store(pty.path, {.image_crc=crc, .image_size=20480, .load_addr=0, .confirmed=4096}));
+    std::string log = flash(pty, image, true, ok);
+    CHECK(ok);
+    CHECK(log.find("Journaled prefix does not verify, starting over") != std::string::npos);
+    CHECK(pty.counters().bytes_programmed == 20480);
+}
+
+int main()
+{
+    // journals stay out of the user's state directory
+    BSLCheck::TempDir state("test_journal");
+    if(!state.ok())
+        return 1;
+    state.set_state_home();
+
+    test_store_load();
+    test_malformed();
+    test_resume();
+    test_resume_unverified();
+
+    return BSLCheck::report();
+}
@@ -0,0 +1,144 @@
+/*
+ * test_metrics.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Station metrics: units flashed on the device model add up in the textfile,
+ * counters and histograms sum while gauges keep the last unit, the exposition
+ * parses back to itself, and parallel writers under the lock lose no unit.
+ */
+
+#include "bsl_check.h"
+#include "bsl_log.h"
+#include "bsl_metrics.h"
+#include "bsl_tool.h"
+#include "loopback_transport.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+static BSLCheck::TempDir tmp("test_metrics");
+
+static std::string read_text(const std::string &path)
+{
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// value of the sample "series value", -1 if there is none
+static double sample(const std::string &text, const std::string &series)
+{
+    const size_t at = text.find("\n" + series + " ");
+    if(at == std::string::npos)
+        return -1;
+    return strtod(text.c_str() + at + series.size() + 2, nullptr);
+}
+
+// one unit flashed on the device model
+static BSLMetrics unit(const std::string &port, bool ok, const std::vector<uint8_t> &image)
+{
+    BSLTarget target;
+    BSLLog::Redirect quiet([](const char*) {});
+    BSLTool tool(new LoopbackTransport(target), BSL_Entry::Method::None);
+    CHECK(tool.flash_image(image.data(), image.size(), BSL::softwareCRC(image.data(), image.size()), true));
+
+    BSLMetrics m;
+    m.record_unit(tool, port, ok);
+    return m;
+}
+
+static void test_merge(const std::vector<uint8_t> &image)
+{
+    const std::string path = tmp.file("merge.prom");
+    const BSLMetrics a = unit("slot0", true, image), b = unit("slot1", false, image);
+
+    CHECK(a.update_file(path));
+    CHECK(a.update_file(path));
+    CHECK(b.update_file(path));
+    const std::string text = read_text(path);
+
+    // counters add up per label set
+    CHECK(sample(text, "mspm0_bsl_units_total{port=\"slot0\",result=\"ok\"}") == 2);
+    CHECK(sample(text, "mspm0_bsl_units_total{port=\"slot1\",result=\"failed\"}") == 1);
+    CHECK(sample(text, "mspm0_bsl_units_total{port=\"slot0\",result=\"failed\"}") == -1);
+    CHECK(sample(text, "mspm0_bsl_programmed_bytes_total{port=\"slot0\"}") == 2 * image.size());
+    CHECK(sample(text, "mspm0_bsl_programmed_bytes_total{port=\"slot1\"}") == image.size());
+    // histograms too, the +Inf bucket counts every observation
+    CHECK(sample(text, "mspm0_bsl_phase_duration_seconds_count{port=\"slot0\",phase=\"program\"}") == 2);
+    CHECK(sample(text, "mspm0_bsl_phase_duration_seconds_bucket{port=\"slot0\",phase=\"program\",le=\"+Inf\"}") == 2);
+    CHECK(sample(text, "mspm0_bsl_phase_duration_seconds_bucket{port=\"slot0\",phase=\"program\",le=\"120.0\"}") == 2);
+    CHECK(sample(text, "mspm0_bsl_phase_duration_seconds_sum{port=\"slot0\",phase=\"program\"}") > 0);
+    // gauges hold the last unit
+    CHECK(sample(text, "mspm0_bsl_last_unit_timestamp_seconds{port=\"slot0\"}") > 0);
+    CHECK(text.find("# TYPE mspm0_bsl_units counter\n") != std::string::npos);
+    CHECK(text.size() >= 6 && text.compare(text.size() - 6, 6, "# EOF\n") == 0);
+
+    // the exposition parses back to the same text
+    BSLMetrics parsed;
+    CHECK(parsed.parse(text));
+    CHECK(parsed.to_openmetrics() == text);
+    CHECK(!parsed.parse("mspm0_bsl_units_total{port=\"x\" 1\n"));
+
+    // a label value with quotes, backslashes and spaces
+    const BSLMetrics odd = unit("a \"b\"\\c", true, image);
+    const std::string odd_text = odd.to_openmetrics();
+    CHECK(sample(odd_text, "mspm0_bsl_units_total{port=\"a \\\"b\\\"\\\\c\",result=\"ok\"}") == 1);
+    parsed.clear();
+    CHECK(parsed.parse(odd_text) && parsed.to_openmetrics() == odd_text);
+}
+
+// a file that is not OpenMetrics is replaced, not merged into
+static void test_malformed(const std::vector<uint8_t> &image)
+{
+    const std::string path = tmp.write_file("malformed.prom", std::string("not a metric\n"));
+    BSLLog::Redirect quiet([](const char*) {});
+    CHECK(unit("slot0", true, image).update_file(path));
+    const std::string text = read_text(path);
+    CHECK(sample(text, "mspm0_bsl_units_total{port=\"slot0\",result=\"ok\"}") == 1);
+    CHECK(text.find("not a metric") == std::string::npos);
+}
+
+// each writer has its own descriptor of the lock file, as separate runs do
+static void test_concurrent_writers(const std::vector<uint8_t> &image)
+{
+    const std::string path = tmp.file("concurrent.prom");
+    const BSLMetrics m = unit("slot0", true, image);
+    const int writers = 8, updates = 10;
+
+    std::vector<std::thread> threads;
+    std::atomic<int> failed{0};
+    for(int i = 0; i < writers; i++) {
+        threads.emplace_back([&]() {
+            for(int j = 0; j < updates; j++) {
+                if(!m.update_file(path))
+                    failed++;
+            }
+        });
+    }
+    for(auto &t : threads)
+        t.join();
+
+    CHECK(failed == 0);
+    const std::string text = read_text(path);
+    CHECK(sample(text, "mspm0_bsl_units_total{port=\"slot0\",result=\"ok\"}") == writers * updates);
+    CHECK(sample(text, "mspm0_bsl_programmed_bytes_total{port=\"slot0\"}") == (double) writers * updates * image.size());
+    CHECK(sample(text, "mspm0_bsl_phase_duration_seconds_count{port=\"slot0\",phase=\"program\"}") == writers * updates);
+    CHECK(access((path + ".tmp").c_str(), F_OK) != 0);
+}
+
+int main()
+{
+    if(!tmp.ok())
+        return 1;
+    tmp.set_state_home();
+
+    const auto image = BSLCheck::random_bytes(2048, 1);
+    test_merge(image);
+    test_malformed(image);
+    test_concurrent_writers(image);
+
+    return BSLCheck::report();
+}
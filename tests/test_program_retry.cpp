@@ -0,0 +1,131 @@
+/*
+ * test_program_retry.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * ProgramData retries against the device model: a frame the device wrote is
+ * never programmed again, whatever happened to its answer.
+ */
+
+#include "bsl_check.h"
+#include "bsl_uart.h"
+#include "loopback_transport.h"
+#include <cstring>
+
+static bool open_session(BSL_UART &uart)
+{
+    // a fast line keeps the back off between retries short
+    return uart.connect() == BSL::AckType::BSL_ACK &&
+        std::get<1>(uart.unlock_bootloader()) == BSL::CoreMessage::SUCCESS &&
+        uart.change_baudrate(BSL::Baudrate::BSL_B3000000) == BSL::AckType::BSL_ACK;
+}
+
+static bool programmed(const BSLTarget &target, uint32_t addr, const std::vector<uint8_t> &image)
+{
+    return !memcmp(target.get_flash().data() + addr, image.data(), image.size());
+}
+
+// line errors in both directions, answers and frames get mangled
+static void test_line_errors(bool pipeline, int window, uint32_t seed)
+{
+    BSLTarget::_config cfg;
+    cfg.error_rate = 2e-4;
+    cfg.error_seed = seed;
+    BSLTarget target(cfg);
+    BSL_UART uart(new LoopbackTransport(target));
+    CHECK(open_session(uart));
+
+    const auto image = BSLCheck::random_bytes(20480, seed);
+    uart.set_pipeline(pipeline, window);
+    uart.set_max_retries(10);
+    auto [ack, msg] = uart.program_data(0, image.data(), image.size());
+    CHECK(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS);
+    CHECK(programmed(target, 0, image));
+    CHECK(target.get_counters().words_reprogrammed == 0);
+    CHECK(target.get_counters().bytes_programmed == image.size());
+
+    // resent bytes apart, each frame is 12 bytes of header, command, address and CRC
+    const auto &report = uart.get_program_report();
+    CHECK(report.tx_bytes - report.retry_bytes == image.size() + report.frames * 12u);
+    CHECK(report.retries == 0 || report.retry_bytes > 0);
+    CHECK(report.utilization() <= 1.0);
+}
+
+// the answer is lost after the device wrote the frame
+static void test_lost_answer()
+{
+    BSLTarget::_config cfg;
+    cfg.lose_program_answer = 3;
+    BSLTarget target(cfg);
+    BSL_UART uart(new LoopbackTransport(target));
+    CHECK(open_session(uart));
+
+    const auto image = BSLCheck::random_bytes(4096, 7);
+    uart.set_pipeline(false, 4);
+    auto [ack, msg] = uart.program_data(0, image.data(), image.size());
+    CHECK(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS);
+    CHECK(programmed(target, 0, image));
+    CHECK(target.get_counters().words_reprogrammed == 0);
+    CHECK(target.get_counters().bytes_programmed == image.size());
+    CHECK(target.get_counters().sectors_erased == 0);
+}
+
+// the frame is half written and unanswered, its sector is erased and programmed again
+static void test_torn_frame()
+{
+    BSLTarget::_config cfg;
+    cfg.lose_program_answer = 4;
+    cfg.lose_torn = true;
+    BSLTarget target(cfg);
+    BSL_UART uart(new LoopbackTransport(target));
+    CHECK(open_session(uart));
+
+    // data of someone else in front of the image, in the same sector
+    const auto other = BSLCheck::random_bytes(16, 3);
+    auto [ack, msg] = uart.program_data(0x1000, other.data(), other.size());
+    CHECK(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS);
+
+    // one frame in flight, a missing answer shows at the frame it belongs to
+    const auto image = BSLCheck::random_bytes(3000, 11);
+    uart.set_pipeline(true, 1);
+    std::tie(ack, msg) = uart.program_data(0x1010, image.data(), image.size() / 8 * 8);
+    CHECK(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS);
+    CHECK(programmed(target, 0x1000, other));
+    CHECK(!memcmp(target.get_flash().data() + 0x1010, image.data(), image.size() / 8 * 8));
+    CHECK(target.get_counters().words_reprogrammed == 0);
+    CHECK(target.get_counters().sectors_erased == 1);
+}
+
+// read out forbidden, a lost answer can only be handled by a rewrite of its sector
+static void test_lost_answer_no_readout()
+{
+    BSLTarget::_config cfg;
+    cfg.lose_program_answer = 10;
+    cfg.readout_enabled = false;
+    BSLTarget target(cfg);
+    BSL_UART uart(new LoopbackTransport(target));
+    CHECK(open_session(uart));
+
+    const auto image = BSLCheck::random_bytes(4096, 5);
+    uart.set_pipeline(false, 2);
+    auto [ack, msg] = uart.program_data(0, image.data(), image.size());
+    CHECK(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS);
+    CHECK(programmed(target, 0, image));
+    CHECK(target.get_counters().words_reprogrammed == 0);
+    CHECK(target.get_counters().sectors_erased == 1);
+}
+
+int main()
+{
+    for(uint32_t seed = 1; seed <= 4; seed++) {
+        test_line_errors(false, 4, seed);
+        test_line_errors(true, 4, seed);
+        test_line_errors(true, 1, seed);
+    }
+    test_lost_answer();
+    test_torn_frame();
+    test_lost_answer_no_readout();
+
+    return BSLCheck::report();
+}
@@ -0,0 +1,124 @@
+/*
+ * test_progress.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Progress records: the NDJSON lines of a flash match the golden records once
+ * the timing dependent numbers are masked, and their timestamps only grow.
+ */
+
+#include "bsl_check.h"
+#include "bsl_progress.h"
+#include <fcntl.h>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <unistd.h>
+
+static BSLCheck::TempDir tmp("test_progress");
+
+// the reporter picks up a phase before the next callback
+static void settle()
+{
+    usleep(100000);
+}
+
+static std::string read_text(const std::string &path)
+{
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// timestamps and rates vary from run to run
+static std::string mask_timing(const std::string &records)
+{
+    static const std::regex t_ms("\"t_ms\":[0-9]+"), rate("\"(rate_bps|avg_bps|fps)\":[0-9.]+");
+    return std::regex_replace(std::regex_replace(records, t_ms, "\"t_ms\":T"), rate, "\"$1\":R");
+}
+
+static void test_golden()
+{
+    const std::string path = tmp.file("progress.ndjson");
+    BSLProgress::_config cfg;
+    cfg.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CHECK(cfg.fd >= 0);
+    // no periodic records during the test, only the ones phases and the end force
+    cfg.interval_ms = 60000;
+    cfg.port = "/dev/tty\"USB0\"";
+
+    {
+        BSLProgress progress(cfg);
+        progress.phase("connect");
+        settle();
+        progress.phase("program");
+        settle();
+        progress.update(512, 1024, 1, 0);
+        progress.update(1024, 1024, 2, 1);
+        progress.phase("verify");
+        settle();
+        progress.finish(true);
+    }
+    close(cfg.fd);
+
+    const std::string records = read_text(path);
+    const std::string golden =
+        "{\"event\":\"phase\",\"t_ms\":T,\"port\":\"/dev/tty\\\"USB0\\\"\",\"phase\":\"connect\"}\n"
+        "{\"event\":\"phase\",\"t_ms\":T,\"port\":\"/dev/tty\\\"USB0\\\"\",\"phase\":\"program\"}\n"
+        "{\"event\":\"progress\",\"t_ms\":T,\"port\":\"/dev/tty\\\"USB0\\\"\",\"phase\":\"program\",\"done\":1024,\"total\":1024,"
+            "\"frames\":2,\"retries\":1,\"rate_bps\":R,\"avg_bps\":R,\"fps\":R,\"eta_s\":0,\"stalled\":false}\n"
+        "{\"event\":\"phase\",\"t_ms\":T,\"port\":\"/dev/tty\\\"USB0\\\"\",\"phase\":\"verify\"}\n"
+        "{\"event\":\"end\",\"t_ms\":T,\"port\":\"/dev/tty\\\"USB0\\\"\",\"ok\":true}\n";
+    CHECK(mask_timing(records) == golden);
+    if(mask_timing(records) != golden)
+        printf("records:\n%s", records.c_str());
+
+    // the timestamps of the records
+    static const std::regex t_ms("\"t_ms\":([0-9]+)");
+    uint64_t last = 0;
+    size_t count = 0;
+    for(std::sregex_iterator it(records.begin(), records.end(), t_ms), end; it != end; ++it, count++) {
+        const uint64_t t = std::stoull((*it)[1]);
+        CHECK(t >= last);
+        last = t;
+    }
+    CHECK(count == 5);
+}
+
+// nothing confirmed for stall_ms: flagged, no ETA
+static void test_stalled()
+{
+    const std::string path = tmp.file("stalled.ndjson");
+    BSLProgress::_config cfg;
+    cfg.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    cfg.interval_ms = 60000;
+    cfg.stall_ms = 50;
+    cfg.port = "p";
+
+    {
+        BSLProgress progress(cfg);
+        progress.phase("program");
+        settle();
+        progress.update(256, 1024, 1, 0);
+        settle();
+        progress.finish(false);
+    }
+    close(cfg.fd);
+
+    const std::string records = mask_timing(read_text(path));
+    CHECK(records.find("\"done\":256,\"total\":1024,\"frames\":1,\"retries\":0,\"rate_bps\":R,\"avg_bps\":R,\"fps\":R,\"eta_s\":null,\"stalled\":true}") != std::string::npos);
+    CHECK(records.find("{\"event\":\"end\",\"t_ms\":T,\"port\":\"p\",\"ok\":false}\n") != std::string::npos);
+}
+
+int main()
+{
+    if(!tmp.ok())
+        return 1;
+
+    test_golden();
+    test_stalled();
+
+    return BSLCheck::report();
+}
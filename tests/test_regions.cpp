@@ -0,0 +1,243 @@
+/*
+ * test_regions.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Flash regions: Intel HEX records become regions, prepare() aligns them to
+ * flash words and refuses overlaps, and flash_regions() erases adjacent
+ * sectors in one run, takes along the regions sharing a changed sector and
+ * keeps what else the erased sectors held.
+ */
+
+#include "bsl_check.h"
+#include "bsl_log.h"
+#include "bsl_region.h"
+#include "bsl_tool.h"
+#include "loopback_transport.h"
+#include <cstring>
+#include <string>
+
+static BSLCheck::TempDir tmp("test_regions");
+
+// :LLAAAATT<data>CC
+static std::string hex_record(uint8_t type, uint16_t offset, const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> rec = {(uint8_t) data.size(), (uint8_t) (offset >> 8), (uint8_t) offset, type};
+    rec.insert(rec.end(), data.begin(), data.end());
+    uint8_t sum = 0;
+    for(uint8_t b : rec)
+        sum += b;
+    rec.push_back(-sum);
+
+    std::string line = ":";
+    char digits[3];
+    for(uint8_t b : rec) {
+        snprintf(digits, sizeof(digits), "%02X", b);
+        line += digits;
+    }
+    return line + "\r\n";
+}
+
+static void test_hex()
+{
+    const auto a = BSLCheck::random_bytes(16, 1), b = BSLCheck::random_bytes(16, 2), c = BSLCheck::random_bytes(8, 3);
+    std::string text;
+    text += hex_record(0x00, 0x0000, a);
+    // 8 bytes apart: filled with 0xFF, one region
+    text += hex_record(0x00, 0x0018, b);
+    // far apart: a region of its own
+    text += hex_record(0x00, 0x0100, c);
+    // extended linear address: NONMAIN at 0x41C00000
+    text += hex_record(0x04, 0x0000, {0x41, 0xC0});
+    text += hex_record(0x00, 0x0000, c);
+    text += hex_record(0x05, 0x0000, {0x00, 0x00, 0x00, 0xC1});
+    text += hex_record(0x01, 0x0000, {});
+    // past the end of file record
+    text += hex_record(0x00, 0x0200, a);
+
+    const std::string path = tmp.write_file("fw.hex", text);
+    CHECK(BSLRegion::is_hex(path));
+    std::vector<BSLRegion::_region> regions;
+    CHECK(BSLRegion::load_spec(path, regions));
+    CHECK(regions.size() == 3);
+    if(regions.size() != 3)
+        return;
+
+    std::vector<uint8_t> first = a;
+    first.resize(0x18, 0xFF);
+    first.insert(first.end(), b.begin(), b.end());
+    CHECK(regions[0].addr == 0x0 && regions[0].data == first);
+    CHECK(regions[1].addr == 0x100 && regions[1].data == c);
+    CHECK(regions[2].addr == 0x41C00000 && regions[2].data == c);
+    CHECK(regions[0].source == path);
+
+    // a plain file needs its address
+    BSLLog::Redirect quiet([](const char*) {});
+    const std::string bin = tmp.write_file("fw.bin", std::string(64, 'x'));
+    CHECK(!BSLRegion::is_hex(bin));
+    regions.clear();
+    CHECK(!BSLRegion::load_spec(bin, regions));
+    CHECK(BSLRegion::load_spec(bin + "@0x4000", regions));
+    CHECK(regions.size() == 1 && regions[0].addr == 0x4000 && regions[0].data.size() == 64);
+    CHECK(!BSLRegion::load_spec(bin + "@0x40zz", regions));
+}
+
+static void test_hex_errors()
+{
+    BSLLog::Redirect quiet([](const char*) {});
+    const auto a = BSLCheck::random_bytes(16, 1);
+    std::vector<BSLRegion::_region> regions;
+
+    // checksum off by one
+    std::string bad = hex_record(0x00, 0x0000, a);
+    bad[bad.size() - 3] ^= 1;
+    CHECK(!BSLRegion::load_hex(tmp.write_file("checksum.hex", bad), regions));
+
+    // length field and data disagree
+    std::string short_rec = hex_record(0x00, 0x0000, a);
+    short_rec.erase(9, 2);
+    CHECK(!BSLRegion::load_hex(tmp.write_file("short.hex", short_rec), regions));
+
+    CHECK(!BSLRegion::load_hex(tmp.write_file("twice.hex", hex_record(0x00, 0x0000, a) + hex_record(0x00, 0x0000, a)), regions));
+    CHECK(!BSLRegion::load_hex(tmp.write_file("overlap.hex", hex_record(0x00, 0x0000, a) + hex_record(0x00, 0x0008, a)), regions));
+    CHECK(!BSLRegion::load_hex(tmp.write_file("empty.hex", hex_record(0x01, 0x0000, {})), regions));
+    CHECK(regions.empty());
+}
+
+static BSLRegion::_region region(uint32_t addr, std::vector<uint8_t> data, const char* source)
+{
+    BSLRegion::_region r;
+    r.addr = addr;
+    r.data = std::move(data);
+    r.source = source;
+    return r;
+}
+
+static void test_prepare()
+{
+    // unaligned start and end are padded with erased flash, the result is sorted
+    std::vector<BSLRegion::_region> regions = {
+        region(0x2003, {1, 2, 3, 4, 5, 6}, "b"),
+        region(0x1000, std::vector<uint8_t>(16, 7), "a"),
+    };
+    CHECK(BSLRegion::prepare(regions));
+    CHECK(regions[0].addr == 0x1000 && regions[0].data.size() == 16);
+    CHECK(regions[1].addr == 0x2000);
+    CHECK(regions[1].data == std::vector<uint8_t>({0xFF, 0xFF, 0xFF, 1, 2, 3, 4, 5, 6, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}));
+
+    // touching is fine, overlapping is not
+    regions = {region(0x0, std::vector<uint8_t>(16), "a"), region(0x10, std::vector<uint8_t>(8), "b")};
+    CHECK(BSLRegion::prepare(regions));
+
+    BSLLog::Redirect quiet([](const char*) {});
+    regions = {region(0x10, std::vector<uint8_t>(8), "b"), region(0x0, std::vector<uint8_t>(17), "a")};
+    CHECK(!BSLRegion::prepare(regions));
+    // only by the word padding
+    regions = {region(0x0, std::vector<uint8_t>(12), "a"), region(0x0C, std::vector<uint8_t>(4), "b")};
+    CHECK(!BSLRegion::prepare(regions));
+}
+
+// one session on the device model, returns what it erased and programmed
+static bool flash(BSLTarget &target, const std::vector<BSLRegion::_region> &regions, bool force, BSLTarget::_counters &delta, std::string &log)
+{
+    const BSLTarget::_counters before = target.get_counters();
+    log.clear();
+    BSLLog::Redirect redirect([&log](const char* text) { log += text; });
+    BSLTool tool(new LoopbackTransport(target), BSL_Entry::Method::None);
+    const bool ok = tool.flash_regions(regions, force);
+    delta.sectors_erased = target.get_counters().sectors_erased - before.sectors_erased;
+    delta.bytes_programmed = target.get_counters().bytes_programmed - before.bytes_programmed;
+    delta.words_reprogrammed = target.get_counters().words_reprogrammed - before.words_reprogrammed;
+    return ok;
+}
+
+static bool holds(const BSLTarget &target, const BSLRegion::_region &r)
+{
+    return !memcmp(target.get_flash().data() + r.addr, r.data.data(), r.data.size());
+}
+
+static void test_flash_regions()
+{
+    // a: sectors 0-5, b: 5-6 sharing sector 5 with a, c: 32-33
+    std::vector<BSLRegion::_region> regions = {
+        region(0x0000, BSLCheck::random_bytes(0x1500, 1), "a"),
+        region(0x1600, BSLCheck::random_bytes(0x600, 2), "b"),
+        region(0x8000, BSLCheck::random_bytes(0x800, 3), "c"),
+    };
+    CHECK(BSLRegion::prepare(regions));
+
+    BSLTarget target;
+    BSLTarget::_counters delta;
+    std::string log;
+
+    // everything: the runs [0, 7) and [32, 34)
+    CHECK(flash(target, regions, true, delta, log));
+    CHECK(delta.sectors_erased == 7 + 2);
+    CHECK(delta.bytes_programmed == 0x1500 + 0x600 + 0x800);
+    CHECK(delta.words_reprogrammed == 0);
+    for(const auto &r : regions)
+        CHECK(holds(target, r));
+    // the gap between a and b is erased flash
+    CHECK(target.get_flash()[0x1500] == 0xFF && target.get_flash()[0x15FF] == 0xFF);
+
+    // nothing changed
+    CHECK(flash(target, regions, false, delta, log));
+    CHECK(log.find("Already up-to-date") != std::string::npos);
+    CHECK(delta.sectors_erased == 0 && delta.bytes_programmed == 0);
+
+    // c alone
+    regions[2].data = BSLCheck::random_bytes(0x800, 4);
+    CHECK(flash(target, regions, false, delta, log));
+    CHECK(delta.sectors_erased == 2);
+    CHECK(delta.bytes_programmed == 0x800);
+    CHECK(holds(target, regions[2]));
+
+    // b changes, the erase of sector 5 takes a along
+    regions[1].data = BSLCheck::random_bytes(0x600, 5);
+    CHECK(flash(target, regions, false, delta, log));
+    CHECK(delta.sectors_erased == 7);
+    CHECK(delta.bytes_programmed == 0x1500 + 0x600);
+    CHECK(delta.words_reprogrammed == 0);
+    for(const auto &r : regions)
+        CHECK(holds(target, r));
+}
+
+// a region covering part of a sector: the rest of the sector is written back after the erase
+static void test_partial_sector()
+{
+    BSLTarget target;
+    BSLTarget::_counters delta;
+    std::string log;
+    const BSLRegion::_region old_data = region(0x4000, BSLCheck::random_bytes(0x400, 6), "old");
+    CHECK(flash(target, {old_data}, true, delta, log));
+
+    std::vector<BSLRegion::_region> regions = {region(0x4100, BSLCheck::random_bytes(0x100, 7), "new")};
+    CHECK(BSLRegion::prepare(regions));
+    CHECK(flash(target, regions, false, delta, log));
+    CHECK(delta.sectors_erased == 1);
+    CHECK(delta.bytes_programmed == 0x400);
+    CHECK(holds(target, regions[0]));
+    const auto &memory = target.get_flash();
+    CHECK(!memcmp(memory.data() + 0x4000, old_data.data.data(), 0x100));
+    CHECK(!memcmp(memory.data() + 0x4200, old_data.data.data() + 0x200, 0x200));
+
+    // erased flash around a region is left erased, nothing to program back
+    BSLTarget blank;
+    CHECK(flash(blank, regions, true, delta, log));
+    CHECK(delta.sectors_erased == 1 && delta.bytes_programmed == 0x100);
+}
+
+int main()
+{
+    if(!tmp.ok())
+        return 1;
+
+    test_hex();
+    test_hex_errors();
+    test_prepare();
+    test_flash_regions();
+    test_partial_sector();
+
+    return BSLCheck::report();
+}
@@ -0,0 +1,218 @@
+/*
+ * test_response_parser.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Response stream parsing: noise in front of a response is skipped, a header
+ * with a length no response can have is resynchronized past, a failed CRC is
+ * reported and the length bounds hold.
+ */
+
+#include "bsl_check.h"
+#include "bsl_packet.h"
+#include "bsl_stats.h"
+#include "bsl_uart.h"
+#include <cstring>
+
+// answers every command with the bytes of the script, a read past its end times out
+class ScriptedTransport : public Transport {
+    public:
+        ScriptedTransport(const std::vector<uint8_t> &_script) : script(_script) {}
+
+        bool _open(speed_t = B9600) override { return true; }
+        int _close() override { return 0; }
+        void _flush() override { drop_staged(); }
+        bool set_baud(speed_t) override { return true; }
+        int readBytes(char buff[], size_t buf_size, int) override
+        {
+            const size_t n = std::min(buf_size, script.size() - pos);
+            memcpy(buff, script.data() + pos, n);
+            pos += n;
+            return n == buf_size ? (int) n : -1;
+        }
+        int writeBytes(const char[], size_t buf_size) override { return buf_size; }
+
+        size_t left() const { return script.size() - pos; }
+
+    private:
+        std::vector<uint8_t> script;
+        size_t pos = 0;
+};
+
+static void append(std::vector<uint8_t> &v, std::initializer_list<uint8_t> bytes)
+{
+    v.insert(v.end(), bytes);
+}
+
+// header, length, code, data and CRC as the BSL sends them
+static void append_response(std::vector<uint8_t> &v, BSL::CoreResponse code, const std::vector<uint8_t> &data, bool good_crc=true)
+{
+    const uint16_t core_len = 1 + data.size();
+    std::vector<uint8_t> core = {static_cast<uint8_t>(code)};
+    core.insert(core.end(), data.begin(), data.end());
+    uint32_t crc = BSL::softwareCRC(core.data(), core.size());
+    if(!good_crc)
+        crc ^= 1;
+
+    append(v, {BSL::RSP_HEADER, (uint8_t) (core_len & 0xFF), (uint8_t) (core_len >> 8)});
+    v.insert(v.end(), core.begin(), core.end());
+    v.insert(v.end(), (uint8_t*) &crc, (uint8_t*) &crc + 4);
+}
+
+static std::vector<uint8_t> device_info_data()
+{
+    std::vector<uint8_t> d(24, 0);
+    d[0] = 0x01;                // cmd_interpreter_version
+    d[10] = 0xC0;               // bsl_max_buff_size 0x06C0
+    d[11] = 0x06;
+    d[16] = 0x42;               // bcr_conf_id
+    return d;
+}
+
+static uint64_t counter(const BSLStats &stats, const char* name)
+{
+    const auto counters = stats.counters();
+    auto it = counters.find(name);
+    return it == counters.end() ? 0 : it->second;
+}
+
+// runs GetDeviceInfo against script, the returned ACK is the parser's verdict
+static BSL::AckType device_info(const std::vector<uint8_t> &script, BSLStats &stats, BSL::_device_info &info, size_t &left)
+{
+    auto* transport = new ScriptedTransport(script);
+    BSL_UART uart(transport);
+    uart.set_stats(&stats);
+    BSL::AckType ack;
+    std::tie(ack, info) = uart.get_device_info();
+    left = transport->left();
+    return ack;
+}
+
+static void test_clean()
+{
+    std::vector<uint8_t> script = {static_cast<uint8_t>(BSL::AckType::BSL_ACK)};
+    append_response(script, BSL::CoreResponse::GetDeviceInfo, device_info_data());
+
+    BSLStats stats;
+    BSL::_device_info info;
+    size_t left;
+    CHECK(device_info(script, stats, info, left) == BSL::AckType::BSL_ACK);
+    CHECK(info.cmd_interpreter_version == 1 && info.bsl_max_buff_size == 0x06C0 && info.bcr_conf_id == 0x42);
+    CHECK(left == 0);
+    CHECK(counter(stats, "rx_skipped_bytes") == 0);
+    CHECK(counter(stats, "rx_crc_errors") == 0);
+}
+
+// line noise between the ACK and the response header
+static void test_noise()
+{
+    std::vector<uint8_t> script = {static_cast<uint8_t>(BSL::AckType::BSL_ACK)};
+    append(script, {0x00, 0xFF, 0x51, 0x3A});
+    append_response(script, BSL::CoreResponse::GetDeviceInfo, device_info_data());
+
+    BSLStats stats;
+    BSL::_device_info info;
+    size_t left;
+    CHECK(device_info(script, stats, info, left) == BSL::AckType::BSL_ACK);
+    CHECK(info.bsl_max_buff_size == 0x06C0);
+    CHECK(counter(stats, "rx_skipped_bytes") == 4);
+}
+
+// a header byte in the noise whose length is 0 or above any response: resync one byte on
+static void test_bad_length()
+{
+    for(uint16_t bad_len : {(uint16_t) 0, (uint16_t) 0x1001, (uint16_t) 0xFFFF}) {
+        std::vector<uint8_t> script = {static_cast<uint8_t>(BSL::AckType::BSL_ACK)};
+        append(script, {BSL::RSP_HEADER, (uint8_t) (bad_len & 0xFF), (uint8_t) (bad_len >> 8)});
+        append_response(script, BSL::CoreResponse::GetDeviceInfo, device_info_data());
+
+        BSLStats stats;
+        BSL::_device_info info;
+        size_t left;
+        CHECK(device_info(script, stats, info, left) == BSL::AckType::BSL_ACK);
+        CHECK(info.bsl_max_buff_size == 0x06C0);
+        CHECK(counter(stats, "rx_skipped_bytes") == 3);
+        CHECK(left == 0);
+    }
+}
+
+// the whole packet is consumed, the next response starts clean
+static void test_crc_error()
+{
+    std::vector<uint8_t> script = {static_cast<uint8_t>(BSL::AckType::BSL_ACK)};
+    append_response(script, BSL::CoreResponse::GetDeviceInfo, device_info_data(), false);
+
+    BSLStats stats;
+    BSL::_device_info info;
+    size_t left;
+    CHECK(device_info(script, stats, info, left) == BSL::AckType::ERR_RX_CHECKSUM);
+    CHECK(counter(stats, "rx_crc_errors") == 1);
+    CHECK(left == 0);
+}
+
+// a response cut short is a timeout, not a packet
+static void test_truncated()
+{
+    std::vector<uint8_t> script = {static_cast<uint8_t>(BSL::AckType::BSL_ACK)};
+    append_response(script, BSL::CoreResponse::GetDeviceInfo, device_info_data());
+    script.resize(script.size() - 2);
+
+    BSLStats stats;
+    BSL::_device_info info;
+    size_t left;
+    CHECK(device_info(script, stats, info, left) == BSL::AckType::ERR_TIMEOUT);
+}
+
+// the longest response the parser takes, MemoryRead of max_response_len - 1 bytes
+static void test_max_length()
+{
+    const uint32_t len = 0x1000 - 1;
+    std::vector<uint8_t> data(len);
+    for(uint32_t i = 0; i < len; i++)
+        data[i] = i * 7;
+
+    std::vector<uint8_t> script = {static_cast<uint8_t>(BSL::AckType::BSL_ACK)};
+    append_response(script, BSL::CoreResponse::MemoryRead, data);
+
+    BSL_UART uart(new ScriptedTransport(script));
+    std::vector<uint8_t> dst(len);
+    auto [ack, msg] = uart.readback_data(0x0, len, dst.data());
+    CHECK(ack == BSL::AckType::BSL_ACK && msg == BSL::CoreMessage::SUCCESS);
+    CHECK(dst == data);
+}
+
+// the packet helpers the stream parser frames with
+static void test_parse_response()
+{
+    std::vector<uint8_t> p;
+    append_response(p, BSL::CoreResponse::Message, {static_cast<uint8_t>(BSL::CoreMessage::SUCCESS)});
+
+    BSL::_response_view rsp;
+    CHECK(BSL::parse_response(p.data(), p.size(), rsp));
+    CHECK(rsp.code == BSL::CoreResponse::Message && rsp.data_len == 1 && rsp.crc_ok);
+    CHECK(!BSL::parse_response(p.data(), p.size() - 1, rsp));
+    CHECK(!BSL::parse_response(p.data(), BSL::packet_len(1) - 1, rsp));
+
+    std::vector<uint8_t> wrong_header = p;
+    wrong_header[0] = BSL::CMD_HEADER;
+    CHECK(!BSL::parse_response(wrong_header.data(), wrong_header.size(), rsp));
+
+    std::vector<uint8_t> flipped = p;
+    flipped[BSL::header_len + 1] ^= 0x10;
+    CHECK(BSL::parse_response(flipped.data(), flipped.size(), rsp));
+    CHECK(!rsp.crc_ok);
+}
+
+int main()
+{
+    test_clean();
+    test_noise();
+    test_bad_length();
+    test_crc_error();
+    test_truncated();
+    test_max_length();
+    test_parse_response();
+
+    return BSLCheck::report();
+}
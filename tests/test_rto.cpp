@@ -0,0 +1,180 @@
+/*
+ * test_rto.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Response timeout estimator: RFC 6298 updates of the smoothed time and its
+ * variation, doubling per timeout until the next answer, the clamp to
+ * [min_timeout_us, max_timeout_us], the estimates kept per port, and a read
+ * whose answer takes long on the wire teaching it the device's time only.
+ */
+
+#include "bsl_check.h"
+#include "bsl_rto.h"
+#include "bsl_uart.h"
+#include "loopback_transport.h"
+#include <unistd.h>
+
+using BSL::CoreCmd;
+
+static void test_unknown()
+{
+    BSLRto rto;
+    CHECK(!rto.known(CoreCmd::ProgramData));
+    CHECK(rto.timeout_us(CoreCmd::ProgramData) == BSLRto::max_timeout_us);
+
+    // no estimate to back off from
+    rto.timed_out(CoreCmd::ProgramData);
+    CHECK(!rto.known(CoreCmd::ProgramData));
+    CHECK(rto.timeout_us(CoreCmd::ProgramData) == BSLRto::max_timeout_us);
+}
+
+static void test_update()
+{
+    BSLRto rto;
+
+    // first answer: srtt 100ms, rttvar 50ms
+    rto.sample(CoreCmd::ProgramData, 100000);
+    CHECK(rto.known(CoreCmd::ProgramData));
+    CHECK(rto.timeout_us(CoreCmd::ProgramData) == 100000 + 4 * 50000);
+
+    // srtt 7/8 old + 1/8 new = 95ms, rttvar 3/4 old + 1/4 |delta| = 47.5ms
+    rto.sample(CoreCmd::ProgramData, 60000);
+    CHECK(rto.timeout_us(CoreCmd::ProgramData) == 95000 + 4 * 47500);
+
+    // per command
+    CHECK(!rto.known(CoreCmd::MemoryRead));
+}
+
+// a steady command loses its variance but keeps twice its usual time
+static void test_steady()
+{
+    BSLRto rto;
+    for(int i = 0; i < 50; i++)
+        rto.sample(CoreCmd::FlashRangeErase, 100000);
+    CHECK(rto.timeout_us(CoreCmd::FlashRangeErase) == 2 * 100000);
+}
+
+static void test_backoff()
+{
+    BSLRto rto;
+    rto.sample(CoreCmd::ProgramData, 100000);
+    const uint32_t base = rto.timeout_us(CoreCmd::ProgramData);
+
+    rto.timed_out(CoreCmd::ProgramData);
+    CHECK(rto.timeout_us(CoreCmd::ProgramData) == 2 * base);
+    rto.timed_out(CoreCmd::ProgramData);
+    CHECK(rto.timeout_us(CoreCmd::ProgramData) == 4 * base);
+
+    // other commands keep theirs
+    rto.sample(CoreCmd::MemoryRead, 100000);
+    CHECK(rto.timeout_us(CoreCmd::MemoryRead) == base);
+
+    // the next answer ends the backoff
+    rto.sample(CoreCmd::ProgramData, 100000);
+    CHECK(rto.timeout_us(CoreCmd::ProgramData) < 2 * base);
+}
+
+static void test_clamp()
+{
+    BSLRto rto;
+
+    // a USB round trip of 1ms still waits min_timeout_us
+    rto.sample(CoreCmd::GetDeviceInfo, 1000);
+    CHECK(rto.timeout_us(CoreCmd::GetDeviceInfo) == BSLRto::min_timeout_us);
+
+    // the backoff doubles at most 8 times: 3ms << 8
+    for(int i = 0; i < 20; i++)
+        rto.timed_out(CoreCmd::GetDeviceInfo);
+    CHECK(rto.timeout_us(CoreCmd::GetDeviceInfo) == (1000 + 2 * 1000) << 8);
+
+    rto.sample(CoreCmd::MassErase, 4000000);
+    CHECK(rto.timeout_us(CoreCmd::MassErase) == BSLRto::max_timeout_us);
+    rto.sample(CoreCmd::ProgramData, 400000);
+    for(int i = 0; i < 20; i++)
+        rto.timed_out(CoreCmd::ProgramData);
+    CHECK(rto.timeout_us(CoreCmd::ProgramData) == BSLRto::max_timeout_us);
+}
+
+// estimates are kept per port, the backoff is not
+static void test_store_load()
+{
+    BSLRto rto;
+    rto.sample(CoreCmd::ProgramData, 100000);
+    rto.sample(CoreCmd::ProgramData, 60000);
+    rto.sample(CoreCmd::MemoryRead, 20000);
+    rto.timed_out(CoreCmd::ProgramData);
+    CHECK(rto.store("/dev/ttyTEST0"));
+
+    BSLRto loaded;
+    CHECK(loaded.load("/dev/ttyTEST0"));
+    CHECK(loaded.known(CoreCmd::ProgramData) && loaded.known(CoreCmd::MemoryRead));
+    CHECK(loaded.timeout_us(CoreCmd::ProgramData) == 95000 + 4 * 47500);
+    CHECK(loaded.timeout_us(CoreCmd::MemoryRead) == rto.timeout_us(CoreCmd::MemoryRead));
+
+    BSLRto other;
+    CHECK(!other.load("/dev/ttyTEST1"));
+    CHECK(!other.known(CoreCmd::ProgramData));
+}
+
+// the device answers at once, its answer takes the line's time to arrive
+class WireLoopback : public LoopbackTransport {
+    public:
+        WireLoopback(BSLTarget &target, uint32_t _baud) : LoopbackTransport(target), baud(_baud) {}
+
+        int commit(size_t len) override
+        {
+            const size_t before = pending();
+            const int n = LoopbackTransport::commit(len);
+            owed_us += (pending() - before) * 10 * 1000000ULL / baud;
+            return n;
+        }
+
+        const uint8_t* peek(size_t len, int max_timeout_tries) override
+        {
+            if(owed_us > 0) {
+                usleep(owed_us);
+                owed_us = 0;
+            }
+            return LoopbackTransport::peek(len, max_timeout_tries);
+        }
+
+    private:
+        uint32_t baud;
+        uint64_t owed_us = 0;
+};
+
+// 256 bytes read back at 9600 baud are 280ms on the wire, the device takes no time
+static void test_payload_wire()
+{
+    BSLTarget target;
+    BSL_UART uart(new WireLoopback(target, 9600));
+    CHECK(uart.connect() == BSL::AckType::BSL_ACK);
+    CHECK(std::get<1>(uart.unlock_bootloader()) == BSL::CoreMessage::SUCCESS);
+
+    std::vector<uint8_t> dst(256);
+    for(int i = 0; i < 3; i++)
+        CHECK(std::get<1>(uart.readback_data(0x0, dst.size(), dst.data())) == BSL::CoreMessage::SUCCESS);
+    CHECK(uart.get_rto().known(CoreCmd::MemoryRead));
+    CHECK(uart.get_rto().timeout_us(CoreCmd::MemoryRead) == BSLRto::min_timeout_us);
+}
+
+int main()
+{
+    // estimates stay out of the user's state directory
+    BSLCheck::TempDir state("test_rto");
+    if(!state.ok())
+        return 1;
+    state.set_state_home();
+
+    test_unknown();
+    test_update();
+    test_steady();
+    test_backoff();
+    test_clamp();
+    test_store_load();
+    test_payload_wire();
+
+    return BSLCheck::report();
+}
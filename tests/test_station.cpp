@@ -0,0 +1,90 @@
+/*
+ * test_station.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Production station: a port appearing in a watched directory is flashed and
+ * its result posted, a board swapped while the last one is still being
+ * flashed is flashed next.
+ */
+
+#include "bsl_check.h"
+#include "bsl_station.h"
+#include "pty_target.h"
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <pthread.h>
+
+static BSLCheck::TempDir tmp("test_station");
+
+static std::vector<std::string> result_lines(const std::string &path)
+{
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    for(std::string line; std::getline(in, line); )
+        lines.push_back(line);
+    return lines;
+}
+
+// until count results are posted, at most timeout_ms
+static std::vector<std::string> wait_results(const std::string &path, size_t count, int timeout_ms)
+{
+    std::vector<std::string> lines;
+    for(int waited = 0; (lines = result_lines(path)).size() < count && waited < timeout_ms; waited += 50)
+        usleep(50000);
+    return lines;
+}
+
+static void test_reattach(const std::string &image_path)
+{
+    PtyTarget pty;
+    BSLStation::_config cfg;
+    cfg.image = image_path;
+    cfg.filters = {tmp.file("port*")};
+    cfg.entry_method = BSL_Entry::Method::None;
+    cfg.present = false;
+    cfg.force = true;
+    cfg.settle_ms = 300;
+    cfg.results_file = tmp.file("results.ndjson");
+
+    BSLStation station(cfg);
+    std::atomic<bool> ok{false};
+    std::thread thread([&]() { ok = station.run(); });
+    usleep(200000);
+
+    // the board, swapped for the next one while its worker still waits for the node to settle
+    const std::string port = tmp.file("port0");
+    CHECK(symlink(pty.path.c_str(), port.c_str()) == 0);
+    usleep(100000);
+    CHECK(unlink(port.c_str()) == 0);
+    CHECK(symlink(pty.path.c_str(), port.c_str()) == 0);
+
+    const auto lines = wait_results(cfg.results_file, 2, 20000);
+    CHECK(lines.size() == 2);
+    for(const std::string &line : lines)
+        CHECK(line.find("\"port\":\"" + port + "\",\"ok\":true") != std::string::npos);
+    CHECK(pty.counters().bytes_programmed == 2 * 4096);
+
+    pthread_kill(thread.native_handle(), SIGTERM);
+    thread.join();
+    CHECK(ok);
+}
+
+int main()
+{
+    if(!tmp.ok())
+        return 1;
+    tmp.set_state_home();
+
+    // the version the station prints at 0xC0
+    auto image = BSLCheck::random_bytes(4096, 1);
+    std::fill(image.begin() + 0xC0, image.begin() + 0xC0 + 51, 0);
+    memcpy(image.data() + 0xC0, "1.0.0", 5);
+    const std::string image_path = tmp.write_file("fw.bin", image);
+    test_reattach(image_path);
+
+    return BSLCheck::report();
+}
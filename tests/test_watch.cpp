@@ -0,0 +1,120 @@
+/*
+ * test_watch.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonas Rockstroh
+ *
+ * Watch mode: an image written in bursts shorter than quiet_ms is flashed once
+ * it is complete, never half written, only its changed sector is programmed,
+ * and an image touched without a change is left alone.
+ */
+
+#include "bsl_check.h"
+#include "bsl_log.h"
+#include "bsl_watch.h"
+#include "pty_target.h"
+#include <csignal>
+#include <fcntl.h>
+#include <mutex>
+#include <pthread.h>
+
+static BSLCheck::TempDir tmp("test_watch");
+
+// output of the watch thread
+static std::mutex log_lock;
+static std::string log_text;
+
+static size_t count(const std::string &what)
+{
+    std::lock_guard<std::mutex> guard(log_lock);
+    size_t n = 0;
+    for(size_t pos = log_text.find(what); pos != std::string::npos; pos = log_text.find(what, pos + 1))
+        n++;
+    return n;
+}
+
+static bool wait_for(const std::string &what, size_t n, int timeout_ms)
+{
+    for(int waited = 0; count(what) < n && waited < timeout_ms; waited += 50)
+        usleep(50000);
+    return count(what) >= n;
+}
+
+// the image in pieces, pause_ms apart, as a slow linker writes it
+static void write_slowly(const std::string &path, const std::vector<uint8_t> &data, size_t piece, int pause_ms)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CHECK(fd >= 0);
+    for(size_t pos = 0; pos < data.size(); pos += piece) {
+        const size_t n = std::min(piece, data.size() - pos);
+        CHECK(write(fd, data.data() + pos, n) == (ssize_t) n);
+        usleep(pause_ms * 1000);
+    }
+    close(fd);
+}
+
+static void test_debounce()
+{
+    auto image = BSLCheck::random_bytes(4096, 1);
+    const std::string path = tmp.write_file("fw.bin", image);
+
+    PtyTarget pty;
+    BSLWatch::_config cfg;
+    cfg.port = pty.path;
+    cfg.image = path;
+    cfg.entry_method = BSL_Entry::Method::None;
+    cfg.start = false;
+    cfg.quiet_ms = 300;
+
+    BSLWatch watch(cfg);
+    std::atomic<bool> ok{false};
+    std::thread thread([&]() {
+        BSLLog::Redirect capture([](const char* text) {
+            std::lock_guard<std::mutex> guard(log_lock);
+            log_text += text;
+        });
+        ok = watch.run();
+    });
+
+    // the first build goes in full
+    CHECK(wait_for("Watching", 1, 10000));
+    CHECK(count("Updated in") == 1);
+    const uint64_t programmed = pty.counters().bytes_programmed;
+    CHECK(programmed == image.size());
+
+    // a rebuild changing sector 2, written in eight bursts 50 ms apart
+    for(size_t i = 2048; i < 3072; i++)
+        image[i] ^= 0x5A;
+    write_slowly(path, image, 512, 50);
+    CHECK(wait_for("Updated in", 2, 10000));
+    // once, with the whole image
+    CHECK(count("fw.bin changed, ") == 1);
+    CHECK(count("fw.bin changed, 4096 bytes") == 1);
+    CHECK(count(">> 1 of 4 sectors changed") == 1);
+    CHECK(pty.counters().bytes_programmed == programmed + 1024);
+    const auto flash = pty.flash();
+    CHECK(!memcmp(flash.data(), image.data(), image.size()));
+
+    // touched, not rebuilt
+    tmp.write_file("fw.bin", image);
+    usleep(cfg.quiet_ms * 1000 + 500000);
+    CHECK(count("Updated in") == 2);
+    CHECK(pty.counters().bytes_programmed == programmed + 1024);
+
+    pthread_kill(thread.native_handle(), SIGTERM);
+    thread.join();
+    CHECK(ok);
+    if(BSLCheck::failures > 0)
+        printf("%s", log_text.c_str());
+}
+
+int main()
+{
+    if(!tmp.ok())
+        return 1;
+    tmp.set_state_home();
+
+    test_debounce();
+
+    return BSLCheck::report();
+}